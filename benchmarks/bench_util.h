@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "api.h"
+
+/// Shared data generators for the benchmarks. Every generator is seeded explicitly, so that runs before and after a
+/// change see exactly the same inputs.
+namespace froaring::bench {
+
+constexpr uint64_t DefaultSeed = 20240601;
+
+enum class Distribution { Uniform, Clustered, Zipfian, Runs };
+
+inline const char* distribution_name(Distribution d) {
+    switch (d) {
+        case Distribution::Uniform:
+            return "uniform";
+        case Distribution::Clustered:
+            return "clustered";
+        case Distribution::Zipfian:
+            return "zipfian";
+        case Distribution::Runs:
+            return "runs";
+    }
+    return "?";
+}
+
+inline const char* type_name(CTy t) {
+    switch (t) {
+        case CTy::Array:
+            return "array";
+        case CTy::Bitmap:
+            return "bitmap";
+        case CTy::RLE:
+            return "rle";
+        case CTy::Full:
+            return "full";
+        case CTy::PackedArray:
+            return "packed";
+        case CTy::Cold:
+            return "cold";
+        default:
+            return "?";
+    }
+}
+
+/// @brief Draw `count` values (duplicates allowed) from [0, universe).
+/// - Uniform: independent uniform draws.
+/// - Clustered: uniform draws inside a few hot windows of 4096 values.
+/// - Zipfian: value v is drawn with probability proportional to 1 / (v + 1), so low values are dense and the tail
+///   is sparse.
+/// - Runs: runs of 1..64 consecutive values starting at uniform positions.
+inline std::vector<uint64_t> generate(Distribution d, size_t count, uint64_t universe, uint64_t seed = DefaultSeed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> out;
+    out.reserve(count);
+    switch (d) {
+        case Distribution::Uniform: {
+            std::uniform_int_distribution<uint64_t> dist(0, universe - 1);
+            while (out.size() < count) out.push_back(dist(rng));
+            break;
+        }
+        case Distribution::Clustered: {
+            constexpr uint64_t Window = 4096;
+            std::vector<uint64_t> hot(16);
+            for (auto& h : hot) h = rng() % std::max<uint64_t>(universe - Window, 1);
+            while (out.size() < count) out.push_back(std::min(hot[rng() % hot.size()] + rng() % Window, universe - 1));
+            break;
+        }
+        case Distribution::Zipfian: {
+            // Inverse transform of the continuous approximation: P(v <= x) ~ log(x + 1) / log(universe + 1)
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            const double log_universe = std::log(static_cast<double>(universe) + 1.0);
+            while (out.size() < count) {
+                double x = std::exp(dist(rng) * log_universe) - 1.0;
+                out.push_back(std::min(static_cast<uint64_t>(x), universe - 1));
+            }
+            break;
+        }
+        case Distribution::Runs: {
+            while (out.size() < count) {
+                uint64_t start = rng() % universe;
+                for (uint64_t len = 1 + rng() % 64; len > 0 && start < universe && out.size() < count; --len) {
+                    out.push_back(start++);
+                }
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+/// @brief Sorted, distinct values of a single container: `cardinality` values in runs of `run_length`, spread
+/// uniformly over [0, universe).
+inline std::vector<uint64_t> container_values(size_t cardinality, size_t run_length, size_t universe,
+                                              uint64_t seed = DefaultSeed) {
+    std::mt19937_64 rng(seed);
+    cardinality = std::min(cardinality, universe);
+    run_length = std::max<size_t>(run_length, 1);
+    std::set<uint64_t> values;
+    while (values.size() < cardinality) {
+        uint64_t start = rng() % universe;
+        for (size_t i = 0; i < run_length && start + i < universe && values.size() < cardinality; ++i) {
+            values.insert(start + i);
+        }
+    }
+    return {values.begin(), values.end()};
+}
+
+/// @brief Remove `--<name>` or `--<name>=<value>` from the command line, so that Google Benchmark does not report it
+/// as unrecognized.
+/// @return The value (empty for `--<name>`), or nothing if the flag is absent.
+inline std::optional<std::string> take_flag(int& argc, char** argv, const char* name) {
+    std::optional<std::string> value;
+    const size_t len = std::strlen(name);
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--", 2) == 0 && std::strncmp(arg + 2, name, len) == 0 &&
+            (arg[2 + len] == '\0' || arg[2 + len] == '=')) {
+            value = arg[2 + len] == '=' ? std::string(arg + 3 + len) : std::string();
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    return value;
+}
+
+template <typename WordType, size_t DataBits>
+froaring_container_t* make_container(const std::vector<uint64_t>& values, CTy type) {
+    switch (type) {
+        case CTy::Array: {
+            auto* c = new ArrayContainer<WordType, DataBits>(values.size());
+            for (auto v : values) c->set(v);
+            return c;
+        }
+        case CTy::Bitmap: {
+            auto* c = new BitmapContainer<WordType, DataBits>();
+            for (auto v : values) c->set(v);
+            return c;
+        }
+        case CTy::RLE: {
+            auto* c = new RLEContainer<WordType, DataBits>();
+            for (auto v : values) c->set(v);
+            return c;
+        }
+        case CTy::Full:  // `values` must be the whole universe
+            return full_container();
+        case CTy::PackedArray: {
+            ArrayContainer<WordType, DataBits> a(values.size());
+            for (auto v : values) a.set(v);
+            return new PackedArrayContainer<WordType, DataBits>(&a);
+        }
+        case CTy::Cold: {
+            ArrayContainer<WordType, DataBits> a(values.size());
+            for (auto v : values) a.set(v);
+            return new ColdContainer<WordType, DataBits>(&a);
+        }
+        default:
+            return nullptr;
+    }
+}
+
+}  // namespace froaring::bench
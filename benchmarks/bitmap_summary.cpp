@@ -0,0 +1,135 @@
+// Bitmap containers of 16 and 20 data bits whose set bits fall in a fraction of their words, as in containers that
+// are dense in places only. Benchmark names read: <op>/<data bits>/<percent of non-empty words>, e.g. and/20/3.
+// Compare a default build, where these geometries keep a summary of the non-empty words, against one configured with
+// -DCMAKE_CXX_FLAGS=-DFROARING_BITMAP_SUMMARY_MIN_BITS=64, which scans every word.
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+using WordType = uint64_t;
+
+enum class Op { And, Or, AndRLE, OrRLE, Intersects, Iterate, Rank };
+
+/// Values in one word out of `stride`, 16 per word; words offset by `shift` strides from those of shift 0.
+template <size_t DataBits>
+BitmapContainer<WordType, DataBits>* make_bitmap(size_t stride, size_t shift, uint64_t seed) {
+    using Bitmap = BitmapContainer<WordType, DataBits>;
+    std::mt19937_64 rng(seed);
+    auto c = new Bitmap();
+    for (size_t w = shift % stride; w < Bitmap::WordsCount; w += stride) {
+        for (int i = 0; i < 16; ++i) {
+            c->set(static_cast<typename Bitmap::NumType>(w * Bitmap::BitsPerWord + rng() % Bitmap::BitsPerWord));
+        }
+    }
+    return c;
+}
+
+/// One 32-value run in each of the words `make_bitmap(stride, shift, ...)` fills.
+template <size_t DataBits>
+RLEContainer<WordType, DataBits>* make_rle(size_t stride, size_t shift) {
+    using Bitmap = BitmapContainer<WordType, DataBits>;
+    auto c = new RLEContainer<WordType, DataBits>();
+    for (size_t w = shift % stride; w < Bitmap::WordsCount; w += stride) {
+        for (size_t i = 16; i < 48; ++i) {
+            c->set(static_cast<typename Bitmap::NumType>(w * Bitmap::BitsPerWord + i));
+        }
+    }
+    return c;
+}
+
+template <size_t DataBits>
+void run(benchmark::State& state, Op op, size_t stride) {
+    using Bitmap = BitmapContainer<WordType, DataBits>;
+    auto* a = make_bitmap<DataBits>(stride, 0, DefaultSeed);
+    // Shares half of its words with `a` for and/or, none for intersects (which then scans to the end)
+    auto* b = make_bitmap<DataBits>(op == Op::Intersects ? stride : 2 * stride, op == Op::Intersects, DefaultSeed + 1);
+    auto* rle = make_rle<DataBits>(2 * stride, 0);
+    const auto queries = generate(Distribution::Uniform, 64, Bitmap::TotalBits);
+    std::vector<uint64_t> out(a->cardinality());
+    CTy rt;
+    for (auto _ : state) {
+        switch (op) {
+            case Op::And:
+            case Op::Or: {
+                auto* r = op == Op::And ? froaring_and<WordType, DataBits>(a, b, CTy::Bitmap, CTy::Bitmap, rt)
+                                        : froaring_or<WordType, DataBits>(a, b, CTy::Bitmap, CTy::Bitmap, rt);
+                benchmark::DoNotOptimize(r);
+                release_container<WordType, DataBits>(r, rt);
+                break;
+            }
+            case Op::AndRLE:
+            case Op::OrRLE: {
+                auto* r = op == Op::AndRLE ? froaring_and<WordType, DataBits>(a, rle, CTy::Bitmap, CTy::RLE, rt)
+                                           : froaring_or<WordType, DataBits>(a, rle, CTy::Bitmap, CTy::RLE, rt);
+                benchmark::DoNotOptimize(r);
+                release_container<WordType, DataBits>(r, rt);
+                break;
+            }
+            case Op::Intersects:
+                benchmark::DoNotOptimize(froaring_intersects<WordType, DataBits>(a, b, CTy::Bitmap, CTy::Bitmap));
+                break;
+            case Op::Iterate:
+                benchmark::DoNotOptimize(a->take_first(out.size(), uint64_t(0), out.data()));
+                break;
+            case Op::Rank: {
+                size_t sum = 0;
+                for (auto q : queries) sum += a->rank(static_cast<typename Bitmap::NumType>(q));
+                benchmark::DoNotOptimize(sum);
+                break;
+            }
+        }
+    }
+    state.counters["summary"] = Bitmap::HasSummary;
+    delete a;
+    delete b;
+    delete rle;
+}
+
+struct OpInfo {
+    Op op;
+    const char* name;
+};
+constexpr OpInfo AllOps[] = {
+    {Op::And, "and"},
+    {Op::Or, "or"},
+    {Op::AndRLE, "and_rle"},  // one run per word of b: the kernel applies each run as a range
+    {Op::OrRLE, "or_rle"},
+    {Op::Intersects, "intersects"},  // disjoint: no early exit
+    {Op::Iterate, "iterate"},        // every value, in order
+    {Op::Rank, "rank"},              // 64 ranks
+};
+
+template <size_t DataBits>
+void register_all() {
+    for (const auto& info : AllOps) {
+        for (size_t stride : {size_t(1), size_t(8), size_t(32)}) {
+            std::string name =
+                std::string(info.name) + "/" + std::to_string(DataBits) + "/" + std::to_string(100 / stride);
+            benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) {
+                run<DataBits>(state, info.op, stride);
+            });
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    register_all<16>();
+    register_all<20>();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Array containers (16 data bits) stored as a plain ArrayContainer or compressed into a ColdContainer. Benchmark names
+// read: <op>/<type>/<cardinality>, e.g. and_small/cold/4000. Every benchmark reports the container size in bytes as
+// the `bytes` counter.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+using WordType = uint64_t;
+constexpr size_t DataBits = 16;
+constexpr size_t Universe = size_t(1) << DataBits;
+
+enum class Op { Test, AndSmall, And, Or, Decode };
+
+void run(benchmark::State& state, Op op, CTy type, size_t card) {
+    auto* c = make_container<WordType, DataBits>(container_values(card, 1, Universe), type);
+    // A few values in the lowest 1/32 of the range, or as many values as `c` spread over all of it
+    auto* other = op == Op::AndSmall
+                      ? make_container<WordType, DataBits>(container_values(32, 1, Universe / 32, DefaultSeed + 1),
+                                                           CTy::Array)
+                      : make_container<WordType, DataBits>(container_values(card, 1, Universe, DefaultSeed + 1),
+                                                           CTy::Array);
+    const auto queries = generate(Distribution::Uniform, 1024, Universe);
+    std::vector<uint64_t> out(card);
+    std::vector<uint8_t> found(queries.size());
+    CTy rt;
+    for (auto _ : state) {
+        switch (op) {
+            case Op::Test:
+                container_test_many<WordType, DataBits>(c, type, queries.data(), queries.size(), found.data());
+                benchmark::DoNotOptimize(found.data());
+                break;
+            case Op::AndSmall:
+            case Op::And:
+            case Op::Or: {
+                auto* r = op == Op::Or ? froaring_or<WordType, DataBits>(c, other, type, CTy::Array, rt)
+                                       : froaring_and<WordType, DataBits>(c, other, type, CTy::Array, rt);
+                benchmark::DoNotOptimize(r);
+                release_container<WordType, DataBits>(r, rt);
+                break;
+            }
+            case Op::Decode:
+                benchmark::DoNotOptimize(
+                    container_take_first<WordType, DataBits>(c, type, card, uint64_t(0), out.data()));
+                break;
+        }
+    }
+    state.counters["bytes"] = double(container_memory_usage<WordType, DataBits>(c, type));
+    release_container<WordType, DataBits>(c, type);
+    release_container<WordType, DataBits>(other, CTy::Array);
+}
+
+struct OpInfo {
+    Op op;
+    const char* name;
+};
+constexpr OpInfo AllOps[] = {
+    {Op::Test, "test"},           // 1024 point lookups
+    {Op::AndSmall, "and_small"},  // with 32 values in a narrow range: most blocks are skipped
+    {Op::And, "and"},             // with an array of the same cardinality
+    {Op::Or, "or"},
+    {Op::Decode, "decode"},  // every value, in order
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+    for (const auto& info : AllOps) {
+        for (auto type : {CTy::Array, CTy::Cold}) {
+            for (size_t card : {size_t(200), size_t(1000), size_t(4000)}) {
+                std::string name = std::string(info.name) + "/" + type_name(type) + "/" + std::to_string(card);
+                benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) {
+                    run(state, info.op, type, card);
+                });
+            }
+        }
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
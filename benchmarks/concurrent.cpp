@@ -0,0 +1,56 @@
+// Writer scalability: every thread sets its own disjoint range of ids, into either one FlexibleRoaring behind a global
+// mutex or a ConcurrentFlexibleRoaring. Benchmark names read: <variant>/real_time/threads:<n>.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+
+#include "concurrent_froaring.h"
+
+using namespace froaring;
+
+namespace {
+constexpr uint64_t IdsPerThread = 1 << 16;
+
+struct GlobalMutex {
+    std::mutex mutex;
+    FlexibleRoaring<uint64_t, 16, 8> bitmap;
+    void set(uint64_t v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bitmap.set(v);
+    }
+};
+using Striped = ConcurrentFlexibleRoaring<uint64_t, 16, 8>;
+
+// Shared by the threads of a run; rebuilt by Setup before each run
+std::unique_ptr<GlobalMutex> global_mutex;
+std::unique_ptr<Striped> striped;
+
+template <typename Target>
+void bench_disjoint_writers(benchmark::State& state, std::unique_ptr<Target>& target) {
+    const uint64_t base = static_cast<uint64_t>(state.thread_index()) * IdsPerThread;
+    uint64_t next = 0;
+    for (auto _ : state) {
+        target->set(base + next);
+        next = (next + 1) % IdsPerThread;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void bench_global_mutex(benchmark::State& state) { bench_disjoint_writers(state, global_mutex); }
+void bench_striped(benchmark::State& state) { bench_disjoint_writers(state, striped); }
+}  // namespace
+
+BENCHMARK(bench_global_mutex)
+    ->Setup([](const benchmark::State&) { global_mutex = std::make_unique<GlobalMutex>(); })
+    ->Teardown([](const benchmark::State&) { global_mutex.reset(); })
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK(bench_striped)
+    ->Setup([](const benchmark::State&) { striped = std::make_unique<Striped>(); })
+    ->Teardown([](const benchmark::State&) { striped.reset(); })
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+// Every container-pair kernel, swept over cardinalities, run lengths and DataBits.
+// Benchmark names read: <op>/<DataBits>/<type a>_<type b>/<cardinality a>/<run length>, e.g. and/16/bitmap_rle/4096/8.
+// The second operand has the same run length and half the cardinality of the first one.
+// Use --benchmark_filter to run a subset, e.g. --benchmark_filter='^and/16/'.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+constexpr CTy AllTypes[] = {CTy::Array, CTy::Bitmap, CTy::RLE};
+constexpr size_t RunLengths[] = {1, 16};
+
+enum class Op { And, Or, Diff, AndInplace, OrInplace, DiffInplace, Intersects, Contains, Equal };
+
+struct OpInfo {
+    Op op;
+    const char* name;
+    bool inplace;
+};
+constexpr OpInfo AllOps[] = {
+    {Op::And, "and", false},
+    {Op::Or, "or", false},
+    {Op::Diff, "diff", false},
+    {Op::AndInplace, "and_inplace", true},
+    {Op::OrInplace, "or_inplace", true},
+    {Op::DiffInplace, "diff_inplace", true},
+    {Op::Intersects, "intersects", false},
+    {Op::Contains, "contains", false},
+    {Op::Equal, "equal", false},
+};
+
+/// In-place kernels consume their left operand, so a pool of copies is prepared outside of the timed region.
+constexpr size_t InplacePoolSize = 64;
+
+template <typename WordType, size_t DataBits>
+void run_kernel(benchmark::State& state, Op op, CTy ta, CTy tb, size_t card, size_t run_length) {
+    constexpr size_t Universe = size_t(1) << DataBits;
+    const auto values_a = container_values(card, run_length, Universe, DefaultSeed);
+    const auto values_b = container_values(card / 2 + 1, run_length, Universe, DefaultSeed + 1);
+    auto* a = make_container<WordType, DataBits>(values_a, ta);
+    auto* b = make_container<WordType, DataBits>(values_b, tb);
+    CTy rt;
+
+    switch (op) {
+        case Op::And:
+        case Op::Or:
+        case Op::Diff:
+            for (auto _ : state) {
+                froaring_container_t* r = op == Op::And  ? froaring_and<WordType, DataBits>(a, b, ta, tb, rt)
+                                          : op == Op::Or ? froaring_or<WordType, DataBits>(a, b, ta, tb, rt)
+                                                         : froaring_diff<WordType, DataBits>(a, b, ta, tb, rt);
+                benchmark::DoNotOptimize(r);
+                release_container<WordType, DataBits>(r, rt);
+            }
+            break;
+        case Op::AndInplace:
+        case Op::OrInplace:
+        case Op::DiffInplace: {
+            std::vector<froaring_container_t*> pool(InplacePoolSize, nullptr);
+            std::vector<CTy> pool_types(InplacePoolSize, ta);
+            size_t next = InplacePoolSize;
+            for (auto _ : state) {
+                if (next == InplacePoolSize) {
+                    state.PauseTiming();
+                    for (size_t i = 0; i < InplacePoolSize; ++i) {
+                        if (pool[i]) release_container<WordType, DataBits>(pool[i], pool_types[i]);
+                        pool[i] = duplicate_container<WordType, DataBits>(a, ta);
+                        pool_types[i] = ta;
+                    }
+                    next = 0;
+                    state.ResumeTiming();
+                }
+                auto* target = pool[next];
+                froaring_container_t* r =
+                    op == Op::AndInplace  ? froaring_andi<WordType, DataBits>(target, b, ta, tb, rt)
+                    : op == Op::OrInplace ? froaring_ori<WordType, DataBits>(target, b, ta, tb, rt)
+                                          : froaring_diffi<WordType, DataBits>(target, b, ta, tb, rt);
+                benchmark::DoNotOptimize(r);
+                if (r != target) {
+                    release_container<WordType, DataBits>(target, ta);
+                }
+                pool[next] = r;
+                pool_types[next] = rt;
+                ++next;
+            }
+            for (size_t i = 0; i < InplacePoolSize; ++i) {
+                if (pool[i]) release_container<WordType, DataBits>(pool[i], pool_types[i]);
+            }
+            break;
+        }
+        case Op::Intersects:
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(froaring_intersects<WordType, DataBits>(a, b, ta, tb));
+            }
+            break;
+        case Op::Contains:
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(froaring_contains<WordType, DataBits>(a, b, ta, tb));
+            }
+            break;
+        case Op::Equal: {
+            // Compare against an equal copy: the worst case, where no early exit is possible
+            auto* a_copy = make_container<WordType, DataBits>(values_a, tb);
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(froaring_equal<WordType, DataBits>(a, a_copy, ta, tb));
+            }
+            release_container<WordType, DataBits>(a_copy, tb);
+            break;
+        }
+    }
+    state.counters["card_a"] = values_a.size();
+    state.counters["card_b"] = values_b.size();
+    release_container<WordType, DataBits>(a, ta);
+    release_container<WordType, DataBits>(b, tb);
+}
+
+template <typename WordType, size_t DataBits>
+void register_kernels(const std::vector<size_t>& cardinalities) {
+    for (const auto& info : AllOps) {
+        for (auto ta : AllTypes) {
+            for (auto tb : AllTypes) {
+                for (auto card : cardinalities) {
+                    for (auto run_length : RunLengths) {
+                        std::string name = std::string(info.name) + "/" + std::to_string(DataBits) + "/" +
+                                           type_name(ta) + "_" + type_name(tb) + "/" + std::to_string(card) + "/" +
+                                           std::to_string(run_length);
+                        benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) {
+                            run_kernel<WordType, DataBits>(state, info.op, ta, tb, card, run_length);
+                        });
+                    }
+                }
+            }
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    // Sparse, around the array/bitmap break-even, and dense
+    register_kernels<uint64_t, 8>({4, 32, 200});
+    register_kernels<uint64_t, 16>({64, 4096, 40000});
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+/// Synthetic bitmap corpora shaped like the classic Roaring benchmark datasets (census, weather, wikileaks, ...).
+/// They are generated from a fixed seed and cached in a binary file under the build directory, so that no data has
+/// to be downloaded and the (slow) generation runs once.
+#ifndef FROARING_BENCHMARK_DATA_DIR
+#define FROARING_BENCHMARK_DATA_DIR "froaring_benchmark_data"
+#endif
+
+namespace froaring::bench {
+
+/// A corpus: each bitmap is a sorted list of distinct values.
+using Corpus = std::vector<std::vector<uint32_t>>;
+
+struct DatasetSpec {
+    const char* name;
+    size_t bitmap_count;
+    uint32_t universe;
+    /// Generate one bitmap of the corpus.
+    std::vector<uint32_t> (*generate)(std::mt19937_64& rng, uint32_t universe);
+};
+
+namespace detail {
+inline void add_run(std::vector<uint32_t>& out, uint64_t start, uint64_t length, uint32_t universe) {
+    for (uint64_t v = start; v < std::min<uint64_t>(start + length, universe); ++v) {
+        out.push_back(static_cast<uint32_t>(v));
+    }
+}
+
+inline std::vector<uint32_t> sort_unique(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
+
+/// census1881-like: sparse attribute bitmaps over a large row space, values clustered around a few hot regions.
+inline std::vector<uint32_t> census1881(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    const size_t clusters = 1 + rng() % 8;
+    for (size_t c = 0; c < clusters; ++c) {
+        const uint64_t center = rng() % universe;
+        std::normal_distribution<double> spread(0.0, 20000.0);
+        for (size_t i = 200 + rng() % 2000; i > 0; --i) {
+            const double v = static_cast<double>(center) + spread(rng);
+            if (v >= 0 && v < universe) out.push_back(static_cast<uint32_t>(v));
+        }
+    }
+    return sort_unique(std::move(out));
+}
+
+/// census-income-like: few rows, high density: most containers become bitmaps.
+inline std::vector<uint32_t> census_income(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    const uint64_t density_permille = 50 + rng() % 400;
+    for (uint32_t v = 0; v < universe; ++v) {
+        if (rng() % 1000 < density_permille) out.push_back(v);
+    }
+    return out;
+}
+
+/// weather_sept_85-like: rows sorted by some attribute, so bitmaps are mostly long and medium runs.
+inline std::vector<uint32_t> weather(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    uint64_t pos = rng() % 5000;
+    while (pos < universe) {
+        const uint64_t run = 1 + rng() % 300;
+        add_run(out, pos, run, universe);
+        pos += run + rng() % 3000;
+    }
+    return out;
+}
+
+/// wikileaks-noquotes-like: sparse term bitmaps with many short runs.
+inline std::vector<uint32_t> wikileaks(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    std::geometric_distribution<uint64_t> run_length(0.2);
+    for (size_t i = 100 + rng() % 1500; i > 0; --i) {
+        add_run(out, rng() % universe, 1 + run_length(rng), universe);
+    }
+    return sort_unique(std::move(out));
+}
+
+/// Uniformly random, very sparse: one value per container or so.
+inline std::vector<uint32_t> uniform_sparse(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    for (size_t i = 1000 + rng() % 4000; i > 0; --i) out.push_back(rng() % universe);
+    return sort_unique(std::move(out));
+}
+
+/// Few, very long runs spanning many containers.
+inline std::vector<uint32_t> dense_runs(std::mt19937_64& rng, uint32_t universe) {
+    std::vector<uint32_t> out;
+    for (size_t i = 2 + rng() % 10; i > 0; --i) {
+        add_run(out, rng() % universe, 100 + rng() % 20000, universe);
+    }
+    return sort_unique(std::move(out));
+}
+}  // namespace detail
+
+/// Universes stay below 2^24, the range of the default `FlexibleRoaring<>` geometry.
+inline const std::vector<DatasetSpec>& all_datasets() {
+    static const std::vector<DatasetSpec> specs = {
+        {"census1881", 200, 4000000, detail::census1881},
+        {"census_income", 200, 200000, detail::census_income},
+        {"weather", 100, 1000000, detail::weather},
+        {"wikileaks", 200, 1200000, detail::wikileaks},
+        {"uniform_sparse", 200, 16000000, detail::uniform_sparse},
+        {"dense_runs", 100, 8000000, detail::dense_runs},
+    };
+    return specs;
+}
+
+namespace detail {
+constexpr uint32_t CorpusMagic = 0x53445246;  // "FRDS"
+constexpr uint32_t CorpusVersion = 1;
+
+inline bool read_corpus(const std::string& path, uint64_t seed, Corpus& corpus) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint32_t magic = 0, version = 0;
+    uint64_t file_seed = 0, count = 0;
+    bool ok = std::fread(&magic, sizeof(magic), 1, f) == 1 && std::fread(&version, sizeof(version), 1, f) == 1 &&
+              std::fread(&file_seed, sizeof(file_seed), 1, f) == 1 && std::fread(&count, sizeof(count), 1, f) == 1 &&
+              magic == CorpusMagic && version == CorpusVersion && file_seed == seed;
+    corpus.clear();
+    for (uint64_t i = 0; ok && i < count; ++i) {
+        uint64_t n = 0;
+        ok = std::fread(&n, sizeof(n), 1, f) == 1;
+        if (!ok) break;
+        std::vector<uint32_t> values(n);
+        ok = std::fread(values.data(), sizeof(uint32_t), n, f) == n;
+        corpus.push_back(std::move(values));
+    }
+    std::fclose(f);
+    return ok;
+}
+
+inline void write_corpus(const std::string& path, uint64_t seed, const Corpus& corpus) {
+    // Write to a temporary file first, so that an interrupted run never leaves a truncated cache behind
+    const std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return;  // caching is best-effort
+    const uint64_t count = corpus.size();
+    std::fwrite(&CorpusMagic, sizeof(CorpusMagic), 1, f);
+    std::fwrite(&CorpusVersion, sizeof(CorpusVersion), 1, f);
+    std::fwrite(&seed, sizeof(seed), 1, f);
+    std::fwrite(&count, sizeof(count), 1, f);
+    for (const auto& values : corpus) {
+        const uint64_t n = values.size();
+        std::fwrite(&n, sizeof(n), 1, f);
+        std::fwrite(values.data(), sizeof(uint32_t), n, f);
+    }
+    const bool ok = std::fclose(f) == 0;
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp, path, ec);
+    } else {
+        std::filesystem::remove(tmp, ec);
+    }
+}
+}  // namespace detail
+
+/// @brief Load a corpus from the cache directory, generating (and caching) it on the first use.
+/// @param spec The dataset.
+/// @param seed Seed of the generator; part of the cache file name.
+/// @param dir Cache directory.
+inline Corpus load_dataset(const DatasetSpec& spec, uint64_t seed = DefaultSeed,
+                           const std::string& dir = FROARING_BENCHMARK_DATA_DIR) {
+    // Bump CorpusVersion whenever a generator changes, so that stale caches are not picked up
+    const std::string path =
+        dir + "/" + spec.name + "-v" + std::to_string(detail::CorpusVersion) + "-" + std::to_string(seed) + ".bin";
+    Corpus corpus;
+    if (detail::read_corpus(path, seed, corpus) && corpus.size() == spec.bitmap_count) {
+        return corpus;
+    }
+    std::mt19937_64 rng(seed);
+    corpus.clear();
+    for (size_t i = 0; i < spec.bitmap_count; ++i) {
+        corpus.push_back(spec.generate(rng, spec.universe));
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    detail::write_corpus(path, seed, corpus);
+    return corpus;
+}
+
+}  // namespace froaring::bench
@@ -0,0 +1,71 @@
+// LIMIT/OFFSET over `a & b` and `a - b`: materializing the result and taking a page of it, against `and_first_n` /
+// `andnot_first_n`, which stop at the page and skip whole containers of the offset. Benchmark names read:
+// <variant>/<offset>.
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "lazy.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+constexpr uint64_t Universe = 1 << 22;
+constexpr size_t PageSize = 100;
+
+struct Operands {
+    Bitmap a, b;
+
+    Operands() {
+        std::mt19937_64 rng(42);
+        for (uint64_t v = 0; v < Universe; v += 1 + rng() % 3) a.set(v);
+        for (uint64_t v = 0; v < Universe; v += 1 + rng() % 5) b.set(v);
+        a.run_optimize();
+        b.run_optimize();
+    }
+};
+
+void bench_eager_and(benchmark::State& state) {
+    const Operands o;
+    const size_t offset = state.range(0);
+    std::vector<uint64_t> out(offset + PageSize);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize((o.a & o.b).take_first(out.size(), out.data()));
+    }
+}
+
+void bench_and_first_n(benchmark::State& state) {
+    const Operands o;
+    std::vector<uint64_t> out(PageSize);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(and_first_n(o.a, o.b, PageSize, out.data(), state.range(0)));
+    }
+}
+
+void bench_eager_andnot(benchmark::State& state) {
+    const Operands o;
+    const size_t offset = state.range(0);
+    std::vector<uint64_t> out(offset + PageSize);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize((o.a - o.b).take_first(out.size(), out.data()));
+    }
+}
+
+void bench_andnot_first_n(benchmark::State& state) {
+    const Operands o;
+    std::vector<uint64_t> out(PageSize);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(andnot_first_n(o.a, o.b, PageSize, out.data(), state.range(0)));
+    }
+}
+}  // namespace
+
+BENCHMARK(bench_eager_and)->Arg(0)->Arg(100000);
+BENCHMARK(bench_and_first_n)->Arg(0)->Arg(100000);
+BENCHMARK(bench_eager_andnot)->Arg(0)->Arg(100000);
+BENCHMARK(bench_andnot_first_n)->Arg(0)->Arg(100000);
+
+BENCHMARK_MAIN();
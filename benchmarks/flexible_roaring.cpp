@@ -0,0 +1,187 @@
+// FlexibleRoaring-level operations on realistic value distributions.
+// Benchmark names read: <op>/<distribution>/<number of values drawn>, e.g. test/zipfian/100000.
+// Pass --perf_counters to also report hardware counters per element (cycles/elem, LLC_misses/elem, IPC, ...).
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "froaring.h"
+#include "perf_counters.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+constexpr uint64_t Universe = uint64_t(1) << 24;
+constexpr Distribution AllDistributions[] = {Distribution::Uniform, Distribution::Clustered, Distribution::Zipfian,
+                                             Distribution::Runs};
+constexpr size_t Sizes[] = {1000, 100000};
+
+Bitmap make_bitmap(const std::vector<uint64_t>& values) {
+    Bitmap b;
+    for (auto v : values) b.set(v);
+    return b;
+}
+
+void bench_set(benchmark::State& state, Distribution d, size_t n) {
+    const auto values = generate(d, n, Universe);
+    PerfScope perf(state, values.size());
+    for (auto _ : state) {
+        Bitmap b;
+        for (auto v : values) b.set(v);
+        benchmark::DoNotOptimize(b.handle.ptr);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+/// Values of the same distribution (mostly hits) followed by uniform ones (mostly misses).
+std::vector<uint64_t> make_probes(Distribution d) {
+    auto probes = generate(d, 4096, Universe, DefaultSeed + 1);
+    const auto misses = generate(Distribution::Uniform, 4096, Universe, DefaultSeed + 2);
+    probes.insert(probes.end(), misses.begin(), misses.end());
+    return probes;
+}
+
+void bench_test(benchmark::State& state, Distribution d, size_t n) {
+    const Bitmap b = make_bitmap(generate(d, n, Universe));
+    const auto probes = make_probes(d);
+    PerfScope perf(state, probes.size());
+    for (auto _ : state) {
+        size_t hits = 0;
+        for (auto v : probes) hits += b.test(v);
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+/// The probes of bench_test, answered in batches of 1024 (the batch size of a join probe).
+void bench_test_many(benchmark::State& state, Distribution d, size_t n) {
+    constexpr size_t Batch = 1024;
+    const Bitmap b = make_bitmap(generate(d, n, Universe));
+    const auto probes = make_probes(d);
+    std::vector<uint8_t> out(Batch);
+    PerfScope perf(state, probes.size());
+    for (auto _ : state) {
+        size_t hits = 0;
+        for (size_t i = 0; i < probes.size(); i += Batch) {
+            const size_t len = std::min(Batch, probes.size() - i);
+            b.test_many(std::span<const uint64_t>(probes.data() + i, len), out.data());
+            for (size_t j = 0; j < len; ++j) hits += out[j];
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+void bench_reset(benchmark::State& state, Distribution d, size_t n) {
+    const auto values = generate(d, n, Universe);
+    const Bitmap full = make_bitmap(values);
+    PerfScope perf(state, values.size());
+    for (auto _ : state) {
+        state.PauseTiming();
+        perf.pause();
+        Bitmap b(full);
+        perf.resume();
+        state.ResumeTiming();
+        for (auto v : values) b.reset(v);
+        benchmark::DoNotOptimize(b.handle.ptr);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+void bench_iterate(benchmark::State& state, Distribution d, size_t n) {
+    const Bitmap b = make_bitmap(generate(d, n, Universe));
+    PerfScope perf(state, b.count());
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (auto it = b.begin(); it != b.end(); ++it) sum += *it;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * b.count());
+}
+
+void bench_count(benchmark::State& state, Distribution d, size_t n) {
+    const Bitmap b = make_bitmap(generate(d, n, Universe));
+    PerfScope perf(state, 1);  // per call
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(b.count());
+    }
+}
+
+void bench_rank_select(benchmark::State& state, Distribution d, size_t n) {
+    const Bitmap b = make_bitmap(generate(d, n, Universe));
+    const auto probes = generate(Distribution::Uniform, 1024, Universe, DefaultSeed + 1);
+    const size_t card = b.count();
+    PerfScope perf(state, probes.size());
+    for (auto _ : state) {
+        uint64_t acc = 0;
+        for (auto v : probes) {
+            acc += b.rank(v);
+            uint64_t selected = 0;
+            b.select(v % card, selected);
+            acc += selected;
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+template <char Op>
+void bench_set_op(benchmark::State& state, Distribution d, size_t n) {
+    const Bitmap a = make_bitmap(generate(d, n, Universe, DefaultSeed));
+    const Bitmap b = make_bitmap(generate(d, n, Universe, DefaultSeed + 1));
+    PerfScope perf(state, a.count() + b.count());  // per input element
+    for (auto _ : state) {
+        Bitmap r = Op == '&' ? (a & b) : Op == '|' ? (a | b) : (a - b);
+        benchmark::DoNotOptimize(r.handle.ptr);
+    }
+}
+
+void register_all() {
+    using Fn = void (*)(benchmark::State&, Distribution, size_t);
+    const std::pair<const char*, Fn> ops[] = {
+        {"set", bench_set},
+        {"test", bench_test},
+        {"test_many", bench_test_many},
+        {"reset", bench_reset},
+        {"iterate", bench_iterate},
+        {"count", bench_count},
+        {"rank_select", bench_rank_select},
+        {"and", bench_set_op<'&'>},
+        {"or", bench_set_op<'|'>},
+        {"diff", bench_set_op<'-'>},
+    };
+    for (const auto& [name, fn] : ops) {
+        for (auto d : AllDistributions) {
+            for (auto n : Sizes) {
+                std::string full_name = std::string(name) + "/" + distribution_name(d) + "/" + std::to_string(n);
+                benchmark::RegisterBenchmark(full_name.c_str(), [fn = fn, d, n](benchmark::State& state) {
+                    fn(state, d, n);
+                });
+            }
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    perf_counters_enabled() = take_flag(argc, argv, "perf_counters").has_value();
+    if (perf_counters_enabled() && !PerfCounters().any_available()) {
+        std::fprintf(stderr, "--perf_counters: perf_event_open is unavailable, no hardware counters reported\n");
+    }
+    register_all();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
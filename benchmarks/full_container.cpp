@@ -0,0 +1,83 @@
+// Set operations with a fully-set container, as in time-range bitmaps, stored as the payload-free Full type or as
+// the single-run RLE container that run_optimize produced before. Benchmark names read:
+// <op>/<full side type>_<other type>/<other cardinality>, e.g. and/full_bitmap/32768.
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+constexpr size_t DataBits = 16;
+constexpr size_t Universe = size_t(1) << DataBits;
+using WordType = uint64_t;
+
+enum class Op { And, Or, Diff, DiffFrom, Cardinality };
+
+void run(benchmark::State& state, Op op, CTy full_type, CTy other_type, size_t card) {
+    std::vector<uint64_t> all(Universe);
+    std::iota(all.begin(), all.end(), 0);
+    auto* full = make_container<WordType, DataBits>(all, full_type);
+    auto* other = make_container<WordType, DataBits>(container_values(card, 16, Universe), other_type);
+    CTy rt;
+    for (auto _ : state) {
+        if (op == Op::Cardinality) {
+            benchmark::DoNotOptimize(container_cardinality<WordType, DataBits>(full, full_type));
+            continue;
+        }
+        froaring_container_t* r =
+            op == Op::And    ? froaring_and<WordType, DataBits>(full, other, full_type, other_type, rt)
+            : op == Op::Or   ? froaring_or<WordType, DataBits>(full, other, full_type, other_type, rt)
+            : op == Op::Diff ? froaring_diff<WordType, DataBits>(other, full, other_type, full_type, rt)
+                             : froaring_diff<WordType, DataBits>(full, other, full_type, other_type, rt);
+        benchmark::DoNotOptimize(r);
+        release_container<WordType, DataBits>(r, rt);
+    }
+    release_container<WordType, DataBits>(full, full_type);
+    release_container<WordType, DataBits>(other, other_type);
+}
+
+struct OpInfo {
+    Op op;
+    const char* name;
+};
+constexpr OpInfo AllOps[] = {
+    {Op::And, "and"},
+    {Op::Or, "or"},
+    {Op::Diff, "diff"},           // other - full
+    {Op::DiffFrom, "diff_from"},  // full - other
+    {Op::Cardinality, "cardinality"},
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+    for (const auto& info : AllOps) {
+        for (auto full_type : {CTy::Full, CTy::RLE}) {
+            for (auto other_type : {CTy::Array, CTy::Bitmap, CTy::RLE}) {
+                for (size_t card : {size_t(1024), size_t(32768)}) {
+                    if (other_type == CTy::Array && card > 4096) {
+                        continue;
+                    }
+                    std::string name = std::string(info.name) + "/" + type_name(full_type) + "_" +
+                                       type_name(other_type) + "/" + std::to_string(card);
+                    benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) {
+                        run(state, info.op, full_type, other_type, card);
+                    });
+                }
+            }
+        }
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,234 @@
+// Replays an id trace against several FlexibleRoaring geometries and recommends one.
+// Each geometry is measured for memory (after run_optimize), insert throughput, point query latency and set operation
+// throughput, and the geometries are ranked by the weighted geometric mean of their slowdowns against the best one.
+//
+// Usage: bench_geometry_advisor [--trace=<file>] [--repeat=<n>] [--weights=<memory>,<insert>,<query>,<set op>]
+// The trace is a text file of unsigned ids separated by whitespace, in insertion order. Without --trace, a synthetic
+// Zipfian trace is used. Geometries whose value range cannot hold the largest id are skipped.
+// To evaluate another geometry, add it to `Geometries` below.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "bench_util.h"
+#include "froaring.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+template <typename WordType, size_t IndexBits, size_t DataBits>
+struct Geometry {
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    static constexpr size_t ValueBits = IndexBits + DataBits;
+    static std::string name() {
+        return "<uint" + std::to_string(sizeof(WordType) * 8) + "_t, " + std::to_string(IndexBits) + ", " +
+               std::to_string(DataBits) + ">";
+    }
+};
+
+using Geometries = std::tuple<Geometry<uint64_t, 16, 8>, Geometry<uint64_t, 16, 16>, Geometry<uint32_t, 20, 12>,
+                              Geometry<uint64_t, 48, 16>>;
+
+enum Metric { Memory, Insert, Query, SetOp, MetricCount };
+constexpr const char* MetricNames[MetricCount] = {"memory", "insert", "query", "set op"};
+
+struct Result {
+    std::string name;
+    bool supported = false;
+    double value[MetricCount] = {};  // bytes, ns per insert, ns per query, ns per set operation
+    double score = 0.0;
+};
+
+struct Options {
+    std::string trace_path;
+    size_t repeat = 3;
+    double weights[MetricCount] = {1.0, 1.0, 1.0, 1.0};
+};
+
+using Clock = std::chrono::steady_clock;
+
+/// Best-of-`repeat` wall time of `fn`, in nanoseconds.
+template <typename Fn>
+double best_time_ns(size_t repeat, Fn&& fn) {
+    double best = std::numeric_limits<double>::max();
+    for (size_t r = 0; r < repeat; ++r) {
+        const auto start = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+template <typename G>
+Result measure(const std::vector<uint64_t>& trace, const std::vector<uint64_t>& probes, size_t repeat) {
+    using Bitmap = typename G::Bitmap;
+    using Word = std::conditional_t<(G::ValueBits > 32), uint64_t, uint32_t>;
+    Result result;
+    result.name = G::name();
+    const uint64_t max_id = trace.empty() ? 0 : *std::max_element(trace.begin(), trace.end());
+    if constexpr (G::ValueBits < 64) {
+        if (max_id >> G::ValueBits) {
+            return result;
+        }
+    }
+    result.supported = true;
+
+    const auto build = [](const std::vector<uint64_t>& ids, size_t begin, size_t step) {
+        Bitmap b;
+        for (size_t i = begin; i < ids.size(); i += step) b.set(static_cast<Word>(ids[i]));
+        return b;
+    };
+
+    result.value[Insert] = best_time_ns(repeat, [&] {
+                               Bitmap b = build(trace, 0, 1);
+                               benchmark::DoNotOptimize(b.handle.ptr);
+                           }) /
+                           std::max<size_t>(trace.size(), 1);
+
+    Bitmap full = build(trace, 0, 1);
+    full.run_optimize();
+    result.value[Memory] = full.memory_usage();
+
+    result.value[Query] = best_time_ns(repeat, [&] {
+                              size_t hits = 0;
+                              for (auto v : probes) hits += full.test(static_cast<Word>(v));
+                              benchmark::DoNotOptimize(hits);
+                          }) /
+                          std::max<size_t>(probes.size(), 1);
+
+    // Set operations between the ids at even and at odd positions of the trace
+    const Bitmap a = build(trace, 0, 2);
+    const Bitmap b = build(trace, 1, 2);
+    result.value[SetOp] = best_time_ns(repeat, [&] {
+                              Bitmap r_and = a & b;
+                              Bitmap r_or = a | b;
+                              Bitmap r_diff = a - b;
+                              benchmark::DoNotOptimize(r_and.handle.ptr);
+                              benchmark::DoNotOptimize(r_or.handle.ptr);
+                              benchmark::DoNotOptimize(r_diff.handle.ptr);
+                          }) /
+                          3;
+    return result;
+}
+
+/// Score each supported geometry by the weighted geometric mean of value / best value over all metrics: 1.0 means
+/// best at everything. Unsupported geometries go last.
+void rank(std::vector<Result>& results, const double (&weights)[MetricCount]) {
+    double best[MetricCount];
+    std::fill(std::begin(best), std::end(best), std::numeric_limits<double>::max());
+    for (const auto& r : results) {
+        if (!r.supported) continue;
+        for (size_t m = 0; m < MetricCount; ++m) best[m] = std::min(best[m], r.value[m]);
+    }
+    double weight_sum = 0.0;
+    for (auto w : weights) weight_sum += w;
+    for (auto& r : results) {
+        if (!r.supported) continue;
+        double log_score = 0.0;
+        for (size_t m = 0; m < MetricCount; ++m) {
+            log_score += weights[m] * std::log(std::max(r.value[m], 1e-9) / std::max(best[m], 1e-9));
+        }
+        r.score = weight_sum > 0 ? std::exp(log_score / weight_sum) : 1.0;
+    }
+    std::stable_sort(results.begin(), results.end(), [](const Result& x, const Result& y) {
+        if (x.supported != y.supported) return x.supported;
+        return x.score < y.score;
+    });
+}
+
+bool read_trace(const std::string& path, std::vector<uint64_t>& trace) {
+    std::ifstream in(path);
+    if (!in) return false;
+    uint64_t id;
+    while (in >> id) trace.push_back(id);
+    return in.eof();
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--trace=", 0) == 0) {
+            options.trace_path = arg.substr(std::strlen("--trace="));
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            options.repeat = std::max<size_t>(std::stoul(arg.substr(std::strlen("--repeat="))), 1);
+        } else if (arg.rfind("--weights=", 0) == 0) {
+            if (std::sscanf(arg.c_str() + std::strlen("--weights="), "%lf,%lf,%lf,%lf", &options.weights[Memory],
+                            &options.weights[Insert], &options.weights[Query], &options.weights[SetOp]) != 4) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--trace=<file>] [--repeat=<n>] [--weights=<memory>,<insert>,<query>,<set op>]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    std::vector<uint64_t> trace;
+    if (options.trace_path.empty()) {
+        trace = generate(Distribution::Zipfian, 1000000, uint64_t(1) << 24);
+        std::printf("trace: synthetic Zipfian, %zu ids over [0, 2^24)\n", trace.size());
+    } else if (read_trace(options.trace_path, trace)) {
+        std::printf("trace: %s, %zu ids\n", options.trace_path.c_str(), trace.size());
+    } else {
+        std::fprintf(stderr, "cannot read trace %s\n", options.trace_path.c_str());
+        return 1;
+    }
+
+    // Probe with ids of the trace (hits) and with uniform ids below the largest one (mostly misses)
+    const uint64_t max_id = trace.empty() ? 0 : *std::max_element(trace.begin(), trace.end());
+    std::vector<uint64_t> probes;
+    for (size_t i = 0; i < trace.size() && probes.size() < 50000; i += std::max<size_t>(trace.size() / 50000, 1)) {
+        probes.push_back(trace[i]);
+    }
+    const auto misses = generate(Distribution::Uniform, probes.size(), max_id + 1, DefaultSeed + 1);
+    probes.insert(probes.end(), misses.begin(), misses.end());
+
+    std::vector<Result> results;
+    std::apply(
+        [&](auto... geometries) {
+            (results.push_back(measure<decltype(geometries)>(trace, probes, options.repeat)), ...);
+        },
+        Geometries{});
+    rank(results, options.weights);
+
+    std::printf("\n%-26s %14s %16s %14s %16s %8s\n", "geometry", "memory (B)", "insert (ns/id)", "query (ns)",
+                "set op (ns)", "score");
+    for (const auto& r : results) {
+        if (!r.supported) {
+            std::printf("%-26s skipped: ids do not fit\n", r.name.c_str());
+            continue;
+        }
+        std::printf("%-26s %14.0f %16.2f %14.2f %16.0f %8.3f\n", r.name.c_str(), r.value[Memory], r.value[Insert],
+                    r.value[Query], r.value[SetOp], r.score);
+    }
+    std::printf("\nweights:");
+    for (size_t m = 0; m < MetricCount; ++m) std::printf(" %s=%g", MetricNames[m], options.weights[m]);
+    if (!results.empty() && results.front().supported) {
+        std::printf("\nrecommendation: FlexibleRoaring%s\n", results.front().name.c_str());
+    } else {
+        std::printf("\nrecommendation: none of the geometries can hold the ids of the trace\n");
+    }
+    return 0;
+}
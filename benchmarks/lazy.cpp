@@ -0,0 +1,81 @@
+// `(a & b) | (c - d)` over bitmaps mixing array, bitmap and run containers: the eager operators (three intermediate
+// bitmaps) against the lazy formula (one pass per key). Benchmark names read: <variant>/<geometry>.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+
+#include "lazy.h"
+
+using namespace froaring;
+
+namespace {
+constexpr uint64_t Universe = 1 << 22;
+
+template <typename Bitmap>
+struct Operands {
+    Bitmap a, b, c, d;
+
+    Operands() {
+        std::mt19937_64 rng(42);
+        int i = 0;
+        for (Bitmap* x : {&a, &b, &c, &d}) {
+            const uint64_t stride = 2 + 3 * i++;
+            for (uint64_t v = rng() % stride; v < Universe; v += 1 + rng() % stride) x->set(v);
+            // Some long runs, so that the operands mix all container types
+            for (uint64_t start = rng() % 65536; start < Universe; start += 65536 + rng() % 65536) {
+                for (uint64_t v = start; v < std::min(Universe, start + 4096); ++v) x->set(v);
+            }
+            x->run_optimize();
+        }
+    }
+};
+
+template <typename Bitmap>
+void bench_eager(benchmark::State& state) {
+    const Operands<Bitmap> o;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize((o.a & o.b) | (o.c - o.d));
+    }
+}
+
+template <typename Bitmap>
+void bench_lazy(benchmark::State& state) {
+    const Operands<Bitmap> o;
+    for (auto _ : state) {
+        Bitmap r = (lazy(o.a) & o.b) | (lazy(o.c) - o.d);
+        benchmark::DoNotOptimize(r);
+    }
+}
+
+template <typename Bitmap>
+void bench_eager_count(benchmark::State& state) {
+    const Operands<Bitmap> o;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(((o.a & o.b) | (o.c - o.d)).count());
+    }
+}
+
+template <typename Bitmap>
+void bench_lazy_count(benchmark::State& state) {
+    const Operands<Bitmap> o;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(((lazy(o.a) & o.b) | (lazy(o.c) - o.d)).count());
+    }
+}
+
+using D8 = FlexibleRoaring<uint64_t, 16, 8>;
+using D12 = FlexibleRoaring<uint64_t, 16, 12>;
+}  // namespace
+
+BENCHMARK(bench_eager<D8>)->Name("bench_eager/d8");
+BENCHMARK(bench_lazy<D8>)->Name("bench_lazy/d8");
+BENCHMARK(bench_eager_count<D8>)->Name("bench_eager_count/d8");
+BENCHMARK(bench_lazy_count<D8>)->Name("bench_lazy_count/d8");
+BENCHMARK(bench_eager<D12>)->Name("bench_eager/d12");
+BENCHMARK(bench_lazy<D12>)->Name("bench_lazy/d12");
+BENCHMARK(bench_eager_count<D12>)->Name("bench_eager_count/d12");
+BENCHMARK(bench_lazy_count<D12>)->Name("bench_lazy_count/d12");
+
+BENCHMARK_MAIN();
@@ -0,0 +1,84 @@
+// Sparse 64-bit ids (a few values per container, spread over the whole space): one flat BinsearchIndex keyed by 56
+// bits against three MultiLevelIndex layers. Benchmark names read: <variant>/<values>. bench_iterate compares the
+// bitmaps built on them, FlexibleRoaring<uint64_t, 56, 8> and FlexibleRoaring64.
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "multilevel.h"
+
+using namespace froaring;
+
+namespace {
+using Flat = BinsearchIndex<uint64_t, 56, 8>;
+using MultiLevel = MultiLevelIndex<MultiLevelIndex<BinsearchIndex<uint64_t, 16, 8>, 20>, 20>;
+
+std::vector<uint64_t> sparse_ids(size_t n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> ids(n);
+    // 4096 hot prefixes of the top 24 bits, like ids minted by a few thousand shards
+    for (auto& id : ids) id = (rng() % 4096) << 40 | (rng() & ((1ull << 40) - 1));
+    return ids;
+}
+
+template <typename Index>
+void bench_insert(benchmark::State& state) {
+    const auto ids = sparse_ids(state.range(0), 1);
+    for (auto _ : state) {
+        Index index;
+        for (auto id : ids) index.set(id);
+        benchmark::DoNotOptimize(index.size);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+template <typename Index>
+void bench_and(benchmark::State& state) {
+    Index a, b;
+    for (auto id : sparse_ids(state.range(0), 1)) a.set(id);
+    for (auto id : sparse_ids(state.range(0), 1)) b.set(id ^ (id & 1));  // mostly the same containers
+    for (auto _ : state) {
+        auto r = Index::and_(&a, &b);
+        benchmark::DoNotOptimize(r->size);
+        delete r;
+    }
+}
+
+template <typename Index>
+void bench_test(benchmark::State& state) {
+    const auto ids = sparse_ids(state.range(0), 1);
+    Index index;
+    for (auto id : ids) index.set(id);
+    for (auto _ : state) {
+        size_t hits = 0;
+        for (auto id : ids) hits += index.test(id);
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+template <typename Bitmap>
+void bench_iterate(benchmark::State& state) {
+    Bitmap bitmap;
+    for (auto id : sparse_ids(state.range(0), 1)) bitmap.set(id);
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (auto it = bitmap.begin(); it != bitmap.end(); ++it) sum += *it;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * bitmap.count());
+}
+}  // namespace
+
+BENCHMARK(bench_insert<Flat>)->Name("bench_insert/flat")->Arg(1 << 14)->Arg(1 << 16);
+BENCHMARK(bench_insert<MultiLevel>)->Name("bench_insert/multilevel")->Arg(1 << 14)->Arg(1 << 16);
+BENCHMARK(bench_and<Flat>)->Name("bench_and/flat")->Arg(1 << 18);
+BENCHMARK(bench_and<MultiLevel>)->Name("bench_and/multilevel")->Arg(1 << 18);
+BENCHMARK(bench_test<Flat>)->Name("bench_test/flat")->Arg(1 << 18);
+BENCHMARK(bench_test<MultiLevel>)->Name("bench_test/multilevel")->Arg(1 << 18);
+BENCHMARK(bench_iterate<FlexibleRoaring<uint64_t, 56, 8>>)->Name("bench_iterate/flat")->Arg(1 << 18);
+BENCHMARK(bench_iterate<FlexibleRoaring64>)->Name("bench_iterate/multilevel")->Arg(1 << 18);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+// Sparse containers of geometries whose values do not fill whole bytes (12 and 20 data bits), stored as a plain
+// ArrayContainer or as a PackedArrayContainer. Benchmark names read: <op>/<data bits>/<type>/<cardinality>, e.g.
+// test/12/packed/200. Every benchmark reports the container size in bytes as the `bytes` counter.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+using WordType = uint64_t;
+
+enum class Op { Test, Rank, And, Or, Decode };
+
+template <size_t DataBits>
+void run(benchmark::State& state, Op op, CTy type, size_t card) {
+    constexpr size_t Universe = size_t(1) << DataBits;
+    auto* c = make_container<WordType, DataBits>(container_values(card, 1, Universe), type);
+    auto* other = make_container<WordType, DataBits>(container_values(card, 1, Universe, DefaultSeed + 1), CTy::Array);
+    const auto queries = generate(Distribution::Uniform, 1024, Universe);
+    std::vector<uint64_t> out(card);
+    std::vector<uint8_t> found(queries.size());
+    CTy rt;
+    for (auto _ : state) {
+        switch (op) {
+            case Op::Test:
+                container_test_many<WordType, DataBits>(c, type, queries.data(), queries.size(), found.data());
+                benchmark::DoNotOptimize(found.data());
+                break;
+            case Op::Rank: {
+                size_t sum = 0;
+                for (auto q : queries) sum += container_rank<WordType, DataBits>(c, type, q);
+                benchmark::DoNotOptimize(sum);
+                break;
+            }
+            case Op::And:
+            case Op::Or: {
+                auto* r = op == Op::And ? froaring_and<WordType, DataBits>(c, other, type, CTy::Array, rt)
+                                        : froaring_or<WordType, DataBits>(c, other, type, CTy::Array, rt);
+                benchmark::DoNotOptimize(r);
+                release_container<WordType, DataBits>(r, rt);
+                break;
+            }
+            case Op::Decode:
+                benchmark::DoNotOptimize(
+                    container_take_first<WordType, DataBits>(c, type, card, uint64_t(0), out.data()));
+                break;
+        }
+    }
+    state.counters["bytes"] = double(container_memory_usage<WordType, DataBits>(c, type));
+    release_container<WordType, DataBits>(c, type);
+    release_container<WordType, DataBits>(other, CTy::Array);
+}
+
+struct OpInfo {
+    Op op;
+    const char* name;
+};
+constexpr OpInfo AllOps[] = {
+    {Op::Test, "test"},  // 1024 point lookups
+    {Op::Rank, "rank"},  // 1024 ranks
+    {Op::And, "and"},    // with an array of the same cardinality
+    {Op::Or, "or"},
+    {Op::Decode, "decode"},  // every value, in order
+};
+
+template <size_t DataBits>
+void register_all(size_t max_card) {
+    for (const auto& info : AllOps) {
+        for (auto type : {CTy::Array, CTy::PackedArray}) {
+            for (size_t card : {size_t(32), size_t(200), max_card}) {
+                std::string name = std::string(info.name) + "/" + std::to_string(DataBits) + "/" + type_name(type) +
+                                   "/" + std::to_string(card);
+                benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) {
+                    run<DataBits>(state, info.op, type, card);
+                });
+            }
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    register_all<12>(340);   // just below the bitmap size
+    register_all<20>(4096);  // sparse enough to stay an array
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
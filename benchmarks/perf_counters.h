@@ -0,0 +1,173 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// Hardware performance counters (Linux perf_event_open) around benchmark loops, reported per processed element.
+/// Counting is per thread and user space only, which works with the default perf_event_paranoid level of 2. Events the
+/// CPU or the kernel does not provide (e.g. in most VMs) are silently left out; elsewhere the wrapper is a no-op.
+namespace froaring::bench {
+
+class PerfCounters {
+public:
+    enum Event { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, EventCount };
+
+    static const char* event_name(Event e) {
+        constexpr const char* names[EventCount] = {"cycles", "instructions", "L1D_misses", "LLC_misses",
+                                                   "branch_misses"};
+        return names[e];
+    }
+
+    PerfCounters() {
+        fds.fill(-1);
+#if defined(__linux__)
+        constexpr uint64_t L1DReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const std::array<std::pair<uint32_t, uint64_t>, EventCount> configs = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, L1DReadMiss},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+        for (size_t e = 0; e < EventCount; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[e].first;
+            attr.config = configs[e].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // More events than hardware counters get multiplexed: read the enabled/running times to scale back
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(Event e) const { return fds[e] >= 0; }
+
+    bool any_available() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    /// @brief Zero and start all counters.
+    void start() {
+        control(Control::Reset);
+        control(Control::Enable);
+    }
+
+    /// @brief Stop counting, keeping the values: use around untimed parts, with `resume`.
+    void pause() { control(Control::Disable); }
+    void resume() { control(Control::Enable); }
+
+    /// @brief Current value of an event, scaled for multiplexing; 0 if unavailable.
+    double read(Event e) const {
+#if defined(__linux__)
+        uint64_t buf[3];  // value, time enabled, time running
+        if (fds[e] < 0 || ::read(fds[e], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) return 0.0;
+        return static_cast<double>(buf[0]) * static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+#else
+        (void)e;
+        return 0.0;
+#endif
+    }
+
+private:
+    enum class Control { Reset, Enable, Disable };
+
+    void control(Control c) {
+#if defined(__linux__)
+        const unsigned long request = c == Control::Reset    ? PERF_EVENT_IOC_RESET
+                                      : c == Control::Enable ? PERF_EVENT_IOC_ENABLE
+                                                             : PERF_EVENT_IOC_DISABLE;
+        for (int fd : fds) {
+            if (fd >= 0) ioctl(fd, request, 0);
+        }
+#else
+        (void)c;
+#endif
+    }
+
+    std::array<int, EventCount> fds;
+};
+
+/// Set by `--perf_counters`: PerfScope does nothing unless enabled.
+inline bool& perf_counters_enabled() {
+    static bool enabled = false;
+    return enabled;
+}
+
+/// @brief Counts hardware events from construction to destruction, and reports them in `state` per processed element,
+/// e.g. cycles/elem, plus IPC. Construct it right before the benchmark loop.
+class PerfScope {
+public:
+    PerfScope(benchmark::State& state, double elements_per_iteration)
+        : state(state), elements_per_iteration(elements_per_iteration) {
+        if (perf_counters_enabled()) {
+            counters.emplace();
+            counters->start();
+        }
+    }
+
+    ~PerfScope() {
+        if (!counters || !counters->any_available()) return;
+        counters->pause();
+        const double elements = static_cast<double>(state.iterations()) * elements_per_iteration;
+        if (elements <= 0) return;
+        for (size_t e = 0; e < PerfCounters::EventCount; ++e) {
+            const auto event = static_cast<PerfCounters::Event>(e);
+            if (counters->available(event)) {
+                state.counters[std::string(PerfCounters::event_name(event)) + "/elem"] =
+                    counters->read(event) / elements;
+            }
+        }
+        if (counters->available(PerfCounters::Cycles) && counters->available(PerfCounters::Instructions)) {
+            const double cycles = counters->read(PerfCounters::Cycles);
+            state.counters["IPC"] = cycles > 0 ? counters->read(PerfCounters::Instructions) / cycles : 0.0;
+        }
+    }
+
+    /// Exclude the untimed parts of the loop, together with State::PauseTiming / ResumeTiming.
+    void pause() {
+        if (counters) counters->pause();
+    }
+    void resume() {
+        if (counters) counters->resume();
+    }
+
+private:
+    benchmark::State& state;
+    double elements_per_iteration;
+    std::optional<PerfCounters> counters;  // opened only if enabled
+};
+
+}  // namespace froaring::bench
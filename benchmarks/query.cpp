@@ -0,0 +1,99 @@
+// Filters of N terms shaped like service requests: a conjunction of broad and selective terms (some of them small
+// disjunctions), followed by exclusions. Compares folding the expression left to right with the out-of-place
+// operators against Query::evaluate.
+// Benchmark names read: <variant>/<terms>.
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "query.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Q = Query<Bitmap>;
+
+constexpr uint64_t Universe = 1 << 20;
+
+struct Filter {
+    std::vector<Bitmap> terms;
+
+    explicit Filter(size_t n) {
+        std::mt19937_64 rng(n);
+        for (size_t i = 0; i < n; ++i) {
+            // Broad terms (1/2 .. 1/8 of the universe) and one selective term
+            const uint64_t stride = i == 3 ? 97 : 2 + i % 7;
+            Bitmap b;
+            for (uint64_t v = rng() % stride; v < Universe; v += 1 + rng() % (2 * stride)) b.set(v);
+            b.run_optimize();
+            terms.push_back(std::move(b));
+        }
+    }
+
+    /// Terms 3k+1 and 3k+2 form a disjunction; the last quarter is excluded.
+    template <typename Fn>
+    void shape(Fn&& fn) const {
+        const size_t excluded = terms.size() - terms.size() / 4;
+        for (size_t i = 1; i < terms.size(); ++i) {
+            if (i >= excluded) {
+                fn(Q::Op::AndNot, i);
+            } else if (i % 3 == 1 && i + 1 < excluded) {
+                fn(Q::Op::Or, i++);
+            } else {
+                fn(Q::Op::And, i);
+            }
+        }
+    }
+
+    Bitmap naive() const {
+        Bitmap r(terms[0]);
+        shape([&](Q::Op op, size_t i) {
+            if (op == Q::Op::Or) {
+                r = r & (terms[i] | terms[i + 1]);
+            } else if (op == Q::Op::AndNot) {
+                r = r - terms[i];
+            } else {
+                r = r & terms[i];
+            }
+        });
+        return r;
+    }
+
+    Q query() const {
+        Q q(terms[0]);
+        shape([&](Q::Op op, size_t i) {
+            if (op == Q::Op::Or) {
+                q = std::move(q) & (Q(terms[i]) | terms[i + 1]);
+            } else if (op == Q::Op::AndNot) {
+                q = std::move(q) - terms[i];
+            } else {
+                q = std::move(q) & terms[i];
+            }
+        });
+        return q;
+    }
+};
+
+void bench_naive(benchmark::State& state) {
+    const Filter f(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f.naive());
+    }
+}
+
+void bench_planned(benchmark::State& state) {
+    const Filter f(state.range(0));
+    const Q q = f.query();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(q.evaluate());
+    }
+}
+}  // namespace
+
+BENCHMARK(bench_naive)->Arg(10)->Arg(30)->Arg(50);
+BENCHMARK(bench_planned)->Arg(10)->Arg(30)->Arg(50);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,79 @@
+// Read throughput of a read-mostly bitmap: every thread runs point queries against one bitmap, either behind a
+// std::shared_mutex or published through RcuFlexibleRoaring. Thread 0 also publishes a small update every
+// UpdateEvery queries. Benchmark names read: <variant>/real_time/threads:<n>.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "rcu_froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Rcu = RcuFlexibleRoaring<uint64_t, 16, 8>;
+
+constexpr uint64_t Universe = 1 << 22;
+constexpr uint64_t UpdateEvery = 1 << 16;
+
+Bitmap make_filter() {
+    Bitmap b;
+    for (uint64_t v = 0; v < Universe; v += 7) b.set(v);
+    b.run_optimize();
+    return b;
+}
+
+struct SharedMutex {
+    mutable std::shared_mutex mutex;
+    Bitmap bitmap = make_filter();
+};
+
+// Shared by the threads of a run; rebuilt by Setup before each run
+std::unique_ptr<SharedMutex> shared_mutex;
+std::unique_ptr<Rcu> rcu;
+
+void bench_shared_mutex(benchmark::State& state) {
+    uint64_t v = static_cast<uint64_t>(state.thread_index()) * 7919, hits = 0, queries = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++queries % UpdateEvery == 0) {
+            std::unique_lock lock(shared_mutex->mutex);
+            shared_mutex->bitmap.set(queries % Universe);
+        }
+        std::shared_lock lock(shared_mutex->mutex);
+        hits += shared_mutex->bitmap.test(v);
+        v = (v + 40503) % Universe;
+    }
+    benchmark::DoNotOptimize(hits);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void bench_rcu(benchmark::State& state) {
+    auto reader = rcu->reader();
+    uint64_t v = static_cast<uint64_t>(state.thread_index()) * 7919, hits = 0, queries = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++queries % UpdateEvery == 0) {
+            rcu->update([queries](Bitmap& b) { b.set(queries % Universe); });
+        }
+        hits += reader.read()->test(v);
+        v = (v + 40503) % Universe;
+    }
+    benchmark::DoNotOptimize(hits);
+    state.SetItemsProcessed(state.iterations());
+}
+}  // namespace
+
+BENCHMARK(bench_shared_mutex)
+    ->Setup([](const benchmark::State&) { shared_mutex = std::make_unique<SharedMutex>(); })
+    ->Teardown([](const benchmark::State&) { shared_mutex.reset(); })
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK(bench_rcu)
+    ->Setup([](const benchmark::State&) { rcu = std::make_unique<Rcu>(make_filter()); })
+    ->Teardown([](const benchmark::State&) { rcu.reset(); })
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
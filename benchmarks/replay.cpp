@@ -0,0 +1,132 @@
+// End-to-end replay of synthetic corpora (see datasets.h): load N bitmaps of a dataset into FlexibleRoaring<> and time
+// the operations of a typical query workload.
+// Benchmark names read: <op>/<dataset>, e.g. pairwise_and/weather.
+// Pass --replay_bitmaps=N to use only the first N bitmaps of each dataset.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "datasets.h"
+#include "froaring.h"
+
+using namespace froaring;
+using namespace froaring::bench;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+
+size_t replay_bitmaps = 0;  // 0: the whole corpus
+
+std::vector<Bitmap> load_bitmaps(const Corpus& corpus) {
+    std::vector<Bitmap> bitmaps(corpus.size());
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        for (auto v : corpus[i]) bitmaps[i].set(v);
+        bitmaps[i].run_optimize();
+    }
+    return bitmaps;
+}
+
+size_t total_values(const Corpus& corpus) {
+    size_t n = 0;
+    for (const auto& values : corpus) n += values.size();
+    return n;
+}
+
+void report_memory(benchmark::State& state, const std::vector<Bitmap>& bitmaps, size_t values) {
+    size_t bytes = 0;
+    for (const auto& b : bitmaps) bytes += b.memory_usage();
+    state.counters["bytes"] = bytes;
+    state.counters["bits_per_value"] = values ? 8.0 * bytes / values : 0.0;
+}
+
+void bench_load(benchmark::State& state, const Corpus& corpus) {
+    std::vector<Bitmap> bitmaps;
+    for (auto _ : state) {
+        bitmaps = load_bitmaps(corpus);
+        benchmark::DoNotOptimize(bitmaps.data());
+    }
+    const size_t values = total_values(corpus);
+    state.SetItemsProcessed(state.iterations() * values);
+    report_memory(state, bitmaps, values);
+}
+
+/// Binary operation on each pair of consecutive bitmaps, as in the classic Roaring benchmarks.
+template <char Op>
+void bench_pairwise(benchmark::State& state, const Corpus& corpus) {
+    const auto bitmaps = load_bitmaps(corpus);
+    for (auto _ : state) {
+        size_t card = 0;
+        for (size_t i = 0; i + 1 < bitmaps.size(); ++i) {
+            const Bitmap r = Op == '&'   ? (bitmaps[i] & bitmaps[i + 1])
+                             : Op == '|' ? (bitmaps[i] | bitmaps[i + 1])
+                                         : (bitmaps[i] - bitmaps[i + 1]);
+            card += r.count();
+        }
+        benchmark::DoNotOptimize(card);
+    }
+    state.SetItemsProcessed(state.iterations() * (bitmaps.size() ? bitmaps.size() - 1 : 0));
+}
+
+/// Union of all bitmaps of the corpus, folded in place.
+void bench_wide_union(benchmark::State& state, const Corpus& corpus) {
+    const auto bitmaps = load_bitmaps(corpus);
+    for (auto _ : state) {
+        Bitmap acc;
+        for (const auto& b : bitmaps) acc |= b;
+        benchmark::DoNotOptimize(acc.count());
+    }
+    state.SetItemsProcessed(state.iterations() * bitmaps.size());
+}
+
+void bench_iterate(benchmark::State& state, const Corpus& corpus) {
+    const auto bitmaps = load_bitmaps(corpus);
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (const auto& b : bitmaps) {
+            for (auto it = b.begin(); it != b.end(); ++it) sum += *it;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * total_values(corpus));
+}
+
+void register_all() {
+    using Fn = void (*)(benchmark::State&, const Corpus&);
+    const std::pair<const char*, Fn> ops[] = {
+        {"load", bench_load},
+        {"pairwise_and", bench_pairwise<'&'>},
+        {"pairwise_or", bench_pairwise<'|'>},
+        {"pairwise_andnot", bench_pairwise<'-'>},
+        {"wide_union", bench_wide_union},
+        {"iterate", bench_iterate},
+    };
+    for (const auto& spec : all_datasets()) {
+        // Shared by the benchmarks of the dataset; loaded (or generated) once, before any timing
+        auto corpus = std::make_shared<Corpus>(load_dataset(spec));
+        if (replay_bitmaps && corpus->size() > replay_bitmaps) corpus->resize(replay_bitmaps);
+        for (const auto& [name, fn] : ops) {
+            std::string full_name = std::string(name) + "/" + spec.name;
+            benchmark::RegisterBenchmark(full_name.c_str(), [fn = fn, corpus](benchmark::State& state) {
+                fn(state, *corpus);
+            });
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (auto n = take_flag(argc, argv, "replay_bitmaps")) {
+        replay_bitmaps = std::stoul(*n);
+    }
+    register_all();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Streaming the first values of a set operation: materializing `a & b` (or `a | b`) and iterating it, against
+// iterating views::intersect / views::unite, which only evaluate the containers they reach.
+// Benchmark names read: <variant>/<values taken> (0 takes everything).
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include "views.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+
+constexpr uint64_t Universe = 1 << 22;
+
+struct Operands {
+    Bitmap a, b;
+
+    Operands() {
+        std::mt19937_64 rng(7);
+        for (uint64_t v = 0; v < Universe; v += 1 + rng() % 4) a.set(v);
+        for (uint64_t v = 0; v < Universe; v += 1 + rng() % 6) b.set(v);
+        a.run_optimize();
+        b.run_optimize();
+    }
+};
+
+template <typename Range>
+uint64_t take(const Range& range, int64_t n) {
+    uint64_t sum = 0;
+    int64_t taken = 0;
+    for (auto v : range) {
+        sum += v;
+        if (++taken == n) break;
+    }
+    return sum;
+}
+
+/// Adapts a bitmap to a range-for loop.
+struct BitmapRange {
+    const Bitmap& b;
+    auto begin() const { return b.begin(); }
+    auto end() const { return b.end(); }
+};
+
+void bench_materialize_and(benchmark::State& state) {
+    const Operands o;
+    for (auto _ : state) {
+        const Bitmap r = o.a & o.b;
+        benchmark::DoNotOptimize(take(BitmapRange{r}, state.range(0)));
+    }
+}
+
+void bench_view_intersect(benchmark::State& state) {
+    const Operands o;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(take(views::intersect(o.a, o.b), state.range(0)));
+    }
+}
+
+void bench_materialize_or(benchmark::State& state) {
+    const Operands o;
+    for (auto _ : state) {
+        const Bitmap r = o.a | o.b;
+        benchmark::DoNotOptimize(take(BitmapRange{r}, state.range(0)));
+    }
+}
+
+void bench_view_unite(benchmark::State& state) {
+    const Operands o;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(take(views::unite(o.a, o.b), state.range(0)));
+    }
+}
+}  // namespace
+
+BENCHMARK(bench_materialize_and)->Arg(4096)->Arg(0);
+BENCHMARK(bench_view_intersect)->Arg(4096)->Arg(0);
+BENCHMARK(bench_materialize_or)->Arg(4096)->Arg(0);
+BENCHMARK(bench_view_unite)->Arg(4096)->Arg(0);
+
+BENCHMARK_MAIN();
@@ -8,10 +8,15 @@
 #include "froaring_api/diff.h"
 #include "froaring_api/diff_inplace.h"
 #include "froaring_api/equal.h"
+#include "froaring_api/instrument.h"
 #include "froaring_api/intersects.h"
 #include "froaring_api/mix_ops.h"
+#include "froaring_api/optimize.h"
 #include "froaring_api/or.h"
 #include "froaring_api/or_inplace.h"
+#include "froaring_api/policy.h"
 #include "froaring_api/prelude.h"
+#include "froaring_api/rank.h"
 #include "froaring_api/rle_container.h"
+#include "froaring_api/test_many.h"
 #include "froaring_api/utils.h"
\ No newline at end of file
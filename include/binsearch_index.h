@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
+#include <vector>
 
 #include "api.h"
 #include "froaring_api/contains.h"
+#include "froaring_api/search.h"
 
 namespace froaring {
 
@@ -25,7 +29,13 @@ public:
     using RLESized = RLEContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
+    using PackedSized = PackedArrayContainer<WordType, DataBits>;
+    using ColdSized = ColdContainer<WordType, DataBits>;
     static constexpr size_t UseLinearScanThreshold = 8;
+    /// An index never holds more containers than there are distinct indexes.
+    static constexpr size_t MaxContainers = size_t(1) << IndexBits;
+    /// Bits of a value held by this layer, for the layers stacked above it (see multilevel.h).
+    static constexpr size_t ValueBits = IndexBits + DataBits;
 
     // handy local aliases
     using CTy = froaring::ContainerType;
@@ -34,13 +44,14 @@ public:
 public:
     explicit BinsearchIndex(SizeType size = 0, SizeType capacity = CONTAINERS_INIT_CAPACITY)
         : size(size),
-          capacity(std::max(capacity, size)),
-          containers(static_cast<ContainerHandle*>(malloc(capacity * sizeof(ContainerHandle)))) {
+          capacity(std::max({capacity, size, SizeType(1)})),
+          containers(static_cast<ContainerHandle*>(malloc(this->capacity * sizeof(ContainerHandle)))) {
         assert(containers && "Failed to allocate memory for containers");
+        FROARING_COUNT(Alloc);
     }
 
-    explicit BinsearchIndex(const BinsearchIndex& other) {
-        expand_to(other.size);
+    explicit BinsearchIndex(const BinsearchIndex& other) : froaring_container_t() {
+        expand_to(std::max(SizeType(other.size), SizeType(1)));
         for (SizeType i = 0; i < other.size; ++i) {
             containers[i].index = other.containers[i].index;
             containers[i].type = other.containers[i].type;
@@ -51,7 +62,11 @@ public:
     }
 
     explicit BinsearchIndex(BinsearchIndex&& other)
-        : size(std::move(other.size)), capacity(std::move(other.capacity)), containers(std::move(other.containers)) {}
+        : size(std::move(other.size)), capacity(std::move(other.capacity)), containers(std::move(other.containers)) {
+        other.size = 0;
+        other.capacity = 0;
+        other.containers = nullptr;
+    }
 
     void debug_print() const {
         for (SizeType i = 0; i < size; ++i) {
@@ -77,6 +92,22 @@ public:
                     static_cast<BitmapContainer<WordType, DataBits>*>(containers[i].ptr)->debug_print();
                     break;
                 }
+                case CTy::Full: {
+                    std::cout << BitmapSized::TotalBits << " (full)" << std::endl;
+                    break;
+                }
+                case CTy::PackedArray: {
+                    std::cout << int(static_cast<PackedSized*>(containers[i].ptr)->cardinality()) << " (packed)"
+                              << std::endl;
+                    static_cast<PackedSized*>(containers[i].ptr)->debug_print();
+                    break;
+                }
+                case CTy::Cold: {
+                    std::cout << int(static_cast<ColdSized*>(containers[i].ptr)->cardinality()) << " (cold)"
+                              << std::endl;
+                    static_cast<ColdSized*>(containers[i].ptr)->debug_print();
+                    break;
+                }
                 default:
                     FROARING_UNREACHABLE
             }
@@ -93,6 +124,7 @@ public:
             }
             return size;
         }
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_BRANCHY
         SizeType left = 0;
         SizeType right = size;
 
@@ -105,6 +137,23 @@ public:
             }
         }
         return left;
+#elif FROARING_SEARCH_MODE == FROARING_SEARCH_EYTZINGER
+        if (search_cache.stale()) {
+            search_cache.rebuild(containers, static_cast<SizeType>(size),
+                                 [](const ContainerHandle& c) { return c.index; });
+        }
+        return search_cache.lower_bound(index);
+#else
+        return branchless_lower_bound(containers, static_cast<SizeType>(size), index,
+                                      [](const ContainerHandle& c) { return c.index; });
+#endif
+    }
+
+    /// @brief Must be called whenever keys are inserted or removed, so that the search shadow gets rebuilt.
+    void invalidate_search_cache() {
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_EYTZINGER
+        search_cache.invalidate();
+#endif
     }
 
     // Check if `value` is present in the container
@@ -125,13 +174,67 @@ public:
                 return static_cast<ArrayContainer<WordType, DataBits>*>(containers[entry_pos].ptr)->test(data);
             case CTy::Bitmap:
                 return static_cast<BitmapContainer<WordType, DataBits>*>(containers[entry_pos].ptr)->test(data);
+            case CTy::Full:
+                return true;
+            case CTy::PackedArray:
+                return static_cast<PackedSized*>(containers[entry_pos].ptr)->test(data);
+            case CTy::Cold:
+                return static_cast<ColdSized*>(containers[entry_pos].ptr)->test(data);
             default:
                 FROARING_UNREACHABLE
         }
     }
 
+    /// @brief `out[i] = test(values[i])` for a batch of queries, in any order.
+    ///
+    /// Queries are resolved `Block` at a time: first the containers of the whole block are located and the touched
+    /// payloads prefetched, then all queries are probed, so that the cache misses of a block overlap. A repeated key
+    /// reuses the previous lookup, and the container after the previous one is tried before searching the index (the
+    /// next key of a dense ascending batch). Runs of queries on the same bitmap container are probed branch-free.
+    template <typename QueryType>
+    void test_many(const QueryType* values, size_t n, uint8_t* out) const {
+        constexpr size_t Block = 16;
+        SizeType pos[Block];  // the container of each query of the block, or `size`
+        SizeType last_pos = size;
+        QueryType last_key = 0;
+        for (size_t begin = 0; begin < n; begin += Block) {
+            const size_t len = std::min(Block, n - begin);
+            const QueryType* block = values + begin;
+            for (size_t i = 0; i < len; ++i) {
+                const QueryType key = block[i] >> DataBits;
+                if (begin + i == 0 || key != last_key) {
+                    const size_t next = static_cast<size_t>(last_pos) + 1;
+                    last_pos = (next < size && containers[next].index == key)
+                                   ? static_cast<SizeType>(next)
+                                   : lower_bound(static_cast<IndexType>(key));
+                    if (last_pos < size && containers[last_pos].index == key) {
+                        prefetch_container<WordType, DataBits>(containers[last_pos].ptr, containers[last_pos].type,
+                                                               static_cast<can_fit_t<DataBits>>(block[i]));
+                    } else {
+                        last_pos = size;
+                    }
+                    last_key = key;
+                }
+                pos[i] = last_pos;
+            }
+
+            for (size_t i = 0; i < len;) {
+                size_t end = i + 1;
+                while (end < len && pos[end] == pos[i]) ++end;
+                if (pos[i] == size) {
+                    for (size_t k = i; k < end; ++k) out[begin + k] = 0;
+                } else {
+                    container_test_many<WordType, DataBits>(containers[pos[i]].ptr, containers[pos[i]].type,
+                                                            block + i, end - i, out + begin + i);
+                }
+                i = end;
+            }
+        }
+    }
+
     // Set a value in the corresponding container
     void set(ValueType value) {
+        invalidate_cardinality_cache();
         can_fit_t<IndexBits> index;
         can_fit_t<DataBits> data;
         num2index_n_data<IndexBits, DataBits>(value, index, data);
@@ -143,25 +246,41 @@ public:
             if (size == capacity) {
                 expand();
             }
+            FROARING_COUNT(Memmove);
+            FROARING_COUNT_N(MemmoveBytes, (size - pos) * sizeof(ContainerHandle));
             std::memmove(&containers[pos + 1], &containers[pos], (size - pos) * sizeof(ContainerHandle));
             auto array_ptr = new ArraySized(ARRAY_CONTAINER_INIT_CAPACITY, 1);
             array_ptr->vals[0] = data;
             containers[pos] = ContainerHandle(array_ptr, CTy::Array, index);
             size++;
+            invalidate_search_cache();
             return;
         }
 
         // Now we found the corresponding container
+        if (is_encoded_array(containers[pos].type)) {  // read-only: unpack it, unless the value is already set
+            if (encoded_array_test<WordType, DataBits>(containers[pos].ptr, containers[pos].type, data)) {
+                return;
+            }
+            unpack_container<WordType, IndexType, DataBits>(containers[pos]);
+        }
+        unshare_container<WordType, IndexType, DataBits>(containers[pos]);
         switch (containers[pos].type) {
             case CTy::RLE: {
-                static_cast<RLEContainer<WordType, DataBits>*>(containers[pos].ptr)->set(data);
+                auto rle_ptr = static_cast<RLEContainer<WordType, DataBits>*>(containers[pos].ptr);
+                rle_ptr->set(data);
+                if (rle_ptr->is_full()) {  // e.g. the last gap of a time range gets filled
+                    release_container(rle_ptr);
+                    containers[pos].ptr = full_container();
+                    containers[pos].type = CTy::Full;
+                }
                 break;
             }
             case CTy::Array: {
                 auto array_ptr = static_cast<ArrayContainer<WordType, DataBits>*>(containers[pos].ptr);
                 array_ptr->set(data);
                 // Transform into a bitmap container if it gets bigger
-                if (array_ptr->size >= ArraySized::ArrayToBitmapCountThreshold) {
+                if (array_ptr->size > ContainerPolicy<WordType, DataBits>::ArrayMaxCardinality) {
                     auto new_bitmap = array_to_bitmap<WordType, DataBits>(array_ptr);
                     release_container(array_ptr);
                     containers[pos].ptr = new_bitmap;
@@ -173,12 +292,15 @@ public:
                 static_cast<BitmapContainer<WordType, DataBits>*>(containers[pos].ptr)->set(data);
                 break;
             }
+            case CTy::Full:
+                break;
             default:
                 FROARING_UNREACHABLE
         }
     }
 
     bool test_and_set(ValueType value) {
+        invalidate_cardinality_cache();
         can_fit_t<IndexBits> index;
         can_fit_t<DataBits> data;
         num2index_n_data<IndexBits, DataBits>(value, index, data);
@@ -190,15 +312,25 @@ public:
             if (size == capacity) {
                 expand();
             }
+            FROARING_COUNT(Memmove);
+            FROARING_COUNT_N(MemmoveBytes, (size - pos) * sizeof(ContainerHandle));
             std::memmove(&containers[pos + 1], &containers[pos], (size - pos) * sizeof(ContainerHandle));
             auto array_ptr = new ArraySized(ARRAY_CONTAINER_INIT_CAPACITY, 1);
             array_ptr->vals[0] = data;
             containers[pos] = ContainerHandle(array_ptr, CTy::Array, index);
             size++;
+            invalidate_search_cache();
             return true;
         }
 
         // Now we found the corresponding container
+        if (is_encoded_array(containers[pos].type)) {  // read-only: unpack it, unless the value is already set
+            if (encoded_array_test<WordType, DataBits>(containers[pos].ptr, containers[pos].type, data)) {
+                return false;
+            }
+            unpack_container<WordType, IndexType, DataBits>(containers[pos]);
+        }
+        unshare_container<WordType, IndexType, DataBits>(containers[pos]);
         switch (containers[pos].type) {
             case CTy::RLE: {
                 return static_cast<RLEContainer<WordType, DataBits>*>(containers[pos].ptr)->test_and_set(data);
@@ -207,7 +339,7 @@ public:
                 auto array_ptr = static_cast<ArrayContainer<WordType, DataBits>*>(containers[pos].ptr);
                 bool was_set = array_ptr->test_and_set(data);
                 // Transform into a bitmap container if it gets bigger
-                if (array_ptr->size >= ArraySized::ArrayToBitmapCountThreshold) {
+                if (array_ptr->size > ContainerPolicy<WordType, DataBits>::ArrayMaxCardinality) {
                     auto new_bitmap = array_to_bitmap<WordType, DataBits>(array_ptr);
                     release_container(array_ptr);
                     containers[pos].ptr = new_bitmap;
@@ -218,14 +350,19 @@ public:
             case CTy::Bitmap: {
                 return static_cast<BitmapContainer<WordType, DataBits>*>(containers[pos].ptr)->test_and_set(data);
             }
+            case CTy::Full:
+                return false;
             default:
                 FROARING_UNREACHABLE
         }
     }
 
     // Calculate the total cardinality of all containers
-    SizeType cardinality() const {
-        SizeType total = 0;
+    size_t cardinality() const {
+        if (!cardinality_cache_stale) {
+            return cardinality_cache[size];
+        }
+        size_t total = 0;
         for (SizeType i = 0; i < size; ++i) {
             auto& entry = containers[i];
             switch (entry.type) {
@@ -238,6 +375,15 @@ public:
                 case CTy::Bitmap:
                     total += static_cast<BitmapContainer<WordType, DataBits>*>(entry.ptr)->cardinality();
                     break;
+                case CTy::Full:
+                    total += BitmapSized::TotalBits;
+                    break;
+                case CTy::PackedArray:
+                    total += static_cast<PackedSized*>(entry.ptr)->cardinality();
+                    break;
+                case CTy::Cold:
+                    total += static_cast<ColdSized*>(entry.ptr)->cardinality();
+                    break;
                 default:
                     FROARING_UNREACHABLE
             }
@@ -245,7 +391,32 @@ public:
         return total;
     }
 
+    /// @brief The smallest value, or the largest ValueType if there is none.
+    ValueType minimum() const {
+        for (SizeType i = 0; i < size; ++i) {
+            if (!container_empty<WordType, DataBits>(containers[i].ptr, containers[i].type)) {
+                return static_cast<ValueType>(ValueType(containers[i].index) << DataBits |
+                                              container_minimum<WordType, DataBits>(containers[i].ptr,
+                                                                                    containers[i].type));
+            }
+        }
+        return std::numeric_limits<ValueType>::max();
+    }
+
+    /// @brief The largest value, or 0 if there is none.
+    ValueType maximum() const {
+        for (SizeType i = size; i > 0; --i) {
+            if (!container_empty<WordType, DataBits>(containers[i - 1].ptr, containers[i - 1].type)) {
+                return static_cast<ValueType>(ValueType(containers[i - 1].index) << DataBits |
+                                              container_maximum<WordType, DataBits>(containers[i - 1].ptr,
+                                                                                    containers[i - 1].type));
+            }
+        }
+        return 0;
+    }
+
     void reset(ValueType value) {
+        invalidate_cardinality_cache();
         can_fit_t<IndexBits> index;
         can_fit_t<DataBits> data;
         num2index_n_data<IndexBits, DataBits>(value, index, data);
@@ -259,6 +430,13 @@ public:
         assert(entry.index == index && "??? Wrong container found or created");
 
         // Now we found the corresponding container
+        if (is_encoded_array(entry.type)) {
+            if (!encoded_array_test<WordType, DataBits>(entry.ptr, entry.type, data)) {  // no need to unpack it
+                return;
+            }
+            unpack_container<WordType, IndexType, DataBits>(entry);
+        }
+        unshare_container<WordType, IndexType, DataBits>(entry);
         switch (entry.type) {
             case CTy::RLE: {
                 auto rle_ptr = static_cast<RLEContainer<WordType, DataBits>*>(entry.ptr);
@@ -266,8 +444,8 @@ public:
                 if (rle_ptr->run_count == 0) {
                     release_container(rle_ptr);
                     std::memmove(&containers[pos], &containers[pos + 1], (size - pos - 1) * sizeof(ContainerHandle));
-
                     size--;
+                    invalidate_search_cache();
                 }
                 break;
             }
@@ -278,6 +456,7 @@ public:
                     release_container(array_ptr);
                     std::memmove(&containers[pos], &containers[pos + 1], (size - pos - 1) * sizeof(ContainerHandle));
                     size--;
+                    invalidate_search_cache();
                 }
                 break;
             }
@@ -288,9 +467,17 @@ public:
                     release_container(bitmap_ptr);
                     std::memmove(&containers[pos], &containers[pos + 1], (size - pos - 1) * sizeof(ContainerHandle));
                     size--;
+                    invalidate_search_cache();
                 }
                 break;
             }
+            case CTy::Full: {  // materialize it: one value out of a full range leaves at most two runs
+                auto rle_ptr = full_to_rle<WordType, DataBits>();
+                rle_ptr->reset(data);
+                entry.ptr = rle_ptr;
+                entry.type = CTy::RLE;
+                break;
+            }
             default:
                 FROARING_UNREACHABLE
         }
@@ -300,6 +487,8 @@ public:
             release_container<WordType, DataBits>(containers[i].ptr, containers[i].type);
         }
         size = 0;
+        invalidate_search_cache();
+        invalidate_cardinality_cache();
     }
     // Release all containers
     ~BinsearchIndex() {
@@ -311,26 +500,17 @@ public:
 
     static BinsearchIndex<WordType, IndexBits, DataBits>* and_(const BinsearchIndex<WordType, IndexBits, DataBits>* a,
                                                                const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
-        auto result = new BinsearchIndex<WordType, IndexBits, DataBits>(0, a->size);
+        auto result = new BinsearchIndex<WordType, IndexBits, DataBits>(0, std::min(a->size, b->size));
         SizeType i = 0, j = 0;
         SizeType new_container_counts = 0;
-        while (true) {
-            while (a->containers[i].index < b->containers[j].index) {
-            SKIP_FIRST_COMPARE:
-                i++;
-                if (i == a->size) {
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            while (a->containers[i].index > b->containers[j].index) {
-                j++;
-                if (j == b->size) {
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            if (a->containers[i].index == b->containers[j].index) {
+        while (i < a->size && j < b->size) {
+            auto keya = a->containers[i].index;
+            auto keyb = b->containers[j].index;
+            if (keya < keyb) {
+                i = a->advanceUntil(keyb, i);
+            } else if (keya > keyb) {
+                j = b->advanceUntil(keya, j);
+            } else {
                 CTy local_res_type;
                 auto res =
                     froaring_and<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
@@ -338,101 +518,52 @@ public:
                 if (container_empty<WordType, DataBits>(res, local_res_type)) {
                     release_container<WordType, DataBits>(res, local_res_type);
                 } else {
-                    result->containers[new_container_counts++] =
-                        ContainerHandle(res, local_res_type, a->containers[i].index);
+                    result->containers[new_container_counts++] = ContainerHandle(res, local_res_type, keya);
                 }
                 i++;
                 j++;
-                if (i == a->size || j == b->size) {
-                    result->size = new_container_counts;
-                    return result;
-                }
-            } else {
-                goto SKIP_FIRST_COMPARE;
             }
         }
-        FROARING_UNREACHABLE
+        result->size = new_container_counts;
+        return result;
     }
 
     static BinsearchIndex<WordType, IndexBits, DataBits>* or_(const BinsearchIndex<WordType, IndexBits, DataBits>* a,
                                                               const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
-        auto result = new BinsearchIndex<WordType, IndexBits, DataBits>(0, a->size + b->size);
+        // The sum may not fit in SizeType (e.g. 2^IndexBits + 2^IndexBits): widen it, then clamp
+        auto result = new BinsearchIndex<WordType, IndexBits, DataBits>(
+            0, static_cast<SizeType>(std::min(static_cast<size_t>(a->size) + b->size, MaxContainers)));
         SizeType i = 0, j = 0;
         SizeType new_container_counts = 0;
-        while (true) {
-            while (a->containers[i].index < b->containers[j].index) {
-            SKIP_FIRST_COMPARE:
-                froaring_container_t* dup =
-                    duplicate_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
+        while (i < a->size && j < b->size) {
+            auto keya = a->containers[i].index;
+            auto keyb = b->containers[j].index;
+            if (keya < keyb) {
                 result->containers[new_container_counts++] =
-                    ContainerHandle(dup, a->containers[i].type, a->containers[i].index);
-                i++;
-                if (i == a->size) {
-                    while (j < b->size) {
-                        froaring_container_t* dup =
-                            duplicate_container<WordType, DataBits>(b->containers[j].ptr, b->containers[j].type);
-                        result->containers[new_container_counts++] =
-                            ContainerHandle(dup, b->containers[j].type, b->containers[j].index);
-                        j++;
-                    }
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            while (a->containers[i].index > b->containers[j].index) {
-                froaring_container_t* dup =
-                    duplicate_container<WordType, DataBits>(b->containers[j].ptr, b->containers[j].type);
+                    duplicate_container<WordType, IndexType, DataBits>(a->containers[i++]);
+            } else if (keya > keyb) {
                 result->containers[new_container_counts++] =
-                    ContainerHandle(dup, b->containers[j].type, b->containers[j].index);
-                j++;
-                if (j == b->size) {
-                    while (i < a->size) {
-                        froaring_container_t* dup =
-                            duplicate_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
-                        result->containers[new_container_counts++] =
-                            ContainerHandle(dup, a->containers[i].type, a->containers[i].index);
-                        i++;
-                    }
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            if (a->containers[i].index == b->containers[j].index) {
+                    duplicate_container<WordType, IndexType, DataBits>(b->containers[j++]);
+            } else {
                 CTy local_res_type;
                 auto res =
                     froaring_or<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
                                                     b->containers[j].type, local_res_type);
-                result->containers[new_container_counts++] =
-                    ContainerHandle(res, local_res_type, a->containers[i].index);
+                result->containers[new_container_counts++] = ContainerHandle(res, local_res_type, keya);
                 i++;
                 j++;
-                if (i == a->size) {
-                    while (j < b->size) {
-                        froaring_container_t* dup =
-                            duplicate_container<WordType, DataBits>(b->containers[j].ptr, b->containers[j].type);
-                        result->containers[new_container_counts++] =
-                            ContainerHandle(dup, b->containers[j].type, b->containers[j].index);
-                        j++;
-                    }
-                    result->size = new_container_counts;
-                    return result;
-                }
-                if (j == b->size) {
-                    while (i < a->size) {
-                        froaring_container_t* dup =
-                            duplicate_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
-                        result->containers[new_container_counts++] =
-                            ContainerHandle(dup, a->containers[i].type, a->containers[i].index);
-                        i++;
-                    }
-                    result->size = new_container_counts;
-                    return result;
-                }
-            } else {
-                goto SKIP_FIRST_COMPARE;
             }
         }
-        FROARING_UNREACHABLE
+        while (i < a->size) {
+            result->containers[new_container_counts++] =
+                duplicate_container<WordType, IndexType, DataBits>(a->containers[i++]);
+        }
+        while (j < b->size) {
+            result->containers[new_container_counts++] =
+                duplicate_container<WordType, IndexType, DataBits>(b->containers[j++]);
+        }
+        result->size = new_container_counts;
+        return result;
     }
 
     static BinsearchIndex<WordType, IndexBits, DataBits>* diff(const BinsearchIndex<WordType, IndexBits, DataBits>* a,
@@ -440,65 +571,39 @@ public:
         auto result = new BinsearchIndex<WordType, IndexBits, DataBits>(0, a->size);
         SizeType i = 0, j = 0;
         SizeType new_container_counts = 0;
-        while (true) {
-            while (a->containers[i].index < b->containers[j].index) {
-            SKIP_FIRST_COMPARE:
-                froaring_container_t* dup =
-                    duplicate_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
+        while (i < a->size) {
+            auto keya = a->containers[i].index;
+            j = b->advanceUntil(keya, j);
+            if (j == b->size || b->containers[j].index != keya) {  // nothing to subtract
                 result->containers[new_container_counts++] =
-                    ContainerHandle(dup, a->containers[i].type, a->containers[i].index);
-                i++;
-                if (i == a->size) {
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            while (a->containers[i].index > b->containers[j].index) {
-                j++;
-                if (j == b->size) {
-                    while (i < a->size) {
-                        froaring_container_t* dup =
-                            duplicate_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
-                        result->containers[new_container_counts++] =
-                            ContainerHandle(dup, a->containers[i].type, a->containers[i].index);
-                        i++;
-                    }
-                    result->size = new_container_counts;
-                    return result;
-                }
-            }
-            if (a->containers[i].index == b->containers[j].index) {
-                CTy local_res_type;
-                auto res =
-                    froaring_diff<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
-                                                      b->containers[j].type, local_res_type);
-                if (container_empty<WordType, DataBits>(res, local_res_type)) {
-                    release_container<WordType, DataBits>(res, local_res_type);
-                } else {
-                    result->containers[new_container_counts++] =
-                        ContainerHandle(res, local_res_type, a->containers[i].index);
-                }
-                i++;
-                j++;
-                if (i == a->size || j == b->size) {
-                    result->size = new_container_counts;
-                    return result;
-                }
+                    duplicate_container<WordType, IndexType, DataBits>(a->containers[i++]);
+                continue;
+            }
+            CTy local_res_type;
+            auto res = froaring_diff<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr,
+                                                         a->containers[i].type, b->containers[j].type, local_res_type);
+            if (container_empty<WordType, DataBits>(res, local_res_type)) {
+                release_container<WordType, DataBits>(res, local_res_type);
             } else {
-                goto SKIP_FIRST_COMPARE;
+                result->containers[new_container_counts++] = ContainerHandle(res, local_res_type, keya);
             }
+            i++;
+            j++;
         }
-        FROARING_UNREACHABLE
+        result->size = new_container_counts;
+        return result;
     }
 
     static void andi(BinsearchIndex<WordType, IndexBits, DataBits>* a,
                      const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
+        a->invalidate_cardinality_cache();
         SizeType i = 0, j = 0;
         SizeType new_container_counts = 0;
         while (i < a->size && j < b->size) {
             auto keya = a->containers[i].index;
             auto keyb = b->containers[j].index;
             if (keya == keyb) {
+                unshare_container<WordType, IndexType, DataBits>(a->containers[i]);
                 CTy local_res_type;
                 auto new_container =
                     froaring_andi<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
@@ -526,12 +631,15 @@ public:
             a->containers[i].ptr = nullptr;
         }
         a->size = new_container_counts;
+        a->invalidate_search_cache();
     }
     static void ori(BinsearchIndex<WordType, IndexBits, DataBits>* a,
                     const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
-        // TODO: tranform into RLE if a container is full
-        // TODO: handle full RLE specifically
+        a->invalidate_cardinality_cache();
 
+        if (b->size == 0) {
+            return;
+        }
         // FIXME: do we will ever have empty "BinsearchIndex" ?
         // Make sure this never happens, then remove this branch.
         if (a->size == 0) {
@@ -540,25 +648,26 @@ public:
                 a->containers[j] = duplicate_container<WordType, IndexType, DataBits>(b->containers[j]);
             }
             a->size = b->size;
+            a->invalidate_search_cache();
             return;
         }
-        if (b->size == 0) {
-            return;
-        }
-        a->expand_to(a->size + b->size);
+        a->invalidate_search_cache();
+        a->expand_to(static_cast<size_t>(a->size) + b->size);
         size_t i = 0, j = 0;
         while (true) {
             if (a->containers[i].index == b->containers[j].index) {
-                // TODO: only do this if a->containers[i] is full
-                CTy local_res_type;
-                auto new_container =
-                    froaring_ori<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
-                                                     b->containers[j].type, local_res_type);
-                if (new_container != a->containers[i].ptr) {  // New container is created: release the old one
-                    release_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
+                if (a->containers[i].type != CTy::Full) {  // a full container stays full: neither copy nor touch it
+                    unshare_container<WordType, IndexType, DataBits>(a->containers[i]);
+                    CTy local_res_type;
+                    auto new_container = froaring_ori<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr,
+                                                                          a->containers[i].type, b->containers[j].type,
+                                                                          local_res_type);
+                    if (new_container != a->containers[i].ptr) {  // New container is created: release the old one
+                        release_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
+                    }
+                    a->containers[i].ptr = new_container;
+                    a->containers[i].type = local_res_type;
                 }
-                a->containers[i].ptr = new_container;
-                a->containers[i].type = local_res_type;
                 ++i;
                 ++j;
                 if (i == a->size) break;
@@ -591,75 +700,57 @@ public:
     }
     static void diffi(BinsearchIndex<WordType, IndexBits, DataBits>* a,
                       const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
+        a->invalidate_cardinality_cache();
         SizeType i = 0, j = 0;
         SizeType new_container_counts = 0;
-        while (i < a->size && j < b->size) {
+        while (i < a->size) {
             auto keya = a->containers[i].index;
-            auto keyb = b->containers[j].index;
-            if (keya == keyb) {
-                CTy local_res_type;
-                auto new_container =
-                    froaring_diffi<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr,
-                                                       a->containers[i].type, b->containers[j].type, local_res_type);
-                if (new_container != a->containers[i].ptr) {  // New container is created: release the old one
-                    release_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
-                }
-
-                if (container_empty<WordType, DataBits>(new_container, local_res_type)) {
-                    release_container<WordType, DataBits>(new_container, local_res_type);
-                } else {
-                    a->containers[new_container_counts++] =
-                        ContainerHandle(new_container, local_res_type, a->containers[i].index);
-                }
-
-                ++i;
-                ++j;
-            } else if (keya < keyb) {
-                i = a->advanceAndReleaseUntil(keyb, i);
+            j = b->advanceUntil(keya, j);
+            if (j == b->size || b->containers[j].index != keya) {  // nothing to subtract: keep it
+                a->containers[new_container_counts++] = std::move(a->containers[i++]);
+                continue;
+            }
+            unshare_container<WordType, IndexType, DataBits>(a->containers[i]);
+            CTy local_res_type;
+            auto new_container =
+                froaring_diffi<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr, a->containers[i].type,
+                                                   b->containers[j].type, local_res_type);
+            if (new_container != a->containers[i].ptr) {  // New container is created: release the old one
+                release_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
+            }
+
+            if (container_empty<WordType, DataBits>(new_container, local_res_type)) {
+                release_container<WordType, DataBits>(new_container, local_res_type);
             } else {
-                j = b->advanceUntil(keya, j);
+                a->containers[new_container_counts++] = ContainerHandle(new_container, local_res_type, keya);
             }
-        }
-        // Release the rest of the containers
-        for (; i < a->size; ++i) {
-            release_container<WordType, DataBits>(a->containers[i].ptr, a->containers[i].type);
-            a->containers[i].ptr = nullptr;
+            ++i;
+            ++j;
         }
         a->size = new_container_counts;
+        a->invalidate_search_cache();
     }
 
     static bool intersects(const BinsearchIndex<WordType, IndexBits, DataBits>* a,
                            const BinsearchIndex<WordType, IndexBits, DataBits>* b) {
         SizeType i = 0, j = 0;
-        while (true) {
-            while (a->containers[i].index < b->containers[j].index) {
-            SKIP_FIRST_COMPARE:
-                i++;
-                if (i == a->size) {
-                    return false;
-                }
-            }
-            while (a->containers[i].index > b->containers[j].index) {
-                j++;
-                if (j == b->size) {
-                    return false;
-                }
-            }
-            if (a->containers[i].index == b->containers[j].index) {
+        while (i < a->size && j < b->size) {
+            auto keya = a->containers[i].index;
+            auto keyb = b->containers[j].index;
+            if (keya < keyb) {
+                i = a->advanceUntil(keyb, i);
+            } else if (keya > keyb) {
+                j = b->advanceUntil(keya, j);
+            } else {
                 if (froaring_intersects<WordType, DataBits>(a->containers[i].ptr, b->containers[j].ptr,
                                                             a->containers[i].type, b->containers[j].type)) {
                     return true;
                 }
                 i++;
                 j++;
-                if (i == a->size || j == b->size) {
-                    return false;
-                }
-            } else {
-                goto SKIP_FIRST_COMPARE;
             }
         }
-        FROARING_UNREACHABLE
+        return false;
     }
 
     static bool contains(const BinsearchIndex<WordType, IndexBits, DataBits>* a,
@@ -732,17 +823,162 @@ public:
         return true;
     }
 
+    /// @brief Convert every container into its smallest type, and drop empty containers.
+    void run_optimize() {
+        invalidate_cardinality_cache();
+        SizeType new_container_counts = 0;
+        for (SizeType i = 0; i < size; ++i) {
+            auto& entry = containers[i];
+            CTy new_type;
+            auto new_ptr = optimize_container<WordType, DataBits>(entry.ptr, entry.type, new_type);
+            if (new_ptr != entry.ptr) {
+                release_container<WordType, DataBits>(entry.ptr, entry.type);
+            }
+            if (container_empty<WordType, DataBits>(new_ptr, new_type)) {
+                release_container<WordType, DataBits>(new_ptr, new_type);
+                continue;
+            }
+            containers[new_container_counts++] = ContainerHandle(new_ptr, new_type, entry.index);
+        }
+        if (new_container_counts != size) {
+            size = new_container_counts;
+            invalidate_search_cache();
+        }
+    }
+
+    /// @brief Compress every container into a Cold one where that is smaller (see `compact_container`).
+    void compact_cold() {
+        for (SizeType i = 0; i < size; ++i) {
+            auto& entry = containers[i];
+            CTy new_type;
+            auto new_ptr = compact_container<WordType, DataBits>(entry.ptr, entry.type, new_type);
+            if (new_ptr != entry.ptr) {
+                release_container<WordType, DataBits>(entry.ptr, entry.type);
+                entry.ptr = new_ptr;
+                entry.type = new_type;
+            }
+        }
+    }
+
+    /// @brief A new index sharing every container with this one (copy-on-write): only the handles are copied.
+    BinsearchIndex* share() const {
+        auto copy = new BinsearchIndex(size, size);
+        for (SizeType i = 0; i < size; ++i) {
+            copy->containers[i] = ContainerHandle(
+                share_container<WordType, DataBits>(containers[i].ptr, containers[i].type), containers[i].type,
+                containers[i].index);
+        }
+        return copy;
+    }
+
+    /// @brief Bytes allocated for the index and all of its containers.
+    size_t memory_usage() const {
+        size_t bytes = sizeof(*this) + capacity * sizeof(ContainerHandle);
+        bytes += cardinality_cache.capacity() * sizeof(size_t);
+        for (SizeType i = 0; i < size; ++i) {
+            bytes += container_memory_usage<WordType, DataBits>(containers[i].ptr, containers[i].type);
+        }
+        return bytes;
+    }
+
+    /// @brief Release unused capacity of every container and of the index itself.
+    /// @return Bytes saved.
+    size_t shrink_to_fit() {
+        size_t saved = 0;
+        for (SizeType i = 0; i < size; ++i) {
+            saved += shrink_container<WordType, DataBits>(containers[i].ptr, containers[i].type);
+        }
+        SizeType new_cap = std::max(SizeType(size), SizeType(1));
+        if (new_cap < capacity) {
+            saved += (capacity - new_cap) * sizeof(ContainerHandle);
+            expand_to(new_cap);
+        }
+        return saved;
+    }
+
+    /// @brief Number of values not greater than `value`.
+    size_t rank(ValueType value) const {
+        can_fit_t<IndexBits> index;
+        can_fit_t<DataBits> data;
+        num2index_n_data<IndexBits, DataBits>(value, index, data);
+
+        SizeType pos = lower_bound(index);
+        size_t count = cardinality_prefix()[pos];
+        if (pos < size && containers[pos].index == index) {
+            count += container_rank<WordType, DataBits>(containers[pos].ptr, containers[pos].type, data);
+        }
+        return count;
+    }
+
+    /// @brief Find the `k`-th smallest value (0-based) with a binary search over the cardinality prefix sums.
+    /// @return false if there are no more than `k` values.
+    bool select(size_t k, ValueType& value) const {
+        const size_t* prefix = cardinality_prefix();
+        if (k >= prefix[size]) {
+            return false;
+        }
+        // The last container whose prefix is not greater than `k`
+        SizeType pos =
+            branchless_lower_bound(prefix, static_cast<SizeType>(size + 1), k + 1, [](size_t v) { return v; }) - 1;
+        auto data = container_select<WordType, DataBits>(containers[pos].ptr, containers[pos].type, k - prefix[pos]);
+        value = (static_cast<ValueType>(containers[pos].index) << DataBits) | data;
+        return true;
+    }
+
+    /// @brief Must be called whenever the cardinality of any container changes, so that the prefix sums used by
+    /// `rank` and `select` get rebuilt.
+    void invalidate_cardinality_cache() { cardinality_cache_stale = true; }
+
+    /// @brief Build the lazily computed caches (prefix sums, search shadow, bitmap cardinalities) now, so that const
+    /// queries write nothing until the next mutation.
+    void warm_caches() const {
+        cardinality_prefix();
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_EYTZINGER
+        if (search_cache.stale()) {
+            search_cache.rebuild(containers, static_cast<SizeType>(size),
+                                 [](const ContainerHandle& c) { return c.index; });
+        }
+#endif
+    }
+
     void expand() { expand_to(2 * capacity); }
 
     void expand_to(size_t new_cap) {
+        new_cap = std::min(new_cap, MaxContainers);
         containers = static_cast<ContainerHandle*>(realloc(containers, new_cap * sizeof(ContainerHandle)));
         assert(containers && "Failed to reallocate memory for containers");
+        FROARING_COUNT(Realloc);
         this->capacity = new_cap;
     }
 
 public:
-    IndexType size = 0;
-    IndexType capacity = 0;
+    // One bit wider than IndexType: a full index holds 2^IndexBits containers
+    SizeType size = 0;
+    SizeType capacity = 0;
     ContainerHandle* containers = nullptr;
+
+private:
+    /// @brief Prefix sums of the container cardinalities: entry `i` is the total cardinality of containers [0, i).
+    /// Built lazily on the first rank/select query after a mutation.
+    const size_t* cardinality_prefix() const {
+        if (cardinality_cache_stale) {
+            cardinality_cache.resize(static_cast<size_t>(size) + 1);
+            cardinality_cache[0] = 0;
+            for (SizeType i = 0; i < size; ++i) {
+                cardinality_cache[i + 1] =
+                    cardinality_cache[i] +
+                    container_cardinality<WordType, DataBits>(containers[i].ptr, containers[i].type);
+            }
+            cardinality_cache_stale = false;
+        }
+        return cardinality_cache.data();
+    }
+
+    mutable std::vector<size_t> cardinality_cache;
+    mutable bool cardinality_cache_stale = true;
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_EYTZINGER
+    /// Eytzinger-ordered shadow of the keys, rebuilt lazily after the keys change.
+    mutable EytzingerLayout<IndexType, SizeType> search_cache;
+#endif
 };
 }  // namespace froaring
\ No newline at end of file
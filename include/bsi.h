@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "froaring.h"
+
+namespace froaring {
+template <typename Bitmap>
+class BitSlicedIndex;
+
+/// @brief A bit-sliced index: maps ids (the values stored in a FlexibleRoaring) to unsigned integer attributes.
+///
+/// Slice `i` holds the ids whose attribute has bit `i` set, and the existence bitmap holds every id with an
+/// attribute. Range predicates and aggregates are evaluated slice by slice with the bitmap set operations, from the
+/// most significant bit down (O'Neil and Quass, "Improved Query Performance with Variant Indexes"), so their cost
+/// depends on the bit depth and the bitmap sizes, not on the number of ids.
+///
+/// Every predicate and aggregate takes an optional `filter`: only ids in it are considered.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+class BitSlicedIndex<FlexibleRoaring<WordType, IndexBits, DataBits>> {
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    using IdType = WordType;
+    using ValueType = uint64_t;
+
+    /// @brief Set (or overwrite) the attribute of `id`.
+    void set(IdType id, ValueType value) {
+        if (slices.size() < bit_width(value)) {
+            slices.reserve(8 * sizeof(ValueType));  // never reallocate: Bitmap moves are not noexcept
+            while (slices.size() < bit_width(value)) {
+                slices.emplace_back();
+            }
+        }
+        for (size_t i = 0; i < slices.size(); ++i) {
+            if ((value >> i) & 1) {
+                slices[i].set(id);
+            } else {
+                slices[i].reset(id);
+            }
+        }
+        exists.set(id);
+    }
+
+    /// @return Whether `id` has an attribute, written to `value`.
+    bool get(IdType id, ValueType& value) const {
+        if (!exists.test(id)) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < slices.size(); ++i) {
+            value |= ValueType(slices[i].test(id)) << i;
+        }
+        return true;
+    }
+
+    void erase(IdType id) {
+        for (auto& slice : slices) {
+            slice.reset(id);
+        }
+        exists.reset(id);
+    }
+
+    /// @brief Number of ids with an attribute.
+    size_t size() const { return exists.count(); }
+
+    /// @brief Number of bit slices, i.e. the bit width of the largest attribute set so far.
+    size_t bit_depth() const { return slices.size(); }
+
+    /// @brief The ids with an attribute.
+    const Bitmap& existence() const { return exists; }
+
+    Bitmap equal(ValueType x, const Bitmap* filter = nullptr) const { return compare(x, filter).eq; }
+    Bitmap less(ValueType x, const Bitmap* filter = nullptr) const { return compare(x, filter).lt; }
+    Bitmap greater(ValueType x, const Bitmap* filter = nullptr) const { return compare(x, filter).gt; }
+    Bitmap less_equal(ValueType x, const Bitmap* filter = nullptr) const {
+        auto r = compare(x, filter);
+        r.lt |= r.eq;
+        return std::move(r.lt);
+    }
+    Bitmap greater_equal(ValueType x, const Bitmap* filter = nullptr) const {
+        auto r = compare(x, filter);
+        r.gt |= r.eq;
+        return std::move(r.gt);
+    }
+
+    /// @brief The ids with `lo <= value <= hi`.
+    Bitmap between(ValueType lo, ValueType hi, const Bitmap* filter = nullptr) const {
+        if (lo > hi) {
+            return Bitmap();
+        }
+        Bitmap result = greater_equal(lo, filter);
+        return less_equal(hi, &result);
+    }
+
+    /// @brief Sum of the attributes of the considered ids: one intersection count per slice.
+    /// Wraps around on overflow.
+    ValueType sum(const Bitmap* filter = nullptr) const {
+        ValueType total = 0;
+        for (size_t i = 0; i < slices.size(); ++i) {
+            const size_t n = filter ? (slices[i] & *filter).count() : slices[i].count();
+            total += ValueType(n) << i;
+        }
+        return total;
+    }
+
+    /// @brief The smallest attribute of the considered ids.
+    /// @param ids If given, receives the ids holding it.
+    /// @return false if no id is considered.
+    bool min(ValueType& value, const Bitmap* filter = nullptr, Bitmap* ids = nullptr) const {
+        return extremum<false>(value, filter, ids);
+    }
+
+    /// @brief The largest attribute of the considered ids.
+    /// @param ids If given, receives the ids holding it.
+    /// @return false if no id is considered.
+    bool max(ValueType& value, const Bitmap* filter = nullptr, Bitmap* ids = nullptr) const {
+        return extremum<true>(value, filter, ids);
+    }
+
+    /// @brief The `k` considered ids with the largest attributes (all of them if fewer). Ties at the k-th value are
+    /// broken by taking the smallest ids.
+    Bitmap top_k(size_t k, const Bitmap* filter = nullptr) const {
+        Bitmap greater_ids;  // ids certainly in the top k
+        if (k == 0) {
+            return greater_ids;
+        }
+        Bitmap tied = candidates(filter);  // ids sharing the bits examined so far with the k-th largest value
+        size_t greater_count = 0;
+        for (size_t i = slices.size(); i > 0; --i) {
+            Bitmap tied_with_bit = tied & slices[i - 1];
+            const size_t with_bit = tied_with_bit.count();
+            if (greater_count + with_bit > k) {
+                tied = std::move(tied_with_bit);
+            } else {
+                greater_ids |= tied_with_bit;
+                greater_count += with_bit;
+                tied -= slices[i - 1];
+                if (greater_count == k) {
+                    return greater_ids;
+                }
+            }
+        }
+        // All of `tied` have the k-th largest value: fill up with the smallest of them. There may be fewer than k ids
+        // in total, so never size the buffer by k alone.
+        const size_t tied_count = tied.count();
+        if (tied_count == 0) {
+            return greater_ids;
+        }
+        std::vector<WordType> fill(std::min(k - greater_count, tied_count));
+        fill.resize(tied.take_first(fill.size(), fill.data()));
+        for (auto id : fill) {
+            greater_ids.set(id);
+        }
+        return greater_ids;
+    }
+
+private:
+    struct Comparison {
+        Bitmap lt, eq, gt;
+    };
+
+    static size_t bit_width(ValueType v) {
+        size_t width = 0;
+        while (v) {
+            ++width;
+            v >>= 1;
+        }
+        return width;
+    }
+
+    /// @brief The considered ids: those with an attribute, restricted to `filter`.
+    Bitmap candidates(const Bitmap* filter) const { return filter ? exists & *filter : exists.snapshot(); }
+
+    /// @brief Split the considered ids by how their attribute compares to `x`, in one pass over the slices.
+    Comparison compare(ValueType x, const Bitmap* filter) const {
+        Comparison r;
+        r.eq = candidates(filter);
+        if (bit_width(x) > slices.size()) {  // x exceeds every attribute
+            r.lt = std::move(r.eq);
+            r.eq = Bitmap();
+            return r;
+        }
+        for (size_t i = slices.size(); i > 0; --i) {
+            const Bitmap& slice = slices[i - 1];
+            if ((x >> (i - 1)) & 1) {
+                r.lt |= r.eq - slice;
+                r.eq &= slice;
+            } else {
+                r.gt |= r.eq & slice;
+                r.eq -= slice;
+            }
+        }
+        return r;
+    }
+
+    template <bool Largest>
+    bool extremum(ValueType& value, const Bitmap* filter, Bitmap* ids) const {
+        Bitmap remaining = candidates(filter);
+        if (remaining.count() == 0) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = slices.size(); i > 0; --i) {
+            // Keep the ids with bit i set (largest) or unset (smallest), if any
+            Bitmap preferred = Largest ? remaining & slices[i - 1] : remaining - slices[i - 1];
+            if (preferred.count() != 0) {
+                remaining = std::move(preferred);
+                value |= ValueType(Largest) << (i - 1);
+            } else {
+                value |= ValueType(!Largest) << (i - 1);
+            }
+        }
+        if (ids) {
+            *ids = std::move(remaining);
+        }
+        return true;
+    }
+
+    std::vector<Bitmap> slices;
+    Bitmap exists;
+};
+}  // namespace froaring
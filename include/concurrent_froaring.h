@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+
+#include "froaring.h"
+
+namespace froaring {
+/// @brief A FlexibleRoaring that can be updated and queried from many threads.
+///
+/// Containers are striped by their key (the high `IndexBits` of a value): stripe `key mod 2^StripeBits` owns an
+/// independent FlexibleRoaring holding exactly the containers with such keys, guarded by its own reader/writer lock.
+/// Writers touching different containers therefore rarely meet on the same lock, and the index layer of a stripe
+/// (including `BinsearchIndex::expand`) only ever grows under that stripe's exclusive lock.
+///
+/// Point queries take the shared lock of a single stripe. They do not validate optimistically against a version
+/// counter: writers realloc and free container buffers, so an unlocked reader could dereference freed memory.
+/// Const queries of a FlexibleRoaring fill lazy caches (search shadow, cardinalities), which readers sharing a stripe
+/// must not do concurrently. Writers only mark their stripe cold; the first reader to find it cold rebuilds the caches
+/// with `warm_caches` under the stripe's warm-up mutex, and every reader then queries a bitmap it writes nothing to.
+/// A burst of writes thus pays for one rebuild, on the next read, instead of one per write.
+///
+/// Operations spanning several stripes (`count`, `snapshot`) lock one stripe at a time: each stripe is seen
+/// consistently, but concurrent writes to other stripes may or may not be reflected.
+/// @tparam StripeBits log2 of the number of stripes.
+template <typename WordType = uint64_t, size_t IndexBits = 16, size_t DataBits = 8, size_t StripeBits = 6>
+class ConcurrentFlexibleRoaring {
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    static constexpr size_t StripeCount = size_t(1) << StripeBits;
+
+    ConcurrentFlexibleRoaring() = default;
+    ConcurrentFlexibleRoaring(const ConcurrentFlexibleRoaring&) = delete;
+    ConcurrentFlexibleRoaring& operator=(const ConcurrentFlexibleRoaring&) = delete;
+
+    void set(WordType num) {
+        auto& s = stripe(num);
+        std::unique_lock lock(s.mutex);
+        s.bitmap.set(num);
+        s.warm.store(false, std::memory_order_relaxed);
+    }
+
+    /// @return Whether `num` was newly set.
+    bool test_and_set(WordType num) {
+        auto& s = stripe(num);
+        std::unique_lock lock(s.mutex);
+        const bool added = s.bitmap.test_and_set(num);
+        s.warm.store(false, std::memory_order_relaxed);
+        return added;
+    }
+
+    void reset(WordType num) {
+        auto& s = stripe(num);
+        std::unique_lock lock(s.mutex);
+        s.bitmap.reset(num);
+        s.warm.store(false, std::memory_order_relaxed);
+    }
+
+    bool test(WordType num) const {
+        const auto& s = stripe(num);
+        std::shared_lock lock(s.mutex);
+        return warmed(s).test(num);
+    }
+
+    /// @brief Set `n` values, taking each stripe's lock once per run of consecutive values falling into it.
+    void set_many(const WordType* nums, size_t n) {
+        size_t i = 0;
+        while (i < n) {
+            auto& s = stripe(nums[i]);
+            std::unique_lock lock(s.mutex);
+            do {
+                s.bitmap.set(nums[i++]);
+            } while (i < n && &stripe(nums[i]) == &s);
+            s.warm.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    size_t count() const {
+        size_t total = 0;
+        for (const auto& s : stripes) {
+            std::shared_lock lock(s.mutex);
+            total += warmed(s).count();
+        }
+        return total;
+    }
+
+    void clear() {
+        for (auto& s : stripes) {
+            std::unique_lock lock(s.mutex);
+            s.bitmap.clear();
+            s.warm.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Merge all stripes into a plain FlexibleRoaring, e.g. to run set operations or iterate in order.
+    Bitmap snapshot() const {
+        Bitmap result;
+        for (const auto& s : stripes) {
+            std::shared_lock lock(s.mutex);
+            result |= warmed(s);
+        }
+        return result;
+    }
+
+private:
+    /// Each stripe on its own cache line(s), so that writers on neighbouring stripes do not false-share.
+    struct alignas(64) Stripe {
+        mutable std::shared_mutex mutex;
+        /// Whether the caches of `bitmap` are filled. Cleared by writers under the exclusive lock, set by `warmed`.
+        mutable std::atomic<bool> warm{false};
+        mutable std::mutex warm_mutex;
+        Bitmap bitmap;
+    };
+
+    /// @brief The stripe's bitmap with its lazy caches filled, so that concurrent const queries write nothing.
+    /// The caller holds the stripe's shared lock, which keeps writers out; readers race only to warm it, once.
+    static const Bitmap& warmed(const Stripe& s) {
+        if (!s.warm.load(std::memory_order_acquire)) {
+            std::lock_guard lock(s.warm_mutex);
+            if (!s.warm.load(std::memory_order_relaxed)) {
+                s.bitmap.warm_caches();
+                s.warm.store(true, std::memory_order_release);
+            }
+        }
+        return s.bitmap;
+    }
+
+    static size_t stripe_of(WordType num) { return static_cast<size_t>(num >> DataBits) & (StripeCount - 1); }
+    Stripe& stripe(WordType num) { return stripes[stripe_of(num)]; }
+    const Stripe& stripe(WordType num) const { return stripes[stripe_of(num)]; }
+
+    std::array<Stripe, StripeCount> stripes;
+};
+}  // namespace froaring
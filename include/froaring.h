@@ -6,6 +6,8 @@
 #include <iostream>
 #include <limits>
 #include <map>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include "api.h"
@@ -37,6 +39,8 @@ class FlexibleRoaring {
     using RLESized = RLEContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
+    using PackedSized = PackedArrayContainer<WordType, DataBits>;
+    using ColdSized = ColdContainer<WordType, DataBits>;
     using CTy = froaring::ContainerType;  // handy local alias
     using ContainerHandle = froaring::ContainerHandle<IndexType>;
     using iterator = FlexibleRoaringIterator<WordType, IndexBits, DataBits>;
@@ -86,12 +90,21 @@ public:
             case ContainerType::Containers:
                 handle.ptr = new ContainersSized(*static_cast<const ContainersSized*>(other.handle.ptr));
                 break;
+            case ContainerType::Full:
+                handle.ptr = full_container();
+                break;
+            case ContainerType::PackedArray:
+                handle.ptr = new PackedSized(*static_cast<const PackedSized*>(other.handle.ptr));
+                break;
+            case ContainerType::Cold:
+                handle.ptr = new ColdSized(*static_cast<const ColdSized*>(other.handle.ptr));
+                break;
             default:
                 FROARING_UNREACHABLE
         }
     }
 
-    FlexibleRoaring(FlexibleRoaring&& other) { handle = other.handle; }
+    FlexibleRoaring(FlexibleRoaring&& other) : handle(std::move(other.handle)) { other.handle.ptr = nullptr; }
 
     ~FlexibleRoaring() {
         if (!handle.ptr) {
@@ -122,16 +135,15 @@ public:
     }
 
     FlexibleRoaring& operator=(const FlexibleRoaring& other) {
-        if (!handle.ptr) {
-            if (handle.type == CTy::Containers) {
-                delete castToContainers(handle.ptr);
-            } else {
-                release_container<WordType, DataBits>(handle.ptr, handle.type);
-            }
+        if (this == &other) {
+            return *this;
         }
+        clear();
         handle.type = other.handle.type;
         handle.index = other.handle.index;
-        if (other.handle.type == CTy::Containers) {
+        if (!other.is_inited()) {
+            handle.ptr = nullptr;
+        } else if (other.handle.type == CTy::Containers) {
             handle.ptr = new ContainersSized(*castToContainers(other.handle.ptr));
         } else {
             handle.ptr = duplicate_container<WordType, DataBits>(other.handle.ptr, other.handle.type);
@@ -165,6 +177,20 @@ public:
                 castToContainers(handle.ptr)->debug_print();
                 break;
             }
+            case CTy::Full: {
+                std::cout << "FULL!" << std::endl;
+                break;
+            }
+            case CTy::PackedArray: {
+                std::cout << "PACKED ARRAY!" << std::endl;
+                static_cast<PackedSized*>(handle.ptr)->debug_print();
+                break;
+            }
+            case CTy::Cold: {
+                std::cout << "COLD!" << std::endl;
+                static_cast<ColdSized*>(handle.ptr)->debug_print();
+                break;
+            }
             default:
                 FROARING_UNREACHABLE
         }
@@ -284,6 +310,13 @@ public:
             return;
         }
 
+        if (is_encoded_array(handle.type)) {
+            if (encoded_array_test<WordType, DataBits>(handle.ptr, handle.type, data)) {  // no need to unpack it
+                return;
+            }
+            unpack_container<WordType, IndexType, DataBits>(handle);
+        }
+        unshare_single();
         switch (handle.type) {
             case CTy::Array:
                 static_cast<ArrayContainer<WordType, DataBits>*>(handle.ptr)->set(data);
@@ -291,8 +324,15 @@ public:
             case CTy::Bitmap:
                 static_cast<BitmapContainer<WordType, DataBits>*>(handle.ptr)->set(data);
                 break;
-            case CTy::RLE:
-                static_cast<RLEContainer<WordType, DataBits>*>(handle.ptr)->set(data);
+            case CTy::RLE: {
+                auto rle_ptr = static_cast<RLEContainer<WordType, DataBits>*>(handle.ptr);
+                rle_ptr->set(data);
+                if (rle_ptr->is_full()) {
+                    updateSingleHandle(full_container(), CTy::Full);
+                }
+                break;
+            }
+            case CTy::Full:
                 break;
             default:
                 FROARING_UNREACHABLE
@@ -326,6 +366,12 @@ public:
                 return index == handle.index && static_cast<RLEContainer<WordType, DataBits>*>(handle.ptr)->test(data);
             case CTy::Containers:
                 return castToContainers(handle.ptr)->test(num);
+            case CTy::Full:
+                return index == handle.index;
+            case CTy::PackedArray:
+                return static_cast<const PackedSized*>(handle.ptr)->test(data);
+            case CTy::Cold:
+                return static_cast<const ColdSized*>(handle.ptr)->test(data);
             default:
                 FROARING_UNREACHABLE
         }
@@ -333,6 +379,32 @@ public:
         return false;
     }
 
+    /// @brief `out[i] = test(values[i])` for a batch of queries, in any order; cheapest when sorted or clustered.
+    /// See `BinsearchIndex::test_many`.
+    void test_many(std::span<const WordType> values, uint8_t* out) const {
+        if (!is_inited()) {
+            std::memset(out, 0, values.size());
+            return;
+        }
+        if (handle.type == CTy::Containers) {
+            castToContainers(handle.ptr)->test_many(values.data(), values.size(), out);
+            return;
+        }
+        // Single container: probe the queries of each run that hits it at once
+        size_t i = 0;
+        while (i < values.size()) {
+            const bool hit = (values[i] >> DataBits) == handle.index;
+            size_t end = i + 1;
+            while (end < values.size() && ((values[end] >> DataBits) == handle.index) == hit) ++end;
+            if (hit) {
+                container_test_many<WordType, DataBits>(handle.ptr, handle.type, values.data() + i, end - i, out + i);
+            } else {
+                std::memset(out + i, 0, end - i);
+            }
+            i = end;
+        }
+    }
+
     bool test_and_set(WordType num) {
         can_fit_t<IndexBits> index;
         can_fit_t<DataBits> data;
@@ -355,6 +427,13 @@ public:
             return true;
         }
 
+        if (is_encoded_array(handle.type)) {
+            if (encoded_array_test<WordType, DataBits>(handle.ptr, handle.type, data)) {  // no need to unpack it
+                return false;
+            }
+            unpack_container<WordType, IndexType, DataBits>(handle);
+        }
+        unshare_single();
         switch (handle.type) {
             case CTy::Array:
                 return static_cast<ArrayContainer<WordType, DataBits>*>(handle.ptr)->test_and_set(data);
@@ -364,6 +443,8 @@ public:
                 return static_cast<RLEContainer<WordType, DataBits>*>(handle.ptr)->test_and_set(data);
             case CTy::Containers:
                 return castToContainers(handle.ptr)->test_and_set(num);
+            case CTy::Full:
+                return false;
             default:
                 FROARING_UNREACHABLE
         }
@@ -386,7 +467,22 @@ public:
             return;
         }
 
-        switch (handle.type) {
+        if (handle.type == CTy::Full) {  // materialize it: one value out of a full range leaves at most two runs
+            auto rle_ptr = full_to_rle<WordType, DataBits>();
+            rle_ptr->reset(data);
+            handle.ptr = rle_ptr;
+            handle.type = CTy::RLE;
+            return;
+        }
+        if (is_encoded_array(handle.type)) {
+            if (!encoded_array_test<WordType, DataBits>(handle.ptr, handle.type, data)) {  // no need to unpack it
+                return;
+            }
+            unpack_container<WordType, IndexType, DataBits>(handle);
+        }
+        const CTy type = handle.type;  // unshare_single() keeps the type: read it once
+        unshare_single();
+        switch (type) {
             case CTy::Array:
                 static_cast<ArrayContainer<WordType, DataBits>*>(handle.ptr)->reset(data);
                 break;
@@ -419,12 +515,117 @@ public:
                 return static_cast<RLEContainer<WordType, DataBits>*>(handle.ptr)->cardinality();
             case CTy::Containers:
                 return castToContainers(handle.ptr)->cardinality();
+            case CTy::Full:
+                return BitmapSized::TotalBits;
+            case CTy::PackedArray:
+                return static_cast<const PackedSized*>(handle.ptr)->cardinality();
+            case CTy::Cold:
+                return static_cast<const ColdSized*>(handle.ptr)->cardinality();
             default:
                 FROARING_UNREACHABLE
         }
         return 0;
     }
 
+    /// @brief Number of elements not greater than `num`.
+    size_t rank(WordType num) const {
+        if (!is_inited()) {
+            return 0;
+        }
+        if (handle.type == CTy::Containers) {
+            return castToContainers(handle.ptr)->rank(num);
+        }
+        can_fit_t<IndexBits> index;
+        can_fit_t<DataBits> data;
+        num2index_n_data<IndexBits, DataBits>(num, index, data);
+        if (index != handle.index) {
+            return index < handle.index ? 0 : count();
+        }
+        return container_rank<WordType, DataBits>(handle.ptr, handle.type, data);
+    }
+
+    /// @brief Find the `k`-th smallest element (0-based).
+    /// @return false if there are no more than `k` elements, in which case `num` is untouched.
+    bool select(size_t k, WordType& num) const {
+        if (!is_inited()) {
+            return false;
+        }
+        if (handle.type == CTy::Containers) {
+            can_fit_t<IndexBits + DataBits> value;
+            if (!castToContainers(handle.ptr)->select(k, value)) {
+                return false;
+            }
+            num = value;
+            return true;
+        }
+        if (k >= count()) {
+            return false;
+        }
+        num = (static_cast<WordType>(handle.index) << DataBits) |
+              container_select<WordType, DataBits>(handle.ptr, handle.type, k);
+        return true;
+    }
+
+    /// @brief Number of elements in [lo, hi], inclusive.
+    size_t range_cardinality(WordType lo, WordType hi) const {
+        if (lo > hi) {
+            return 0;
+        }
+        return rank(hi) - (lo == 0 ? 0 : rank(lo - 1));
+    }
+
+    /// @brief The smallest element, or the largest value of WordType if the bitmap is empty.
+    WordType minimum() const {
+        auto [entries, entry_count] = container_handles();
+        for (size_t i = 0; i < entry_count; ++i) {
+            if (!container_empty<WordType, DataBits>(entries[i].ptr, entries[i].type)) {
+                return (static_cast<WordType>(entries[i].index) << DataBits) |
+                       container_minimum<WordType, DataBits>(entries[i].ptr, entries[i].type);
+            }
+        }
+        return std::numeric_limits<WordType>::max();
+    }
+
+    /// @brief The largest element, or 0 if the bitmap is empty.
+    WordType maximum() const {
+        auto [entries, entry_count] = container_handles();
+        for (size_t i = entry_count; i > 0; --i) {
+            if (!container_empty<WordType, DataBits>(entries[i - 1].ptr, entries[i - 1].type)) {
+                return (static_cast<WordType>(entries[i - 1].index) << DataBits) |
+                       container_maximum<WordType, DataBits>(entries[i - 1].ptr, entries[i - 1].type);
+            }
+        }
+        return 0;
+    }
+
+    /// @brief Write the (at most) `n` smallest elements to `out` in ascending order, visiting only the containers
+    /// that hold them.
+    /// @return Number of elements written.
+    size_t take_first(size_t n, WordType* out) const {
+        auto [entries, entry_count] = container_handles();
+        size_t written = 0;
+        for (size_t i = 0; i < entry_count && written < n; ++i) {
+            const WordType base = static_cast<WordType>(entries[i].index) << DataBits;
+            written += container_take_first<WordType, DataBits>(entries[i].ptr, entries[i].type, n - written, base,
+                                                                out + written);
+        }
+        return written;
+    }
+
+    /// @brief Write the (at most) `n` largest elements to `out` in descending order, visiting only the containers
+    /// that hold them.
+    /// @return Number of elements written.
+    size_t take_last(size_t n, WordType* out) const {
+        auto [entries, entry_count] = container_handles();
+        size_t written = 0;
+        for (size_t i = entry_count; i > 0 && written < n; --i) {
+            const WordType base = static_cast<WordType>(entries[i - 1].index) << DataBits;
+            written += container_take_last<WordType, DataBits>(entries[i - 1].ptr, entries[i - 1].type, n - written,
+                                                               base, out + written);
+        }
+        return written;
+    }
+
     /// This invalidates the handle!
     inline void clear() {
         if (!is_inited()) {
@@ -435,6 +636,9 @@ public:
             case CTy::Array:
             case CTy::Bitmap:
             case CTy::RLE:
+            case CTy::Full:
+            case CTy::PackedArray:
+            case CTy::Cold:
                 release_container<WordType, DataBits>(handle.ptr, handle.type);
                 break;
             case CTy::Containers: {
@@ -470,10 +674,16 @@ public:
         if (!is_inited()) {
             return (other.count() == 0);
         }
+        if (!other.is_inited()) {
+            return (count() == 0);
+        }
         if (handle.type == CTy::Containers && other.handle.type == CTy::Containers) {
             return ContainersSized::equals(castToContainers(handle.ptr), castToContainers(other.handle.ptr));
         }
         if (handle.type == CTy::Containers) {  // the other is a single container
+            if (castToContainers(handle.ptr)->size != 1) {
+                return false;
+            }
             const ContainerHandle& lhs = castToContainers(handle.ptr)->containers[0];
             const ContainerHandle& rhs = other.handle;
             if (lhs.index != rhs.index) {
@@ -481,9 +691,12 @@ public:
             }
             return froaring_equal<WordType, DataBits>(lhs.ptr, rhs.ptr, lhs.type, rhs.type);
         }
-        if (other.handle.type == CTy::Containers) {  // other is a single container
-            const ContainerHandle& lhs = castToContainers(other.handle.ptr)->containers[0];
-            const ContainerHandle& rhs = other.handle;
+        if (other.handle.type == CTy::Containers) {  // this is a single container
+            if (castToContainers(other.handle.ptr)->size != 1) {
+                return false;
+            }
+            const ContainerHandle& lhs = handle;
+            const ContainerHandle& rhs = castToContainers(other.handle.ptr)->containers[0];
             if (lhs.index != rhs.index) {
                 return false;
             }
@@ -495,6 +708,184 @@ public:
     bool operator!=(const FlexibleRoaring& other) const { return !(*this == other); }
 
     FlexibleRoaring operator&(const FlexibleRoaring& other) const noexcept {
+        FlexibleRoaring result = and_impl(other);
+        result.apply_post_pass();
+        return result;
+    }
+
+    FlexibleRoaring& operator&=(const FlexibleRoaring& other) noexcept {
+        andi_impl(other);
+        apply_post_pass();
+        return *this;
+    }
+
+    FlexibleRoaring operator|(const FlexibleRoaring& other) const noexcept {
+        FlexibleRoaring result = or_impl(other);
+        result.apply_post_pass();
+        return result;
+    }
+
+    FlexibleRoaring& operator|=(const FlexibleRoaring& other) noexcept {
+        ori_impl(other);
+        apply_post_pass();
+        return *this;
+    }
+
+    FlexibleRoaring operator-(const FlexibleRoaring& other) const noexcept {
+        FlexibleRoaring result = diff_impl(other);
+        result.apply_post_pass();
+        return result;
+    }
+
+    FlexibleRoaring& operator-=(const FlexibleRoaring& other) noexcept {
+        diffi_impl(other);
+        apply_post_pass();
+        return *this;
+    }
+
+    void intersectWithComplement(const FlexibleRoaring& other) noexcept { *this -= other; }
+
+    /// @brief Overwrite current FlexibleRoaring with the result of lhs-rhs.
+    void intersectWithComplement(const FlexibleRoaring& lhs, const FlexibleRoaring& rhs) noexcept {
+        *this = lhs;
+        *this -= rhs;
+    }
+
+    /// @brief Convert every container into whichever container type is the smallest for its exact cardinality
+    /// and run count. Empty containers are dropped, and an index left with a single container collapses into it.
+    /// Cold containers (see `compact_cold`) are kept as they are.
+    FlexibleRoaring& run_optimize() {
+        if (!is_inited()) {
+            return *this;
+        }
+        if (handle.type == CTy::Containers) {
+            castToContainers(handle.ptr)->run_optimize();
+            collapse_index();
+            return *this;
+        }
+        CTy new_type;
+        auto ptr = optimize_container<WordType, DataBits>(handle.ptr, handle.type, new_type);
+        updateSingleHandle(ptr, new_type);
+        return *this;
+    }
+
+    /// @brief Compress every container into a read-only Cold container where that is smaller, for bitmaps that are
+    /// rarely queried: lookups and intersections then decode only the blocks they hit, and other set operations
+    /// decode whole containers. Setting or resetting a value of a Cold container decompresses it.
+    FlexibleRoaring& compact_cold() {
+        if (!is_inited()) {
+            return *this;
+        }
+        if (handle.type == CTy::Containers) {
+            castToContainers(handle.ptr)->compact_cold();
+            return *this;
+        }
+        CTy new_type;
+        auto ptr = compact_container<WordType, DataBits>(handle.ptr, handle.type, new_type);
+        updateSingleHandle(ptr, new_type);
+        return *this;
+    }
+
+    /// @brief Bytes allocated for this bitmap, including unused capacity.
+    size_t memory_usage() const {
+        if (!is_inited()) {
+            return sizeof(*this);
+        }
+        if (handle.type == CTy::Containers) {
+            return sizeof(*this) + castToContainers(handle.ptr)->memory_usage();
+        }
+        return sizeof(*this) + container_memory_usage<WordType, DataBits>(handle.ptr, handle.type);
+    }
+
+    /// @brief Release unused capacity of all containers (and of the index layer).
+    FlexibleRoaring& shrink_to_fit() {
+        if (!is_inited()) {
+            return *this;
+        }
+        if (handle.type == CTy::Containers) {
+            castToContainers(handle.ptr)->shrink_to_fit();
+        } else {
+            shrink_container<WordType, DataBits>(handle.ptr, handle.type);
+        }
+        return *this;
+    }
+
+    /// @brief Build all lazily computed caches now. Afterwards, const member functions perform no writes until the
+    /// next mutation, so the bitmap can be read from several threads at once.
+    void warm_caches() const {
+        if (!is_inited()) {
+            return;
+        }
+        if (handle.type == CTy::Containers) {
+            castToContainers(handle.ptr)->warm_caches();
+        } else if (handle.type == CTy::Bitmap) {
+            static_cast<const BitmapSized*>(handle.ptr)->cardinality();
+        }
+    }
+
+    /// @brief An immutable-by-convention copy that shares all containers with this bitmap (copy-on-write): it costs
+    /// one pointer copy per container, and whichever side is mutated later clones only the containers it touches.
+    ///
+    /// Must not race with mutations of this bitmap; afterwards, the snapshot may be handed to reader threads while
+    /// this bitmap keeps being updated. Its caches are warmed (see `warm_caches`), so any number of threads may read it
+    /// at once. Shared containers are counted by `memory_usage` of every owner.
+    FlexibleRoaring snapshot() const {
+        if (!is_inited()) {
+            return FlexibleRoaring();
+        }
+        FlexibleRoaring result =
+            handle.type == CTy::Containers
+                ? FlexibleRoaring(castToContainers(handle.ptr)->share(), CTy::Containers, ANY_INDEX)
+                : FlexibleRoaring(share_container<WordType, DataBits>(handle.ptr, handle.type), handle.type,
+                                  handle.index);
+        result.warm_caches();
+        return result;
+    }
+
+private:
+    /// @brief Take a private copy of the single container before mutating it in place, if it is shared.
+    void unshare_single() { handle.ptr = unshare_container<WordType, DataBits>(handle.ptr, handle.type); }
+
+    /// @brief Apply the post-pass selected by FROARING_SET_OP_POST_PASS to the result of a set operation.
+    void apply_post_pass() {
+        if constexpr ((FROARING_SET_OP_POST_PASS & FROARING_POST_PASS_RUN_OPTIMIZE) != 0) {
+            run_optimize();
+        }
+        if constexpr ((FROARING_SET_OP_POST_PASS & FROARING_POST_PASS_SHRINK_TO_FIT) != 0) {
+            shrink_to_fit();
+        }
+    }
+
+    /// @brief All containers in key order: the index entries, or the single container (if any).
+    std::pair<const ContainerHandle*, size_t> container_handles() const {
+        if (!is_inited()) {
+            return {nullptr, 0};
+        }
+        if (handle.type == CTy::Containers) {
+            auto containers = castToContainers(handle.ptr);
+            return {containers->containers, containers->size};
+        }
+        return {&handle, 1};
+    }
+
+    /// @brief Turn an index holding no or only one container back into an uninitialized or a single container bitmap.
+    void collapse_index() {
+        auto containers = castToContainers(handle.ptr);
+        if (containers->size > 1) {
+            return;
+        }
+        if (containers->size == 0) {
+            delete containers;
+            handle = ContainerHandle(nullptr, CTy::Array, UNKNOWN_INDEX);
+            return;
+        }
+        ContainerHandle single = std::move(containers->containers[0]);
+        containers->size = 0;
+        delete containers;
+        handle = std::move(single);
+    }
+
+    FlexibleRoaring and_impl(const FlexibleRoaring& other) const noexcept {
         if (!is_inited() || !other.is_inited()) {
             return FlexibleRoaring<WordType, IndexBits, DataBits>();
         }
@@ -560,15 +951,15 @@ public:
         return FlexibleRoaring<WordType, IndexBits, DataBits>(ptr, local_res_type, handle.index);
     }
 
-    FlexibleRoaring& operator&=(const FlexibleRoaring& other) noexcept {
+    void andi_impl(const FlexibleRoaring& other) noexcept {
         if (!is_inited() || !other.is_inited()) {
             clear();
-            return *this;
+            return;
         }
         // Both containers
         if (handle.type == CTy::Containers && other.handle.type == CTy::Containers) {
             ContainersSized::andi(castToContainers(handle.ptr), castToContainers(other.handle.ptr));
-            return *this;
+            return;
         }
 
         // One of them are containers: the result must be a single container
@@ -578,70 +969,58 @@ public:
             auto pos = this_containers->lower_bound(other_single.index);
             if (pos == this_containers->size || this_containers->containers[pos].index != other_single.index) {
                 clear();
-                return *this;
+                return;
             }
             // Now we found the corresponding container
+            unshare_container<WordType, IndexType, DataBits>(this_containers->containers[pos]);
             CTy local_res_type;
             auto ptr = froaring_andi<WordType, DataBits>(this_containers->containers[pos].ptr, other_single.ptr,
                                                          this_containers->containers[pos].type, other_single.type,
                                                          local_res_type);
-            if (ptr != this_containers->containers[pos].ptr) {
-                // All containers should be released
-                castToContainers(handle.ptr)->clear();
-                delete castToContainers(handle.ptr);
-            } else {
-                // All containers except the corresponding one should be released
-                for (size_t i = 0; i < pos; ++i) {
-                    release_container<WordType, DataBits>(this_containers->containers[i].ptr,
-                                                          this_containers->containers[i].type);
-                }
-                for (size_t i = pos + 1; i < this_containers->size; ++i) {
-                    release_container<WordType, DataBits>(this_containers->containers[i].ptr,
-                                                          this_containers->containers[i].type);
-                }
-                delete this->handle.ptr;
+            if (ptr == this_containers->containers[pos].ptr) {
+                // Detach the corresponding container, so that it survives releasing the others
+                this_containers->containers[pos].ptr = nullptr;
             }
+            // All (remaining) containers should be released
+            this_containers->clear();
+            delete this_containers;
             this->handle = ContainerHandle(ptr, local_res_type, other_single.index);
-            return *this;
+            if (container_empty<WordType, DataBits>(ptr, local_res_type)) {
+                clear();
+            }
+            return;
         }
         if (other.handle.type == CTy::Containers) {  // this is a single container
-            auto other_containers = castToContainers(handle.ptr);
+            auto other_containers = castToContainers(other.handle.ptr);
             const ContainerHandle& this_single = handle;
             auto pos = other_containers->lower_bound(this_single.index);
             if (pos == other_containers->size || other_containers->containers[pos].index != this_single.index) {
                 clear();
-                return *this;
+                return;
             }
+            unshare_single();
             CTy local_res_type;
             auto ptr = froaring_andi<WordType, DataBits>(this_single.ptr, other_containers->containers[pos].ptr,
                                                          this_single.type, other_containers->containers[pos].type,
                                                          local_res_type);
             updateSingleHandle(ptr, local_res_type);
-            return *this;
+            return;
         }
         // Both are single container:
         if (handle.index != other.handle.index) {
             clear();
-            return *this;
+            return;
         }
+        unshare_single();
         CTy local_res_type;
         auto ptr = froaring_andi<WordType, DataBits>(handle.ptr, other.handle.ptr, handle.type, other.handle.type,
                                                      local_res_type);
         // new container has been created, and the old one should be released by the caller
         // (i.e., this function)
         updateSingleHandle(ptr, local_res_type);
-        return *this;
-    }
-
-    void intersectWithComplement(const FlexibleRoaring& other) noexcept { *this -= other; }
-
-    /// @brief Overwrite current FlexibleRoaring with the result of lhs-rhs.
-    void intersectWithComplement(const FlexibleRoaring& lhs, const FlexibleRoaring& rhs) noexcept {
-        *this = lhs;
-        *this -= rhs;
     }
 
-    FlexibleRoaring operator|(const FlexibleRoaring& other) const noexcept {
+    FlexibleRoaring or_impl(const FlexibleRoaring& other) const noexcept {
         if (!is_inited()) {
             return FlexibleRoaring<WordType, IndexBits, DataBits>(other);
         }
@@ -656,6 +1035,14 @@ public:
                                                        local_res_type);
             return FlexibleRoaring<WordType, IndexBits, DataBits>(ptr, local_res_type, handle.index);
         }
+        if (handle.type != CTy::Containers && other.handle.type != CTy::Containers) {  // different indexes
+            auto new_containers = new ContainersSized(2, 2);
+            const ContainerHandle& lower = handle.index < other.handle.index ? handle : other.handle;
+            const ContainerHandle& upper = handle.index < other.handle.index ? other.handle : handle;
+            new_containers->containers[0] = duplicate_container<WordType, IndexType, DataBits>(lower);
+            new_containers->containers[1] = duplicate_container<WordType, IndexType, DataBits>(upper);
+            return FlexibleRoaring<WordType, IndexBits, DataBits>(new_containers, CTy::Containers, ANY_INDEX);
+        }
 
         // Both are containers
         if (handle.type == CTy::Containers && other.handle.type == CTy::Containers) {
@@ -677,7 +1064,7 @@ public:
 
         auto pos = containers->lower_bound(single->index);
         auto result_ctns = new ContainersSized(0, containers->size + 1);
-        typename ContainersSized::IndexType new_size = 0;
+        typename ContainersSized::SizeType new_size = 0;
         // before pos
         for (size_t i = 0; i < pos; ++i) {
             result_ctns->containers[new_size++] =
@@ -704,17 +1091,18 @@ public:
         return FlexibleRoaring<WordType, IndexBits, DataBits>(result_ctns, CTy::Containers, ANY_INDEX);
     }
 
-    FlexibleRoaring& operator|=(const FlexibleRoaring& other) noexcept {
+    void ori_impl(const FlexibleRoaring& other) noexcept {
         if (!is_inited()) {
-            this->handle = duplicate_container<WordType, IndexType, DataBits>(other.handle);
-            return *this;
+            *this = other;
+            return;
         }
         if (!other.is_inited()) {
-            return *this;
+            return;
         }
         // Both are single container:
         if (handle.type != CTy::Containers && other.handle.type != CTy::Containers) {
             if (handle.index == other.handle.index) {
+                unshare_single();
                 CTy local_res_type;
                 auto ptr = froaring_ori<WordType, DataBits>(handle.ptr, other.handle.ptr, handle.type,
                                                             other.handle.type, local_res_type);
@@ -725,7 +1113,7 @@ public:
                 }
                 handle.ptr = ptr;
                 handle.type = local_res_type;
-                return *this;
+                return;
             } else {  // So we need to make it into Containers
                 ContainersSized* containers = new ContainersSized(2, 2);
                 if (handle.index < other.handle.index) {
@@ -736,14 +1124,14 @@ public:
                     containers->containers[1] = std::move(handle);
                 }
                 handle = ContainerHandle(containers, CTy::Containers, ANY_INDEX);
-                return *this;
+                return;
             }
         }
 
         // Both are containers
         if (handle.type == CTy::Containers && other.handle.type == CTy::Containers) {
             ContainersSized::ori(castToContainers(handle.ptr), castToContainers(other.handle.ptr));
-            return *this;
+            return;
         }
 
         // One of them are containers:
@@ -751,10 +1139,12 @@ public:
             auto this_containers = castToContainers(handle.ptr);
             auto&& other_single = other.handle;
             auto pos = this_containers->lower_bound(other_single.index);
+            this_containers->invalidate_cardinality_cache();
             // before pos: no change
             // at pos: Update or insert
             if (pos < this_containers->size && this_containers->containers[pos].index == other_single.index) {
                 // The corresponding container is found:
+                unshare_container<WordType, IndexType, DataBits>(this_containers->containers[pos]);
                 CTy local_res_type;
                 auto ptr = froaring_ori<WordType, DataBits>(this_containers->containers[pos].ptr, other_single.ptr,
                                                             this_containers->containers[pos].type, other_single.type,
@@ -773,14 +1163,14 @@ public:
                              (this_containers->size - pos) * sizeof(ContainerHandle));
                 this_containers->containers[pos] = duplicate_container<WordType, IndexType, DataBits>(other_single);
                 this_containers->size++;
+                this_containers->invalidate_search_cache();
             }
         } else {  // the other are containers: duplicate and insert. We will create new Containers
             auto other_containers = castToContainers(other.handle.ptr);
             auto this_single = std::move(handle);
             size_t pos = other_containers->lower_bound(this_single.index);
-            typename ContainersSized::IndexType new_size = 0;
-            ContainersSized* new_containers = new ContainersSized(other_containers->size + 1);
-            handle = ContainerHandle(other_containers, CTy::Containers, ANY_INDEX);
+            typename ContainersSized::SizeType new_size = 0;
+            ContainersSized* new_containers = new ContainersSized(0, other_containers->size + 1);
             // before pos
             for (size_t i = 0; i < pos; i++) {
                 new_containers->containers[new_size++] =
@@ -789,6 +1179,7 @@ public:
             // at pos: Update or insert
             if (pos < other_containers->size &&
                 other_containers->containers[pos].index == this_single.index) {  // update
+                unshare_container<WordType, IndexType, DataBits>(this_single);
                 CTy local_res_type;
                 auto ptr = froaring_ori<WordType, DataBits>(this_single.ptr, other_containers->containers[pos].ptr,
                                                             this_single.type, other_containers->containers[pos].type,
@@ -799,7 +1190,7 @@ public:
                 new_containers->containers[new_size++] = ContainerHandle(ptr, local_res_type, this_single.index);
                 pos++;  // container at pos handled
             } else {    // just insert it
-                new_containers->containers[new_size++] = std::move(handle);
+                new_containers->containers[new_size++] = std::move(this_single);
             }
             // after pos:
             for (size_t i = pos; i < other_containers->size; ++i) {
@@ -809,11 +1200,9 @@ public:
             new_containers->size = new_size;
             this->handle = ContainerHandle(new_containers, CTy::Containers, ANY_INDEX);
         }
-
-        return *this;
     }
 
-    FlexibleRoaring operator-(const FlexibleRoaring& other) const noexcept {
+    FlexibleRoaring diff_impl(const FlexibleRoaring& other) const noexcept {
         if (!is_inited()) {
             return FlexibleRoaring<WordType, IndexBits, DataBits>();
         }
@@ -854,8 +1243,6 @@ public:
                                                          this_containers->containers[pos].type, other_single.type,
                                                          local_res_type);
             auto new_containers = new ContainersSized(0, this_containers->size);
-            auto result = FlexibleRoaring<WordType, IndexBits, DataBits>(
-                ContainerHandle(new_containers, CTy::Containers, ANY_INDEX));
 
             size_t new_containers_size = 0;
             // before pos
@@ -893,20 +1280,21 @@ public:
             // We found the corresponding contianer:
             CTy local_res_type;
             auto ptr =
-                froaring_diff<WordType, DataBits>(lhs.ptr, this_single.ptr, lhs.type, this_single.type, local_res_type);
+                froaring_diff<WordType, DataBits>(this_single.ptr, lhs.ptr, this_single.type, lhs.type, local_res_type);
             return FlexibleRoaring<WordType, IndexBits, DataBits>(ptr, local_res_type, this_single.index);
         }
-        FROARING_UNREACHABLE
+        // Both are single containers with different indexes
+        return FlexibleRoaring<WordType, IndexBits, DataBits>(*this);
     }
 
-    FlexibleRoaring& operator-=(const FlexibleRoaring& other) noexcept {
+    void diffi_impl(const FlexibleRoaring& other) noexcept {
         if (!is_inited() || !other.is_inited()) {  // Nothing happens
-            return *this;
+            return;
         }
         // Both containers
         if (handle.type == CTy::Containers && other.handle.type == CTy::Containers) {
             ContainersSized::diffi(castToContainers(handle.ptr), castToContainers(other.handle.ptr));
-            return *this;
+            return;
         }
 
         // One of them are containers:
@@ -915,13 +1303,15 @@ public:
             const ContainerHandle& other_single = other.handle;
             auto pos = this_containers->lower_bound(other_single.index);
             if (pos == this_containers->size) {
-                return *this;
+                return;
             }
             if (this_containers->containers[pos].index != other_single.index) {
-                return *this;
+                return;
             }
             // before pos: do nothing
             // at pos: update or remove
+            this_containers->invalidate_cardinality_cache();
+            unshare_container<WordType, IndexType, DataBits>(this_containers->containers[pos]);
             CTy local_res_type;
             auto ptr = froaring_diffi<WordType, DataBits>(this_containers->containers[pos].ptr, other_single.ptr,
                                                           this_containers->containers[pos].type, other_single.type,
@@ -934,41 +1324,45 @@ public:
                 release_container<WordType, DataBits>(ptr, local_res_type);
                 std::memmove(&this_containers->containers[pos], &this_containers->containers[pos + 1],
                              (this_containers->size - pos - 1) * sizeof(ContainerHandle));
+                this_containers->size--;
+                this_containers->invalidate_search_cache();
             } else {  // update
-                this->containers[pos] = ContainerHandle(ptr, local_res_type, other_single.index);
+                this_containers->containers[pos] = ContainerHandle(ptr, local_res_type, other_single.index);
             }
-            return *this;
+            return;
         }
         if (other.handle.type == CTy::Containers) {  // this is a single container
             auto other_containers = castToContainers(other.handle.ptr);
             const ContainerHandle& this_single = handle;
             auto pos = other_containers->lower_bound(this_single.index);
             if (pos == other_containers->size) {
-                return *this;
+                return;
             }
             const ContainerHandle& corresponding = other_containers->containers[pos];
             if (corresponding.index != this_single.index) {
-                return *this;
+                return;
             }
+            unshare_single();
             CTy local_res_type;
             auto ptr = froaring_diffi<WordType, DataBits>(this_single.ptr, corresponding.ptr, this_single.type,
                                                           corresponding.type, local_res_type);
             updateSingleHandle(ptr, local_res_type);
-            return *this;
+            return;
         }
         // Both are single container:
         if (handle.index != other.handle.index) {
-            return *this;
+            return;
         }
+        unshare_single();
         CTy local_res_type;
         auto ptr = froaring_diffi<WordType, DataBits>(handle.ptr, other.handle.ptr, handle.type, other.handle.type,
                                                       local_res_type);
         // new container has been created, and the old one should be released by the caller
         // (i.e., this function)
         updateSingleHandle(ptr, local_res_type);
-        return *this;
     }
 
+public:
     // FlexibleRoaring operator^(const FlexibleRoaring& other) const noexcept {
     //     // TODO...
     // }
@@ -1015,224 +1409,221 @@ public:
     // ContainersSized* containers;
 };
 
+/// @brief Forward iterator over the values of a FlexibleRoaring, in increasing order.
+///
+/// Walks the containers in place (array values, bitmap words, RLE runs) and never allocates. The bitmap must not be
+/// modified while it is iterated.
 template <typename WordType, size_t IndexBits, size_t DataBits>
 class FlexibleRoaringIterator {
 public:
     using NumberType = can_fit_t<IndexBits + DataBits>;
     using DataType = typename ArrayContainer<WordType, DataBits>::IndexOrNumType;
-    explicit FlexibleRoaringIterator(const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking,
-                                     size_t pos_or_index, size_t arraypos,
-                                     ArrayContainer<WordType, DataBits>* array = nullptr)
-        : tracking(tracking), pos_or_index(pos_or_index), arraypos(arraypos), array(array) {}
-    ~FlexibleRoaringIterator() { delete array; }
 
-    inline static FlexibleRoaringIterator begin(const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking) {
-        static auto end_ = FlexibleRoaringIterator(tracking, (size_t)(~0), 0);
+    /// @brief Positioned on the first value of the `pos_or_index`-th container (or of the next non-empty one), or
+    /// at the end if there is none.
+    explicit FlexibleRoaringIterator(const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking,
+                                     size_t pos_or_index) {
         if (!tracking.is_inited()) {
-            return end_;
+            count = 0;
+        } else if (tracking.handle.type == CTy::Containers) {
+            const auto containers = tracking.castToContainers(tracking.handle.ptr);
+            handles = containers->containers;
+            count = containers->size;
+        } else {
+            handles = &tracking.handle;
+            count = 1;
         }
+        seek_container(pos_or_index);
+    }
 
-        switch (tracking.handle.type) {
-            case CTy::Array:
-                return FlexibleRoaringIterator(tracking, 0, 0);
-            case CTy::RLE: {
-                auto bitmap_ptr = static_cast<RLEContainer<WordType, DataBits>*>(tracking.handle.ptr);
-                auto converted_array = rle_to_array<WordType, DataBits>(bitmap_ptr);
-                ;
-                return FlexibleRoaringIterator(tracking, tracking.handle.index, 0, converted_array);
-            }
-            case CTy::Bitmap: {
-                auto bitmap_ptr = static_cast<BitmapContainer<WordType, DataBits>*>(tracking.handle.ptr);
-                auto converted_array = bitmap_to_array<WordType, DataBits>(bitmap_ptr);
-                ;
-                return FlexibleRoaringIterator(tracking, tracking.handle.index, 0, converted_array);
-            }
-            case CTy::Containers: {
-                const auto containers = tracking.castToContainers(tracking.handle.ptr);
-                if (containers->size == 0) {
-                    return end_;
-                }
-                switch (containers->containers[0].type) {
-                    case CTy::Array:
-                        return FlexibleRoaringIterator(tracking, 0, 0);
-                    case CTy::RLE: {
-                        auto converted_array = rle_to_array<WordType, DataBits>(
-                            static_cast<RLEContainer<WordType, DataBits>*>(containers->containers[0].ptr));
-
-                        return FlexibleRoaringIterator(tracking, 0, 0, converted_array);
-                    }
-
-                    case CTy::Bitmap: {
-                        auto converted_array = bitmap_to_array<WordType, DataBits>(
-                            static_cast<BitmapContainer<WordType, DataBits>*>(containers->containers[0].ptr));
-
-                        return FlexibleRoaringIterator(tracking, 0, 0, converted_array);
-                    }
-                    default:
-                        FROARING_UNREACHABLE
-                }
-                return FlexibleRoaringIterator(tracking, 0, 0);
-            }
+    /// @brief Like the above, over the containers of an index layer, e.g. a leaf layer of a `MultiLevelIndex`.
+    explicit FlexibleRoaringIterator(const BinsearchIndex<WordType, IndexBits, DataBits>& containers,
+                                     size_t pos_or_index)
+        : handles(containers.containers), count(containers.size) {
+        seek_container(pos_or_index);
+    }
 
-            default:
-                FROARING_UNREACHABLE
-        }
-        return FlexibleRoaringIterator(tracking, 0, 0);
+    inline static FlexibleRoaringIterator begin(const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking) {
+        return FlexibleRoaringIterator(tracking, 0);
     }
     inline static FlexibleRoaringIterator end(const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking) {
-        static auto end_ = FlexibleRoaringIterator(tracking, (size_t)(~0), 0);
-        return end_;
+        return FlexibleRoaringIterator(tracking, End);
+    }
+    inline static FlexibleRoaringIterator begin(const BinsearchIndex<WordType, IndexBits, DataBits>& containers) {
+        return FlexibleRoaringIterator(containers, 0);
+    }
+    inline static FlexibleRoaringIterator end(const BinsearchIndex<WordType, IndexBits, DataBits>& containers) {
+        return FlexibleRoaringIterator(containers, End);
     }
 
     /// Note: we assume that you will never compare iterators tracking different FlexibleRoaring bitmaps...
     bool operator==(const FlexibleRoaringIterator& o) const {
-        return pos_or_index == o.pos_or_index && arraypos == o.arraypos;
+        return pos_or_index == o.pos_or_index && current == o.current;
     }
 
-    bool operator!=(const FlexibleRoaringIterator& o) const {
-        return pos_or_index != o.pos_or_index || arraypos != o.arraypos;
-    }
+    bool operator!=(const FlexibleRoaringIterator& o) const { return !(*this == o); }
 
     // ++i
     FlexibleRoaringIterator& operator++() {
-        switch (tracking.handle.type) {
+        const ContainerHandle<IndexType>& c = handles[pos_or_index];
+        switch (c.type) {
             case CTy::Array: {
-                auto arr_ptr = static_cast<ArrayContainer<WordType, DataBits>*>(tracking.handle.ptr);
-                if (arraypos + 1 != arr_ptr->size) {
-                    arraypos++;
+                auto arr_ptr = static_cast<const ArrayContainer<WordType, DataBits>*>(c.ptr);
+                if (++arraypos != arr_ptr->size) {
+                    current = arr_ptr->vals[arraypos];
                     return *this;
                 }
-                pos_or_index = (size_t)(~0);
-                arraypos = 0;
-                return *this;
+                break;
             }
-            case CTy::RLE:
             case CTy::Bitmap: {
-                if (arraypos + 1 != array->size) {
-                    arraypos++;
+                auto bitmap_ptr = static_cast<const BitmapContainer<WordType, DataBits>*>(c.ptr);
+                word &= word - 1;
+                if (word == 0) {
+                    arraypos = bitmap_ptr->next_nonzero_word(arraypos + 1);
+                    if (arraypos != BitmapContainer<WordType, DataBits>::WordsCount) {
+                        word = bitmap_ptr->words[arraypos];
+                    }
+                }
+                if (word != 0) {
+                    current = static_cast<DataType>(arraypos * BitmapContainer<WordType, DataBits>::BitsPerWord +
+                                                    std::countr_zero(word));
                     return *this;
                 }
-                arraypos = 0;
-                pos_or_index = (size_t)(~0);
-                delete array;
-                array = nullptr;
-                return *this;
+                break;
             }
-            case CTy::Containers: {
-                const auto containers = tracking.castToContainers(tracking.handle.ptr);
-                switch (containers->containers[pos_or_index].type) {
-                    case CTy::Array: {
-                        auto arr_ptr =
-                            static_cast<ArrayContainer<WordType, DataBits>*>(containers->containers[pos_or_index].ptr);
-                        if (arraypos + 1 != arr_ptr->size) {
-                            arraypos++;
-                            return *this;
-                        }
-                        arraypos = 0;
-                        if (pos_or_index + 1 != containers->size) {
-                            pos_or_index++;
-                            set_array_with_container(containers->containers[pos_or_index]);
-                            return *this;
-                        }
-                        pos_or_index = (size_t)(~0);
-                        return *this;
-                    }
-
-                    case CTy::RLE:
-                    case CTy::Bitmap: {
-                        if (arraypos + 1 != array->size) {
-                            arraypos++;
-                            return *this;
-                        }
-                        arraypos = 0;
-                        if (pos_or_index + 1 != containers->size) {
-                            pos_or_index++;
-                            delete array;
-                            array = nullptr;
-                            set_array_with_container(containers->containers[pos_or_index]);
-                            return *this;
-                        }
-                        pos_or_index = (size_t)(~0);
-                        delete array;
-                        array = nullptr;
-                        return *this;
-                    }
-                    default:
-                        FROARING_UNREACHABLE
+            case CTy::RLE: {
+                auto rle_ptr = static_cast<const RLEContainer<WordType, DataBits>*>(c.ptr);
+                if (current != rle_ptr->runs[arraypos].end) {
+                    ++current;
+                    return *this;
                 }
+                if (++arraypos != rle_ptr->run_count) {
+                    current = rle_ptr->runs[arraypos].start;
+                    return *this;
+                }
+                break;
             }
-        }
-        FROARING_UNREACHABLE
-    }
-    NumberType operator*() const {
-        switch (tracking.handle.type) {
-            case CTy::Array:
-                return (NumberType)(pos_or_index << DataBits) |
-                       (NumberType)(static_cast<ArrayContainer<WordType, DataBits>*>(tracking.handle.ptr)
-                                        ->vals[arraypos]);
-            case CTy::RLE:
-            case CTy::Bitmap: {
-                return (NumberType)(pos_or_index << DataBits) | (NumberType)(array->vals[arraypos]);
+            case CTy::Full: {
+                if (size_t(current) + 1 != BitmapContainer<WordType, DataBits>::TotalBits) {
+                    ++current;
+                    return *this;
+                }
+                break;
             }
-            case CTy::Containers: {
-                const auto containers = tracking.castToContainers(tracking.handle.ptr);
-                switch (containers->containers[pos_or_index].type) {
-                    case CTy::Array:
-                        return (NumberType)(containers->containers[pos_or_index].index << DataBits) |
-                               (NumberType)(static_cast<ArrayContainer<WordType, DataBits>*>(
-                                                containers->containers[pos_or_index].ptr)
-                                                ->vals[arraypos]);
-                    case CTy::RLE:
-                    case CTy::Bitmap: {
-                        return (NumberType)(containers->containers[pos_or_index].index << DataBits) |
-                               (NumberType)(static_cast<ArrayContainer<WordType, DataBits>*>(array)->vals[arraypos]);
-                    }
-                    default:
-                        FROARING_UNREACHABLE
+            case CTy::PackedArray: {
+                auto packed_ptr = static_cast<const PackedArrayContainer<WordType, DataBits>*>(c.ptr);
+                if (++arraypos != packed_ptr->size) {
+                    current = packed_ptr->get(arraypos);
+                    return *this;
                 }
+                break;
+            }
+            case CTy::Cold: {
+                auto cold_ptr = static_cast<const ColdContainer<WordType, DataBits>*>(c.ptr);
+                if (++arraypos != cold_ptr->size) {
+                    current = cold_ptr->next_value(arraypos, current);
+                    return *this;
+                }
+                break;
             }
-
             default:
                 FROARING_UNREACHABLE
         }
+        seek_container(pos_or_index + 1);
+        return *this;
     }
+
+    NumberType operator*() const {
+        return (NumberType)((NumberType)handles[pos_or_index].index << DataBits) | (NumberType)current;
+    }
+
     void debug_print() {
-        std::cout << "pos_or_index: " << pos_or_index << ", arraypos: " << arraypos << " , ptr=" << (void*)array
+        std::cout << "pos_or_index: " << pos_or_index << ", arraypos: " << arraypos << ", current: " << size_t(current)
                   << std::endl;
     }
 
 private:
     using IndexType = typename FlexibleRoaring<WordType, IndexBits, DataBits>::IndexType;
+    static constexpr size_t End = ~size_t(0);
+
+    /// @brief Move to the first value of the first non-empty container at or after position `pos`.
+    void seek_container(size_t pos) {
+        for (; pos < count; ++pos) {
+            if (first_in_container(handles[pos])) {
+                pos_or_index = pos;
+                return;
+            }
+        }
+        pos_or_index = End;
+        arraypos = 0;
+        current = 0;
+    }
 
-    /// @brief Create a temporary array container from the given container.
-    void set_array_with_container(const ContainerHandle<IndexType>& ch) {
-        assert(array == nullptr);
-        switch (ch.type) {
+    bool first_in_container(const ContainerHandle<IndexType>& c) {
+        arraypos = 0;
+        switch (c.type) {
             case CTy::Array: {
-                array = nullptr;
-                break;
+                auto arr_ptr = static_cast<const ArrayContainer<WordType, DataBits>*>(c.ptr);
+                if (arr_ptr->size == 0) {
+                    return false;
+                }
+                current = arr_ptr->vals[0];
+                return true;
+            }
+            case CTy::Bitmap: {
+                auto bitmap_ptr = static_cast<const BitmapContainer<WordType, DataBits>*>(c.ptr);
+                arraypos = bitmap_ptr->next_nonzero_word(0);
+                if (arraypos == BitmapContainer<WordType, DataBits>::WordsCount) {
+                    return false;
+                }
+                word = bitmap_ptr->words[arraypos];
+                current = static_cast<DataType>(arraypos * BitmapContainer<WordType, DataBits>::BitsPerWord +
+                                                std::countr_zero(word));
+                return true;
             }
             case CTy::RLE: {
-                this->array = rle_to_array<WordType, DataBits>(static_cast<RLEContainer<WordType, DataBits>*>(ch.ptr));
-                std::cout << "RLE->Array:" << std::endl;
-                this->array->debug_print();
-                break;
+                auto rle_ptr = static_cast<const RLEContainer<WordType, DataBits>*>(c.ptr);
+                if (rle_ptr->run_count == 0) {
+                    return false;
+                }
+                current = rle_ptr->runs[0].start;
+                return true;
             }
-            case CTy::Bitmap: {
-                this->array =
-                    bitmap_to_array<WordType, DataBits>(static_cast<BitmapContainer<WordType, DataBits>*>(ch.ptr));
-                std::cout << "Bitmap->Array:" << std::endl;
-                this->array->debug_print();
-                break;
+            case CTy::Full:
+                current = 0;
+                return true;
+            case CTy::PackedArray: {
+                auto packed_ptr = static_cast<const PackedArrayContainer<WordType, DataBits>*>(c.ptr);
+                if (packed_ptr->size == 0) {
+                    return false;
+                }
+                current = packed_ptr->get(0);
+                return true;
+            }
+            case CTy::Cold: {
+                auto cold_ptr = static_cast<const ColdContainer<WordType, DataBits>*>(c.ptr);
+                if (cold_ptr->size == 0) {
+                    return false;
+                }
+                current = cold_ptr->minimum();
+                return true;
             }
             default:
                 FROARING_UNREACHABLE
         }
+        return false;
     }
 
-    const FlexibleRoaring<WordType, IndexBits, DataBits>& tracking;
-    size_t pos_or_index = 0;
+    const ContainerHandle<IndexType>* handles = nullptr;
+    size_t count = 0;
+    /// Position of the current container in `handles`, or `End`.
+    size_t pos_or_index = End;
+    /// Array, PackedArray, Cold: position of the value. Bitmap: position of the word. RLE: position of the run.
+    /// Full: unused.
     size_t arraypos = 0;
-    ArrayContainer<WordType, DataBits>* array = nullptr;
+    /// Bitmap: the bits of the current word not visited yet, including the current one.
+    WordType word = 0;
+    /// The current value inside its container.
+    DataType current = 0;
 };
 }  // namespace froaring
\ No newline at end of file
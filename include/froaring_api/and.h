@@ -4,6 +4,9 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
+#include "optimize.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -14,224 +17,202 @@ template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_bb(const BitmapContainer<WordType, DataBits>* a,
                                       const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
     auto* result = new BitmapContainer<WordType, DataBits>();
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        result->words[i] = a->words[i] & b->words[i];
-    }
-    result_type = CTy::Bitmap;
-    return result;
+    BitmapStats<WordType> stats;
+    // Words empty in either input stay empty
+    result->write_words([&](size_t s) { return a->summary[s] & b->summary[s]; },
+                        [&](size_t i) { return a->words[i] & b->words[i]; }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_aa(const ArrayContainer<WordType, DataBits>* a,
                                       const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
     auto* result = new ArrayContainer<WordType, DataBits>(std::min(a->size, b->size));
-    if (a->size == 0 || b->size == 0) {
-        result_type = CTy::Array;
-        return result;
-    }
     size_t i = 0, j = 0;
-    size_t new_card = 0;
+    size_t new_card = 0, runs = 0;
     // Linear scan
-    result_type = CTy::Array;
-    while (true) {
-        while (a->vals[i] < b->vals[j]) {
-        SKIP_FIRST_COMPARE:
+    while (i < a->size && j < b->size) {
+        if (a->vals[i] < b->vals[j]) {
             ++i;
-            if (i == a->size) {
-                result->size = new_card;
-                return result;
-            }
-        }
-        while (a->vals[i] > b->vals[j]) {
+        } else if (a->vals[i] > b->vals[j]) {
             ++j;
-            if (j == b->size) {
-                result->size = new_card;
-                return result;
-            }
-        }
-        if (a->vals[i] == b->vals[j]) {
+        } else {
+            runs += is_run_start(result->vals, new_card, a->vals[i]);
             result->vals[new_card++] = a->vals[i];
             ++i;
             ++j;
-            if (i == a->size || j == b->size) {
-                result->size = new_card;
-                return result;
-            }
-        } else {
-            goto SKIP_FIRST_COMPARE;
         }
     }
-    FROARING_UNREACHABLE
+    result->size = new_card;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, new_card, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_rr(const RLEContainer<WordType, DataBits>* a,
                                       const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::RLE;
-
     auto* result = new RLEContainer<WordType, DataBits>(a->run_count + b->run_count);
-    if (a->run_count == 0 || b->run_count == 0) {
-        return result;
-    }
     size_t i = 0, j = 0;
-    size_t new_card = 0;
-    while (true) {
-        auto& run_a = a->runs[i];
-        auto& run_b = b->runs[j];
-        while (run_a.end < run_b.start) {
-        SKIP_FIRST_COMPARE:
+    size_t new_runs = 0, card = 0;
+    while (i < a->run_count && j < b->run_count) {
+        auto start = std::max(a->runs[i].start, b->runs[j].start);
+        auto end = std::min(a->runs[i].end, b->runs[j].end);
+        if (start <= end) {
+            result->runs[new_runs++] = {start, end};
+            card += end - start + 1;
+        }
+        // The run that ends first cannot overlap anything else
+        if (a->runs[i].end < b->runs[j].end) {
             ++i;
-            if (i == a->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
-        }
-        while (run_b.end < run_a.start) {
-            ++j;
-            if (j == b->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
-        }
-        if (run_a.end >= run_b.start && run_b.end >= run_a.start) {
-            result->runs[new_card++] = {std::max(run_a.start, run_b.start), std::min(run_a.end, run_b.end)};
-            if (run_a.end < run_b.end) {
-                ++i;
-            } else {
-                ++j;
-            }
-            if (i == a->run_count || j == b->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
         } else {
-            goto SKIP_FIRST_COMPARE;
+            ++j;
         }
     }
-    FROARING_UNREACHABLE
+    result->run_count = new_runs;
+    return finalize_container<WordType, DataBits>(result, CTy::RLE, card, new_runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_ar(const ArrayContainer<WordType, DataBits>* a,
                                       const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
     auto* result = new ArrayContainer<WordType, DataBits>(a->cardinality());
-    if (a->size == 0 || b->run_count == 0) {
-        return result;
-    }
-
     size_t rlepos = 0;
-    size_t arraypos = 0;
-    size_t newcard = 0;
-    auto rle = b->runs[rlepos];
-
-    while (true) {
-        while (rle.end < a->vals[arraypos]) {
+    size_t newcard = 0, runs = 0;
+    for (size_t arraypos = 0; arraypos < a->size; ++arraypos) {
+        auto val = a->vals[arraypos];
+        // FIXME: use Gallop Search (advanceUntil) if the array is big enough
+        while (rlepos < b->run_count && b->runs[rlepos].end < val) {
             ++rlepos;
-            if (rlepos == b->run_count) {  // done
-                result->size = newcard;
-                return result;
-            }
-            rle = b->runs[rlepos];
         }
-        while (rle.start > a->vals[arraypos]) {
-            // FIXME: use Gallop Search (advanceUntil) if the array is big enough
-            ++arraypos;
-            if (arraypos == a->size) {
-                result->size = newcard;
-                return result;
-            }
+        if (rlepos == b->run_count) {
+            break;
         }
-        while (rle.start <= a->vals[arraypos] && a->vals[arraypos] <= rle.end) {
-            result->vals[newcard++] = a->vals[arraypos];
-            ++arraypos;
-            if (arraypos == a->size) {
-                result->size = newcard;
-                return result;
-            }
+        if (b->runs[rlepos].start <= val) {
+            runs += is_run_start(result->vals, newcard, val);
+            result->vals[newcard++] = val;
         }
     }
-
     result->size = newcard;
-    return result;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, newcard, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_br(const BitmapContainer<WordType, DataBits>* a,
                                       const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    if (b->run_count == 0) {
-        auto* result = new BitmapContainer<WordType, DataBits>();
-        result_type = CTy::Bitmap;
-        return result;
-    }
     auto rle_card = b->cardinality();
-    if (rle_card <= ArrayContainer<WordType, DataBits>::ArrayToBitmapCountThreshold) {
-        auto* result = new ArrayContainer<WordType, DataBits>();
-        size_t newcard = 0;
+    if (rle_card <= ContainerPolicy<WordType, DataBits>::ArrayMaxCardinality) {
+        // The result can never outgrow an array
+        using IndexOrNumType = typename ArrayContainer<WordType, DataBits>::IndexOrNumType;
+        auto* result = new ArrayContainer<WordType, DataBits>(rle_card);
+        size_t newcard = 0, runs = 0;
 
         // This branchless implementation reduces branch mispredictions
-        for (size_t i = 0; i < rle_card; ++i) {
+        for (size_t i = 0; i < b->run_count; ++i) {
             auto run = b->runs[i];
             for (size_t val = run.start; val <= run.end; ++val) {
+                bool hit = a->test(val);
+                runs += hit && is_run_start(result->vals, newcard, static_cast<IndexOrNumType>(val));
                 result->vals[newcard] = val;
-                newcard += a->test(val);
+                newcard += hit;
             }
         }
         result->size = newcard;
-        result_type = CTy::Array;
-        return result;
-    }
-
-    // If the cardinality is high, we first guess that the result will be a bitmap
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
-    typename BitmapContainer<WordType, DataBits>::NumType start;
-    typename RLEContainer<WordType, DataBits>::RunPair first_run = b->runs[0];
-    if (first_run.start > 0) {
-        result->reset_range(0, first_run.start - 1);
+        return finalize_container<WordType, DataBits>(result, CTy::Array, newcard, runs, result_type);
     }
-    start = first_run.end + 1;
-    for (size_t i = 1; i < rle_card; ++i) {
-        auto run = b->runs[i];
-        auto end = run.start - 1;
-        result->reset_range(start, end);
-        start = end + 1;
-    }
-    result_type = CTy::Bitmap;
-
-    // if the guess is wrong...
-    // TODO: Should we convert it back to an array?
 
-    return result;
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(b);
+    result->write_words([&](size_t s) { return a->summary[s] & runs.summary(s); },
+                        [&](size_t i) { return a->words[i] & runs.word(i); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_ba(const BitmapContainer<WordType, DataBits>* a,
                                       const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
-    auto* result = new ArrayContainer<WordType, DataBits>();
     auto array_size = b->cardinality();
-    size_t newcard = 0;
-    if (array_size == 0) {
-        return result;
-    }
+    auto* result = new ArrayContainer<WordType, DataBits>(array_size);
+    size_t newcard = 0, runs = 0;
     // This branchless implementation reduces branch mispredictions
     for (size_t i = 0; i < array_size; ++i) {
         auto val = b->vals[i];
+        bool hit = a->test(val);
+        runs += hit && is_run_start(result->vals, newcard, val);
         result->vals[newcard] = val;
-        newcard += a->test(val);
+        newcard += hit;
     }
     result->size = newcard;
-    return result;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, newcard, runs, result_type);
+}
+
+/// @brief Intersect a cold container with an array, decoding only the blocks that the array values hit.
+template <typename WordType, size_t DataBits>
+froaring_container_t* froaring_and_ca(const ColdContainer<WordType, DataBits>* a,
+                                      const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
+    auto* result = new ArrayContainer<WordType, DataBits>(std::min(a->size, b->size));
+    size_t new_card = 0, runs = 0;
+    a->for_each_common(b->vals, b->size, [&](auto val) {
+        runs += is_run_start(result->vals, new_card, val);
+        result->vals[new_card++] = val;
+        return true;
+    });
+    result->size = new_card;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, new_card, runs, result_type);
+}
+
+/// @brief Intersect two cold containers, decoding only the blocks whose ranges overlap.
+template <typename WordType, size_t DataBits>
+froaring_container_t* froaring_and_cc(const ColdContainer<WordType, DataBits>* a,
+                                      const ColdContainer<WordType, DataBits>* b, CTy& result_type) {
+    auto* result = new ArrayContainer<WordType, DataBits>(std::min(a->size, b->size));
+    size_t new_card = 0, runs = 0;
+    a->for_each_common(*b, [&](auto val) {
+        runs += is_run_start(result->vals, new_card, val);
+        result->vals[new_card++] = val;
+        return true;
+    });
+    result->size = new_card;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, new_card, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                    CTy& result_type) {
+    FROARING_KERNEL_SCOPE(And, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    using ColdSized = ColdContainer<WordType, DataBits>;
+    if (ta == CTy::Full || tb == CTy::Full) {  // a copy of the other side
+        return tb == CTy::Full ? optimized_copy<WordType, DataBits>(a, ta, result_type)
+                               : optimized_copy<WordType, DataBits>(b, tb, result_type);
+    }
+    if (ta == CTy::Cold && tb == CTy::Cold) {
+        return froaring_and_cc(static_cast<const ColdSized*>(a), static_cast<const ColdSized*>(b), result_type);
+    }
+    if ((ta == CTy::Cold && (tb == CTy::Array || tb == CTy::PackedArray)) ||
+        (tb == CTy::Cold && (ta == CTy::Array || ta == CTy::PackedArray))) {  // skip the blocks no value hits
+        const auto* cold = static_cast<const ColdSized*>(ta == CTy::Cold ? a : b);
+        const froaring_container_t* other = ta == CTy::Cold ? b : a;
+        CTy array_type = ta == CTy::Cold ? tb : ta;
+        auto array = unpacked<WordType, DataBits>(other, array_type);
+        auto result = froaring_and_ca(cold, static_cast<const ArraySized*>(array), result_type);
+        release_unpacked<WordType, DataBits>(array, other);
+        return result;
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_and<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_and_bb(static_cast<const BitmapSized*>(a), static_cast<const BitmapSized*>(b), result_type);
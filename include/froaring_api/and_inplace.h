@@ -5,6 +5,9 @@
 #include "and.h"
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
+#include "optimize.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -14,68 +17,44 @@ using CTy = froaring::ContainerType;
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_bb(BitmapContainer<WordType, DataBits>* a,
                                               const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        a->words[i] &= b->words[i];
-    }
-    result_type = CTy::Bitmap;
-
-    return a;
-    // TODO: may transform into array container if the cardinality is low
+    BitmapStats<WordType> stats;
+    // Words empty in `b` must still be cleared in `a`
+    a->write_words([&](size_t s) { return a->summary[s]; },
+                   [&](size_t i) { return a->words[i] & b->words[i]; }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_aa(ArrayContainer<WordType, DataBits>* a,
                                               const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    if (a->size == 0 || b->size == 0) {
-        a->clear();
-        result_type = CTy::Array;
-        return a;
-    }
-
     size_t i = 0, j = 0;
     // TODO: handle small & large arrays' intersection (skewed)
 
     // Linear scan
-    auto new_size = 0;
-    result_type = CTy::Array;
+    size_t new_size = 0, runs = 0;
     // We can modify while scan since the position being scanned moves forward faster or equal to the position being
     // overwrtitten
-    while (true) {
-        while (a->vals[i] < b->vals[j]) {
-        SKIP_FIRST_COMPARE:
+    while (i < a->size && j < b->size) {
+        if (a->vals[i] < b->vals[j]) {
             ++i;
-            if (i == a->size) {
-                a->size = new_size;
-                return a;
-            }
-        }
-        while (a->vals[i] > b->vals[j]) {
+        } else if (a->vals[i] > b->vals[j]) {
             ++j;
-            if (j == b->size) {
-                a->size = new_size;
-                return a;
-            }
-        }
-        if (a->vals[i] == b->vals[j]) {
+        } else {
+            runs += is_run_start(a->vals, new_size, a->vals[i]);
             a->vals[new_size++] = a->vals[i];
             ++i;
             ++j;
-            if (i == a->size || j == b->size) {
-                a->size = new_size;
-                return a;
-            }
-        } else {
-            goto SKIP_FIRST_COMPARE;
         }
     }
-    FROARING_UNREACHABLE
+    a->size = new_size;
+    return finalize_inplace<WordType, DataBits>(a, CTy::Array, new_size, runs, result_type);
 }
 
 /// NOT in-place internally
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_rr(RLEContainer<WordType, DataBits>* a,
                                               const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     return froaring_and_rr(a, b, result_type);
 }
 
@@ -83,7 +62,6 @@ froaring_container_t* froaring_and_inplace_rr(RLEContainer<WordType, DataBits>*
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_ar(ArrayContainer<WordType, DataBits>* a,
                                               const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     return froaring_and_ar(a, b, result_type);  // No need to actually do it in-place
 }
 
@@ -91,14 +69,12 @@ froaring_container_t* froaring_and_inplace_ar(ArrayContainer<WordType, DataBits>
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_ra(RLEContainer<WordType, DataBits>* a,
                                               const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     return froaring_and_ar(b, a, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_br(BitmapContainer<WordType, DataBits>* a,
                                               const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     // TODO: inplace!
     return froaring_and_br(a, b, result_type);
 }
@@ -106,38 +82,58 @@ froaring_container_t* froaring_and_inplace_br(BitmapContainer<WordType, DataBits
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_rb(RLEContainer<WordType, DataBits>* a,
                                               const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     // TODO: inplace!
     return froaring_and_br(b, a, result_type);
 }
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_ba(BitmapContainer<WordType, DataBits>* a,
                                               const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    return froaring_and_ba(a, b, result_type);  // should be Array type
+    return froaring_and_ba(a, b, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_and_inplace_ab(ArrayContainer<WordType, DataBits>* a,
                                               const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
-    size_t new_card = 0;
+    size_t new_card = 0, runs = 0;
     const size_t origcard = a->size;
 
     for (size_t i = 0; i < origcard; i++) {
         typename ArrayContainer<WordType, DataBits>::IndexOrNumType key = a->vals[i];
+        bool hit = b->test(key);
+        runs += hit && is_run_start(a->vals, new_card, key);
         a->vals[new_card] = key;
-        new_card += b->test(key);
+        new_card += hit;
     }
     a->size = new_card;
-    return a;
+    return finalize_inplace<WordType, DataBits>(a, CTy::Array, new_card, runs, result_type);
 }
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_andi(froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                     CTy& result_type) {
+    FROARING_KERNEL_SCOPE(AndInplace, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (tb == CTy::Full) {  // no-op, besides converting `a` into its smallest type as any kernel does
+        return optimize_container<WordType, DataBits>(a, ta, result_type);
+    }
+    if (ta == CTy::Full) {  // a copy of `b`
+        return optimized_copy<WordType, DataBits>(b, tb, result_type);
+    }
+    if (ta == CTy::Cold || tb == CTy::Cold) {  // a new container either way: skip the blocks the other side misses
+        return froaring_and<WordType, DataBits>(a, b, ta, tb, result_type);
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_andi<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        if (result != ua) {  // `ua` was not operated in place
+            release_unpacked<WordType, DataBits>(ua, a);
+        }
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_and_inplace_bb(static_cast<BitmapSized*>(a), static_cast<const BitmapSized*>(b),
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>  // for std::memmove
 #include <iostream>
 
+#include "instrument.h"
 #include "prelude.h"
+#include "search.h"
 namespace froaring {
 template <typename WordType, size_t DataBits>
 class ArrayContainer : public froaring_container_t {
@@ -14,9 +17,6 @@ public:
     using SizeType = froaring::can_fit_t<DataBits + 1>;
     /// Bit capacity for containers indexed
     static constexpr size_t ContainerCapacity = (1 << DataBits);
-    /// Array threshold (Array will not be optimum for storing more
-    /// elements)
-    static constexpr size_t ArrayToBitmapCountThreshold = ContainerCapacity / DataBits;
     static constexpr size_t UseLinearScanThreshold = 8;
 
 public:
@@ -28,16 +28,19 @@ public:
     }
 
     explicit ArrayContainer(SizeType capacity = ARRAY_CONTAINER_INIT_CAPACITY, SizeType size = 0)
-        : capacity(std::max(capacity, size)),
+        : capacity(std::max({capacity, size, SizeType(1)})),
           size(size),
-          vals(static_cast<IndexOrNumType*>(malloc(capacity * sizeof(IndexOrNumType)))) {
+          vals(static_cast<IndexOrNumType*>(malloc(this->capacity * sizeof(IndexOrNumType)))) {
         assert(vals && "Failed to allocate memory for ArrayContainer");
+        FROARING_COUNT(Alloc);
     }
     explicit ArrayContainer(const ArrayContainer& other)
-        : capacity(other.size),
+        : froaring_container_t(),
+          capacity(std::max(other.size, SizeType(1))),
           size(other.size),
           vals(static_cast<IndexOrNumType*>(malloc(this->capacity * sizeof(IndexOrNumType)))) {
         std::memcpy(vals, other.vals, other.size * sizeof(IndexOrNumType));
+        FROARING_COUNT(Alloc);
     }
 
     ~ArrayContainer() { free(vals); }
@@ -47,11 +50,13 @@ public:
     void clear() { size = 0; }
 
     void set(IndexOrNumType num) {
-        IndexOrNumType pos = (size ? lower_bound(num) : 0);
+        SizeType pos = (size ? lower_bound(num) : 0);
         if (pos < size && vals[pos] == num) return;
 
         if (size == capacity) expand();
 
+        FROARING_COUNT(Memmove);
+        FROARING_COUNT_N(MemmoveBytes, (size - pos) * sizeof(IndexOrNumType));
         std::memmove(&vals[pos + 1], &vals[pos],
                      (size - pos) * sizeof(IndexOrNumType));  // TODO: Boost by combining
                                                               // memmove with expand()
@@ -77,7 +82,7 @@ public:
 
     bool test_and_set(IndexOrNumType num) {
         bool was_set;
-        IndexOrNumType pos;
+        SizeType pos = 0;
         if (!size) {
             was_set = false;
         } else {
@@ -89,6 +94,8 @@ public:
 
         if (size == capacity) expand();
 
+        FROARING_COUNT(Memmove);
+        FROARING_COUNT_N(MemmoveBytes, (size - pos) * sizeof(IndexOrNumType));
         std::memmove(&vals[pos + 1], &vals[pos], (size - pos) * sizeof(IndexOrNumType));
 
         vals[pos] = num;
@@ -99,16 +106,83 @@ public:
 
     SizeType cardinality() const { return size; }
 
+    /// @brief Number of values not greater than `num`.
+    SizeType rank(IndexOrNumType num) const {
+        SizeType pos = lower_bound(num);
+        return pos + (pos < size && vals[pos] == num);
+    }
+
+    /// @brief The `k`-th smallest value (0-based). `k` must be less than the cardinality.
+    IndexOrNumType select(SizeType k) const {
+        assert(k < size);
+        return vals[k];
+    }
+
+    /// @brief The smallest value. The container must not be empty.
+    IndexOrNumType minimum() const {
+        assert(size);
+        return vals[0];
+    }
+
+    /// @brief The largest value. The container must not be empty.
+    IndexOrNumType maximum() const {
+        assert(size);
+        return vals[size - 1];
+    }
+
+    /// @brief Write the (at most) `n` smallest values, each plus `base`, to `out` in ascending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_first(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = base + vals[i];
+        }
+        return n;
+    }
+
+    /// @brief Write the (at most) `n` largest values, each plus `base`, to `out` in descending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_last(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = base + vals[size - 1 - i];
+        }
+        return n;
+    }
+
+    /// @brief Number of maximal runs of consecutive values.
+    SizeType count_runs() const {
+        if (!size) return 0;
+        SizeType runs = 1;
+        for (SizeType i = 1; i < size; ++i) {
+            runs += (vals[i] != vals[i - 1] + 1);
+        }
+        return runs;
+    }
+
+    /// @brief Release unused capacity.
+    /// @return Bytes saved.
+    size_t shrink_to_fit() {
+        SizeType new_cap = std::max(size, SizeType(1));
+        if (new_cap == capacity) return 0;
+        size_t saved = (capacity - new_cap) * sizeof(IndexOrNumType);
+        expand_to(new_cap);
+        return saved;
+    }
+
     void expand() { expand_to(this->capacity * 2); }
 
     void expand_to(SizeType new_cap) {
         void* new_memory = realloc(vals, new_cap * sizeof(IndexOrNumType));
         assert(new_memory && "Failed to reallocate memory for ArrayContainer");
+        FROARING_COUNT(Realloc);
         vals = static_cast<IndexOrNumType*>(new_memory);
         this->capacity = new_cap;
     }
 
-    IndexOrNumType lower_bound(IndexOrNumType num) const {
+    SizeType lower_bound(IndexOrNumType num) const {
         if (size < UseLinearScanThreshold) {
             for (SizeType i = 0; i < size; ++i) {
                 if (vals[i] >= num) {
@@ -117,6 +191,7 @@ public:
             }
             return size;
         }
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_BRANCHY
         SizeType left = 0;
         SizeType right = size;
         while (left < right) {
@@ -128,6 +203,9 @@ public:
             }
         }
         return left;
+#else
+        return branchless_lower_bound(vals, size, num, [](IndexOrNumType v) { return v; });
+#endif
     }
 
     SizeType advanceUntil(IndexOrNumType key, SizeType pos) const {
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <limits>
 
 #include "prelude.h"
 
@@ -19,13 +21,24 @@ public:
                                                                     // currently it is ceiled.
     using SizeType = froaring::can_fit_t<DataBits + 1>;
     static constexpr WordType IndexInsideWordMask = (1ULL << cexpr_log2(BitsPerWord)) - 1;
+    /// Marks the cached cardinality as stale; no container can hold this many bits.
+    static constexpr SizeType UnknownCardinality = std::numeric_limits<SizeType>::max();
+    /// A WordType with every bit set. `~WordType(0)` alone is an int of -1 for words narrower than int, which a right
+    /// shift keeps negative.
+    static constexpr WordType AllOnes = static_cast<WordType>(~WordType(0));
+    /// Whether `summary` flags the non-zero words, so that scans skip the empty ones (see
+    /// FROARING_BITMAP_SUMMARY_MIN_BITS).
+    static constexpr bool HasSummary = DataBits >= FROARING_BITMAP_SUMMARY_MIN_BITS;
+    static constexpr size_t SummaryWords = HasSummary ? WordsCount / BitsPerWord : 0;
 
     static_assert(WordsCount * BitsPerWord == TotalBits, "Size of WordType must divides DataBits");
+    static_assert(!HasSummary || SummaryWords * BitsPerWord == WordsCount, "The summary must cover whole words");
 
 public:
-    explicit BitmapContainer() { memset(words, 0, sizeof(words)); }
+    explicit BitmapContainer() : summary{}, card(0) { memset(words, 0, sizeof(words)); }
 
-    explicit BitmapContainer(const BitmapContainer& other) {
+    explicit BitmapContainer(const BitmapContainer& other)
+        : froaring_container_t(), summary(other.summary), card(other.card) {
         std::memcpy(words, other.words, WordsCount * sizeof(WordType));
     }
     BitmapContainer& operator=(const BitmapContainer&) = delete;
@@ -43,12 +56,25 @@ public:
         std::cout << std::endl;
     }
 
-    void clear() { std::memset(words, 0, WordsCount * sizeof(WordType)); }
+    void clear() {
+        std::memset(words, 0, WordsCount * sizeof(WordType));
+        summary = {};
+        card = 0;
+    }
 
-    void set(NumType index) { words[index / BitsPerWord] |= ((WordType)1 << (index % BitsPerWord)); }
+    void set(NumType index) {
+        WordType& word = words[index / BitsPerWord];
+        const WordType mask = (WordType)1 << (index % BitsPerWord);
+        if (card != UnknownCardinality) {
+            card += !(word & mask);
+        }
+        word |= mask;
+        mark_word(index / BitsPerWord);
+    }
 
+    /// @brief Set [start, end], inclusive
     void set_range(NumType start, NumType end) {
-        if (start >= end) {
+        if (start > end) {
             return;
         }
         const IndexType start_word = start / BitsPerWord;
@@ -57,12 +83,14 @@ public:
         if (end_word >= WordsCount || start_word >= WordsCount) {
             return;
         }
+        card = UnknownCardinality;  // the summary is kept by mark_words below
         // All "1" from `start` to MSB
         const WordType first_mask = ~((1ULL << (start & IndexInsideWordMask)) - 1);
         // All "1" from LSB to `end`
         const WordType last_mask =
             ((1ULL << ((end & IndexInsideWordMask))) - 1) ^ (1ULL << ((end & IndexInsideWordMask)));
 
+        mark_words(start_word, end_word + 1, true);
         if (start_word == end_word) {
             words[end_word] |= (first_mask & last_mask);
             return;
@@ -71,11 +99,12 @@ public:
         words[start_word] |= first_mask;
         words[end_word] |= last_mask;
 
-        std::memset(&words[start_word + 1], 0xFF, (end_word - start_word - 1) * sizeof(NumType));
+        std::memset(&words[start_word + 1], 0xFF, (end_word - start_word - 1) * sizeof(WordType));
     }
 
+    /// @brief Check if any bit in [start, end] (inclusive) is set.
     bool any_range(NumType start, NumType end) const {
-        if (start >= end) {
+        if (start > end) {
             return false;
         }
         const IndexType start_word = start / BitsPerWord;
@@ -91,7 +120,7 @@ public:
             ((1ULL << ((end & IndexInsideWordMask))) - 1) ^ (1ULL << ((end & IndexInsideWordMask)));
 
         if (start_word == end_word) {
-            if (words[start_word] & (first_mask & last_mask)) return true;
+            return words[start_word] & (first_mask & last_mask);
         }
 
         if (words[start_word] & first_mask) {
@@ -100,28 +129,47 @@ public:
         if (end_word < WordsCount && words[end_word] & last_mask) {
             return true;
         }
-        for (size_t i = start_word + 1; i < std::min((size_t)(end_word), WordsCount); ++i) {
-            if (words[i]) {
-                return true;
-            }
-        }
-        return false;
+        return next_nonzero_word(start_word + 1) < std::min((size_t)(end_word), WordsCount);
     }
 
     bool test(NumType index) const { return words[index / BitsPerWord] & ((WordType)1 << (index % BitsPerWord)); }
 
+    /// @brief `out[i] = test(low DataBits of values[i])` for a batch of queries. Branch-free, so that the compiler
+    /// can vectorize it.
+    template <typename ValueType>
+    void test_many(const ValueType* values, size_t n, uint8_t* out) const {
+        for (size_t i = 0; i < n; ++i) {
+            const size_t bit = static_cast<size_t>(values[i]) & (TotalBits - 1);
+            out[i] = static_cast<uint8_t>((words[bit / BitsPerWord] >> (bit % BitsPerWord)) & 1);
+        }
+    }
+
     bool test_and_set(NumType index) {
         bool was_set = test(index);
         if (was_set) return false;
-        set(index);
+        words[index / BitsPerWord] |= ((WordType)1 << (index % BitsPerWord));
+        mark_word(index / BitsPerWord);
+        if (card != UnknownCardinality) {
+            ++card;
+        }
         return true;
     }
 
-    void reset(NumType index) { words[index / BitsPerWord] &= ~((WordType)1 << (index % BitsPerWord)); }
+    void reset(NumType index) {
+        WordType& word = words[index / BitsPerWord];
+        const WordType mask = (WordType)1 << (index % BitsPerWord);
+        if (card != UnknownCardinality) {
+            card -= !!(word & mask);
+        }
+        word &= ~mask;
+        if (!word) {
+            unmark_word(index / BitsPerWord);
+        }
+    }
 
     /// @brief Reset [start, end], inclusive
     void reset_range(NumType start, NumType end) {
-        if (start >= end) {
+        if (start > end) {
             return;
         }
         const IndexType start_word = start / BitsPerWord;
@@ -129,22 +177,26 @@ public:
         if (end_word >= WordsCount || start_word >= WordsCount) {
             return;
         }
+        card = UnknownCardinality;
         // All "0" from `start` to MSB
         const WordType first_mask = ((1ULL << (start & IndexInsideWordMask)) - 1);
-        ;
         // All "0" from LSB to `end`
         const WordType last_mask =
             (~((1ULL << ((end & IndexInsideWordMask))) - 1)) ^ (1ULL << ((end & IndexInsideWordMask)));
 
         if (start_word == end_word) {
             words[start_word] &= (first_mask | last_mask);
+            mark_words(start_word, start_word + 1, words[start_word]);
             return;
         }
 
         words[start_word] &= first_mask;
         words[end_word] &= last_mask;
 
-        std::memset(&words[start_word + 1], 0, (end_word - start_word - 1) * sizeof(NumType));
+        std::memset(&words[start_word + 1], 0, (end_word - start_word - 1) * sizeof(WordType));
+        mark_words(start_word, start_word + 1, words[start_word]);
+        mark_words(start_word + 1, end_word, false);
+        mark_words(end_word, end_word + 1, words[end_word]);
     }
 
     /// @brief Check if the range is fully contained in the container.
@@ -152,7 +204,7 @@ public:
     /// @param end inclusive.
     /// @return If [start, end] is fully contained in the container.
     bool test_range(NumType start, NumType end) const {
-        if (start >= end) {
+        if (start > end) {
             return true;
         }
         const IndexType start_word = start / BitsPerWord;
@@ -185,8 +237,9 @@ public:
         return true;
     }
 
+    /// @brief Keep [start, end] (inclusive) only, clear all bits outside.
     void intersect_range(NumType start, NumType end) {
-        if (start >= end) {
+        if (start > end) {
             clear();
             return;
         }
@@ -196,30 +249,300 @@ public:
             clear();
             return;
         }
+        card = UnknownCardinality;
         // All "1" from `start` to MSB
         const WordType first_mask = ~((1ULL << (start & IndexInsideWordMask)) - 1);
         // All "1" from LSB to `end`
         const WordType last_mask =
             ((1ULL << ((end & IndexInsideWordMask))) - 1) ^ (1ULL << ((end & IndexInsideWordMask)));
 
+        std::memset(&words[0], 0, start_word * sizeof(WordType));
+        std::memset(&words[end_word + 1], 0, (WordsCount - end_word - 1) * sizeof(WordType));
+        mark_words(0, start_word, false);
+        mark_words(end_word + 1, WordsCount, false);
         if (start_word == end_word) {
             words[start_word] &= first_mask & last_mask;
+            mark_words(start_word, start_word + 1, words[start_word]);
             return;
         }
 
         words[start_word] &= first_mask;
         words[end_word] &= last_mask;
+        mark_words(start_word, start_word + 1, words[start_word]);
+        mark_words(end_word, end_word + 1, words[end_word]);
     }
 
+    /// @brief Number of set bits. O(1) unless a bulk operation made the cached value stale.
     SizeType cardinality() const {
+        if (card == UnknownCardinality) {
+            card = count_bits(0, WordsCount);
+        }
+        return card;
+    }
+
+    bool empty() const { return cardinality() == 0; }
+
+    /// @brief Number of set bits not greater than `index`. Popcounts from whichever end of the words is closer, using
+    /// the cached cardinality for the upper half.
+    SizeType rank(NumType index) const {
+        const size_t word = index / BitsPerWord;
+        // All "1" from LSB to `index`
+        const WordType mask = static_cast<WordType>((WordType(2) << (index & IndexInsideWordMask)) - 1);
+        if (2 * word < WordsCount || card == UnknownCardinality) {
+            return std::popcount(static_cast<WordType>(words[word] & mask)) + count_bits(0, word);
+        }
+        return card - std::popcount(static_cast<WordType>(words[word] & ~mask)) - count_bits(word + 1, WordsCount);
+    }
+
+    /// @brief The `k`-th smallest set bit (0-based). `k` must be less than the cardinality.
+    NumType select(SizeType k) const {
+        for (size_t i = next_nonzero_word(0); i < WordsCount; i = next_nonzero_word(i + 1)) {
+            SizeType count = std::popcount(words[i]);
+            if (k < count) {
+                WordType w = words[i];
+                for (; k > 0; --k) {
+                    w &= w - 1;  // drop the lowest set bit
+                }
+                return static_cast<NumType>(i * BitsPerWord + std::countr_zero(w));
+            }
+            k -= count;
+        }
+        FROARING_UNREACHABLE
+        return 0;
+    }
+
+    /// @brief The smallest set bit. The container must not be empty.
+    NumType minimum() const {
+        const size_t i = next_nonzero_word(0);
+        assert(i < WordsCount);
+        return static_cast<NumType>(i * BitsPerWord + std::countr_zero(words[i]));
+    }
+
+    /// @brief The largest set bit. The container must not be empty.
+    NumType maximum() const {
+        const size_t i = prev_nonzero_word(WordsCount);
+        assert(i < WordsCount);
+        return static_cast<NumType>((i + 1) * BitsPerWord - 1 - std::countl_zero(words[i]));
+    }
+
+    /// @brief Write the (at most) `n` smallest set bits, each plus `base`, to `out` in ascending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_first(size_t n, OutType base, OutType* out) const {
+        size_t written = 0;
+        for (size_t i = next_nonzero_word(0); i < WordsCount && written < n; i = next_nonzero_word(i + 1)) {
+            for (WordType w = words[i]; w && written < n; w &= w - 1) {
+                out[written++] = base + static_cast<OutType>(i * BitsPerWord + std::countr_zero(w));
+            }
+        }
+        return written;
+    }
+
+    /// @brief Write the (at most) `n` largest set bits, each plus `base`, to `out` in descending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_last(size_t n, OutType base, OutType* out) const {
+        size_t written = 0;
+        for (size_t i = prev_nonzero_word(WordsCount); i < WordsCount && written < n; i = prev_nonzero_word(i)) {
+            for (WordType w = words[i]; w && written < n;) {
+                const size_t bit = BitsPerWord - 1 - std::countl_zero(w);
+                out[written++] = base + static_cast<OutType>(i * BitsPerWord + bit);
+                w ^= (WordType)1 << bit;
+            }
+        }
+        return written;
+    }
+
+    /// @brief Must be called after writing `words` directly, unless the new cardinality is known (see
+    /// `set_cardinality`). Rebuilds the whole summary, O(WordsCount); the next `cardinality()` call recounts.
+    /// The member mutators keep the summary up to date word by word and never need this.
+    void invalidate_cardinality() {
+        rebuild_summary();
+        card = UnknownCardinality;
+    }
+
+    /// @brief Record the cardinality of `words` after a kernel wrote them directly and counted the bits on the way.
+    /// The kernel must also have kept the summary valid, by writing through `write_words` or calling
+    /// `rebuild_summary`.
+    void set_cardinality(SizeType cardinality) {
+        assert(cardinality <= TotalBits);
+        card = cardinality;
+    }
+
+    /// @brief Recompute the summary from `words`.
+    void rebuild_summary() {
+        if constexpr (HasSummary) {
+            for (size_t s = 0; s < SummaryWords; ++s) {
+                WordType bits = 0;
+                for (size_t j = 0; j < BitsPerWord; ++j) {
+                    bits |= WordType(words[s * BitsPerWord + j] != 0) << j;
+                }
+                summary[s] = bits;
+            }
+        }
+    }
+
+    /// @brief Index of the first non-zero word at or after `from`, or WordsCount. With a summary, runs of empty
+    /// words are skipped a summary word at a time.
+    size_t next_nonzero_word(size_t from) const {
+        if constexpr (HasSummary) {
+            size_t s = from / BitsPerWord;
+            if (s >= SummaryWords) {
+                return WordsCount;
+            }
+            WordType bits = summary[s] & static_cast<WordType>(~WordType(0) << (from % BitsPerWord));
+            while (!bits) {
+                if (++s == SummaryWords) {
+                    return WordsCount;
+                }
+                bits = summary[s];
+            }
+            return s * BitsPerWord + std::countr_zero(bits);
+        } else {
+            while (from < WordsCount && !words[from]) {
+                ++from;
+            }
+            return from;
+        }
+    }
+
+    /// @brief Index of the last non-zero word before `end`, or WordsCount if there is none.
+    size_t prev_nonzero_word(size_t end) const {
+        if constexpr (HasSummary) {
+            if (end == 0) {
+                return WordsCount;
+            }
+            size_t s = (end - 1) / BitsPerWord;
+            // All "1" from LSB to bit `end - 1`
+            const WordType mask = static_cast<WordType>(AllOnes >> (BitsPerWord - 1 - (end - 1) % BitsPerWord));
+            WordType bits = summary[s] & mask;
+            while (!bits) {
+                if (s-- == 0) {
+                    return WordsCount;
+                }
+                bits = summary[s];
+            }
+            return s * BitsPerWord + BitsPerWord - 1 - std::countl_zero(bits);
+        } else {
+            while (end > 0) {
+                if (words[--end]) {
+                    return end;
+                }
+            }
+            return WordsCount;
+        }
+    }
+
+    /// @brief Set `words[i] = op(i)` for every word `i` flagged by `candidates(s)`, the candidate bits of summary word
+    /// `s`, reporting each written word to `stats.add_word(i, word)` in ascending order, and update the summary.
+    /// Words that are not candidates must already be zero. Without a summary every word is a candidate.
+    template <typename Candidates, typename Op, typename Stats>
+    void write_words(Candidates candidates, Op op, Stats& stats) {
+        if constexpr (HasSummary) {
+            for (size_t s = 0; s < SummaryWords; ++s) {
+                WordType bits = 0;
+                auto write = [&](size_t bit) {
+                    const size_t i = s * BitsPerWord + bit;
+                    const WordType w = op(i);
+                    words[i] = w;
+                    bits |= WordType(w != 0) << bit;
+                    stats.add_word(i, w);
+                };
+                const WordType c = candidates(s);
+                if (c == static_cast<WordType>(~WordType(0))) {  // no word to skip: a plain loop
+                    for (size_t bit = 0; bit < BitsPerWord; ++bit) {
+                        write(bit);
+                    }
+                } else {
+                    for (WordType rest = c; rest; rest &= rest - 1) {
+                        write(std::countr_zero(rest));
+                    }
+                }
+                summary[s] = bits;
+            }
+        } else {
+            for (size_t i = 0; i < WordsCount; ++i) {
+                words[i] = op(i);
+                stats.add_word(i, words[i]);
+            }
+        }
+    }
+
+    /// @brief Number of maximal runs of consecutive set bits.
+    SizeType count_runs() const {
+        SizeType runs = 0;
+        WordType carry = 0;  // MSB of the previous word, shifted into position 0
+        for (size_t i = next_nonzero_word(0), next = 0; i < WordsCount; next = i + 1, i = next_nonzero_word(next)) {
+            const WordType word = words[i];
+            carry = i == next ? carry : 0;  // skipped words are zero
+            // A run starts at every set bit whose lower neighbour is unset.
+            runs += std::popcount(static_cast<WordType>(word & ~((word << 1) | carry)));
+            carry = word >> (BitsPerWord - 1);
+        }
+        return runs;
+    }
+
+private:
+    /// @brief Number of set bits in `words[first, last)`.
+    SizeType count_bits(size_t first, size_t last) const {
         SizeType count = 0;
-        for (const auto& word : words) {
-            count += std::popcount(word);
+        if constexpr (HasSummary) {
+            for (size_t s = first / BitsPerWord; s * BitsPerWord < last; ++s) {
+                const size_t lo = std::max(first, s * BitsPerWord), hi = std::min(last, (s + 1) * BitsPerWord);
+                if (summary[s] == static_cast<WordType>(~WordType(0))) {  // no word to skip: a plain loop
+                    for (size_t i = lo; i < hi; ++i) {
+                        count += std::popcount(words[i]);
+                    }
+                    continue;
+                }
+                auto bits = static_cast<WordType>(summary[s] >> (lo % BitsPerWord) << (lo % BitsPerWord));
+                if (hi % BitsPerWord) {
+                    bits &= static_cast<WordType>((WordType(1) << (hi % BitsPerWord)) - 1);
+                }
+                for (; bits; bits &= bits - 1) {
+                    count += std::popcount(words[s * BitsPerWord + std::countr_zero(bits)]);
+                }
+            }
+        } else {
+            for (size_t i = first; i < last; ++i) {
+                count += std::popcount(words[i]);
+            }
         }
         return count;
     }
 
+    void mark_word(size_t i) {
+        if constexpr (HasSummary) {
+            summary[i / BitsPerWord] |= WordType(1) << (i % BitsPerWord);
+        }
+    }
+
+    void unmark_word(size_t i) {
+        if constexpr (HasSummary) {
+            summary[i / BitsPerWord] &= ~(WordType(1) << (i % BitsPerWord));
+        }
+    }
+
+    /// @brief Flag words [first, last) as non-zero (`value`) or zero.
+    void mark_words(size_t first, size_t last, bool value) {
+        if constexpr (HasSummary) {
+            for (size_t s = first / BitsPerWord; first < last; ++s) {
+                const size_t lo = first % BitsPerWord, hi = std::min(last - s * BitsPerWord, BitsPerWord);
+                // All "1" from bit `lo` to bit `hi - 1`
+                const WordType mask =
+                    static_cast<WordType>(AllOnes << lo) & static_cast<WordType>(AllOnes >> (BitsPerWord - hi));
+                summary[s] = value ? (summary[s] | mask) : (summary[s] & ~mask);
+                first = (s + 1) * BitsPerWord;
+            }
+        }
+    }
+
 public:
     WordType words[WordsCount];
+    /// Bit `i` is set iff `words[i]` is non-zero. Empty unless HasSummary.
+    [[no_unique_address]] std::array<WordType, SummaryWords> summary;
+
+private:
+    mutable SizeType card;  // cached cardinality, or UnknownCardinality
 };
 }  // namespace froaring
\ No newline at end of file
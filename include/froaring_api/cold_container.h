@@ -0,0 +1,423 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "array_container.h"
+#include "instrument.h"
+#include "prelude.h"
+
+namespace froaring {
+/// @brief A read-only, compressed container for rarely queried data. Only `compact_cold()` produces it, and only
+/// where it is smaller than the container it replaces; a mutation turns it back into an `ArrayContainer`.
+///
+/// Values are split into blocks of BlockSize. Each block keeps its first and last value as skip information, and
+/// the gaps between consecutive values (minus one) bit-packed at the width of its largest gap. Queries decode only
+/// the blocks whose [min, max] range they hit.
+template <typename WordType, size_t DataBits>
+class ColdContainer : public froaring_container_t {
+public:
+    using IndexOrNumType = froaring::can_fit_t<DataBits>;
+    using SizeType = froaring::can_fit_t<DataBits + 1>;
+    using Unpacked = ArrayContainer<WordType, DataBits>;
+    static constexpr size_t ContainerCapacity = (1 << DataBits);
+    static constexpr size_t BlockSize = 128;
+
+    static_assert(DataBits < 64, "A cold container packs gaps narrower than a word");
+
+    /// Skip information and location of one block.
+    struct Block {
+        IndexOrNumType min;  // the first value, stored as is
+        IndexOrNumType max;
+        uint32_t offset;  // first word of the packed gaps in `words`
+        uint8_t width;    // bits per gap
+    };
+
+    /// @brief Words needed to pack `n` gaps of `width` bits.
+    static constexpr size_t words_for(size_t n, size_t width) { return (n * width + 63) / 64; }
+
+    explicit ColdContainer(const Unpacked* a) : size(a->size), block_count((a->size + BlockSize - 1) / BlockSize) {
+        blocks = static_cast<Block*>(malloc(std::max<size_t>(block_count, 1) * sizeof(Block)));
+        assert(blocks && "Failed to allocate memory for ColdContainer");
+        size_t total = 0;
+        for (size_t b = 0; b < block_count; ++b) {
+            const size_t first = b * BlockSize, n = block_size(b);
+            size_t widest = 0;
+            for (size_t i = 1; i < n; ++i) {
+                widest |= size_t(a->vals[first + i] - a->vals[first + i - 1] - 1);
+            }
+            blocks[b].min = a->vals[first];
+            blocks[b].max = a->vals[first + n - 1];
+            blocks[b].offset = static_cast<uint32_t>(total);
+            blocks[b].width = static_cast<uint8_t>(std::bit_width(widest));
+            total += words_for(n - 1, blocks[b].width);
+        }
+        word_count = static_cast<uint32_t>(total);
+        words = static_cast<uint64_t*>(calloc(std::max<size_t>(total, 1), sizeof(uint64_t)));
+        assert(words && "Failed to allocate memory for ColdContainer");
+        FROARING_COUNT(Alloc);
+        for (size_t b = 0; b < block_count; ++b) {
+            const size_t first = b * BlockSize, n = block_size(b), width = blocks[b].width;
+            uint64_t* out = words + blocks[b].offset;
+            for (size_t i = 1; i < n && width; ++i) {
+                const uint64_t gap = a->vals[first + i] - a->vals[first + i - 1] - 1;
+                const size_t bit = (i - 1) * width, w = bit / 64, offset = bit % 64;
+                out[w] |= gap << offset;
+                if (offset + width > 64) {
+                    out[w + 1] |= gap >> (64 - offset);
+                }
+            }
+        }
+    }
+    explicit ColdContainer(const ColdContainer& other)
+        : froaring_container_t(),
+          size(other.size),
+          block_count(other.block_count),
+          word_count(other.word_count),
+          blocks(static_cast<Block*>(malloc(std::max<size_t>(block_count, 1) * sizeof(Block)))),
+          words(static_cast<uint64_t*>(malloc(std::max<size_t>(word_count, 1) * sizeof(uint64_t)))) {
+        assert(blocks && words && "Failed to allocate memory for ColdContainer");
+        std::memcpy(blocks, other.blocks, block_count * sizeof(Block));
+        std::memcpy(words, other.words, word_count * sizeof(uint64_t));
+        FROARING_COUNT(Alloc);
+    }
+
+    ~ColdContainer() {
+        free(blocks);
+        free(words);
+    }
+
+    ColdContainer& operator=(const ColdContainer&) = delete;
+
+    void debug_print() const {
+        IndexOrNumType block[BlockSize];
+        for (size_t b = 0; b < block_count; ++b) {
+            const size_t n = decode_block(b, block);
+            std::cout << "[" << int(blocks[b].width) << " bits] ";
+            for (size_t i = 0; i < n; ++i) {
+                std::cout << int(block[i]) << " ";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    /// @brief Number of values in block `b`.
+    size_t block_size(size_t b) const { return std::min(BlockSize, size - b * BlockSize); }
+
+    /// @brief Payload bytes: the block table and the packed gaps.
+    size_t payload_bytes() const { return block_count * sizeof(Block) + word_count * sizeof(uint64_t); }
+
+    /// @brief Decode block `b` into `out`, which holds at least BlockSize values.
+    /// @return Number of values decoded.
+    size_t decode_block(size_t b, IndexOrNumType* out) const {
+        static constexpr auto decoders = make_decoders(std::make_index_sequence<DataBits + 1>());
+        const Block& block = blocks[b];
+        const size_t n = block_size(b);
+        const uint64_t* in = words + block.offset;
+        out[0] = block.min;
+        if (n == BlockSize) {  // gaps at constant shifts
+            decoders[block.width](in, out);
+            return n;
+        }
+        IndexOrNumType v = block.min;
+        for (size_t i = 1; i < n; ++i) {
+            v = static_cast<IndexOrNumType>(v + gap(in, i - 1, block.width) + 1);
+            out[i] = v;
+        }
+        return n;
+    }
+
+    /// @brief Every value, decoded into `out`, which holds at least `size` values.
+    void unpack(IndexOrNumType* out) const {
+        IndexOrNumType block[BlockSize];
+        for (size_t b = 0; b < block_count; ++b) {
+            const size_t n = decode_block(b, block);
+            std::copy(block, block + n, out + b * BlockSize);
+        }
+    }
+
+    /// @brief An `ArrayContainer` holding the same values. The caller owns it.
+    Unpacked* to_array() const {
+        auto ans = new Unpacked(size, size);
+        unpack(ans->vals);
+        return ans;
+    }
+
+    SizeType cardinality() const { return size; }
+
+    /// @brief The value at position `pos`, given the value `prev` at `pos - 1` (ignored at the start of a block):
+    /// sequential reads without decoding whole blocks.
+    IndexOrNumType next_value(size_t pos, IndexOrNumType prev) const {
+        const size_t b = pos / BlockSize, i = pos % BlockSize;
+        if (i == 0) {
+            return blocks[b].min;
+        }
+        return static_cast<IndexOrNumType>(prev + gap(words + blocks[b].offset, i - 1, blocks[b].width) + 1);
+    }
+
+    /// @brief First block whose largest value is not less than `num`, at or after block `from`, or `block_count`.
+    size_t find_block(IndexOrNumType num, size_t from = 0) const {
+        return std::partition_point(blocks + from, blocks + block_count,
+                                    [num](const Block& block) { return block.max < num; }) -
+               blocks;
+    }
+
+    bool test(IndexOrNumType num) const {
+        const size_t b = find_block(num);
+        if (b == block_count || blocks[b].min > num) {
+            return false;
+        }
+        if (blocks[b].min == num || blocks[b].max == num) {
+            return true;
+        }
+        // Sum the gaps up to `num` only: that reads half a block on average, rather than decoding all of it
+        const uint64_t* in = words + blocks[b].offset;
+        const size_t width = blocks[b].width;
+        size_t v = blocks[b].min;
+        for (size_t i = 0; v < num; ++i) {
+            v += gap(in, i, width) + 1;
+        }
+        return v == num;
+    }
+
+    /// @brief Number of values not greater than `num`.
+    SizeType rank(IndexOrNumType num) const {
+        const size_t b = find_block(num);
+        if (b == block_count) {
+            return size;
+        }
+        if (blocks[b].min > num) {
+            return static_cast<SizeType>(b * BlockSize);
+        }
+        IndexOrNumType block[BlockSize];
+        const size_t n = decode_block(b, block);
+        return static_cast<SizeType>(b * BlockSize + (std::upper_bound(block, block + n, num) - block));
+    }
+
+    /// @brief The `k`-th smallest value (0-based). `k` must be less than the cardinality.
+    IndexOrNumType select(SizeType k) const {
+        assert(k < size);
+        const size_t b = k / BlockSize;
+        IndexOrNumType v = blocks[b].min;
+        for (size_t pos = b * BlockSize + 1; pos <= k; ++pos) {
+            v = next_value(pos, v);
+        }
+        return v;
+    }
+
+    /// @brief The smallest value. The container must not be empty.
+    IndexOrNumType minimum() const {
+        assert(size);
+        return blocks[0].min;
+    }
+
+    /// @brief The largest value. The container must not be empty.
+    IndexOrNumType maximum() const {
+        assert(size);
+        return blocks[block_count - 1].max;
+    }
+
+    /// @brief Write the (at most) `n` smallest values, each plus `base`, to `out` in ascending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_first(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        IndexOrNumType block[BlockSize];
+        for (size_t b = 0; b * BlockSize < n; ++b) {
+            const size_t count = std::min(decode_block(b, block), n - b * BlockSize);
+            for (size_t i = 0; i < count; ++i) {
+                out[b * BlockSize + i] = base + block[i];
+            }
+        }
+        return n;
+    }
+
+    /// @brief Write the (at most) `n` largest values, each plus `base`, to `out` in descending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_last(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        IndexOrNumType block[BlockSize];
+        size_t written = 0;
+        for (size_t b = block_count; b-- > 0 && written < n;) {
+            const size_t count = decode_block(b, block);
+            for (size_t i = count; i-- > 0 && written < n;) {
+                out[written++] = base + block[i];
+            }
+        }
+        return n;
+    }
+
+    /// @brief Number of maximal runs of consecutive values.
+    SizeType count_runs() const {
+        SizeType runs = 0;
+        for (size_t b = 0; b < block_count; ++b) {
+            const uint64_t* in = words + blocks[b].offset;
+            runs += b == 0 || size_t(blocks[b - 1].max) + 1 != blocks[b].min;
+            for (size_t i = 1; i < block_size(b) && blocks[b].width; ++i) {
+                runs += gap(in, i - 1, blocks[b].width) != 0;
+            }
+        }
+        return runs;
+    }
+
+    /// @brief Whether both containers hold the same values: the encoding is canonical, unused bits are zero.
+    bool equals(const ColdContainer& other) const {
+        if (size != other.size || word_count != other.word_count) {
+            return false;
+        }
+        for (size_t b = 0; b < block_count; ++b) {
+            if (blocks[b].min != other.blocks[b].min || blocks[b].max != other.blocks[b].max ||
+                blocks[b].width != other.blocks[b].width) {
+                return false;
+            }
+        }
+        return std::memcmp(words, other.words, word_count * sizeof(uint64_t)) == 0;
+    }
+
+    /// @brief Call `visit(value)` for every value also held by the sorted array `vals[0..n)`, in ascending order,
+    /// until it returns false. Blocks whose range holds none of `vals` are skipped without being decoded.
+    /// @return Whether every call returned true.
+    template <typename Visitor>
+    bool for_each_common(const IndexOrNumType* vals, size_t n, Visitor&& visit) const {
+        IndexOrNumType block[BlockSize];
+        size_t b = 0, j = 0;
+        while (j < n) {
+            b = find_block(vals[j], b);
+            if (b == block_count) {
+                break;
+            }
+            j = std::lower_bound(vals + j, vals + n, blocks[b].min) - vals;
+            if (j == n || vals[j] > blocks[b].max) {  // nothing to look up in this block
+                continue;
+            }
+            const size_t count = decode_block(b, block);
+            for (size_t i = 0; i < count && j < n;) {
+                if (block[i] < vals[j]) {
+                    ++i;
+                } else if (block[i] > vals[j]) {
+                    ++j;
+                } else {
+                    if (!visit(block[i])) {
+                        return false;
+                    }
+                    ++i;
+                    ++j;
+                }
+            }
+            ++b;
+        }
+        return true;
+    }
+
+    /// @brief Call `visit(value)` for every value held by both containers, in ascending order, until it returns
+    /// false. Only the blocks whose ranges overlap a block of the other side are decoded.
+    /// @return Whether every call returned true.
+    template <typename Visitor>
+    bool for_each_common(const ColdContainer& other, Visitor&& visit) const {
+        IndexOrNumType mine[BlockSize], theirs[BlockSize];
+        size_t i = 0, j = 0, decoded_i = block_count, decoded_j = other.block_count, ni = 0, nj = 0;
+        while (i < block_count && j < other.block_count) {
+            if (blocks[i].max < other.blocks[j].min) {
+                ++i;
+                continue;
+            }
+            if (other.blocks[j].max < blocks[i].min) {
+                ++j;
+                continue;
+            }
+            if (decoded_i != i) {
+                ni = decode_block(i, mine);
+                decoded_i = i;
+            }
+            if (decoded_j != j) {
+                nj = other.decode_block(j, theirs);
+                decoded_j = j;
+            }
+            for (size_t x = 0, y = 0; x < ni && y < nj;) {
+                if (mine[x] < theirs[y]) {
+                    ++x;
+                } else if (mine[x] > theirs[y]) {
+                    ++y;
+                } else {
+                    if (!visit(mine[x])) {
+                        return false;
+                    }
+                    ++x;
+                    ++y;
+                }
+            }
+            // The block ending first cannot overlap anything further on the other side
+            if (blocks[i].max < other.blocks[j].max) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+        return true;
+    }
+
+private:
+    using Decoder = void (*)(const uint64_t*, IndexOrNumType*);
+
+    /// @brief The `i`-th gap of a block whose gaps start at `in`.
+    static IndexOrNumType gap(const uint64_t* in, size_t i, size_t width) {
+        if (!width) {  // no words are stored for the block
+            return 0;
+        }
+        const size_t bit = i * width, w = bit / 64, offset = bit % 64;
+        uint64_t v = in[w] >> offset;
+        if (offset + width > 64) {
+            v |= in[w + 1] << (64 - offset);
+        }
+        return static_cast<IndexOrNumType>(v & ((uint64_t(1) << width) - 1));
+    }
+
+    /// @brief The `I`-th gap of a block packed at `Width` bits.
+    template <size_t Width, size_t I>
+    static IndexOrNumType gap(const uint64_t* in) {
+        if constexpr (Width == 0) {
+            return 0;
+        } else {
+            constexpr size_t bit = I * Width, w = bit / 64, offset = bit % 64;
+            uint64_t v = in[w] >> offset;
+            if constexpr (offset + Width > 64) {
+                v |= in[w + 1] << (64 - offset);
+            }
+            return static_cast<IndexOrNumType>(v & ((uint64_t(1) << Width) - 1));
+        }
+    }
+
+    /// @brief Decode the values after `out[0]` of a full block packed at `Width` bits, with every shift a constant.
+    /// The running value stays in a register rather than being reloaded from `out`.
+    template <size_t Width, size_t... I>
+    static void decode_gaps(const uint64_t* in, IndexOrNumType* out, std::index_sequence<I...>) {
+        IndexOrNumType v = out[0];
+        ((v = static_cast<IndexOrNumType>(v + gap<Width, I>(in) + 1), out[I + 1] = v), ...);
+    }
+
+    template <size_t Width>
+    static void decode_gaps(const uint64_t* in, IndexOrNumType* out) {
+        decode_gaps<Width>(in, out, std::make_index_sequence<BlockSize - 1>());
+    }
+
+    /// @brief One gap decoder per width, from 0 to DataBits bits.
+    template <size_t... Width>
+    static constexpr std::array<Decoder, sizeof...(Width)> make_decoders(std::index_sequence<Width...>) {
+        return {&decode_gaps<Width>...};
+    }
+
+public:
+    SizeType size;
+    SizeType block_count;
+    uint32_t word_count = 0;
+    Block* blocks;
+    uint64_t* words = nullptr;
+};
+}  // namespace froaring
@@ -4,7 +4,9 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
 #include "mix_ops.h"
+#include "optimize.h"
 #include "prelude.h"
 #include "rle_container.h"
 #include "utils.h"
@@ -14,6 +16,20 @@ using CTy = froaring::ContainerType;
 
 template <typename WordType, size_t DataBits>
 bool froaring_contains_bb(const BitmapContainer<WordType, DataBits>* a, const BitmapContainer<WordType, DataBits>* b) {
+    if constexpr (BitmapContainer<WordType, DataBits>::HasSummary) {  // only the non-empty words of `b`
+        for (size_t s = 0; s < b->SummaryWords; ++s) {
+            if (b->summary[s] & ~a->summary[s]) {
+                return false;
+            }
+            for (WordType c = b->summary[s]; c; c &= c - 1) {
+                const size_t i = s * b->BitsPerWord + std::countr_zero(c);
+                if ((a->words[i] & b->words[i]) != b->words[i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
     for (size_t i = 0; i < a->WordsCount; ++i) {
         if ((a->words[i] & b->words[i]) != b->words[i]) {
             return false;
@@ -53,8 +69,17 @@ bool froaring_contains_aa(const ArrayContainer<WordType, DataBits>* a, const Arr
 
 template <typename WordType, size_t DataBits>
 bool froaring_contains_rr(const RLEContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
-    // FIXME: TODO: ...
-    FROARING_NOT_IMPLEMENTED
+    // Every run of `b` must lie within a single run of `a`, as runs are never adjacent
+    size_t i = 0;
+    for (size_t j = 0; j < b->run_count; ++j) {
+        while (i < a->run_count && a->runs[i].end < b->runs[j].start) {
+            ++i;
+        }
+        if (i == a->run_count || a->runs[i].start > b->runs[j].start || a->runs[i].end < b->runs[j].end) {
+            return false;
+        }
+    }
+    return true;
 }
 
 template <typename WordType, size_t DataBits>
@@ -66,17 +91,19 @@ bool froaring_contains_ar(const ArrayContainer<WordType, DataBits>* a, const RLE
     if (run_card > a->size) {
         return false;
     }
-    size_t start_pos = 0, stop_pos = 0;
-    for (int i = 0; i < b->run_count; ++i) {
-        typename ArrayContainer<WordType, DataBits>::SizeType start = b->runs[i].start;
-        typename ArrayContainer<WordType, DataBits>::SizeType stop = b->runs[i].end;
-        start_pos = a->advanceUntil(start, stop_pos);
-        stop_pos = a->advanceUntil(stop, stop_pos);
-        if (stop_pos == a->size) {
-            return false;
-        } else if (stop_pos - start_pos != stop - start || a->vals[start_pos] != start || a->vals[stop_pos] != stop) {
+    // Values are unique and sorted, so a run [start, end] is contained iff `start` is found at some position p and
+    // `end` at p + (end - start)
+    size_t pos = 0;
+    for (size_t i = 0; i < b->run_count; ++i) {
+        size_t start = b->runs[i].start;
+        size_t stop = b->runs[i].end;
+        while (pos < a->size && a->vals[pos] < start) {
+            ++pos;
+        }
+        if (pos + (stop - start) >= a->size || a->vals[pos] != start || a->vals[pos + (stop - start)] != stop) {
             return false;
         }
+        pos += stop - start + 1;
     }
     return true;
 }
@@ -89,7 +116,7 @@ bool froaring_contains_ra(const RLEContainer<WordType, DataBits>* a, const Array
     if (b->size > a->cardinality()) {
         return false;
     }
-    int i_array = 0, i_run = 0;
+    size_t i_array = 0, i_run = 0;
     while (i_array < b->size && i_run < a->run_count) {
         typename RLEContainer<WordType, DataBits>::SizeType start = a->runs[i_run].start;
         typename RLEContainer<WordType, DataBits>::SizeType stop = a->runs[i_run].end;
@@ -113,7 +140,7 @@ bool froaring_contains_br(const BitmapContainer<WordType, DataBits>* a, const RL
     if (a->cardinality() < b->cardinality()) {
         return false;
     }
-    for (int i = 0; i < b->run_count; ++i) {
+    for (size_t i = 0; i < b->run_count; ++i) {
         typename RLEContainer<WordType, DataBits>::SizeType run_start = b->runs[i].start;
         typename RLEContainer<WordType, DataBits>::SizeType run_end = b->runs[i].end;
         if (!a->test_range(run_start, run_end)) {
@@ -197,9 +224,25 @@ bool froaring_contains_ab(const ArrayContainer<WordType, DataBits>* a, const Bit
 
 template <typename WordType, size_t DataBits>
 bool froaring_contains(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb) {
+    FROARING_KERNEL_SCOPE(Contains, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (ta == CTy::Full) {
+        return true;
+    }
+    if (tb == CTy::Full) {
+        return container_cardinality<WordType, DataBits>(a, ta) == BitmapSized::TotalBits;
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        const bool result = froaring_contains<WordType, DataBits>(ua, ub, ua_type, ub_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_contains_bb(static_cast<const BitmapSized*>(a), static_cast<const BitmapSized*>(b));
@@ -4,7 +4,9 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
 #include "mix_ops.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 #include "utils.h"
@@ -16,247 +18,211 @@ template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_bb(const BitmapContainer<WordType, DataBits>* a,
                                        const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
     auto* result = new BitmapContainer<WordType, DataBits>();
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        result->words[i] = a->words[i] & (~b->words[i]);
-    }
-    result_type = CTy::Bitmap;
-    return result;
+    BitmapStats<WordType> stats;
+    // Words empty in `a` stay empty
+    result->write_words([&](size_t s) { return a->summary[s]; },
+                        [&](size_t i) { return a->words[i] & (~b->words[i]); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_aa(const ArrayContainer<WordType, DataBits>* a,
                                        const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    if (a->size == 0) {
-        result_type = CTy::Array;
-        return new ArrayContainer<WordType, DataBits>();
-    }
-
-    if (b->size == 0) {
-        result_type = CTy::Array;
-        return new ArrayContainer<WordType, DataBits>(*a);
-    }
-
     auto* result = new ArrayContainer<WordType, DataBits>(a->size);
     size_t i = 0, j = 0;
-    size_t new_card = 0;
+    size_t new_card = 0, runs = 0;
+    auto append = [&](typename ArrayContainer<WordType, DataBits>::IndexOrNumType val) {
+        runs += is_run_start(result->vals, new_card, val);
+        result->vals[new_card++] = val;
+    };
     // Linear scan
-    result_type = CTy::Array;
-    while (true) {
-        while (a->vals[i] < b->vals[j]) {
-        SKIP_FIRST_COMPARE:
-            result->vals[new_card++] = a->vals[i];
-            ++i;
-            if (i == a->size) {
-                result->size = new_card;
-                return result;
-            }
-        }
-        while (a->vals[i] > b->vals[j]) {
+    while (i < a->size && j < b->size) {
+        if (a->vals[i] < b->vals[j]) {
+            append(a->vals[i++]);
+        } else if (a->vals[i] > b->vals[j]) {
             ++j;
-            if (j == b->size) {
-                while (i < a->size) {
-                    result->vals[new_card++] = a->vals[i];
-                    i++;
-                }
-                result->size = new_card;
-                return result;
-            }
-        }
-        if (a->vals[i] == b->vals[j]) {
+        } else {
             ++i;
             ++j;
-            if (i == a->size || j == b->size) {
-                result->size = new_card;
-                return result;
-            }
-        } else {
-            goto SKIP_FIRST_COMPARE;
         }
     }
-    FROARING_UNREACHABLE
+    while (i < a->size) {
+        append(a->vals[i++]);
+    }
+    result->size = new_card;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, new_card, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_rr(const RLEContainer<WordType, DataBits>* a,
                                        const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // FIXME:...
-    FROARING_NOT_IMPLEMENTED
+    using NumType = typename RLEContainer<WordType, DataBits>::IndexOrNumType;
+    // Each run of `b` splits at most one run of `a` into two
+    auto* result = new RLEContainer<WordType, DataBits>(a->run_count + b->run_count);
+    size_t new_runs = 0, card = 0;
+    auto append = [&](size_t start, size_t end) {
+        result->runs[new_runs++] = {static_cast<NumType>(start), static_cast<NumType>(end)};
+        card += end - start + 1;
+    };
+    size_t j = 0;
+    for (size_t i = 0; i < a->run_count; ++i) {
+        // Use size_t so that `end + 1` cannot overflow at the maximum value
+        size_t start = a->runs[i].start;
+        const size_t end = a->runs[i].end;
+        while (j < b->run_count && b->runs[j].end < start) {
+            ++j;
+        }
+        // `j` stays on the last overlapping run of `b`, as it may also overlap the next run of `a`
+        for (size_t k = j; k < b->run_count && b->runs[k].start <= end; ++k) {
+            if (b->runs[k].start > start) {
+                append(start, b->runs[k].start - 1);
+            }
+            start = size_t(b->runs[k].end) + 1;
+            j = k;
+        }
+        if (start <= end) {
+            append(start, end);
+        }
+    }
+    result->run_count = new_runs;
+    return finalize_container<WordType, DataBits>(result, CTy::RLE, card, new_runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_ar(const ArrayContainer<WordType, DataBits>* a,
                                        const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
-    if (a->size == 0) {
-        return new ArrayContainer<WordType, DataBits>();
-    }
-
-    if (b->run_count == 0) {
-        return new ArrayContainer<WordType, DataBits>(*a);
-    }
     auto* result = new ArrayContainer<WordType, DataBits>(a->cardinality());
 
     size_t rlepos = 0;
-    size_t arraypos = 0;
-    size_t newcard = 0;
-    auto rle = b->runs[rlepos];
-
-    while (true) {
-        while (rle.end < a->vals[arraypos]) {
-        SKIP_FIRST_COMPARE:
+    size_t newcard = 0, runs = 0;
+    for (size_t arraypos = 0; arraypos < a->size; ++arraypos) {
+        auto val = a->vals[arraypos];
+        // TODO: use Gallop search
+        while (rlepos < b->run_count && b->runs[rlepos].end < val) {
             ++rlepos;
-            if (rlepos == b->run_count) {  // done
-                while (arraypos < a->size) {
-                    result->vals[newcard++] = a->vals[arraypos];
-                    ++arraypos;
-                }
-                result->size = newcard;
-                return result;
-            }
-            rle = b->runs[rlepos];
-        }
-        while (rle.start > a->vals[arraypos]) {
-            result->vals[newcard++] = a->vals[arraypos];
-            ++arraypos;
-            if (arraypos == a->size) {
-                result->size = newcard;
-                return result;
-            }
         }
-        while (rle.start <= a->vals[arraypos] && a->vals[arraypos] <= rle.end) {
-            // TODO: use Gallop search
-            ++arraypos;
-            if (arraypos == a->size) {
-                result->size = newcard;
-                return result;
-            }
-            goto SKIP_FIRST_COMPARE;
+        if (rlepos < b->run_count && b->runs[rlepos].start <= val) {
+            continue;
         }
+        runs += is_run_start(result->vals, newcard, val);
+        result->vals[newcard++] = val;
     }
-
-    FROARING_UNREACHABLE;
+    result->size = newcard;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, newcard, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_ra(const RLEContainer<WordType, DataBits>* a,
                                        const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
-    if (a->run_count == 0) {
-        return new ArrayContainer<WordType, DataBits>();
-    }
-
-    if (b->size == 0) {
-        return new RLEContainer<WordType, DataBits>(*a);
-    }
-
-    result_type = CTy::RLE;
     auto* result = new RLEContainer<WordType, DataBits>(*a);
     for (size_t i = 0; i < b->size; ++i) {
         auto val = b->vals[i];
         result->reset(val);
     }
-    return result;
-
-    // TODO: Use more efficient type depends on the cardinality!
+    return finalize_container(result, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_br(const BitmapContainer<WordType, DataBits>* a,
                                        const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    if (b->run_count == 0) {
-        auto* result = new BitmapContainer<WordType, DataBits>(*a);
-        result_type = CTy::Bitmap;
-        return result;
-    }
-
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
-    for (size_t i = 0; i < b->run_count; i++) {
-        result->reset_range(b->runs[i].start, b->runs[i].end);
-    }
-    result_type = CTy::Bitmap;
-    return result;
-    // TODO: maybe convert to ArrayContainer if the cardinality is low?
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(b);
+    result->write_words([&](size_t s) { return a->summary[s]; },
+                        [&](size_t i) { return static_cast<WordType>(a->words[i] & ~runs.word(i)); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_rb(const RLEContainer<WordType, DataBits>* a,
                                        const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
     size_t card = a->cardinality();
-    if (card <= ArrayContainer<WordType, DataBits>::ArrayToBitmapCountThreshold) {
-        result_type = CTy::Array;
+    if (card <= ContainerPolicy<WordType, DataBits>::ArrayMaxCardinality) {
+        // The result can never outgrow an array
+        using IndexOrNumType = typename ArrayContainer<WordType, DataBits>::IndexOrNumType;
         auto* result = new ArrayContainer<WordType, DataBits>(card, 0);
+        size_t runs = 0;
         for (size_t rlepos = 0; rlepos < a->run_count; ++rlepos) {
             auto rle = a->runs[rlepos];
-            for (auto run_value = rle.start; run_value <= rle.end; ++run_value) {
+            for (size_t run_value = rle.start; run_value <= rle.end; ++run_value) {
                 if (!b->test(run_value)) {
+                    runs += is_run_start(result->vals, result->size, static_cast<IndexOrNumType>(run_value));
                     result->vals[result->size++] = run_value;
                 }
             }
         }
-        return result;
-    } else {  // we guess it will be a bitset, though have to check guess when done
-        FROARING_NOT_IMPLEMENTED
-        // auto* result = new RLEContainer<WordType, DataBits>(*b);
-
-        // uint32_t last_pos = 0;
-        // for (int32_t rlepos = 0; rlepos < result->runs_count; ++rlepos) {
-        //     auto rle = a->runs[rlepos];
-
-        //     uint32_t start = rle.start;
-        //     uint32_t end = rle.end;
-        //     // FIXME: TODO: ...
-        //     FROARING_NOT_IMPLEMENTED
-        //     // bitset_reset_range(result->words, last_pos, start);
-        //     // bitset_flip_range(result->words, start, end);
-        //     last_pos = end;
-        // }
-        // // bitset_reset_range(result->words, last_pos, ...);
-
-        // // TODO: maybe convert to ArrayContainer if the cardinality is low?
-        // return result;  // bitset
+        return finalize_container<WordType, DataBits>(result, CTy::Array, result->size, runs, result_type);
     }
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(a);
+    result->write_words([&](size_t s) { return runs.summary(s); },
+                        [&](size_t i) { return static_cast<WordType>(runs.word(i) & ~b->words[i]); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_ba(const BitmapContainer<WordType, DataBits>* a,
                                        const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: accelerate with assembly
-    result_type = CTy::Bitmap;
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
-    for (size_t i = 0; i < b->size; ++i) {
-        auto val = b->vals[i];
-        result->reset(val);
-    }
-    return result;
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    ArrayWords<WordType, DataBits> vals(b);
+    result->write_words([&](size_t s) { return a->summary[s]; },
+                        [&](size_t i) { return static_cast<WordType>(a->words[i] & ~vals.word(i)); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_ab(const ArrayContainer<WordType, DataBits>* a,
                                        const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
     // TODO: accelerate with assembly
-
-    result_type = CTy::Array;
-
     auto* result = new ArrayContainer<WordType, DataBits>(a->size, 0);
-    size_t new_size = 0;
+    size_t new_size = 0, runs = 0;
     for (size_t i = 0; i < a->size; ++i) {
         auto val = a->vals[i];
         if (!b->test(val)) {
+            runs += is_run_start(result->vals, new_size, val);
             result->vals[new_size++] = val;
         }
     }
     result->size = new_size;
-    return result;
+    return finalize_container<WordType, DataBits>(result, CTy::Array, new_size, runs, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                     CTy& result_type) {
+    FROARING_KERNEL_SCOPE(Diff, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (tb == CTy::Full) {  // nothing is left
+        result_type = CTy::Array;
+        return new ArraySized(0, 0);
+    }
+    if (ta == CTy::Full) {  // the complement of `b`, subtracted from a temporary full run
+        auto full = full_to_rle<WordType, DataBits>();
+        auto result = froaring_diff<WordType, DataBits>(full, b, CTy::RLE, tb, result_type);
+        release_container(full);
+        return result;
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_diff<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_diff_bb(static_cast<const BitmapSized*>(a), static_cast<const BitmapSized*>(b),
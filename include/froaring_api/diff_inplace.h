@@ -5,6 +5,8 @@
 #include "array_container.h"
 #include "bitmap_container.h"
 #include "diff.h"
+#include "instrument.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -14,121 +16,69 @@ using CTy = froaring::ContainerType;
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_bb(BitmapContainer<WordType, DataBits>* a,
                                                const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        a->words[i] &= (~b->words[i]);
-    }
-    result_type = CTy::Bitmap;
-
-    return a;
-    // TODO: may transform into array container if the cardinality is low
+    BitmapStats<WordType> stats;
+    a->write_words([&](size_t s) { return a->summary[s]; },
+                   [&](size_t i) { return a->words[i] & (~b->words[i]); }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_aa(ArrayContainer<WordType, DataBits>* a,
                                                const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    if (a->size == 0 || b->size == 0) {
-        result_type = CTy::Array;
-        return a;
-    }
-
     size_t i = 0, j = 0;
     // Linear scan
-    auto new_card = 0;
+    size_t new_card = 0, runs = 0;
+    auto append = [&](typename ArrayContainer<WordType, DataBits>::IndexOrNumType val) {
+        runs += is_run_start(a->vals, new_card, val);
+        a->vals[new_card++] = val;
+    };
     // We can modify while scanning since the position being scanned moves forward faster or equal to the position being
     // overwrtitten
-    result_type = CTy::Array;
-    while (true) {
-        while (a->vals[i] < b->vals[j]) {
-        SKIP_FIRST_COMPARE:
-            a->vals[new_card++] = a->vals[i];
-            ++i;
-            if (i == a->size) {
-                a->size = new_card;
-                return a;
-            }
-        }
-        while (a->vals[i] > b->vals[j]) {
+    while (i < a->size && j < b->size) {
+        if (a->vals[i] < b->vals[j]) {
+            append(a->vals[i++]);
+        } else if (a->vals[i] > b->vals[j]) {
             ++j;
-            if (j == b->size) {
-                a->size = new_card;
-                return a;
-            }
-        }
-        if (a->vals[i] == b->vals[j]) {
+        } else {
             ++i;
             ++j;
-            if (i == a->size || j == b->size) {
-                a->size = new_card;
-                return a;
-            }
-        } else {
-            goto SKIP_FIRST_COMPARE;
         }
     }
-    FROARING_UNREACHABLE
+    while (i < a->size) {
+        append(a->vals[i++]);
+    }
+    a->size = new_card;
+    return finalize_inplace<WordType, DataBits>(a, CTy::Array, new_card, runs, result_type);
 }
 
 /// NOT in-place internally
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_rr(RLEContainer<WordType, DataBits>* a,
                                                const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     return froaring_diff_rr(a, b, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_ar(ArrayContainer<WordType, DataBits>* a,
                                                const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Array;
-
-    if (a->size == 0 || b->size == 0) {
-        return a;
-    }
-
-    if (b->run_count == 0) {
-        return a;
-    }
-
     size_t rlepos = 0;
-    size_t arraypos = 0;
-    size_t newcard = 0;
-    auto rle = b->runs[rlepos];
-
+    size_t newcard = 0, runs = 0;
     // We can overwrite the values since arraypos >= newcard
-    while (true) {
-        while (rle.end < a->vals[arraypos]) {
-        SKIP_FIRST_COMPARE:
+    for (size_t arraypos = 0; arraypos < a->size; ++arraypos) {
+        auto val = a->vals[arraypos];
+        // TODO: use Gallop search
+        while (rlepos < b->run_count && b->runs[rlepos].end < val) {
             ++rlepos;
-            if (rlepos == b->run_count) {  // done
-                while (arraypos < a->size) {
-                    a->vals[newcard++] = a->vals[arraypos];
-                    ++arraypos;
-                }
-                a->size = newcard;
-                return a;
-            }
-            rle = b->runs[rlepos];
-        }
-        while (rle.start > a->vals[arraypos]) {
-            a->vals[newcard++] = a->vals[arraypos];
-            ++arraypos;
-            if (arraypos == a->size) {
-                a->size = newcard;
-                return a;
-            }
         }
-        while (rle.start <= a->vals[arraypos] && a->vals[arraypos] <= rle.end) {
-            // TODO: use Gallop search
-            ++arraypos;
-            if (arraypos == a->size) {
-                a->size = newcard;
-                return a;
-            }
-            goto SKIP_FIRST_COMPARE;
+        if (rlepos < b->run_count && b->runs[rlepos].start <= val) {
+            continue;
         }
+        runs += is_run_start(a->vals, newcard, val);
+        a->vals[newcard++] = val;
     }
-
-    FROARING_UNREACHABLE;
+    a->size = newcard;
+    return finalize_inplace<WordType, DataBits>(a, CTy::Array, newcard, runs, result_type);
 }
 
 /// NOT in-place internally
@@ -142,12 +92,12 @@ froaring_container_t* froaring_diff_inplace_ra(RLEContainer<WordType, DataBits>*
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_br(BitmapContainer<WordType, DataBits>* a,
                                                const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Bitmap;
-    for (size_t i = 0; i < b->run_count; i++) {
-        a->reset_range(b->runs[i].start, b->runs[i].end);
-    }
-    return a;
-    // TODO: convert into ArrayContainer if the cardinality is low?
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(b);
+    a->write_words([&](size_t s) { return a->summary[s]; },
+                   [&](size_t i) { return static_cast<WordType>(a->words[i] & ~runs.word(i)); }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 /// NOT in-place internally
@@ -160,13 +110,12 @@ froaring_container_t* froaring_diff_inplace_rb(RLEContainer<WordType, DataBits>*
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diff_inplace_ba(BitmapContainer<WordType, DataBits>* a,
                                                const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: accelerate with assembly
-    result_type = CTy::Bitmap;
-    for (size_t i = 0; i < b->size; ++i) {
-        auto val = b->vals[i];
-        a->reset(val);
-    }
-    return a;
+    BitmapStats<WordType> stats;
+    ArrayWords<WordType, DataBits> vals(b);
+    a->write_words([&](size_t s) { return a->summary[s]; },
+                   [&](size_t i) { return static_cast<WordType>(a->words[i] & ~vals.word(i)); }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 /// NOT in-place internally
@@ -179,9 +128,24 @@ froaring_container_t* froaring_diff_inplace_ab(ArrayContainer<WordType, DataBits
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_diffi(froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                      CTy& result_type) {
+    FROARING_KERNEL_SCOPE(DiffInplace, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (ta == CTy::Full || tb == CTy::Full) {  // a new container: `a` has no payload to operate in place
+        return froaring_diff<WordType, DataBits>(a, b, ta, tb, result_type);
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_diffi<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        if (result != ua) {  // `ua` was not operated in place
+            release_unpacked<WordType, DataBits>(ua, a);
+        }
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_diff_inplace_bb(static_cast<BitmapSized*>(a), static_cast<const BitmapSized*>(b),
@@ -5,6 +5,10 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "cold_container.h"
+#include "instrument.h"
+#include "optimize.h"
+#include "packed_array_container.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -21,7 +25,7 @@ bool froaring_equal_bb(const BitmapContainer<WordType, DataBits>* a, const Bitma
 template <typename WordType, size_t DataBits>
 bool froaring_equal_aa(const ArrayContainer<WordType, DataBits>* a, const ArrayContainer<WordType, DataBits>* b) {
     if (a->size != b->size) return false;
-    for (auto i = 0; i < a->size; ++i) {
+    for (size_t i = 0; i < a->size; ++i) {
         if (a->vals[i] != b->vals[i]) return false;
     }
     return true;
@@ -29,14 +33,14 @@ bool froaring_equal_aa(const ArrayContainer<WordType, DataBits>* a, const ArrayC
 template <typename WordType, size_t DataBits>
 bool froaring_equal_rr(const RLEContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
     if (a->run_count != b->run_count) return false;
-    for (auto i = 0; i < a->run_count; ++i) {
+    for (size_t i = 0; i < a->run_count; ++i) {
         if (a->runs[i].start != b->runs[i].start || a->runs[i].end != b->runs[i].end) return false;
     }
     return true;
 }
 template <typename WordType, size_t DataBits>
 bool froaring_equal_ar(const ArrayContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
-    if (a->size > b->run_count) return false;
+    if (a->size < b->run_count) return false;
     if (a->cardinality() != b->cardinality()) return false;
     size_t pos = 0;
     for (size_t i = 0; i < b->run_count; ++i) {
@@ -75,7 +79,7 @@ bool froaring_equal_ba(const BitmapContainer<WordType, DataBits>* a, const Array
                 return false;
             }
             WordType t = w & (~w + 1);
-            WordType r = i * sizeof(WordType) + std::countr_zero(w);
+            WordType r = i * BitmapContainer<WordType, DataBits>::BitsPerWord + std::countr_zero(w);
             if (b->vals[pos] != r) {
                 return false;
             }
@@ -88,6 +92,27 @@ bool froaring_equal_ba(const BitmapContainer<WordType, DataBits>* a, const Array
 
 template <typename WordType, size_t DataBits>
 bool froaring_equal(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb) {
+    FROARING_KERNEL_SCOPE(Equal, ta, tb);
+    if (ta == CTy::Full || tb == CTy::Full) {  // Full is the only container holding every value
+        return container_cardinality<WordType, DataBits>(a, ta) == container_cardinality<WordType, DataBits>(b, tb);
+    }
+    if (ta == CTy::PackedArray && tb == CTy::PackedArray) {
+        return static_cast<const PackedArrayContainer<WordType, DataBits>*>(a)->equals(
+            *static_cast<const PackedArrayContainer<WordType, DataBits>*>(b));
+    }
+    if (ta == CTy::Cold && tb == CTy::Cold) {
+        return static_cast<const ColdContainer<WordType, DataBits>*>(a)->equals(
+            *static_cast<const ColdContainer<WordType, DataBits>*>(b));
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        const bool result = froaring_equal<WordType, DataBits>(ua, ub, ua_type, ub_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_equal_bb(static_cast<const BitmapContainer<WordType, DataBits>*>(a),
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "prelude.h"
+
+/// Opt-in instrumentation of the hot paths, enabled by defining FROARING_INSTRUMENT to 1 before including any
+/// froaring header. When disabled (the default), every hook below expands to nothing.
+///
+/// Counters are kept per thread, so that the hooks never contend, and are summed over all threads (including the
+/// exited ones) by `instrument::snapshot()`.
+#if FROARING_INSTRUMENT
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace froaring::instrument {
+
+enum class Event : uint8_t {
+    ArrayToBitmap,
+    ArrayToRle,
+    BitmapToArray,
+    BitmapToRle,
+    RleToArray,
+    RleToBitmap,
+    ArrayToPacked,  // an array container bit-packed into a PackedArrayContainer
+    PackedToArray,  // a PackedArrayContainer unpacked, for a mutation or a set operation
+    ArrayToCold,    // an array container compressed into a ColdContainer by `compact_cold()`
+    ColdToArray,    // a ColdContainer decompressed, for a mutation or a set operation
+    Alloc,          // heap buffer allocated by a container or an index
+    Realloc,        // heap buffer resized by `expand_to`
+    Memmove,        // elements shifted by an insertion into an array container or an index
+    MemmoveBytes,   // bytes shifted by the above
+    Count
+};
+
+/// The container-pair kernel dispatchers (`froaring_and`, `froaring_ori`, ...).
+enum class Kernel : uint8_t { And, Or, Diff, AndInplace, OrInplace, DiffInplace, Intersects, Contains, Equal, Count };
+
+constexpr size_t EventCount = static_cast<size_t>(Event::Count);
+constexpr size_t KernelCount = static_cast<size_t>(Kernel::Count);
+constexpr size_t PairCount = 49;  // CTYPE_PAIR(t1, t2) over 7 container types
+
+inline const char* event_name(Event e) {
+    constexpr const char* names[EventCount] = {
+        "array_to_bitmap", "array_to_rle",    "bitmap_to_array", "bitmap_to_rle", "rle_to_array",
+        "rle_to_bitmap",   "array_to_packed", "packed_to_array", "array_to_cold", "cold_to_array",
+        "alloc",           "realloc",         "memmove",         "memmove_bytes"};
+    return names[static_cast<size_t>(e)];
+}
+
+inline const char* kernel_name(Kernel k) {
+    constexpr const char* names[KernelCount] = {"and",          "or",         "diff",     "and_inplace", "or_inplace",
+                                                "diff_inplace", "intersects", "contains", "equal"};
+    return names[static_cast<size_t>(k)];
+}
+
+/// Name of a CTYPE_PAIR value, e.g. "array_bitmap".
+inline const char* pair_name(size_t pair) {
+    constexpr const char* names[PairCount] = {
+        "array_array",  "array_bitmap",  "array_rle",  "array_index",  "array_full",  "array_packed",  "array_cold",
+        "bitmap_array", "bitmap_bitmap", "bitmap_rle", "bitmap_index", "bitmap_full", "bitmap_packed", "bitmap_cold",
+        "rle_array",    "rle_bitmap",    "rle_rle",    "rle_index",    "rle_full",    "rle_packed",    "rle_cold",
+        "index_array",  "index_bitmap",  "index_rle",  "index_index",  "index_full",  "index_packed",  "index_cold",
+        "full_array",   "full_bitmap",   "full_rle",   "full_index",   "full_full",   "full_packed",   "full_cold",
+        "packed_array", "packed_bitmap", "packed_rle", "packed_index", "packed_full", "packed_packed", "packed_cold",
+        "cold_array",   "cold_bitmap",   "cold_rle",   "cold_index",   "cold_full",   "cold_packed",   "cold_cold"};
+    return names[pair];
+}
+
+/// Plain (aggregated) counters, as returned by `snapshot()`.
+struct Counters {
+    uint64_t events[EventCount] = {};
+    uint64_t kernel_calls[KernelCount][PairCount] = {};
+    uint64_t kernel_nanos[KernelCount][PairCount] = {};
+
+    uint64_t event(Event e) const { return events[static_cast<size_t>(e)]; }
+    uint64_t calls(Kernel k, ContainerType ta, ContainerType tb) const {
+        return kernel_calls[static_cast<size_t>(k)][CTYPE_PAIR(ta, tb)];
+    }
+    uint64_t nanos(Kernel k, ContainerType ta, ContainerType tb) const {
+        return kernel_nanos[static_cast<size_t>(k)][CTYPE_PAIR(ta, tb)];
+    }
+};
+
+namespace detail {
+/// Only the owning thread writes its counters, so a relaxed load + store (a plain add) is enough; atomics only keep
+/// the concurrent reads of `snapshot()` well-defined.
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct ThreadCounters {
+    std::atomic<uint64_t> events[EventCount] = {};
+    std::atomic<uint64_t> kernel_calls[KernelCount][PairCount] = {};
+    std::atomic<uint64_t> kernel_nanos[KernelCount][PairCount] = {};
+
+    void add_to(Counters& out) const {
+        for (size_t e = 0; e < EventCount; ++e) out.events[e] += events[e].load(std::memory_order_relaxed);
+        for (size_t k = 0; k < KernelCount; ++k) {
+            for (size_t p = 0; p < PairCount; ++p) {
+                out.kernel_calls[k][p] += kernel_calls[k][p].load(std::memory_order_relaxed);
+                out.kernel_nanos[k][p] += kernel_nanos[k][p].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void clear() {
+        for (auto& e : events) e.store(0, std::memory_order_relaxed);
+        for (size_t k = 0; k < KernelCount; ++k) {
+            for (size_t p = 0; p < PairCount; ++p) {
+                kernel_calls[k][p].store(0, std::memory_order_relaxed);
+                kernel_nanos[k][p].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/// Live thread counters, plus the totals of the threads that already exited.
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> live;
+    Counters retired;
+};
+
+inline Registry& registry() {
+    static Registry* r = new Registry;  // never destroyed: threads may exit after static destruction started
+    return *r;
+}
+
+struct ThreadSlot {
+    ThreadCounters counters;
+    ThreadSlot() {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().live.push_back(&counters);
+    }
+    ~ThreadSlot() {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        auto& live = registry().live;
+        for (size_t i = 0; i < live.size(); ++i) {
+            if (live[i] == &counters) {
+                live[i] = live.back();
+                live.pop_back();
+                break;
+            }
+        }
+        counters.add_to(registry().retired);
+    }
+};
+
+inline ThreadCounters& local() {
+    thread_local ThreadSlot slot;
+    return slot.counters;
+}
+}  // namespace detail
+
+inline void count(Event e, uint64_t n = 1) { detail::bump(detail::local().events[static_cast<size_t>(e)], n); }
+
+/// @brief Counts one kernel invocation and the time spent in it, until the end of the enclosing scope.
+class KernelScope {
+public:
+    KernelScope(Kernel k, ContainerType ta, ContainerType tb)
+        : kernel(static_cast<size_t>(k)), pair(CTYPE_PAIR(ta, tb)), start(std::chrono::steady_clock::now()) {}
+    ~KernelScope() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto& counters = detail::local();
+        detail::bump(counters.kernel_calls[kernel][pair], 1);
+        detail::bump(counters.kernel_nanos[kernel][pair],
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    KernelScope(const KernelScope&) = delete;
+    KernelScope& operator=(const KernelScope&) = delete;
+
+private:
+    size_t kernel;
+    size_t pair;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// @brief Sum of the counters of all threads, alive or exited.
+inline Counters snapshot() {
+    auto& r = detail::registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Counters total = r.retired;
+    for (auto* c : r.live) c->add_to(total);
+    return total;
+}
+
+/// @brief Zero the counters of all threads. Increments racing with the reset may survive it.
+inline void reset() {
+    auto& r = detail::registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = Counters{};
+    for (auto* c : r.live) c->clear();
+}
+
+/// @brief Print the non-zero counters of `c`, one per line.
+inline void dump(std::ostream& os, const Counters& c = snapshot()) {
+    for (size_t e = 0; e < EventCount; ++e) {
+        if (c.events[e]) os << event_name(static_cast<Event>(e)) << " " << c.events[e] << "\n";
+    }
+    for (size_t k = 0; k < KernelCount; ++k) {
+        for (size_t p = 0; p < PairCount; ++p) {
+            if (!c.kernel_calls[k][p]) continue;
+            os << kernel_name(static_cast<Kernel>(k)) << "/" << pair_name(p) << " calls=" << c.kernel_calls[k][p]
+               << " ns=" << c.kernel_nanos[k][p] << "\n";
+        }
+    }
+}
+
+}  // namespace froaring::instrument
+
+#define FROARING_COUNT(event) froaring::instrument::count(froaring::instrument::Event::event)
+#define FROARING_COUNT_N(event, n) froaring::instrument::count(froaring::instrument::Event::event, (n))
+#define FROARING_KERNEL_SCOPE(kernel, ta, tb) \
+    froaring::instrument::KernelScope froaring_kernel_scope_(froaring::instrument::Kernel::kernel, (ta), (tb))
+
+#else
+
+#define FROARING_COUNT(event) ((void)0)
+#define FROARING_COUNT_N(event, n) ((void)0)
+#define FROARING_KERNEL_SCOPE(kernel, ta, tb) ((void)0)
+
+#endif
@@ -5,9 +5,11 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
 #include "mix_ops.h"
 #include "prelude.h"
 #include "rle_container.h"
+#include "utils.h"
 
 namespace froaring {
 using CTy = froaring::ContainerType;
@@ -15,6 +17,17 @@ using CTy = froaring::ContainerType;
 template <typename WordType, size_t DataBits>
 bool froaring_intersects_bb(const BitmapContainer<WordType, DataBits>* a,
                             const BitmapContainer<WordType, DataBits>* b) {
+    if constexpr (BitmapContainer<WordType, DataBits>::HasSummary) {  // only words non-empty in both
+        for (size_t s = 0; s < a->SummaryWords; ++s) {
+            for (WordType c = a->summary[s] & b->summary[s]; c; c &= c - 1) {
+                const size_t i = s * a->BitsPerWord + std::countr_zero(c);
+                if (a->words[i] & b->words[i]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
     for (size_t i = 0; i < a->WordsCount; ++i) {
         if (a->words[i] & b->words[i]) {
             return true;
@@ -60,74 +73,43 @@ bool froaring_intersects_aa(const ArrayContainer<WordType, DataBits>* a, const A
 
 template <typename WordType, size_t DataBits>
 bool froaring_intersects_rr(const RLEContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
-    if (a->run_count == 0 || b->run_count == 0) {
-        return false;
-    }
-
     size_t i = 0, j = 0;
-    while (true) {
-        auto& run_a = a->runs[i];
-        auto& run_b = b->runs[j];
-        while (run_a.end < run_b.start) {
-        SKIP_FIRST_COMPARE:
-            ++i;
-            if (i == a->run_count) {
-                return false;
-            }
-        }
-        while (run_b.end < run_a.start) {
-            ++j;
-            if (j == b->run_count) {
-                return false;
-            }
-        }
-        if (run_a.end >= run_b.start && run_b.end >= run_a.start) {
+    while (i < a->run_count && j < b->run_count) {
+        if (a->runs[i].start <= b->runs[j].end && b->runs[j].start <= a->runs[i].end) {
             return true;
+        }
+        if (a->runs[i].end < b->runs[j].end) {
+            ++i;
         } else {
-            goto SKIP_FIRST_COMPARE;
+            ++j;
         }
     }
-    FROARING_UNREACHABLE
+    return false;
 }
 
 template <typename WordType, size_t DataBits>
 bool froaring_intersects_ar(const ArrayContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
-    if (a->size == 0 || b->run_count == 0) {
-        return false;
-    }
-
-    size_t i = 0, j = 0;
-    while (true) {
-        auto& val_a = a->vals[i];
-        auto& run_b = b->runs[j];
-        while (val_a < run_b.start) {
-        SKIP_FIRST_COMPARE:
-            ++i;
-            if (i == a->size) {
-                return false;
-            }
-        }
-        while (run_b.end < val_a) {
+    size_t j = 0;
+    for (size_t i = 0; i < a->size; ++i) {
+        auto val = a->vals[i];
+        while (j < b->run_count && b->runs[j].end < val) {
             ++j;
-            if (j == b->run_count) {
-                return false;
-            }
         }
-        if (val_a >= run_b.start && run_b.end >= val_a) {
+        if (j == b->run_count) {
+            return false;
+        }
+        if (b->runs[j].start <= val) {
             return true;
-        } else {
-            goto SKIP_FIRST_COMPARE;
         }
     }
-    FROARING_UNREACHABLE
+    return false;
 }
 
 template <typename WordType, size_t DataBits>
 bool froaring_intersects_br(const BitmapContainer<WordType, DataBits>* a, const RLEContainer<WordType, DataBits>* b) {
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
     auto rle_count = b->run_count;
     for (size_t i = 0; i < rle_count; i++) {
-        if (result->any_range(b->runs[i].start, b->runs[i].end)) {
+        if (a->any_range(b->runs[i].start, b->runs[i].end)) {
             return true;
         }
     }
@@ -148,11 +130,48 @@ bool froaring_intersects_ba(const BitmapContainer<WordType, DataBits>* a, const
     return false;
 }
 
+template <typename WordType, size_t DataBits>
+bool froaring_intersects_ca(const ColdContainer<WordType, DataBits>* a, const ArrayContainer<WordType, DataBits>* b) {
+    return !a->for_each_common(b->vals, b->size, [](auto) { return false; });
+}
+
+template <typename WordType, size_t DataBits>
+bool froaring_intersects_cc(const ColdContainer<WordType, DataBits>* a, const ColdContainer<WordType, DataBits>* b) {
+    return !a->for_each_common(*b, [](auto) { return false; });
+}
+
 template <typename WordType, size_t DataBits>
 bool froaring_intersects(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb) {
+    FROARING_KERNEL_SCOPE(Intersects, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (ta == CTy::Full || tb == CTy::Full) {  // Full meets any value of the other side
+        return !container_empty<WordType, DataBits>(a, ta) && !container_empty<WordType, DataBits>(b, tb);
+    }
+    using ColdSized = ColdContainer<WordType, DataBits>;
+    if (ta == CTy::Cold && tb == CTy::Cold) {
+        return froaring_intersects_cc(static_cast<const ColdSized*>(a), static_cast<const ColdSized*>(b));
+    }
+    if ((ta == CTy::Cold && (tb == CTy::Array || tb == CTy::PackedArray)) ||
+        (tb == CTy::Cold && (ta == CTy::Array || ta == CTy::PackedArray))) {  // skip the blocks no value hits
+        const auto* cold = static_cast<const ColdSized*>(ta == CTy::Cold ? a : b);
+        const froaring_container_t* other = ta == CTy::Cold ? b : a;
+        CTy array_type = ta == CTy::Cold ? tb : ta;
+        auto array = unpacked<WordType, DataBits>(other, array_type);
+        const bool result = froaring_intersects_ca(cold, static_cast<const ArraySized*>(array));
+        release_unpacked<WordType, DataBits>(array, other);
+        return result;
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        const bool result = froaring_intersects<WordType, DataBits>(ua, ub, ua_type, ub_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_intersects_bb(static_cast<const BitmapSized*>(a), static_cast<const BitmapSized*>(b));
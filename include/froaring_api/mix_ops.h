@@ -1,25 +1,31 @@
 #pragma once
 
+#include <algorithm>
+
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "cold_container.h"
 #include "handle.h"
+#include "instrument.h"
+#include "packed_array_container.h"
 #include "prelude.h"
 #include "rle_container.h"
 
 namespace froaring {
+/// @brief An array container holding the set bits of `words`, which has `cardinality` of them.
 template <typename WordType, size_t DataBits>
-inline ArrayContainer<WordType, DataBits>* bitmap_to_array(const BitmapContainer<WordType, DataBits>* c) {
+inline ArrayContainer<WordType, DataBits>* words_to_array(const WordType* words, size_t cardinality) {
     // TODO: accelerate with SSE, AVX2 or AVX512
-    auto cardinality = c->cardinality();
+    using IndexOrNumType = typename ArrayContainer<WordType, DataBits>::IndexOrNumType;
     auto ans = new ArrayContainer<WordType, DataBits>(cardinality, cardinality);
     size_t outpos = 0;
-    typename ArrayContainer<WordType, DataBits>::IndexOrNumType base = 0;
-    for (size_t i = 0; i < c->WordsCount; ++i) {
-        WordType w = c->words[i];
+    IndexOrNumType base = 0;
+    for (size_t i = 0; i < BitmapContainer<WordType, DataBits>::WordsCount; ++i) {
+        WordType w = words[i];
         while (w != 0) {
             WordType t = w & (~w + 1);
             auto r = std::countr_zero(w);
-            ans->vals[outpos++] = (typename ArrayContainer<WordType, DataBits>::IndexOrNumType)(r + base);
+            ans->vals[outpos++] = (IndexOrNumType)(r + base);
             w ^= t;
         }
         base += BitmapContainer<WordType, DataBits>::BitsPerWord;
@@ -28,16 +34,23 @@ inline ArrayContainer<WordType, DataBits>* bitmap_to_array(const BitmapContainer
     return ans;
 }
 
+template <typename WordType, size_t DataBits>
+inline ArrayContainer<WordType, DataBits>* bitmap_to_array(const BitmapContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(BitmapToArray);
+    return words_to_array<WordType, DataBits>(c->words, c->cardinality());
+}
+
 template <typename WordType, size_t DataBits>
 inline ArrayContainer<WordType, DataBits>* rle_to_array(const RLEContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(RleToArray);
     // TODO: accelerate with SSE, AVX2 or AVX512
     auto cardinality = c->cardinality();
     size_t outpos = 0;
     auto ans = new ArrayContainer<WordType, DataBits>(cardinality, cardinality);
     for (size_t i = 0; i < c->run_count; ++i) {
-        for (typename ArrayContainer<WordType, DataBits>::IndexOrNumType j = c->runs[i].start; j <= c->runs[i].end;
-             j++) {
-            ans->vals[outpos++] = j;
+        // `size_t` so that a run ending at the last value does not wrap around
+        for (size_t j = c->runs[i].start; j <= c->runs[i].end; j++) {
+            ans->vals[outpos++] = static_cast<typename ArrayContainer<WordType, DataBits>::IndexOrNumType>(j);
         }
     }
     return ans;
@@ -45,6 +58,7 @@ inline ArrayContainer<WordType, DataBits>* rle_to_array(const RLEContainer<WordT
 
 template <typename WordType, size_t DataBits>
 inline BitmapContainer<WordType, DataBits>* array_to_bitmap(const ArrayContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(ArrayToBitmap);
     auto ans = new BitmapContainer<WordType, DataBits>();
     auto size = c->cardinality();
     for (size_t i = 0; i < size; ++i) {
@@ -52,6 +66,290 @@ inline BitmapContainer<WordType, DataBits>* array_to_bitmap(const ArrayContainer
     }
     return ans;
 }
+template <typename WordType, size_t DataBits>
+inline BitmapContainer<WordType, DataBits>* rle_to_bitmap(const RLEContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(RleToBitmap);
+    auto ans = new BitmapContainer<WordType, DataBits>();
+    for (size_t i = 0; i < c->run_count; ++i) {
+        ans->set_range(c->runs[i].start, c->runs[i].end);
+    }
+    ans->set_cardinality(c->cardinality());
+    return ans;
+}
+
+template <typename WordType, size_t DataBits>
+inline RLEContainer<WordType, DataBits>* array_to_rle(const ArrayContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(ArrayToRle);
+    auto run_count = c->count_runs();
+    auto ans = new RLEContainer<WordType, DataBits>(run_count, run_count);
+    size_t outpos = 0;
+    for (size_t i = 0; i < c->size; ++i) {
+        if (i == 0 || c->vals[i] != c->vals[i - 1] + 1) {
+            ans->runs[outpos++] = {c->vals[i], c->vals[i]};
+        } else {
+            ans->runs[outpos - 1].end = c->vals[i];
+        }
+    }
+    assert(outpos == run_count);
+    return ans;
+}
+
+/// @brief An RLE container holding the set bits of `words`, which form `run_count` runs.
+template <typename WordType, size_t DataBits>
+inline RLEContainer<WordType, DataBits>* words_to_rle(const WordType* words, size_t run_count) {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    using IndexOrNumType = typename RLEContainer<WordType, DataBits>::IndexOrNumType;
+    auto ans = new RLEContainer<WordType, DataBits>(run_count, run_count);
+    size_t outpos = 0;
+    size_t i = 0;
+    WordType w = words[0];
+    while (true) {
+        // Find the next set bit: the start of a run
+        while (w == 0) {
+            if (++i == BitmapSized::WordsCount) {
+                assert(outpos == run_count);
+                return ans;
+            }
+            w = words[i];
+        }
+        size_t start = i * BitmapSized::BitsPerWord + std::countr_zero(w);
+        // Fill the trailing zeros below the start, then find the next unset bit: the end of the run
+        w |= w - 1;
+        while (w == static_cast<WordType>(~WordType(0))) {
+            if (++i == BitmapSized::WordsCount) {
+                ans->runs[outpos++] = {static_cast<IndexOrNumType>(start),
+                                       static_cast<IndexOrNumType>(BitmapSized::TotalBits - 1)};
+                assert(outpos == run_count);
+                return ans;
+            }
+            w = words[i];
+        }
+        size_t end = i * BitmapSized::BitsPerWord + std::countr_one(w) - 1;
+        ans->runs[outpos++] = {static_cast<IndexOrNumType>(start), static_cast<IndexOrNumType>(end)};
+        // Clear the bits of this run (the lowest ones up to `end`)
+        w &= w + 1;
+    }
+}
+
+template <typename WordType, size_t DataBits>
+inline RLEContainer<WordType, DataBits>* bitmap_to_rle(const BitmapContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(BitmapToRle);
+    return words_to_rle<WordType, DataBits>(c->words, c->count_runs());
+}
+
+/// @brief Write the values of an array container into the bitmap words `out` (overwriting them).
+template <typename WordType, size_t DataBits>
+inline void array_to_words(const ArrayContainer<WordType, DataBits>* c, WordType* out) {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    std::memset(out, 0, BitmapSized::WordsCount * sizeof(WordType));
+    for (size_t i = 0; i < c->size; ++i) {
+        out[c->vals[i] / BitmapSized::BitsPerWord] |= WordType(1) << (c->vals[i] % BitmapSized::BitsPerWord);
+    }
+}
+
+/// @brief Write the values of a packed array container into the bitmap words `out` (overwriting them).
+template <typename WordType, size_t DataBits>
+inline void packed_to_words(const PackedArrayContainer<WordType, DataBits>* c, WordType* out) {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    using Packed = PackedArrayContainer<WordType, DataBits>;
+    std::memset(out, 0, BitmapSized::WordsCount * sizeof(WordType));
+    typename Packed::IndexOrNumType block[Packed::BlockSize];
+    for (size_t first = 0; first < c->size; first += Packed::BlockSize) {
+        const size_t n = std::min(Packed::BlockSize, c->size - first);
+        if (n == Packed::BlockSize) {
+            c->unpack_block(first / Packed::BlockSize, block);
+        } else {
+            for (size_t i = 0; i < n; ++i) block[i] = c->get(first + i);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out[block[i] / BitmapSized::BitsPerWord] |= WordType(1) << (block[i] % BitmapSized::BitsPerWord);
+        }
+    }
+}
+
+/// @brief Write the values of a cold container into the bitmap words `out` (overwriting them).
+template <typename WordType, size_t DataBits>
+inline void cold_to_words(const ColdContainer<WordType, DataBits>* c, WordType* out) {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    using Cold = ColdContainer<WordType, DataBits>;
+    std::memset(out, 0, BitmapSized::WordsCount * sizeof(WordType));
+    typename Cold::IndexOrNumType block[Cold::BlockSize];
+    for (size_t b = 0; b < c->block_count; ++b) {
+        const size_t n = c->decode_block(b, block);
+        for (size_t i = 0; i < n; ++i) {
+            out[block[i] / BitmapSized::BitsPerWord] |= WordType(1) << (block[i] % BitmapSized::BitsPerWord);
+        }
+    }
+}
+
+/// @brief Write the runs of an RLE container into the bitmap words `out` (overwriting them).
+template <typename WordType, size_t DataBits>
+inline void rle_to_words(const RLEContainer<WordType, DataBits>* c, WordType* out) {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    constexpr WordType AllOnes = ~WordType(0);
+    std::memset(out, 0, BitmapSized::WordsCount * sizeof(WordType));
+    for (size_t r = 0; r < c->run_count; ++r) {
+        const size_t start = c->runs[r].start, end = c->runs[r].end;
+        const size_t first = start / BitmapSized::BitsPerWord, last = end / BitmapSized::BitsPerWord;
+        const WordType first_mask = AllOnes << (start % BitmapSized::BitsPerWord);
+        const WordType last_mask = AllOnes >> (BitmapSized::BitsPerWord - 1 - end % BitmapSized::BitsPerWord);
+        if (first == last) {
+            out[first] |= first_mask & last_mask;
+            continue;
+        }
+        out[first] |= first_mask;
+        for (size_t i = first + 1; i < last; ++i) {
+            out[i] = AllOnes;
+        }
+        out[last] |= last_mask;
+    }
+}
+
+/// @brief The words of an RLE container as a bitmap, yielded one at a time so that a kernel can combine them with
+/// the words of a bitmap in a single pass (see `BitmapContainer::write_words`). `word` and `summary` each keep a
+/// cursor into the runs, so each must be called in ascending order.
+template <typename WordType, size_t DataBits>
+class RunWords {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    static constexpr size_t BitsPerWord = BitmapSized::BitsPerWord;
+    static constexpr WordType AllOnes = BitmapSized::AllOnes;
+
+public:
+    explicit RunWords(const RLEContainer<WordType, DataBits>* c) : c(c) {}
+
+    /// @brief Word `i` of the bitmap.
+    WordType word(size_t i) { return bits_in(word_run, i * BitsPerWord, 1); }
+
+    /// @brief Summary word `s`: which of the words `s * BitsPerWord` onwards some run touches.
+    WordType summary(size_t s) { return bits_in(summary_run, s * BitsPerWord * BitsPerWord, BitsPerWord); }
+
+private:
+    /// Bit `j` is set if a run touches [lo + j * unit, lo + (j + 1) * unit).
+    WordType bits_in(size_t& run, size_t lo, size_t unit) const {
+        const size_t hi = lo + BitsPerWord * unit - 1;
+        while (run < c->run_count && size_t(c->runs[run].end) < lo) {
+            ++run;
+        }
+        if (run < c->run_count && size_t(c->runs[run].start) <= lo && size_t(c->runs[run].end) >= hi) {
+            return AllOnes;  // inside a long run
+        }
+        WordType bits = 0;
+        for (size_t r = run; r < c->run_count && size_t(c->runs[r].start) <= hi; ++r) {
+            const size_t first = (std::max<size_t>(c->runs[r].start, lo) - lo) / unit;
+            const size_t last = (std::min<size_t>(c->runs[r].end, hi) - lo) / unit;
+            bits |= static_cast<WordType>(AllOnes << first) & static_cast<WordType>(AllOnes >> (BitsPerWord - 1 - last));
+        }
+        return bits;
+    }
+
+    const RLEContainer<WordType, DataBits>* c;
+    size_t word_run = 0;
+    size_t summary_run = 0;
+};
+
+/// @brief The words of an array container as a bitmap, yielded one at a time like `RunWords`.
+template <typename WordType, size_t DataBits>
+class ArrayWords {
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    static constexpr size_t BitsPerWord = BitmapSized::BitsPerWord;
+
+public:
+    explicit ArrayWords(const ArrayContainer<WordType, DataBits>* c) : c(c) {}
+
+    WordType word(size_t i) { return bits_in(word_pos, i * BitsPerWord, 1); }
+
+    WordType summary(size_t s) { return bits_in(summary_pos, s * BitsPerWord * BitsPerWord, BitsPerWord); }
+
+private:
+    /// Bit `j` is set if a value falls into [lo + j * unit, lo + (j + 1) * unit).
+    WordType bits_in(size_t& pos, size_t lo, size_t unit) const {
+        const size_t hi = lo + BitsPerWord * unit - 1;
+        while (pos < c->size && size_t(c->vals[pos]) < lo) {
+            ++pos;
+        }
+        WordType bits = 0;
+        for (; pos < c->size && size_t(c->vals[pos]) <= hi; ++pos) {
+            bits |= WordType(1) << ((size_t(c->vals[pos]) - lo) / unit);
+        }
+        return bits;
+    }
+
+    const ArrayContainer<WordType, DataBits>* c;
+    size_t word_pos = 0;
+    size_t summary_pos = 0;
+};
+
+/// @brief An RLE container holding every value, for the kernels that have no Full variant.
+template <typename WordType, size_t DataBits>
+inline RLEContainer<WordType, DataBits>* full_to_rle() {
+    using IndexOrNumType = typename RLEContainer<WordType, DataBits>::IndexOrNumType;
+    auto ans = new RLEContainer<WordType, DataBits>(1, 1);
+    ans->runs[0] = {0, static_cast<IndexOrNumType>(RLEContainer<WordType, DataBits>::ContainerCapacity - 1)};
+    return ans;
+}
+
+template <typename WordType, size_t DataBits>
+inline BitmapContainer<WordType, DataBits>* full_to_bitmap() {
+    auto ans = new BitmapContainer<WordType, DataBits>();
+    std::memset(ans->words, 0xff, sizeof(ans->words));
+    ans->rebuild_summary();
+    ans->set_cardinality(BitmapContainer<WordType, DataBits>::TotalBits);
+    return ans;
+}
+
+template <typename WordType, size_t DataBits>
+inline PackedArrayContainer<WordType, DataBits>* array_to_packed(const ArrayContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(ArrayToPacked);
+    return new PackedArrayContainer<WordType, DataBits>(c);
+}
+
+template <typename WordType, size_t DataBits>
+inline ArrayContainer<WordType, DataBits>* packed_to_array(const PackedArrayContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(PackedToArray);
+    return c->to_array();
+}
+
+template <typename WordType, size_t DataBits>
+inline ColdContainer<WordType, DataBits>* array_to_cold(const ArrayContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(ArrayToCold);
+    return new ColdContainer<WordType, DataBits>(c);
+}
+
+template <typename WordType, size_t DataBits>
+inline ArrayContainer<WordType, DataBits>* cold_to_array(const ColdContainer<WordType, DataBits>* c) {
+    FROARING_COUNT(ColdToArray);
+    return c->to_array();
+}
+
+/// @brief Whether a container is a read-only encoding of an array (PackedArray or Cold), which kernels and
+/// mutations work on as an unpacked `ArrayContainer`.
+inline bool is_encoded_array(ContainerType type) {
+    return type == ContainerType::PackedArray || type == ContainerType::Cold;
+}
+
+/// @brief `c` itself, or an unpacked copy of it if it is an encoded array (and `type` becomes Array), for the
+/// kernels that have no variant for it. Release it with `release_unpacked`.
+template <typename WordType, size_t DataBits, typename Container>
+inline Container* unpacked(Container* c, ContainerType& type) {
+    switch (type) {
+        case ContainerType::PackedArray:
+            type = ContainerType::Array;
+            return packed_to_array(static_cast<const PackedArrayContainer<WordType, DataBits>*>(c));
+        case ContainerType::Cold:
+            type = ContainerType::Array;
+            return cold_to_array(static_cast<const ColdContainer<WordType, DataBits>*>(c));
+        default:
+            return c;
+    }
+}
+
+template <typename WordType, size_t DataBits>
+inline void release_unpacked(const froaring_container_t* c, const froaring_container_t* original) {
+    if (c != original) {
+        delete static_cast<const ArrayContainer<WordType, DataBits>*>(c);
+    }
+}
+
 template <typename WordType, size_t DataBits>
 inline void bitmap_set_array(BitmapContainer<WordType, DataBits>* b, const ArrayContainer<WordType, DataBits>* a) {
     auto size = a->cardinality();
@@ -62,12 +360,19 @@ inline void bitmap_set_array(BitmapContainer<WordType, DataBits>* b, const Array
 template <typename WordType, size_t DataBits>
 inline froaring_container_t* duplicate_container(const froaring_container_t* c, ContainerType ctype) {
     switch (ctype) {
+        case ContainerType::Full:
+            return full_container();
         case ContainerType::Array:
             return new ArrayContainer<WordType, DataBits>(*static_cast<const ArrayContainer<WordType, DataBits>*>(c));
         case ContainerType::Bitmap:
             return new BitmapContainer<WordType, DataBits>(*static_cast<const BitmapContainer<WordType, DataBits>*>(c));
         case ContainerType::RLE:
             return new RLEContainer<WordType, DataBits>(*static_cast<const RLEContainer<WordType, DataBits>*>(c));
+        case ContainerType::PackedArray:
+            return new PackedArrayContainer<WordType, DataBits>(
+                *static_cast<const PackedArrayContainer<WordType, DataBits>*>(c));
+        case ContainerType::Cold:
+            return new ColdContainer<WordType, DataBits>(*static_cast<const ColdContainer<WordType, DataBits>*>(c));
         default:
             FROARING_UNREACHABLE
     }
@@ -75,7 +380,7 @@ inline froaring_container_t* duplicate_container(const froaring_container_t* c,
 
 template <typename WordType, typename IndexType, size_t DataBits>
 inline ContainerHandle<IndexType> duplicate_container(const ContainerHandle<IndexType>& c) {
-    froaring_container_t* ptr;
+    froaring_container_t* ptr = nullptr;
     if (c.ptr == nullptr) {
         return ContainerHandle<IndexType>(nullptr, c.type, c.index);
     }
@@ -91,9 +396,74 @@ inline ContainerHandle<IndexType> duplicate_container(const ContainerHandle<Inde
         case ContainerType::RLE:
             ptr = new RLEContainer<WordType, DataBits>(*static_cast<const RLEContainer<WordType, DataBits>*>(c.ptr));
             break;
+        case ContainerType::Full:
+            ptr = full_container();
+            break;
+        case ContainerType::PackedArray:
+            ptr = new PackedArrayContainer<WordType, DataBits>(
+                *static_cast<const PackedArrayContainer<WordType, DataBits>*>(c.ptr));
+            break;
+        case ContainerType::Cold:
+            ptr = new ColdContainer<WordType, DataBits>(*static_cast<const ColdContainer<WordType, DataBits>*>(c.ptr));
+            break;
         default:
             FROARING_UNREACHABLE
     }
     return ContainerHandle<IndexType>(ptr, c.type, c.index);
 }
+
+/// @brief Add an owner to `c` instead of copying it (copy-on-write): every owner releases it with
+/// `release_container`, and must call `unshare_container` before mutating it.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* share_container(froaring_container_t* c, ContainerType ctype) {
+    if (ctype == ContainerType::Full) {  // immutable, and owned by nobody
+        return c;
+    }
+    if (ctype == ContainerType::Bitmap) {
+        // Fill the cardinality cache now: a shared bitmap is never mutated, so no owner writes the cache again
+        static_cast<const BitmapContainer<WordType, DataBits>*>(c)->cardinality();
+    }
+    c->extra_owners.fetch_add(1, std::memory_order_relaxed);
+    return c;
+}
+
+/// @brief Prepare `c` for an in-place mutation: a shared container is replaced by a private copy, dropping the
+/// caller's ownership of the original.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* unshare_container(froaring_container_t* c, ContainerType ctype) {
+    if (ctype == ContainerType::Full || !container_shared(c)) {
+        return c;
+    }
+    auto copy = duplicate_container<WordType, DataBits>(c, ctype);
+    release_container<WordType, DataBits>(c, ctype);
+    return copy;
+}
+
+template <typename WordType, typename IndexType, size_t DataBits>
+inline void unshare_container(ContainerHandle<IndexType>& c) {
+    c.ptr = unshare_container<WordType, DataBits>(c.ptr, c.type);
+}
+
+/// @brief Whether an encoded array (see `is_encoded_array`) holds `value`.
+template <typename WordType, size_t DataBits>
+inline bool encoded_array_test(const froaring_container_t* c, ContainerType type, can_fit_t<DataBits> value) {
+    if (type == ContainerType::Cold) {
+        return static_cast<const ColdContainer<WordType, DataBits>*>(c)->test(value);
+    }
+    return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->test(value);
+}
+
+/// @brief Replace an encoded array (see `is_encoded_array`), which is read-only, by a private Array holding the same
+/// values before a mutation.
+template <typename WordType, typename IndexType, size_t DataBits>
+inline void unpack_container(ContainerHandle<IndexType>& c) {
+    if (!is_encoded_array(c.type)) {
+        return;
+    }
+    ContainerType type = c.type;
+    auto array = unpacked<WordType, DataBits>(c.ptr, type);
+    release_container<WordType, DataBits>(c.ptr, c.type);
+    c.ptr = array;
+    c.type = type;
+}
 };  // namespace froaring
\ No newline at end of file
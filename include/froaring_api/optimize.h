@@ -0,0 +1,149 @@
+#pragma once
+
+#include "array_container.h"
+#include "bitmap_container.h"
+#include "cold_container.h"
+#include "mix_ops.h"
+#include "policy.h"
+#include "prelude.h"
+#include "rle_container.h"
+
+namespace froaring {
+using CTy = froaring::ContainerType;
+
+template <typename WordType, size_t DataBits>
+inline size_t container_cardinality(const froaring_container_t* c, CTy type) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->cardinality();
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->cardinality();
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->cardinality();
+        case CTy::Full:
+            return BitmapContainer<WordType, DataBits>::TotalBits;
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->cardinality();
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->cardinality();
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+template <typename WordType, size_t DataBits>
+inline size_t container_run_count(const froaring_container_t* c, CTy type) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->count_runs();
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->count_runs();
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->run_count;
+        case CTy::Full:
+            return 1;
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->count_runs();
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->count_runs();
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief Convert a container into the type with the smallest payload for its exact cardinality and run count (see
+/// `choose_container_type`). The new container (if any) is exactly sized. The old one should be released by the caller
+/// if a new one is returned. Cold containers are returned as they are.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* optimize_container(froaring_container_t* c, CTy type, CTy& result_type) {
+    if (type == CTy::Cold) {  // only `compact_cold()` produces it, and only a mutation undoes it
+        result_type = type;
+        return c;
+    }
+    return finalize_inplace<WordType, DataBits>(c, type, container_cardinality<WordType, DataBits>(c, type),
+                                                container_run_count<WordType, DataBits>(c, type), result_type);
+}
+
+/// @brief A copy of a container, in its smallest type (see `optimize_container`).
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* optimized_copy(const froaring_container_t* c, CTy type, CTy& result_type) {
+    result_type = choose_container_type<WordType, DataBits>(container_cardinality<WordType, DataBits>(c, type),
+                                                            container_run_count<WordType, DataBits>(c, type));
+    if (result_type == type) {
+        return duplicate_container<WordType, DataBits>(c, type);
+    }
+    return convert_container<WordType, DataBits>(c, type, result_type);
+}
+
+/// @brief Bytes allocated for a container: the object itself plus its heap buffer, including unused capacity.
+template <typename WordType, size_t DataBits>
+inline size_t container_memory_usage(const froaring_container_t* c, CTy type) {
+    switch (type) {
+        case CTy::Array: {
+            auto array = static_cast<const ArrayContainer<WordType, DataBits>*>(c);
+            return sizeof(*array) + array_size_in_bytes<WordType, DataBits>(array->capacity);
+        }
+        case CTy::RLE: {
+            auto rle = static_cast<const RLEContainer<WordType, DataBits>*>(c);
+            return sizeof(*rle) + rle_size_in_bytes<WordType, DataBits>(rle->capacity);
+        }
+        case CTy::Bitmap:  // words are stored inline
+            return sizeof(BitmapContainer<WordType, DataBits>);
+        case CTy::Full:  // no payload
+            return 0;
+        case CTy::PackedArray: {  // exactly sized
+            auto packed = static_cast<const PackedArrayContainer<WordType, DataBits>*>(c);
+            return sizeof(*packed) + packed_size_in_bytes<WordType, DataBits>(packed->size);
+        }
+        case CTy::Cold: {  // exactly sized
+            auto cold = static_cast<const ColdContainer<WordType, DataBits>*>(c);
+            return sizeof(*cold) + cold->payload_bytes();
+        }
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief Compress a container into a Cold one (see `FlexibleRoaring::compact_cold`) if that takes fewer bytes. The
+/// old one should be released by the caller if a new one is returned.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* compact_container(froaring_container_t* c, CTy type, CTy& result_type) {
+    result_type = type;
+    if (type == CTy::Full || type == CTy::Cold || container_empty<WordType, DataBits>(c, type)) {
+        return c;
+    }
+    auto cold = convert_container<WordType, DataBits>(c, type, CTy::Cold);
+    const size_t bytes = container_memory_usage<WordType, DataBits>(c, type);
+    if (container_memory_usage<WordType, DataBits>(cold, CTy::Cold) >= bytes) {
+        release_container<WordType, DataBits>(cold, CTy::Cold);
+        return c;
+    }
+    result_type = CTy::Cold;
+    return cold;
+}
+
+/// @brief Release unused capacity of a container.
+/// @return Bytes saved.
+template <typename WordType, size_t DataBits>
+inline size_t shrink_container(froaring_container_t* c, CTy type) {
+    if (type == CTy::Full || container_shared(c)) {  // would need a private copy, which saves nothing
+        return 0;
+    }
+    switch (type) {
+        case CTy::Array:
+            return static_cast<ArrayContainer<WordType, DataBits>*>(c)->shrink_to_fit();
+        case CTy::RLE:
+            return static_cast<RLEContainer<WordType, DataBits>*>(c)->shrink_to_fit();
+        case CTy::Bitmap:  // fixed size
+        case CTy::PackedArray:  // exactly sized
+        case CTy::Cold:
+            return 0;
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+}  // namespace froaring
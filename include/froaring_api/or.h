@@ -1,11 +1,12 @@
 #pragma once
 
 #include <bit>
-#include <stop_token>
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
 #include "mix_ops.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -16,199 +17,145 @@ template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_bb(const BitmapContainer<WordType, DataBits>* a,
                                      const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
     auto* result = new BitmapContainer<WordType, DataBits>();
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        result->words[i] = a->words[i] | b->words[i];
-    }
-    result_type = CTy::Bitmap;
-    return result;
+    BitmapStats<WordType> stats;
+    result->write_words([&](size_t s) { return a->summary[s] | b->summary[s]; },
+                        [&](size_t i) { return a->words[i] | b->words[i]; }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_aa(const ArrayContainer<WordType, DataBits>* a,
                                      const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    // If one of them is empty: just return the copy of the other one
-    if (a->size == 0) {
-        result_type = CTy::Array;
-        return new ArrayContainer<WordType, DataBits>(*b);
-    }
-    if (b->size == 0) {
-        result_type = CTy::Array;
-        return new ArrayContainer<WordType, DataBits>(*a);
-    }
     size_t max_new_card = a->size + b->size;
-    if (a->size > b->size) {  // consider the small array first to make it faster
-        std::swap(a, b);
-    }
 
-    // If both are small, we'll definitely get a new ArrayContainer
-    if (max_new_card <= ArrayContainer<WordType, DataBits>::ArrayToBitmapCountThreshold) {
+    // If both are small, the result can never outgrow an array
+    if (max_new_card <= ContainerPolicy<WordType, DataBits>::ArrayMaxCardinality) {
         auto* result =
             new ArrayContainer<WordType, DataBits>(max_new_card);  // the union of sets never have no more elements
 
         size_t i = 0, j = 0;
-        size_t new_card = 0;
+        size_t new_card = 0, runs = 0;
+        auto append = [&](typename ArrayContainer<WordType, DataBits>::IndexOrNumType val) {
+            runs += is_run_start(result->vals, new_card, val);
+            result->vals[new_card++] = val;
+        };
 
         // Linear scan
-        result_type = CTy::Array;
-        while (true) {
-            while (a->vals[i] < b->vals[j]) {
-            SKIP_FIRST_COMPARE:
-                result->vals[new_card++] = a->vals[i];
-                ++i;
-                if (i == a->size) {
-                    while (j < b->size) {
-                        result->vals[new_card++] = b->vals[j];
-                        j++;
-                    }
-                    result->size = new_card;
-                    return result;
-                }
-            }
-            while (a->vals[i] > b->vals[j]) {
-                result->vals[new_card++] = b->vals[j];
-                ++j;
-                if (j == b->size) {
-                    while (i < a->size) {
-                        result->vals[new_card++] = a->vals[i];
-                        i++;
-                    }
-                    result->size = new_card;
-                    return result;
-                }
-            }
-            if (a->vals[i] == b->vals[j]) {
-                result->vals[new_card++] = a->vals[i];
+        while (i < a->size && j < b->size) {
+            if (a->vals[i] < b->vals[j]) {
+                append(a->vals[i++]);
+            } else if (a->vals[i] > b->vals[j]) {
+                append(b->vals[j++]);
+            } else {
+                append(a->vals[i]);
                 ++i;
                 ++j;
-                if (i == a->size) {
-                    while (j < b->size) {
-                        result->vals[new_card++] = b->vals[j];
-                        j++;
-                    }
-                    result->size = new_card;
-                    return result;
-                }
-                if (j == b->size) {
-                    while (i < a->size) {
-                        result->vals[new_card++] = a->vals[i];
-                        i++;
-                    }
-                    result->size = new_card;
-                    return result;
-                }
-            } else {
-                goto SKIP_FIRST_COMPARE;
             }
         }
-        FROARING_UNREACHABLE
+        while (i < a->size) append(a->vals[i++]);
+        while (j < b->size) append(b->vals[j++]);
+        result->size = new_card;
+        return finalize_container<WordType, DataBits>(result, CTy::Array, new_card, runs, result_type);
     }
 
     // Otherwise, the result may be dense, so we use a BitmapContainer
-    result_type = CTy::Bitmap;
-    auto* result = array_to_bitmap(a);
-    bitmap_set_array(result, b);
-    auto new_bitmap_card = b->cardinality();
-    if (new_bitmap_card < ArrayContainer<WordType, DataBits>::ArrayToBitmapCountThreshold) {  //
-        result_type = CTy::Array;
-        return bitmap_to_array(result);
-    }
-    return result;
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    ArrayWords<WordType, DataBits> a_words(a), b_words(b);
+    result->write_words([&](size_t s) { return a_words.summary(s) | b_words.summary(s); },
+                        [&](size_t i) { return a_words.word(i) | b_words.word(i); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_rr(const RLEContainer<WordType, DataBits>* a,
                                      const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::RLE;
-    if (a->run_count == 0) {
-        return new RLEContainer<WordType, DataBits>(*b);
-    }
-    if (b->run_count == 0) {
-        return new RLEContainer<WordType, DataBits>(*a);
-    }
-
     auto* result = new RLEContainer<WordType, DataBits>(a->run_count + b->run_count);
     size_t i = 0, j = 0;
     size_t new_card = 0;
-    // FIXME: Uncombined runs! e.g., [1,2] + [3,4] => [1,4], however this method will NOT perform this.
-    // This MUST be fixed since we must make sure no equivalent representations exist.
-    while (true) {
-        auto& run_a = a->runs[i];
-        auto& run_b = b->runs[j];
-        while (run_a.end < run_b.start) {
-        SKIP_FIRST_COMPARE:
-            result->runs[new_card++] = {run_a.start, run_a.end};
-            ++i;
-            if (i == a->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
-        }
-        while (run_b.end < run_a.start) {
-            result->runs[new_card++] = {run_b.start, run_b.end};
-            ++j;
-            if (j == b->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
+    // Runs are merged by their starts. Overlapping or adjacent runs are combined (e.g., [1,2] + [3,4] => [1,4]), so
+    // that no equivalent representations exist.
+    auto append = [&](const typename RLEContainer<WordType, DataBits>::RunPair& run) {
+        if (new_card > 0 && size_t(run.start) <= size_t(result->runs[new_card - 1].end) + 1) {
+            result->runs[new_card - 1].end = std::max(result->runs[new_card - 1].end, run.end);
+        } else {
+            result->runs[new_card++] = run;
         }
-        if (run_a.end >= run_b.start && run_b.end >= run_a.start) {
-            result->runs[new_card++] = {std::max(run_a.start, run_b.start), std::min(run_a.end, run_b.end)};
-            if (run_a.end < run_b.end) {
-                ++i;
-            } else {
-                ++j;
-            }
-            if (i == a->run_count || j == b->run_count) {
-                result->run_count = new_card;
-                return result;
-            }
+    };
+    while (i < a->run_count && j < b->run_count) {
+        if (a->runs[i].start <= b->runs[j].start) {
+            append(a->runs[i++]);
         } else {
-            goto SKIP_FIRST_COMPARE;
+            append(b->runs[j++]);
         }
     }
-    FROARING_UNREACHABLE
+    while (i < a->run_count) append(a->runs[i++]);
+    while (j < b->run_count) append(b->runs[j++]);
+    result->run_count = new_card;
+    return finalize_container(result, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_ar(const ArrayContainer<WordType, DataBits>* a,
                                      const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::RLE;
-
     auto* result = new RLEContainer<WordType, DataBits>(*b);
     auto array_size = a->size;
     for (size_t i = 0; i < array_size; i++) {
         result->set(a->vals[i]);  // FIXME: Do not use set() but manually set on run!
     }
-    return result;
+    return finalize_container(result, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_br(const BitmapContainer<WordType, DataBits>* a,
                                      const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Bitmap;
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
-    auto rle_count = b->run_count;
-    for (size_t i = 0; i < rle_count; i++) {
-        result->set_range(b->runs[i].start, b->runs[i].end);
-    }
-    return result;
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(b);
+    result->write_words([&](size_t s) { return a->summary[s] | runs.summary(s); },
+                        [&](size_t i) { return a->words[i] | runs.word(i); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_ba(const BitmapContainer<WordType, DataBits>* a,
                                      const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    result_type = CTy::Bitmap;
-    auto* result = new BitmapContainer<WordType, DataBits>(*a);
-    bitmap_set_array(result, b);
-    return result;
+    auto* result = new BitmapContainer<WordType, DataBits>();
+    BitmapStats<WordType> stats;
+    ArrayWords<WordType, DataBits> vals(b);
+    result->write_words([&](size_t s) { return a->summary[s] | vals.summary(s); },
+                        [&](size_t i) { return a->words[i] | vals.word(i); }, stats);
+    result->set_cardinality(stats.cardinality);
+    return finalize_container<WordType, DataBits>(result, CTy::Bitmap, stats.cardinality, stats.run_count,
+                                                  result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or(const froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                   CTy& result_type) {
+    FROARING_KERNEL_SCOPE(Or, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (ta == CTy::Full || tb == CTy::Full) {
+        result_type = CTy::Full;
+        return full_container();
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_or<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        release_unpacked<WordType, DataBits>(ua, a);
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_or_bb(static_cast<const BitmapSized*>(a), static_cast<const BitmapSized*>(b), result_type);
@@ -1,13 +1,13 @@
 #pragma once
 
-// TODO: convert to full rle?
-
 #include <bit>
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "instrument.h"
 #include "mix_ops.h"
 #include "or.h"
+#include "policy.h"
 #include "prelude.h"
 #include "rle_container.h"
 
@@ -17,46 +17,28 @@ using CTy = froaring::ContainerType;
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_bb(BitmapContainer<WordType, DataBits>* a,
                                              const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    for (size_t i = 0; i < a->WordsCount; ++i) {
-        a->words[i] |= b->words[i];
-    }
-    result_type = CTy::Bitmap;
-
-    return a;
+    BitmapStats<WordType> stats;
+    a->write_words([&](size_t s) { return a->summary[s] | b->summary[s]; },
+                   [&](size_t i) { return a->words[i] | b->words[i]; }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_aa(ArrayContainer<WordType, DataBits>* a,
                                              const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
     if (b->size == 0) {
-        result_type = CTy::Array;
-        return a;
-    }
-    if (a->size == 0) {
-        a->expand_to(b->size);
-        a->size = b->size;
-        std::memcpy(a->vals, b->vals, b->size * sizeof(typename ArrayContainer<WordType, DataBits>::IndexOrNumType));
-        result_type = CTy::Array;
-        return a;
-    }
-    size_t estimate_card = a->size + b->size;
-    if (estimate_card < ArrayContainer<WordType, DataBits>::ArrayToBitmapCountThreshold) {
-        // No inplace op is available
-        return froaring_or_aa(a, b, result_type);
+        // `a` is the result; counting its runs is the only pass
+        return finalize_inplace<WordType, DataBits>(a, CTy::Array, a->size, a->count_runs(), result_type);
     }
-    // If the result may be large...
-    result_type = CTy::Bitmap;
-    auto bitset_ptr = array_to_bitmap(a);
-    bitmap_set_array(bitset_ptr, b);
-    return bitset_ptr;
-    // TODO: maybe convert to array if the result cardinality is low?
+    // No inplace op is available: merging backwards would need the final cardinality first
+    return froaring_or_aa(a, b, result_type);
 }
 
 /// NOT in-place internally
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_rr(RLEContainer<WordType, DataBits>* a,
                                              const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     // TODO: inplace!
     return froaring_or_rr(a, b, result_type);
 }
@@ -65,7 +47,6 @@ froaring_container_t* froaring_or_inplace_rr(RLEContainer<WordType, DataBits>* a
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_ar(ArrayContainer<WordType, DataBits>* a,
                                              const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     return froaring_or_ar(a, b, result_type);  // No need to actually do it in-place
 }
 
@@ -73,7 +54,6 @@ froaring_container_t* froaring_or_inplace_ar(ArrayContainer<WordType, DataBits>*
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_ra(RLEContainer<WordType, DataBits>* a,
                                              const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     // TODO: inplace!
     return froaring_or_ar(b, a, result_type);
 }
@@ -81,28 +61,29 @@ froaring_container_t* froaring_or_inplace_ra(RLEContainer<WordType, DataBits>* a
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_br(BitmapContainer<WordType, DataBits>* a,
                                              const RLEContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: Auto transform into full RLE
-    result_type = CTy::Bitmap;
-    auto rle_count = b->run_count;
-    for (size_t i = 0; i < rle_count; i++) {
-        a->set_range(b->runs[i].start, b->runs[i].end);
-    }
-    return a;
+    BitmapStats<WordType> stats;
+    RunWords<WordType, DataBits> runs(b);
+    a->write_words([&](size_t s) { return a->summary[s] | runs.summary(s); },
+                   [&](size_t i) { return a->words[i] | runs.word(i); }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_rb(RLEContainer<WordType, DataBits>* a,
                                              const BitmapContainer<WordType, DataBits>* b, CTy& result_type) {
-    // TODO: convert RLE to efficient type
     // TODO: inplace!
     return froaring_or_br(b, a, result_type);
 }
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_or_inplace_ba(BitmapContainer<WordType, DataBits>* a,
                                              const ArrayContainer<WordType, DataBits>* b, CTy& result_type) {
-    bitmap_set_array(a, b);
-    result_type = CTy::Bitmap;
-    return a;
+    BitmapStats<WordType> stats;
+    ArrayWords<WordType, DataBits> vals(b);
+    a->write_words([&](size_t s) { return a->summary[s] | vals.summary(s); },
+                   [&](size_t i) { return a->words[i] | vals.word(i); }, stats);
+    a->set_cardinality(stats.cardinality);
+    return finalize_inplace<WordType, DataBits>(a, CTy::Bitmap, stats.cardinality, stats.run_count, result_type);
 }
 
 template <typename WordType, size_t DataBits>
@@ -113,9 +94,25 @@ froaring_container_t* froaring_or_inplace_ab(ArrayContainer<WordType, DataBits>*
 template <typename WordType, size_t DataBits>
 froaring_container_t* froaring_ori(froaring_container_t* a, const froaring_container_t* b, CTy ta, CTy tb,
                                    CTy& result_type) {
+    FROARING_KERNEL_SCOPE(OrInplace, ta, tb);
     using RLESized = RLEContainer<WordType, DataBits>;
     using ArraySized = ArrayContainer<WordType, DataBits>;
     using BitmapSized = BitmapContainer<WordType, DataBits>;
+    if (ta == CTy::Full || tb == CTy::Full) {
+        result_type = CTy::Full;
+        return full_container();
+    }
+    if (is_encoded_array(ta) || is_encoded_array(tb)) {  // unpack, then run the array kernels
+        CTy ua_type = ta, ub_type = tb;
+        auto ua = unpacked<WordType, DataBits>(a, ua_type);
+        auto ub = unpacked<WordType, DataBits>(b, ub_type);
+        auto result = froaring_ori<WordType, DataBits>(ua, ub, ua_type, ub_type, result_type);
+        if (result != ua) {  // `ua` was not operated in place
+            release_unpacked<WordType, DataBits>(ua, a);
+        }
+        release_unpacked<WordType, DataBits>(ub, b);
+        return result;
+    }
     switch (CTYPE_PAIR(ta, tb)) {
         case CTYPE_PAIR(CTy::Bitmap, CTy::Bitmap): {
             return froaring_or_inplace_bb(static_cast<BitmapSized*>(a), static_cast<const BitmapSized*>(b),
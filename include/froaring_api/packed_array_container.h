@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "array_container.h"
+#include "instrument.h"
+#include "prelude.h"
+
+namespace froaring {
+/// @brief A read-mostly array container storing exactly DataBits per value, instead of the `can_fit_t<DataBits>`
+/// of `ArrayContainer` (e.g. 12 bits instead of 16). Values are packed in ascending order into 64-bit words, the
+/// lowest bits first, and a value may straddle two words.
+///
+/// It is only used for geometries whose array values waste at least FROARING_PACKED_ARRAY_MIN_WASTE percent of
+/// their bits (see `Enabled`), and only when it is smaller than the other types (see `choose_container_type`).
+/// Point reads decode values in place; mutations and set operations work on an unpacked `ArrayContainer`.
+template <typename WordType, size_t DataBits>
+class PackedArrayContainer : public froaring_container_t {
+public:
+    using IndexOrNumType = froaring::can_fit_t<DataBits>;
+    using SizeType = froaring::can_fit_t<DataBits + 1>;
+    using Unpacked = ArrayContainer<WordType, DataBits>;
+    static constexpr size_t ContainerCapacity = (1 << DataBits);
+    /// Bits of each value left unused by `ArrayContainer`, in percent.
+    static constexpr size_t WastedPercent =
+        (sizeof(IndexOrNumType) * 8 - DataBits) * 100 / (sizeof(IndexOrNumType) * 8);
+    static constexpr bool Enabled = WastedPercent >= FROARING_PACKED_ARRAY_MIN_WASTE;
+    /// Values decoded at once by `unpack_block`: they fill exactly DataBits words, so that every block starts at a
+    /// word boundary and the shift of each value in it is a compile-time constant.
+    static constexpr size_t BlockSize = 64;
+    static constexpr uint64_t Mask = (uint64_t(1) << DataBits) - 1;
+
+    static_assert(DataBits < 64, "A packed array stores values narrower than a word");
+
+    /// @brief Words needed to pack `n` values.
+    static constexpr size_t words_for(size_t n) { return (n * DataBits + 63) / 64; }
+
+    explicit PackedArrayContainer(const Unpacked* a)
+        : size(a->size), words(static_cast<uint64_t*>(calloc(std::max<size_t>(words_for(size), 1), 8))) {
+        assert(words && "Failed to allocate memory for PackedArrayContainer");
+        FROARING_COUNT(Alloc);
+        for (size_t i = 0; i < size; ++i) {
+            const size_t bit = i * DataBits, w = bit / 64, offset = bit % 64;
+            words[w] |= uint64_t(a->vals[i]) << offset;
+            if (offset + DataBits > 64) {
+                words[w + 1] |= uint64_t(a->vals[i]) >> (64 - offset);
+            }
+        }
+    }
+    explicit PackedArrayContainer(const PackedArrayContainer& other)
+        : froaring_container_t(),
+          size(other.size),
+          words(static_cast<uint64_t*>(malloc(std::max<size_t>(words_for(size), 1) * 8))) {
+        assert(words && "Failed to allocate memory for PackedArrayContainer");
+        std::memcpy(words, other.words, std::max<size_t>(words_for(size), 1) * 8);
+        FROARING_COUNT(Alloc);
+    }
+
+    ~PackedArrayContainer() { free(words); }
+
+    PackedArrayContainer& operator=(const PackedArrayContainer&) = delete;
+
+    void debug_print() const {
+        for (SizeType i = 0; i < size; ++i) {
+            std::cout << int(get(i)) << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    /// @brief The `i`-th smallest value.
+    IndexOrNumType get(size_t i) const {
+        const size_t bit = i * DataBits, w = bit / 64, offset = bit % 64;
+        uint64_t v = words[w] >> offset;
+        if (offset + DataBits > 64) {
+            v |= words[w + 1] << (64 - offset);
+        }
+        return static_cast<IndexOrNumType>(v & Mask);
+    }
+
+    /// @brief Decode values `[block * BlockSize, (block + 1) * BlockSize)`, which must all exist, into `out`.
+    /// The loop is expanded at compile time, so every shift is a constant and no branch depends on the data.
+    void unpack_block(size_t block, IndexOrNumType* out) const {
+        unpack_block_impl(words + block * DataBits, out, std::make_index_sequence<BlockSize>());
+    }
+
+    /// @brief Decode every value into `out`, which holds at least `size` values.
+    void unpack(IndexOrNumType* out) const {
+        const size_t blocks = size / BlockSize;
+        for (size_t b = 0; b < blocks; ++b) {
+            unpack_block(b, out + b * BlockSize);
+        }
+        for (size_t i = blocks * BlockSize; i < size; ++i) {
+            out[i] = get(i);
+        }
+    }
+
+    /// @brief An `ArrayContainer` holding the same values. The caller owns it.
+    Unpacked* to_array() const {
+        auto ans = new Unpacked(size, size);
+        unpack(ans->vals);
+        return ans;
+    }
+
+    SizeType cardinality() const { return size; }
+
+    /// @brief First position whose value is not less than `num`, or `size`.
+    SizeType lower_bound(IndexOrNumType num) const {
+        size_t lo = 0, len = size;
+        while (len > 0) {  // values decode in a few shifts, so search them in place
+            const size_t half = len / 2;
+            if (get(lo + half) < num) {
+                lo += half + 1;
+                len -= half + 1;
+            } else {
+                len = half;
+            }
+        }
+        return static_cast<SizeType>(lo);
+    }
+
+    bool test(IndexOrNumType num) const {
+        const SizeType pos = lower_bound(num);
+        return pos < size && get(pos) == num;
+    }
+
+    /// @brief Number of values not greater than `num`.
+    SizeType rank(IndexOrNumType num) const {
+        const SizeType pos = lower_bound(num);
+        return pos + (pos < size && get(pos) == num);
+    }
+
+    /// @brief The `k`-th smallest value (0-based). `k` must be less than the cardinality.
+    IndexOrNumType select(SizeType k) const {
+        assert(k < size);
+        return get(k);
+    }
+
+    /// @brief The smallest value. The container must not be empty.
+    IndexOrNumType minimum() const {
+        assert(size);
+        return get(0);
+    }
+
+    /// @brief The largest value. The container must not be empty.
+    IndexOrNumType maximum() const {
+        assert(size);
+        return get(size - 1);
+    }
+
+    /// @brief Write the (at most) `n` smallest values, each plus `base`, to `out` in ascending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_first(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        IndexOrNumType block[BlockSize];
+        size_t i = 0;
+        for (; i + BlockSize <= n; i += BlockSize) {
+            unpack_block(i / BlockSize, block);
+            for (size_t j = 0; j < BlockSize; ++j) {
+                out[i + j] = base + block[j];
+            }
+        }
+        for (; i < n; ++i) {
+            out[i] = base + get(i);
+        }
+        return n;
+    }
+
+    /// @brief Write the (at most) `n` largest values, each plus `base`, to `out` in descending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_last(size_t n, OutType base, OutType* out) const {
+        n = std::min(n, size_t(size));
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = base + get(size - 1 - i);
+        }
+        return n;
+    }
+
+    /// @brief Number of maximal runs of consecutive values.
+    SizeType count_runs() const {
+        if (!size) return 0;
+        SizeType runs = 1;
+        for (SizeType i = 1; i < size; ++i) {
+            runs += (get(i) != get(i - 1) + 1);
+        }
+        return runs;
+    }
+
+    /// @brief Whether both containers hold the same values: packing is canonical, unused bits are zero.
+    bool equals(const PackedArrayContainer& other) const {
+        return size == other.size && std::memcmp(words, other.words, words_for(size) * 8) == 0;
+    }
+
+private:
+    template <size_t... I>
+    static void unpack_block_impl(const uint64_t* in, IndexOrNumType* out, std::index_sequence<I...>) {
+        ((out[I] = decode<I>(in)), ...);
+    }
+
+    /// @brief The `i`-th value of a block starting at `in`.
+    template <size_t I>
+    static IndexOrNumType decode(const uint64_t* in) {
+        constexpr size_t bit = I * DataBits, w = bit / 64, offset = bit % 64;
+        uint64_t v = in[w] >> offset;
+        if constexpr (offset + DataBits > 64) {
+            v |= in[w + 1] << (64 - offset);
+        }
+        return static_cast<IndexOrNumType>(v & Mask);
+    }
+
+public:
+    SizeType size;
+    uint64_t* words;
+};
+}  // namespace froaring
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+#include "array_container.h"
+#include "bitmap_container.h"
+#include "mix_ops.h"
+#include "packed_array_container.h"
+#include "prelude.h"
+#include "rle_container.h"
+#include "utils.h"
+
+namespace froaring {
+using CTy = froaring::ContainerType;
+
+/// Payload size of each container type, in bytes. Headers are the same for all of them and thus ignored.
+template <typename WordType, size_t DataBits>
+constexpr size_t array_size_in_bytes(size_t cardinality) {
+    return cardinality * sizeof(typename ArrayContainer<WordType, DataBits>::IndexOrNumType);
+}
+
+template <typename WordType, size_t DataBits>
+constexpr size_t packed_size_in_bytes(size_t cardinality) {
+    return PackedArrayContainer<WordType, DataBits>::words_for(cardinality) * sizeof(uint64_t);
+}
+
+template <typename WordType, size_t DataBits>
+constexpr size_t bitmap_size_in_bytes() {
+    return BitmapContainer<WordType, DataBits>::WordsCount * sizeof(WordType);
+}
+
+template <typename WordType, size_t DataBits>
+constexpr size_t rle_size_in_bytes(size_t run_count) {
+    return run_count * sizeof(typename RLEContainer<WordType, DataBits>::RunPair);
+}
+
+/// @brief Break-even points of the container types, derived from their payload sizes.
+template <typename WordType, size_t DataBits>
+struct ContainerPolicy {
+    /// An array holding more values than this is larger than a bitmap.
+    static constexpr size_t ArrayMaxCardinality =
+        bitmap_size_in_bytes<WordType, DataBits>() / array_size_in_bytes<WordType, DataBits>(1);
+    /// Runs more than this are larger than a bitmap.
+    static constexpr size_t RleMaxRuns =
+        bitmap_size_in_bytes<WordType, DataBits>() / rle_size_in_bytes<WordType, DataBits>(1);
+};
+
+/// @brief Choose the type with the smallest payload for a container of the given cardinality and run count.
+/// A container holding every value is Full, which has no payload. PackedArray is only considered for geometries
+/// that enable it (see `PackedArrayContainer::Enabled`). Other ties are broken in favour of Array, then Bitmap,
+/// which are cheaper to operate on.
+template <typename WordType, size_t DataBits>
+constexpr CTy choose_container_type(size_t cardinality, size_t run_count) {
+    if (cardinality == BitmapContainer<WordType, DataBits>::TotalBits) {
+        return CTy::Full;
+    }
+    const size_t array_bytes = array_size_in_bytes<WordType, DataBits>(cardinality);
+    const size_t packed_bytes = PackedArrayContainer<WordType, DataBits>::Enabled
+                                    ? packed_size_in_bytes<WordType, DataBits>(cardinality)
+                                    : array_bytes;
+    const size_t bitmap_bytes = bitmap_size_in_bytes<WordType, DataBits>();
+    const size_t rle_bytes = rle_size_in_bytes<WordType, DataBits>(run_count);
+    const size_t smallest_array_bytes = std::min(array_bytes, packed_bytes);
+    if (smallest_array_bytes <= bitmap_bytes && smallest_array_bytes <= rle_bytes) {
+        return packed_bytes < array_bytes ? CTy::PackedArray : CTy::Array;
+    }
+    if (bitmap_bytes <= rle_bytes) {
+        return CTy::Bitmap;
+    }
+    return CTy::RLE;
+}
+
+/// @brief Accumulates the cardinality and run count of a bitmap word by word, so that a kernel can produce them
+/// while writing its result.
+template <typename WordType>
+struct BitmapStats {
+    size_t cardinality = 0;
+    size_t run_count = 0;
+    WordType carry = 0;  // the highest bit of the previous word
+
+    size_t next = 0;  // index of the word after the last one added by `add_word`
+
+    void add(WordType w) {
+        cardinality += std::popcount(w);
+        // A run starts at every set bit whose lower neighbour is unset
+        run_count += std::popcount(static_cast<WordType>(w & ~((w << 1) | carry)));
+        carry = w >> (sizeof(WordType) * 8 - 1);
+    }
+
+    /// @brief Add word `i`, for a kernel that skips empty words: the words since the previous one added are zero.
+    void add_word(size_t i, WordType w) {
+        if (i != next) {
+            carry = 0;
+        }
+        add(w);
+        next = i + 1;
+    }
+};
+
+/// @brief Whether appending `val` after `vals[0..pos)` starts a new run.
+template <typename T>
+inline bool is_run_start(const T* vals, size_t pos, T val) {
+    return pos == 0 || size_t(vals[pos - 1]) + 1 != size_t(val);
+}
+
+/// @brief Convert a container into another type. The old container is NOT released.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* convert_container(const froaring_container_t* c, CTy from, CTy to) {
+    using ArraySized = ArrayContainer<WordType, DataBits>;
+    if (to == CTy::Full) {
+        return full_container();
+    }
+    // Encoded arrays convert through Array
+    if (is_encoded_array(from)) {
+        ArraySized* array =
+            from == CTy::Cold ? cold_to_array(static_cast<const ColdContainer<WordType, DataBits>*>(c))
+                              : packed_to_array(static_cast<const PackedArrayContainer<WordType, DataBits>*>(c));
+        if (to == CTy::Array) {
+            return array;
+        }
+        auto ans = convert_container<WordType, DataBits>(array, CTy::Array, to);
+        delete array;
+        return ans;
+    }
+    if (is_encoded_array(to)) {
+        auto encode = [to](const ArraySized* array) -> froaring_container_t* {
+            return to == CTy::Cold ? static_cast<froaring_container_t*>(array_to_cold(array)) : array_to_packed(array);
+        };
+        if (from == CTy::Array) {
+            return encode(static_cast<const ArraySized*>(c));
+        }
+        auto array = static_cast<ArraySized*>(convert_container<WordType, DataBits>(c, from, CTy::Array));
+        auto ans = encode(array);
+        delete array;
+        return ans;
+    }
+    switch (CTYPE_PAIR(from, to)) {
+        case CTYPE_PAIR(CTy::Full, CTy::Bitmap):
+            return full_to_bitmap<WordType, DataBits>();
+        case CTYPE_PAIR(CTy::Full, CTy::RLE):
+            return full_to_rle<WordType, DataBits>();
+        case CTYPE_PAIR(CTy::Bitmap, CTy::Array):
+            return bitmap_to_array(static_cast<const BitmapContainer<WordType, DataBits>*>(c));
+        case CTYPE_PAIR(CTy::RLE, CTy::Array):
+            return rle_to_array(static_cast<const RLEContainer<WordType, DataBits>*>(c));
+        case CTYPE_PAIR(CTy::Array, CTy::Bitmap):
+            return array_to_bitmap(static_cast<const ArrayContainer<WordType, DataBits>*>(c));
+        case CTYPE_PAIR(CTy::RLE, CTy::Bitmap):
+            return rle_to_bitmap(static_cast<const RLEContainer<WordType, DataBits>*>(c));
+        case CTYPE_PAIR(CTy::Array, CTy::RLE):
+            return array_to_rle(static_cast<const ArrayContainer<WordType, DataBits>*>(c));
+        case CTYPE_PAIR(CTy::Bitmap, CTy::RLE):
+            return bitmap_to_rle(static_cast<const BitmapContainer<WordType, DataBits>*>(c));
+        default:
+            FROARING_UNREACHABLE
+    }
+    return nullptr;
+}
+
+/// @brief Finish a kernel whose result is a container operated in-place: convert it into its minimal-size
+/// representation. If a new container is returned, the old one should be released by the caller.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* finalize_inplace(froaring_container_t* c, CTy type, size_t cardinality, size_t run_count,
+                                              CTy& result_type) {
+    result_type = choose_container_type<WordType, DataBits>(cardinality, run_count);
+    if (result_type == type) {
+        return c;
+    }
+    return convert_container<WordType, DataBits>(c, type, result_type);
+}
+
+/// @brief Finish a kernel whose result is a newly created container: convert it into its minimal-size
+/// representation, releasing the original one if converted.
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* finalize_container(froaring_container_t* c, CTy type, size_t cardinality,
+                                                size_t run_count, CTy& result_type) {
+    auto* result = finalize_inplace<WordType, DataBits>(c, type, cardinality, run_count, result_type);
+    if (result != c) {
+        release_container<WordType, DataBits>(c, type);
+    }
+    return result;
+}
+
+template <typename WordType, size_t DataBits>
+inline froaring_container_t* finalize_container(RLEContainer<WordType, DataBits>* c, CTy& result_type) {
+    return finalize_container<WordType, DataBits>(c, CTy::RLE, c->cardinality(), c->run_count, result_type);
+}
+}  // namespace froaring
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <bit>
 #include <cassert>
 #include <cstdint>
@@ -8,11 +9,52 @@
 #define INIT_FLAG 0x1
 #define FROARING_UNREACHABLE assert(false && "Should never reach here");
 #define FROARING_NOT_IMPLEMENTED assert(false && "Not implemented yet");
+#define FROARING_PREFETCH(addr) __builtin_prefetch(addr)
+
+/// Search strategies for sorted arrays (index keys, array values and runs).
+/// Select one by defining FROARING_SEARCH_MODE before including any froaring header.
+#define FROARING_SEARCH_BRANCHY 0     // classic binary search
+#define FROARING_SEARCH_BRANCHLESS 1  // branchless binary search with prefetching
+#define FROARING_SEARCH_EYTZINGER 2   // branchless + an Eytzinger-ordered shadow of the index keys
+#ifndef FROARING_SEARCH_MODE
+#define FROARING_SEARCH_MODE FROARING_SEARCH_BRANCHLESS
+#endif
+
+/// Optional post-pass applied to the result of every set operation (&, |, - and their in-place versions).
+/// Flags can be combined, e.g. (FROARING_POST_PASS_RUN_OPTIMIZE | FROARING_POST_PASS_SHRINK_TO_FIT).
+#define FROARING_POST_PASS_NONE 0
+#define FROARING_POST_PASS_RUN_OPTIMIZE 1  // convert each container into its smallest type
+#define FROARING_POST_PASS_SHRINK_TO_FIT 2  // release unused capacity
+#ifndef FROARING_SET_OP_POST_PASS
+#define FROARING_SET_OP_POST_PASS FROARING_POST_PASS_NONE
+#endif
+
+/// Array values of geometries whose DataBits leave at least this percentage of `can_fit_t<DataBits>` unused (e.g. 25%
+/// for DataBits=12, 37% for DataBits=20) are bit-packed when that is smaller (see PackedArrayContainer). Define as
+/// 101 to never pack.
+#ifndef FROARING_PACKED_ARRAY_MIN_WASTE
+#define FROARING_PACKED_ARRAY_MIN_WASTE 20
+#endif
+
+/// Bitmap containers of at least this many DataBits keep a summary bit per word, set iff the word is non-zero, so that
+/// scans and bitmap-bitmap kernels skip empty words (see BitmapContainer::summary). It costs 1/64 more memory with
+/// 64-bit words. Define as 64 to never keep one.
+#ifndef FROARING_BITMAP_SUMMARY_MIN_BITS
+#define FROARING_BITMAP_SUMMARY_MIN_BITS 16
+#endif
+
+/// Define as 1 to count conversions, allocations, memmoves and kernel invocations (see instrument.h).
+#ifndef FROARING_INSTRUMENT
+#define FROARING_INSTRUMENT 0
+#endif
 
 namespace froaring {
 
-#define CTYPE_PAIR(t1, t2) (static_cast<uint8_t>(t1) * 4 + static_cast<uint8_t>(t2))
-enum class ContainerType : uint8_t { Array, Bitmap, RLE, Containers };
+#define CTYPE_PAIR(t1, t2) (static_cast<uint8_t>(t1) * 7 + static_cast<uint8_t>(t2))
+/// `Full` is a container with every value set. It has no payload: see `full_container()`.
+/// `PackedArray` is an array storing exactly DataBits per value: see `PackedArrayContainer`.
+/// `Cold` is a compressed, read-only container produced by `compact_cold()`: see `ColdContainer`.
+enum class ContainerType : uint8_t { Array, Bitmap, RLE, Containers, Full, PackedArray, Cold };
 
 const int ARRAY_CONTAINER_INIT_CAPACITY = 4;
 const int RLE_CONTAINER_INIT_CAPACITY = 4;
@@ -21,11 +63,26 @@ const int CONTAINERS_INIT_CAPACITY = 16;
 const std::size_t MINIMAL_SIZE_TO_BINSEARCH = 8;
 
 // Markers
-struct froaring_container_t {};
+struct froaring_container_t {
+    /// Owners besides the first one, for copy-on-write sharing (see `share_container`). A container may only be
+    /// mutated in place while this is 0. Copies start unshared.
+    mutable std::atomic<uint32_t> extra_owners{0};
+
+    froaring_container_t() = default;
+    froaring_container_t(const froaring_container_t&) noexcept {}
+    froaring_container_t& operator=(const froaring_container_t&) noexcept { return *this; }
+};
 struct froaring_indices_t : public froaring_container_t {};
 using froaring_container_t = struct froaring_container_t;
 using froaring_indices_t = struct froaring_indices_t;
 
+/// @brief The pointer held by every Full container. It is never freed, copied or mutated: all Full containers share
+/// it, whatever their geometry.
+inline froaring_container_t* full_container() {
+    static froaring_container_t full;
+    return &full;
+}
+
 // Helper functions
 template <std::size_t Bits>
 struct can_fit {
@@ -56,11 +113,9 @@ template <std::size_t IndexBits, std::size_t DataBits>
 void num2index_n_data(can_fit_t<IndexBits + DataBits> value, can_fit_t<IndexBits>& index, can_fit_t<DataBits>& data) {
     static_assert(IndexBits + DataBits <= sizeof(value) * 8,
                   "IndexBits + DataBits exceeds the type size of the value.");
-    assert(value < (~can_fit_t<IndexBits + DataBits>(0)) &&
-           "Value exceeds the allowed index bits.");  // FIXME: the check is not
-                                                      // sound if can_fit_t is
-                                                      // larger than actual bits
-                                                      // needed
+    if constexpr (IndexBits + DataBits < sizeof(value) * 8) {
+        assert((value >> (IndexBits + DataBits)) == 0 && "Value exceeds the allowed index bits.");
+    }
     data = value & ((can_fit_t<IndexBits + DataBits>(1) << DataBits) - 1);
     index = value >> DataBits;
 }
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+
+#include "array_container.h"
+#include "bitmap_container.h"
+#include "cold_container.h"
+#include "packed_array_container.h"
+#include "prelude.h"
+#include "rle_container.h"
+
+namespace froaring {
+using CTy = froaring::ContainerType;
+
+/// @brief Number of values in the container not greater than `value`.
+template <typename WordType, size_t DataBits>
+inline size_t container_rank(const froaring_container_t* c, CTy type, can_fit_t<DataBits> value) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->rank(value);
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->rank(value);
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->rank(value);
+        case CTy::Full:
+            return size_t(value) + 1;
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->rank(value);
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->rank(value);
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief The `k`-th smallest value (0-based) of the container. `k` must be less than its cardinality.
+template <typename WordType, size_t DataBits>
+inline can_fit_t<DataBits> container_select(const froaring_container_t* c, CTy type, size_t k) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->select(k);
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->select(k);
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->select(k);
+        case CTy::Full:
+            return static_cast<can_fit_t<DataBits>>(k);
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->select(k);
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->select(k);
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief The smallest value of the container. It must not be empty.
+template <typename WordType, size_t DataBits>
+inline can_fit_t<DataBits> container_minimum(const froaring_container_t* c, CTy type) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->minimum();
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->minimum();
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->minimum();
+        case CTy::Full:
+            return 0;
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->minimum();
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->minimum();
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief The largest value of the container. It must not be empty.
+template <typename WordType, size_t DataBits>
+inline can_fit_t<DataBits> container_maximum(const froaring_container_t* c, CTy type) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->maximum();
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->maximum();
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->maximum();
+        case CTy::Full:
+            return static_cast<can_fit_t<DataBits>>(BitmapContainer<WordType, DataBits>::TotalBits - 1);
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->maximum();
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->maximum();
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief Write the (at most) `n` smallest values of the container, each plus `base`, to `out` in ascending order.
+/// @return Number of values written.
+template <typename WordType, size_t DataBits, typename OutType>
+inline size_t container_take_first(const froaring_container_t* c, CTy type, size_t n, OutType base, OutType* out) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->take_first(n, base, out);
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->take_first(n, base, out);
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->take_first(n, base, out);
+        case CTy::Full: {
+            const size_t count = std::min(n, BitmapContainer<WordType, DataBits>::TotalBits);
+            for (size_t i = 0; i < count; ++i) out[i] = base + static_cast<OutType>(i);
+            return count;
+        }
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->take_first(n, base, out);
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->take_first(n, base, out);
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+
+/// @brief Write the (at most) `n` largest values of the container, each plus `base`, to `out` in descending order.
+/// @return Number of values written.
+template <typename WordType, size_t DataBits, typename OutType>
+inline size_t container_take_last(const froaring_container_t* c, CTy type, size_t n, OutType base, OutType* out) {
+    switch (type) {
+        case CTy::Array:
+            return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->take_last(n, base, out);
+        case CTy::Bitmap:
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->take_last(n, base, out);
+        case CTy::RLE:
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->take_last(n, base, out);
+        case CTy::Full: {
+            constexpr size_t Capacity = BitmapContainer<WordType, DataBits>::TotalBits;
+            const size_t count = std::min(n, Capacity);
+            for (size_t i = 0; i < count; ++i) out[i] = base + static_cast<OutType>(Capacity - 1 - i);
+            return count;
+        }
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->take_last(n, base, out);
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->take_last(n, base, out);
+        default:
+            FROARING_UNREACHABLE
+    }
+    return 0;
+}
+}  // namespace froaring
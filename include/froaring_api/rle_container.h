@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 
+#include "instrument.h"
 #include "prelude.h"
+#include "search.h"
 
 // TODO: addRange may delete runs in middle!(not implemented, just a reminder for whom will)
 namespace froaring {
@@ -22,23 +25,24 @@ public:
 
     /// Bit capacity for containers indexed
     static constexpr size_t ContainerCapacity = (1 << DataBits);
-    /// RLE threshold (RLE will not be optimum for more runs)
-    static constexpr size_t RleToBitmapRunThreshold = ContainerCapacity / (DataBits * 2);
     static constexpr size_t UseLinearScanThreshold = 8;
 
 public:
     explicit RLEContainer(SizeType capacity = RLE_CONTAINER_INIT_CAPACITY, SizeType run_count = 0)
-        : capacity(std::max(capacity, run_count)),
+        : capacity(std::max({capacity, run_count, SizeType(1)})),
           run_count(run_count),
-          runs(static_cast<RunPair*>(malloc(capacity * sizeof(RunPair)))) {
+          runs(static_cast<RunPair*>(malloc(this->capacity * sizeof(RunPair)))) {
         assert(runs && "Failed to allocate memory for RLEContainer");
+        FROARING_COUNT(Alloc);
     }
 
     explicit RLEContainer(const RLEContainer& other)
-        : capacity(other.run_count),
+        : froaring_container_t(),
+          capacity(std::max(SizeType(other.run_count), SizeType(1))),
           run_count(other.run_count),
           runs(static_cast<RunPair*>(malloc(this->capacity * sizeof(RunPair)))) {
         std::memcpy(this->runs, other.runs, sizeof(RunPair) * run_count);
+        FROARING_COUNT(Alloc);
     }
 
     ~RLEContainer() { free(runs); }
@@ -97,7 +101,7 @@ public:
 
     bool test_and_set(IndexOrNumType num) {
         bool was_set;
-        IndexOrNumType pos;
+        SizeType pos = 0;
         if (!run_count) {
             was_set = false;
         } else {
@@ -118,6 +122,79 @@ public:
         return count + run_count;
     }
 
+    /// @brief Number of values not greater than `num`.
+    SizeType rank(IndexOrNumType num) const {
+        SizeType count = 0;
+        for (SizeType i = 0; i < run_count && runs[i].start <= num; ++i) {
+            count += std::min(runs[i].end, num) - runs[i].start + 1;
+        }
+        return count;
+    }
+
+    /// @brief The `k`-th smallest value (0-based). `k` must be less than the cardinality.
+    IndexOrNumType select(SizeType k) const {
+        for (SizeType i = 0; i < run_count; ++i) {
+            SizeType length = runs[i].end - runs[i].start + 1;
+            if (k < length) {
+                return runs[i].start + k;
+            }
+            k -= length;
+        }
+        FROARING_UNREACHABLE
+        return 0;
+    }
+
+    /// @brief The smallest value. The container must not be empty.
+    IndexOrNumType minimum() const {
+        assert(run_count);
+        return runs[0].start;
+    }
+
+    /// @brief The largest value. The container must not be empty.
+    IndexOrNumType maximum() const {
+        assert(run_count);
+        return runs[run_count - 1].end;
+    }
+
+    /// @brief Write the (at most) `n` smallest values, each plus `base`, to `out` in ascending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_first(size_t n, OutType base, OutType* out) const {
+        size_t written = 0;
+        for (SizeType i = 0; i < run_count && written < n; ++i) {
+            // `size_t` so that a run ending at the last value does not wrap around
+            for (size_t v = runs[i].start; v <= runs[i].end && written < n; ++v) {
+                out[written++] = base + static_cast<OutType>(v);
+            }
+        }
+        return written;
+    }
+
+    /// @brief Write the (at most) `n` largest values, each plus `base`, to `out` in descending order.
+    /// @return Number of values written.
+    template <typename OutType>
+    size_t take_last(size_t n, OutType base, OutType* out) const {
+        size_t written = 0;
+        for (SizeType i = run_count; i > 0 && written < n; --i) {
+            const auto& run = runs[i - 1];
+            // Count down with an offset so that a run starting at 0 does not wrap around
+            for (size_t v = size_t(run.end) + 1; v > run.start && written < n; --v) {
+                out[written++] = base + static_cast<OutType>(v - 1);
+            }
+        }
+        return written;
+    }
+
+    /// @brief Release unused capacity.
+    /// @return Bytes saved.
+    size_t shrink_to_fit() {
+        SizeType new_cap = std::max(SizeType(run_count), SizeType(1));
+        if (new_cap == capacity) return 0;
+        size_t saved = (capacity - new_cap) * sizeof(RunPair);
+        expand_to(new_cap);
+        return saved;
+    }
+
     bool is_full() const { return run_count == 1 && runs[0].start == 0 && runs[0].end == ContainerCapacity - 1; }
 
 private:
@@ -130,6 +207,7 @@ private:
             }
             return run_count;
         }
+#if FROARING_SEARCH_MODE == FROARING_SEARCH_BRANCHY
         SizeType left = 0;
         SizeType right = run_count;
         while (left < right) {
@@ -141,18 +219,25 @@ private:
             }
         }
         return left;
+#else
+        return branchless_lower_bound(runs, static_cast<SizeType>(run_count), num,
+                                      [](const RunPair& r) { return r.end; });
+#endif
     }
 
+public:
     void expand() { expand_to(this->capacity * 2); }
 
     void expand_to(SizeType new_cap) {
         void* new_memory = realloc(runs, new_cap * sizeof(RunPair));
-        assert(new_memory && "Failed to reallocate memory for ArrayContainer");
+        assert(new_memory && "Failed to reallocate memory for RLEContainer");
+        FROARING_COUNT(Realloc);
         runs = static_cast<RunPair*>(new_memory);
         this->capacity = new_cap;
     }
 
-    void set_raw(IndexOrNumType pos, IndexOrNumType num) {
+private:
+    void set_raw(SizeType pos, IndexOrNumType num) {
         // If the value is next to the previous run's end (and need merging)
         bool merge_prev = (pos > 0 && num > 0 && num - 1 == runs[pos - 1].end);
         // If the value is next to the next run's start (and need merging)
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+#include "prelude.h"
+
+namespace froaring {
+
+/// @brief Branchless lower bound on a sorted array.
+/// The loop body compiles to a conditional move, so the only branch left is the loop counter, which is perfectly
+/// predictable. Both candidate positions of the next round are prefetched before the comparison resolves.
+/// @param base Sorted array.
+/// @param n Number of elements in `base`.
+/// @param key The key to search.
+/// @param proj Projection from an element to its comparison key (e.g. the `end` of a run).
+/// @return The first position whose key is not less than `key`, or `n` if no such position.
+template <typename SizeT, typename T, typename Key, typename Proj>
+inline SizeT branchless_lower_bound(const T* base, SizeT n, Key key, Proj proj) {
+    if (n == 0) return 0;
+    const T* first = base;
+    size_t len = n;
+    while (len > 1) {
+        size_t half = len / 2;
+        FROARING_PREFETCH(first + half / 2);
+        FROARING_PREFETCH(first + half + half / 2);
+        first = (proj(first[half]) < key) ? first + half : first;
+        len -= half;
+    }
+    return static_cast<SizeT>((first - base) + (proj(*first) < key));
+}
+
+/// @brief A read-only shadow copy of sorted keys in Eytzinger (BFS) order.
+/// Searching it touches one cache line per few levels and the prefetcher can fetch several levels ahead, which beats a
+/// plain binary search on large, read-mostly key arrays. It must be rebuilt after the source keys change; the owner
+/// calls `invalidate()` on mutation and the shadow is rebuilt lazily on the next search.
+/// @tparam KeyType Type of keys.
+/// @tparam SizeT Type of positions in the source array.
+template <typename KeyType, typename SizeT>
+class EytzingerLayout {
+    /// How many nodes ahead to prefetch: the descendants 4 levels below share a cache line (for small keys).
+    static constexpr size_t PrefetchStride = 16;
+
+public:
+    bool stale() const { return dirty; }
+
+    void invalidate() { dirty = true; }
+
+    /// @brief Rebuild the shadow from a sorted source.
+    /// @param src Source array.
+    /// @param n Number of elements in `src`.
+    /// @param proj Projection from an element to its key.
+    template <typename T, typename Proj>
+    void rebuild(const T* src, SizeT n, Proj proj) {
+        // 1-based layout: node k has children 2k and 2k+1, slot 0 is unused.
+        keys.resize(static_cast<size_t>(n) + 1);
+        ranks.resize(static_cast<size_t>(n) + 1);
+        size_t next = 0;
+        fill(src, n, proj, next, 1);
+        count = n;
+        dirty = false;
+    }
+
+    /// @brief Same contract as `branchless_lower_bound`: the position in the *source* array.
+    SizeT lower_bound(KeyType key) const {
+        size_t k = 1;
+        const size_t n = count;
+        while (k <= n) {
+            // Clamped: a pointer past the end of `keys` is UB even if only prefetched.
+            FROARING_PREFETCH(keys.data() + std::min(PrefetchStride * k, n));
+            k = 2 * k + (keys[k] < key);
+        }
+        // Undo the trailing right turns: the answer is the last node where we went left.
+        k >>= std::countr_one(k) + 1;
+        return k == 0 ? count : ranks[k];
+    }
+
+private:
+    template <typename T, typename Proj>
+    void fill(const T* src, SizeT n, Proj proj, size_t& next, size_t k) {
+        if (k > n) return;
+        fill(src, n, proj, next, 2 * k);
+        keys[k] = proj(src[next]);
+        ranks[k] = static_cast<SizeT>(next);
+        ++next;
+        fill(src, n, proj, next, 2 * k + 1);
+    }
+
+    std::vector<KeyType> keys;
+    std::vector<SizeT> ranks;
+    SizeT count = 0;
+    bool dirty = true;
+};
+}  // namespace froaring
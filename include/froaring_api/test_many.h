@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstring>
+
+#include "array_container.h"
+#include "bitmap_container.h"
+#include "cold_container.h"
+#include "packed_array_container.h"
+#include "prelude.h"
+#include "rle_container.h"
+
+namespace froaring {
+using CTy = froaring::ContainerType;
+
+/// @brief Prefetch the part of the container that a lookup of `value` will touch first.
+template <typename WordType, size_t DataBits>
+inline void prefetch_container(const froaring_container_t* c, CTy type, can_fit_t<DataBits> value) {
+    switch (type) {
+        case CTy::Array: {
+            auto array = static_cast<const ArrayContainer<WordType, DataBits>*>(c);
+            FROARING_PREFETCH(array->vals + array->size / 2);
+            break;
+        }
+        case CTy::Bitmap: {
+            using Bitmap = BitmapContainer<WordType, DataBits>;
+            FROARING_PREFETCH(static_cast<const Bitmap*>(c)->words + value / Bitmap::BitsPerWord);
+            break;
+        }
+        case CTy::RLE: {
+            auto rle = static_cast<const RLEContainer<WordType, DataBits>*>(c);
+            FROARING_PREFETCH(rle->runs + rle->run_count / 2);
+            break;
+        }
+        case CTy::Full:  // nothing to fetch
+            break;
+        case CTy::PackedArray: {  // the middle of the binary search
+            auto packed = static_cast<const PackedArrayContainer<WordType, DataBits>*>(c);
+            FROARING_PREFETCH(packed->words + packed->words_for(packed->size) / 2);
+            break;
+        }
+        case CTy::Cold: {  // the middle of the block search
+            auto cold = static_cast<const ColdContainer<WordType, DataBits>*>(c);
+            FROARING_PREFETCH(cold->blocks + cold->block_count / 2);
+            break;
+        }
+        default:
+            FROARING_UNREACHABLE
+    }
+}
+
+/// @brief `out[i]` = whether the container holds the low DataBits of `values[i]`, for `n` queries.
+template <typename WordType, size_t DataBits, typename ValueType>
+inline void container_test_many(const froaring_container_t* c, CTy type, const ValueType* values, size_t n,
+                                uint8_t* out) {
+    constexpr ValueType DataMask = (ValueType(1) << DataBits) - 1;
+    switch (type) {
+        case CTy::Array: {
+            auto array = static_cast<const ArrayContainer<WordType, DataBits>*>(c);
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = array->test(static_cast<can_fit_t<DataBits>>(values[i] & DataMask));
+            }
+            break;
+        }
+        case CTy::Bitmap:
+            static_cast<const BitmapContainer<WordType, DataBits>*>(c)->test_many(values, n, out);
+            break;
+        case CTy::RLE: {
+            auto rle = static_cast<const RLEContainer<WordType, DataBits>*>(c);
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = rle->test(static_cast<can_fit_t<DataBits>>(values[i] & DataMask));
+            }
+            break;
+        }
+        case CTy::Full:
+            std::memset(out, 1, n);
+            break;
+        case CTy::PackedArray: {
+            auto packed = static_cast<const PackedArrayContainer<WordType, DataBits>*>(c);
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = packed->test(static_cast<can_fit_t<DataBits>>(values[i] & DataMask));
+            }
+            break;
+        }
+        case CTy::Cold: {
+            auto cold = static_cast<const ColdContainer<WordType, DataBits>*>(c);
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = cold->test(static_cast<can_fit_t<DataBits>>(values[i] & DataMask));
+            }
+            break;
+        }
+        default:
+            FROARING_UNREACHABLE
+    }
+}
+}  // namespace froaring
@@ -2,6 +2,8 @@
 
 #include "array_container.h"
 #include "bitmap_container.h"
+#include "cold_container.h"
+#include "packed_array_container.h"
 #include "prelude.h"
 #include "rle_container.h"
 namespace froaring {
@@ -12,16 +14,38 @@ inline bool container_empty(const froaring_container_t* c, CTy type) {
         case CTy::Array:
             return static_cast<const ArrayContainer<WordType, DataBits>*>(c)->cardinality() == 0;
         case CTy::Bitmap:
-            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->cardinality() == 0;
+            return static_cast<const BitmapContainer<WordType, DataBits>*>(c)->empty();
         case CTy::RLE:
-            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->cardinality() == 0;
+            return static_cast<const RLEContainer<WordType, DataBits>*>(c)->run_count == 0;
+        case CTy::Full:
+            return false;
+        case CTy::PackedArray:
+            return static_cast<const PackedArrayContainer<WordType, DataBits>*>(c)->cardinality() == 0;
+        case CTy::Cold:
+            return static_cast<const ColdContainer<WordType, DataBits>*>(c)->cardinality() == 0;
         default:
             FROARING_UNREACHABLE
     }
 }
 
+/// @brief Whether other owners hold `c` (see `share_container`), so that it must not be mutated in place.
+inline bool container_shared(const froaring_container_t* c) {
+    return c->extra_owners.load(std::memory_order_acquire) != 0;
+}
+
+/// @brief Drop one owner of a shared container. Returns whether the caller was the last owner, and must delete it
+/// (true for nullptr, which is deleted as a no-op).
+inline bool drop_container_owner(froaring_container_t* c) {
+    // Sole owner (the common case): nobody else can share it concurrently, since sharing needs an owner
+    return !c || c->extra_owners.load(std::memory_order_acquire) == 0 ||
+           c->extra_owners.fetch_sub(1, std::memory_order_acq_rel) == 0;
+}
+
 template <typename WordType, size_t DataBits>
 inline void release_container(froaring_container_t* c, CTy type) {
+    if (type == CTy::Full || !drop_container_owner(c)) {  // Full has no payload to free
+        return;
+    }
     switch (type) {
         case CTy::Array:
             delete static_cast<ArrayContainer<WordType, DataBits>*>(c);
@@ -32,6 +56,12 @@ inline void release_container(froaring_container_t* c, CTy type) {
         case CTy::RLE:
             delete static_cast<RLEContainer<WordType, DataBits>*>(c);
             break;
+        case CTy::PackedArray:
+            delete static_cast<PackedArrayContainer<WordType, DataBits>*>(c);
+            break;
+        case CTy::Cold:
+            delete static_cast<ColdContainer<WordType, DataBits>*>(c);
+            break;
         default:
             FROARING_UNREACHABLE
     }
@@ -39,17 +69,17 @@ inline void release_container(froaring_container_t* c, CTy type) {
 
 template <typename WordType, size_t DataBits>
 inline void release_container(ArrayContainer<WordType, DataBits>* c) {
-    delete c;
+    if (drop_container_owner(c)) delete c;
 }
 
 template <typename WordType, size_t DataBits>
 inline void release_container(RLEContainer<WordType, DataBits>* c) {
-    delete c;
+    if (drop_container_owner(c)) delete c;
 }
 
 template <typename WordType, size_t DataBits>
 inline void release_container(BitmapContainer<WordType, DataBits>* c) {
-    delete c;
+    if (drop_container_owner(c)) delete c;
 }
 
 }  // namespace froaring
\ No newline at end of file
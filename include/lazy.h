@@ -0,0 +1,456 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "froaring.h"
+
+namespace froaring {
+/// @brief Lazily evaluated bitmap formulas (expression templates).
+///
+/// `lazy(a)` wraps a bitmap without copying it; `& | -` between lazy operands (or a lazy operand and a bitmap) only
+/// capture the formula: `Bitmap r = (lazy(a) & b) | (lazy(c) - d);`. The formula is evaluated key by key when it is
+/// converted to a bitmap or asked for `count()`. For each key that can hold a result, the operand containers are
+/// read as bitmap words (bitmap containers in place, arrays and runs expanded into a scratch buffer) and combined
+/// word by word in one pass. Only the final container for that key is allocated, in its smallest type, so no
+/// intermediate bitmap is ever materialized. The scratch buffer is allocated once per evaluation, on the heap: a
+/// block is 2^DataBits bits, too large to keep one per formula level on the stack.
+///
+/// The bitmaps must outlive the formula and must not change while it is evaluated.
+enum class LazyOp : uint8_t { And, Or, AndNot };
+
+template <typename Derived, typename Bitmap>
+class LazyExpression;
+template <typename Bitmap>
+class LazyLeaf;
+template <LazyOp Op, typename Left, typename Right>
+class LazyNode;
+
+template <typename T>
+struct is_lazy_expression : std::false_type {};
+template <typename Bitmap>
+struct is_lazy_expression<LazyLeaf<Bitmap>> : std::true_type {};
+template <LazyOp Op, typename Left, typename Right>
+struct is_lazy_expression<LazyNode<Op, Left, Right>> : std::true_type {};
+
+/// @brief Evaluation and materialization, shared by all the nodes of a formula.
+///
+/// A node provides `rewind()` (start a new evaluation), `next_key(key)` (the smallest key >= `key` that may hold a
+/// result, called with non-decreasing keys), `words(key, scratch)` (the bitmap words of its result for that key,
+/// possibly written into the first block of `scratch`, or nullptr if empty; `scratch` holds `ScratchBlocks` blocks of
+/// `WordsCount` words) and `known_cardinality(key, card)` (whether the result
+/// cardinality for that key follows from the operand cardinalities alone, without evaluating it).
+template <typename Derived, typename WordType, size_t IndexBits, size_t DataBits>
+class LazyExpression<Derived, FlexibleRoaring<WordType, IndexBits, DataBits>> {
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    using Word = WordType;
+    using BitmapSized = BitmapContainer<WordType, DataBits>;
+    static constexpr size_t WordsCount = BitmapSized::WordsCount;
+    static constexpr size_t EndKey = std::numeric_limits<size_t>::max();
+
+    /// @brief Materialize the result.
+    Bitmap evaluate() const {
+        using ContainersSized = BinsearchIndex<WordType, IndexBits, DataBits>;
+        using IndexType = can_fit_t<IndexBits>;
+        auto index = new ContainersSized();
+        for_each_block([&](size_t key, const WordType* words, const BitmapStats<WordType>& stats) {
+            if (index->size == index->capacity) {
+                index->expand();
+            }
+            CTy type = choose_container_type<WordType, DataBits>(stats.cardinality, stats.run_count);
+            index->containers[index->size++] =
+                ContainerHandle<IndexType>(make_container(words, stats, type), type, static_cast<IndexType>(key));
+        });
+        // Same shapes as the eager operators: nothing, a single container, or an index
+        if (index->size == 0) {
+            delete index;
+            return Bitmap();
+        }
+        if (index->size == 1) {
+            auto& only = index->containers[0];
+            Bitmap single(only.ptr, only.type, only.index);
+            index->size = 0;
+            delete index;
+            return single;
+        }
+        return Bitmap(index, CTy::Containers);
+    }
+
+    /// @brief Number of values in the result, without allocating any container.
+    size_t count() const {
+        Derived expr = static_cast<const Derived&>(*this);
+        expr.rewind();
+        auto scratch = make_scratch();
+        size_t n = 0;
+        for (size_t key = expr.next_key(0); key != EndKey; key = expr.next_key(key + 1)) {
+            size_t card;
+            if (expr.known_cardinality(key, card)) {
+                n += card;
+            } else if (const WordType* words = expr.words(key, scratch.data())) {
+                for (size_t i = 0; i < WordsCount; ++i) {
+                    n += std::popcount(words[i]);
+                }
+            }
+        }
+        return n;
+    }
+
+    /// @brief Write the result values ranked [offset, offset + n) to `out` in ascending order. Only the keys up to
+    /// the last value written are visited, and keys skipped by the offset are not evaluated when their cardinality is
+    /// known from the operands (e.g. a key only the left operand of a difference holds).
+    /// @return Number of values written.
+    size_t take_first(size_t n, WordType* out, size_t offset = 0) const {
+        Derived expr = static_cast<const Derived&>(*this);
+        expr.rewind();
+        auto scratch = make_scratch();
+        size_t written = 0;
+        for (size_t key = expr.next_key(0); key != EndKey && written < n; key = expr.next_key(key + 1)) {
+            size_t card;
+            if (offset != 0 && expr.known_cardinality(key, card) && card <= offset) {
+                offset -= card;
+                continue;
+            }
+            const WordType* words = expr.words(key, scratch.data());
+            if (!words) {
+                continue;
+            }
+            const WordType base = static_cast<WordType>(key) << DataBits;
+            for (size_t i = 0; i < WordsCount && written < n; ++i) {
+                WordType w = words[i];
+                if (offset != 0) {
+                    const size_t c = std::popcount(w);
+                    if (c <= offset) {
+                        offset -= c;
+                        continue;
+                    }
+                    for (; offset != 0; --offset) {
+                        w &= w - 1;
+                    }
+                }
+                for (; w != 0 && written < n; w &= w - 1) {
+                    out[written++] = base | static_cast<WordType>(i * BitmapSized::BitsPerWord + std::countr_zero(w));
+                }
+            }
+        }
+        return written;
+    }
+
+    operator Bitmap() const { return evaluate(); }
+
+private:
+    static std::vector<WordType> make_scratch() { return std::vector<WordType>(Derived::ScratchBlocks * WordsCount); }
+
+    /// @brief Call `fn(key, words, stats)` for every key with a non-empty result, in increasing key order.
+    template <typename Fn>
+    void for_each_block(Fn&& fn) const {
+        Derived expr = static_cast<const Derived&>(*this);
+        expr.rewind();
+        auto scratch = make_scratch();
+        for (size_t key = expr.next_key(0); key != EndKey; key = expr.next_key(key + 1)) {
+            const WordType* words = expr.words(key, scratch.data());
+            if (!words) {
+                continue;
+            }
+            BitmapStats<WordType> stats;
+            for (size_t i = 0; i < WordsCount; ++i) {
+                stats.add(words[i]);
+            }
+            if (stats.cardinality != 0) {
+                fn(key, words, stats);
+            }
+        }
+    }
+
+    static froaring_container_t* make_container(const WordType* words, const BitmapStats<WordType>& stats, CTy type) {
+        switch (type) {
+            case CTy::Array:
+                return words_to_array<WordType, DataBits>(words, stats.cardinality);
+            case CTy::RLE:
+                return words_to_rle<WordType, DataBits>(words, stats.run_count);
+            case CTy::Bitmap: {
+                auto c = new BitmapSized();
+                std::memcpy(c->words, words, sizeof(c->words));
+                c->rebuild_summary();
+                c->set_cardinality(stats.cardinality);
+                return c;
+            }
+            case CTy::Full:
+                return full_container();
+            case CTy::PackedArray: {
+                auto array = words_to_array<WordType, DataBits>(words, stats.cardinality);
+                auto packed = array_to_packed(array);
+                delete array;
+                return packed;
+            }
+            default:
+                FROARING_UNREACHABLE
+        }
+        return nullptr;
+    }
+};
+
+/// @brief A bitmap operand, borrowed.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+class LazyLeaf<FlexibleRoaring<WordType, IndexBits, DataBits>>
+    : public LazyExpression<LazyLeaf<FlexibleRoaring<WordType, IndexBits, DataBits>>,
+                            FlexibleRoaring<WordType, IndexBits, DataBits>> {
+    using Base = LazyExpression<LazyLeaf, FlexibleRoaring<WordType, IndexBits, DataBits>>;
+    using ContainerHandle = froaring::ContainerHandle<can_fit_t<IndexBits>>;
+
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    static constexpr size_t ScratchBlocks = 1;
+
+    explicit LazyLeaf(const Bitmap& bitmap) : bitmap(&bitmap) {}
+
+    void rewind() {
+        pos = 0;
+        if (!bitmap->is_inited()) {
+            handles = nullptr;
+            size = 0;
+        } else if (bitmap->handle.type == CTy::Containers) {
+            auto index = static_cast<const BinsearchIndex<WordType, IndexBits, DataBits>*>(bitmap->handle.ptr);
+            handles = index->containers;
+            size = index->size;
+        } else {
+            handles = &bitmap->handle;
+            size = 1;
+        }
+    }
+
+    size_t next_key(size_t key) {
+        while (pos < size && handles[pos].index < key) {
+            pos++;
+        }
+        return pos < size ? handles[pos].index : Base::EndKey;
+    }
+
+    bool known_cardinality(size_t key, size_t& card) {
+        card = 0;
+        if (next_key(key) == key) {
+            card = container_cardinality<WordType, DataBits>(handles[pos].ptr, handles[pos].type);
+        }
+        return true;
+    }
+
+    const WordType* words(size_t key, WordType* scratch) {
+        if (next_key(key) != key) {
+            return nullptr;
+        }
+        const ContainerHandle& c = handles[pos];
+        switch (c.type) {
+            case CTy::Bitmap:
+                return static_cast<const BitmapContainer<WordType, DataBits>*>(c.ptr)->words;
+            case CTy::Array:
+                array_to_words(static_cast<const ArrayContainer<WordType, DataBits>*>(c.ptr), scratch);
+                return scratch;
+            case CTy::RLE:
+                rle_to_words(static_cast<const RLEContainer<WordType, DataBits>*>(c.ptr), scratch);
+                return scratch;
+            case CTy::Full:
+                std::memset(scratch, 0xff, Base::WordsCount * sizeof(WordType));
+                return scratch;
+            case CTy::PackedArray:
+                packed_to_words(static_cast<const PackedArrayContainer<WordType, DataBits>*>(c.ptr), scratch);
+                return scratch;
+            case CTy::Cold:
+                cold_to_words(static_cast<const ColdContainer<WordType, DataBits>*>(c.ptr), scratch);
+                return scratch;
+            default:
+                FROARING_UNREACHABLE
+        }
+        return nullptr;
+    }
+
+private:
+    const Bitmap* bitmap;
+    const ContainerHandle* handles = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+};
+
+/// @brief `left & right`, `left | right` or `left - right`.
+template <LazyOp Op, typename Left, typename Right>
+class LazyNode : public LazyExpression<LazyNode<Op, Left, Right>, typename Left::Bitmap> {
+    using Base = LazyExpression<LazyNode, typename Left::Bitmap>;
+    using WordType = typename Base::Word;
+
+public:
+    using Bitmap = typename Left::Bitmap;
+    static_assert(std::is_same_v<Bitmap, typename Right::Bitmap>, "Operands must be of the same bitmap type");
+    /// The result goes to the first block; the right operand is evaluated past it, once the left one is done.
+    static constexpr size_t ScratchBlocks = std::max(Left::ScratchBlocks, 1 + Right::ScratchBlocks);
+
+    LazyNode(Left left, Right right) : left(std::move(left)), right(std::move(right)) {}
+
+    void rewind() {
+        left.rewind();
+        right.rewind();
+    }
+
+    size_t next_key(size_t key) {
+        if constexpr (Op == LazyOp::And) {
+            // Leapfrog until both sides agree
+            while (true) {
+                const size_t k = left.next_key(key);
+                if (k == Base::EndKey) {
+                    return k;
+                }
+                key = right.next_key(k);
+                if (key == k) {
+                    return k;
+                }
+            }
+        } else if constexpr (Op == LazyOp::Or) {
+            return std::min(left.next_key(key), right.next_key(key));
+        } else {
+            return left.next_key(key);
+        }
+    }
+
+    bool known_cardinality(size_t key, size_t& card) {
+        constexpr size_t Full = Base::WordsCount * 8 * sizeof(WordType);  // every value of a container
+        size_t l, r;
+        const bool left_known = left.known_cardinality(key, l);
+        const bool right_known = right.known_cardinality(key, r);
+        if constexpr (Op == LazyOp::And) {
+            // Known when one side is empty, or full: the result is the other side
+            card = 0;
+            if ((left_known && l == 0) || (right_known && r == 0)) {
+                return true;
+            }
+            if (left_known && l == Full) {
+                card = r;
+                return right_known;
+            }
+            card = l;
+            return right_known && r == Full && left_known;
+        } else if constexpr (Op == LazyOp::Or) {
+            // Known when one side is full, or empty: the result is the other side
+            if ((left_known && l == Full) || (right_known && r == Full)) {
+                card = Full;
+                return true;
+            }
+            if (left_known && l == 0) {
+                card = r;
+                return right_known;
+            }
+            card = l;
+            return right_known && r == 0 && left_known;
+        } else {
+            if ((left_known && l == 0) || (right_known && r == Full)) {
+                card = 0;
+                return true;
+            }
+            card = l;
+            return left_known && right_known && r == 0;
+        }
+    }
+
+    const WordType* words(size_t key, WordType* out) {
+        const WordType* a = left.words(key, out);
+        if (!a) {
+            if constexpr (Op == LazyOp::Or) {
+                return right.words(key, out);
+            }
+            return nullptr;
+        }
+        const WordType* b = right.words(key, out + Base::WordsCount);
+        if (!b) {
+            return Op == LazyOp::And ? nullptr : a;
+        }
+        for (size_t i = 0; i < Base::WordsCount; ++i) {
+            if constexpr (Op == LazyOp::And) {
+                out[i] = a[i] & b[i];
+            } else if constexpr (Op == LazyOp::Or) {
+                out[i] = a[i] | b[i];
+            } else {
+                out[i] = a[i] & ~b[i];
+            }
+        }
+        return out;
+    }
+
+private:
+    Left left;
+    Right right;
+};
+
+template <typename WordType, size_t IndexBits, size_t DataBits>
+LazyLeaf<FlexibleRoaring<WordType, IndexBits, DataBits>> lazy(const FlexibleRoaring<WordType, IndexBits, DataBits>& b) {
+    return LazyLeaf<FlexibleRoaring<WordType, IndexBits, DataBits>>(b);
+}
+template <typename WordType, size_t IndexBits, size_t DataBits>
+void lazy(FlexibleRoaring<WordType, IndexBits, DataBits>&&) = delete;
+
+namespace detail {
+/// A formula operand as stored in a node: formulas by value, bitmaps wrapped into leaves.
+template <typename T>
+auto as_lazy(const T& x) {
+    if constexpr (is_lazy_expression<T>::value) {
+        return x;
+    } else {
+        return lazy(x);
+    }
+}
+}  // namespace detail
+
+/// Enabled when at least one side is a formula, so that `Bitmap & Bitmap` keeps its eager meaning.
+template <typename L, typename R>
+concept LazyOperands =
+    is_lazy_expression<std::remove_cvref_t<L>>::value || is_lazy_expression<std::remove_cvref_t<R>>::value;
+
+template <typename L, typename R>
+    requires LazyOperands<L, R>
+auto operator&(const L& l, const R& r) {
+    return LazyNode<LazyOp::And, decltype(detail::as_lazy(l)), decltype(detail::as_lazy(r))>(detail::as_lazy(l),
+                                                                                           detail::as_lazy(r));
+}
+template <typename L, typename R>
+    requires LazyOperands<L, R>
+auto operator|(const L& l, const R& r) {
+    return LazyNode<LazyOp::Or, decltype(detail::as_lazy(l)), decltype(detail::as_lazy(r))>(detail::as_lazy(l),
+                                                                                          detail::as_lazy(r));
+}
+template <typename L, typename R>
+    requires LazyOperands<L, R>
+auto operator-(const L& l, const R& r) {
+    return LazyNode<LazyOp::AndNot, decltype(detail::as_lazy(l)), decltype(detail::as_lazy(r))>(detail::as_lazy(l),
+                                                                                              detail::as_lazy(r));
+}
+
+/// @brief LIMIT / OFFSET over `a & b`: write the values ranked [offset, offset + n) to `out` in ascending order,
+/// merging keys only up to the last value written instead of computing the whole intersection.
+/// @return Number of values written.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+size_t and_first_n(const FlexibleRoaring<WordType, IndexBits, DataBits>& a,
+                   const FlexibleRoaring<WordType, IndexBits, DataBits>& b, size_t n, WordType* out,
+                   size_t offset = 0) {
+    return (lazy(a) & b).take_first(n, out, offset);
+}
+
+/// @brief LIMIT / OFFSET over `a | b`. Keys held by one side only are skipped by the offset without being read.
+/// @return Number of values written.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+size_t or_first_n(const FlexibleRoaring<WordType, IndexBits, DataBits>& a,
+                  const FlexibleRoaring<WordType, IndexBits, DataBits>& b, size_t n, WordType* out, size_t offset = 0) {
+    return (lazy(a) | b).take_first(n, out, offset);
+}
+
+/// @brief LIMIT / OFFSET over `a - b`. Keys of `a` absent from `b` are skipped by the offset without being read.
+/// @return Number of values written.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+size_t andnot_first_n(const FlexibleRoaring<WordType, IndexBits, DataBits>& a,
+                      const FlexibleRoaring<WordType, IndexBits, DataBits>& b, size_t n, WordType* out,
+                      size_t offset = 0) {
+    return (lazy(a) - b).take_first(n, out, offset);
+}
+}  // namespace froaring
@@ -0,0 +1,627 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "binsearch_index.h"
+#include "froaring.h"
+
+namespace froaring {
+template <typename Child, size_t HighBits>
+class MultiLevelIndexIterator;
+
+/// @brief An index layer whose containers are child index layers (`ContainerType::Containers`), keyed by the
+/// `HighBits` bits above the values of the child.
+///
+/// Nesting layers forms a radix tree, like the 64-bit roaring treemaps: a sparse 64-bit id space keeps one short key
+/// array per populated prefix instead of a single flat array with an entry per container. For instance,
+/// `MultiLevelIndex<MultiLevelIndex<BinsearchIndex<uint64_t, 16, 8>, 20>, 20>` holds any 64-bit value.
+///
+/// Set operations merge the keys of a layer and recurse into the children sharing a key. A child is never left
+/// empty: it is released as soon as its last value goes away. `MultiLevelRoaring` wraps a layer into a bitmap with the
+/// interface of FlexibleRoaring.
+/// @tparam Child The layer below: a `BinsearchIndex`, or another `MultiLevelIndex`.
+/// @tparam HighBits High bits of a value used as the key of this layer.
+template <typename Child, size_t HighBits>
+class MultiLevelIndex : public froaring_indices_t {
+public:
+    static constexpr size_t ValueBits = HighBits + Child::ValueBits;
+    static_assert(ValueBits <= 64, "HighBits + the value bits of the child must not exceed 64.");
+
+    using IndexType = froaring::can_fit_t<HighBits>;
+    using SizeType = froaring::can_fit_t<HighBits + 1>;
+    using ValueType = froaring::can_fit_t<ValueBits>;
+    using ChildValueType = typename Child::ValueType;
+    using CTy = froaring::ContainerType;
+    using ContainerHandle = froaring::ContainerHandle<IndexType>;
+    /// A layer never holds more children than there are distinct keys.
+    static constexpr size_t MaxContainers = size_t(1) << HighBits;
+
+    friend MultiLevelIndexIterator<Child, HighBits>;
+
+public:
+    explicit MultiLevelIndex(SizeType size = 0, SizeType capacity = CONTAINERS_INIT_CAPACITY)
+        : size(size),
+          capacity(std::max({capacity, size, SizeType(1)})),
+          containers(static_cast<ContainerHandle*>(malloc(this->capacity * sizeof(ContainerHandle)))) {
+        assert(containers && "Failed to allocate memory for containers");
+        FROARING_COUNT(Alloc);
+    }
+
+    explicit MultiLevelIndex(const MultiLevelIndex& other) : MultiLevelIndex(0, std::max(other.size, SizeType(1))) {
+        for (SizeType i = 0; i < other.size; ++i) {
+            containers[i] = ContainerHandle(new Child(*child(other.containers[i])), CTy::Containers,
+                                            other.containers[i].index);
+        }
+        size = other.size;
+    }
+
+    explicit MultiLevelIndex(MultiLevelIndex&& other)
+        : size(std::move(other.size)), capacity(std::move(other.capacity)), containers(std::move(other.containers)) {
+        other.size = 0;
+        other.capacity = 0;
+        other.containers = nullptr;
+    }
+
+    ~MultiLevelIndex() {
+        for (SizeType i = 0; i < size; ++i) {
+            delete child(containers[i]);
+        }
+        free(containers);
+    }
+
+    /// Return the entry position if found. Otherwise the first position that is greater than `index`.
+    SizeType lower_bound(IndexType index) const {
+        return branchless_lower_bound(containers, size, index, [](const ContainerHandle& c) { return c.index; });
+    }
+
+    bool test(ValueType value) const {
+        const SizeType pos = lower_bound(high(value));
+        return pos < size && containers[pos].index == high(value) && child(containers[pos])->test(low(value));
+    }
+
+    void set(ValueType value) { find_or_insert(high(value))->set(low(value)); }
+
+    bool test_and_set(ValueType value) { return find_or_insert(high(value))->test_and_set(low(value)); }
+
+    void reset(ValueType value) {
+        const SizeType pos = lower_bound(high(value));
+        if (pos == size || containers[pos].index != high(value)) {
+            return;
+        }
+        Child* c = child(containers[pos]);
+        c->reset(low(value));
+        if (c->size == 0) {
+            delete c;
+            std::memmove(&containers[pos], &containers[pos + 1], (size - pos - 1) * sizeof(ContainerHandle));
+            size--;
+        }
+    }
+
+    size_t cardinality() const {
+        size_t total = 0;
+        for (SizeType i = 0; i < size; ++i) {
+            total += child(containers[i])->cardinality();
+        }
+        return total;
+    }
+
+    /// @brief The smallest value, or the largest ValueType if there is none.
+    ValueType minimum() const {
+        return size == 0 ? std::numeric_limits<ValueType>::max()
+                         : join(containers[0].index, child(containers[0])->minimum());
+    }
+
+    /// @brief The largest value, or 0 if there is none.
+    ValueType maximum() const {
+        return size == 0 ? 0 : join(containers[size - 1].index, child(containers[size - 1])->maximum());
+    }
+
+    void clear() {
+        for (SizeType i = 0; i < size; ++i) {
+            delete child(containers[i]);
+        }
+        size = 0;
+    }
+
+    /// @brief Optimize every child, and drop the children left empty.
+    void run_optimize() {
+        SizeType new_container_counts = 0;
+        for (SizeType i = 0; i < size; ++i) {
+            Child* c = child(containers[i]);
+            c->run_optimize();
+            if (c->size == 0) {
+                delete c;
+            } else {
+                containers[new_container_counts++] = std::move(containers[i]);
+            }
+        }
+        size = new_container_counts;
+    }
+
+    /// @brief Compress the containers of every child (see `BinsearchIndex::compact_cold`).
+    void compact_cold() {
+        for (SizeType i = 0; i < size; ++i) {
+            child(containers[i])->compact_cold();
+        }
+    }
+
+    /// @brief Bytes allocated for this layer and all of the layers below.
+    size_t memory_usage() const {
+        size_t bytes = sizeof(*this) + capacity * sizeof(ContainerHandle);
+        for (SizeType i = 0; i < size; ++i) {
+            bytes += child(containers[i])->memory_usage();
+        }
+        return bytes;
+    }
+
+    static MultiLevelIndex* and_(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        auto result = new MultiLevelIndex(0, std::min(a->size, b->size));
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        while (i < a->size && j < b->size) {
+            auto keya = a->containers[i].index;
+            auto keyb = b->containers[j].index;
+            if (keya < keyb) {
+                i = a->advanceUntil(keyb, i);
+            } else if (keya > keyb) {
+                j = b->advanceUntil(keya, j);
+            } else {
+                auto c = Child::and_(child(a->containers[i]), child(b->containers[j]));
+                result->push_nonempty(new_container_counts, c, keya);
+                i++;
+                j++;
+            }
+        }
+        result->size = new_container_counts;
+        return result;
+    }
+
+    static MultiLevelIndex* or_(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        // The sum may not fit in SizeType (e.g. 2^HighBits + 2^HighBits): widen it, then clamp
+        const size_t merged_capacity = std::min(static_cast<size_t>(a->size) + b->size, MaxContainers);
+        auto result = new MultiLevelIndex(0, static_cast<SizeType>(merged_capacity));
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        while (i < a->size || j < b->size) {
+            if (j == b->size || (i < a->size && a->containers[i].index < b->containers[j].index)) {
+                result->containers[new_container_counts++] = duplicate(a->containers[i++]);
+            } else if (i == a->size || a->containers[i].index > b->containers[j].index) {
+                result->containers[new_container_counts++] = duplicate(b->containers[j++]);
+            } else {
+                auto c = Child::or_(child(a->containers[i]), child(b->containers[j]));
+                auto key = a->containers[i].index;
+                result->containers[new_container_counts++] = ContainerHandle(c, CTy::Containers, key);
+                i++;
+                j++;
+            }
+        }
+        result->size = new_container_counts;
+        return result;
+    }
+
+    static MultiLevelIndex* diff(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        auto result = new MultiLevelIndex(0, a->size);
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        for (; i < a->size; ++i) {
+            auto keya = a->containers[i].index;
+            j = b->advanceUntil(keya, j);
+            if (j == b->size || b->containers[j].index != keya) {  // nothing to subtract
+                result->containers[new_container_counts++] = duplicate(a->containers[i]);
+            } else {
+                auto c = Child::diff(child(a->containers[i]), child(b->containers[j]));
+                result->push_nonempty(new_container_counts, c, keya);
+            }
+        }
+        result->size = new_container_counts;
+        return result;
+    }
+
+    static void andi(MultiLevelIndex* a, const MultiLevelIndex* b) {
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        for (; i < a->size; ++i) {
+            auto keya = a->containers[i].index;
+            j = b->advanceUntil(keya, j);
+            Child* c = child(a->containers[i]);
+            if (j < b->size && b->containers[j].index == keya) {
+                Child::andi(c, child(b->containers[j]));
+                if (c->size != 0) {
+                    a->containers[new_container_counts++] = std::move(a->containers[i]);
+                    continue;
+                }
+            }
+            delete c;
+        }
+        a->size = new_container_counts;
+    }
+
+    static void ori(MultiLevelIndex* a, const MultiLevelIndex* b) {
+        if (b->size == 0) {
+            return;
+        }
+        // Merge into a new handle array: the children of `a` move over, the ones only in `b` are copied.
+        const size_t merged_capacity = std::min(static_cast<size_t>(a->size) + b->size, MaxContainers);
+        auto merged = static_cast<ContainerHandle*>(malloc(merged_capacity * sizeof(ContainerHandle)));
+        assert(merged && "Failed to allocate memory for containers");
+        FROARING_COUNT(Alloc);
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        while (i < a->size || j < b->size) {
+            if (j == b->size || (i < a->size && a->containers[i].index < b->containers[j].index)) {
+                merged[new_container_counts++] = std::move(a->containers[i++]);
+            } else if (i == a->size || a->containers[i].index > b->containers[j].index) {
+                merged[new_container_counts++] = duplicate(b->containers[j++]);
+            } else {
+                Child::ori(child(a->containers[i]), child(b->containers[j]));
+                merged[new_container_counts++] = std::move(a->containers[i]);
+                i++;
+                j++;
+            }
+        }
+        free(a->containers);
+        a->containers = merged;
+        a->capacity = merged_capacity;
+        a->size = new_container_counts;
+    }
+
+    static void diffi(MultiLevelIndex* a, const MultiLevelIndex* b) {
+        SizeType i = 0, j = 0;
+        SizeType new_container_counts = 0;
+        for (; i < a->size; ++i) {
+            auto keya = a->containers[i].index;
+            j = b->advanceUntil(keya, j);
+            Child* c = child(a->containers[i]);
+            if (j < b->size && b->containers[j].index == keya) {
+                Child::diffi(c, child(b->containers[j]));
+                if (c->size == 0) {
+                    delete c;
+                    continue;
+                }
+            }
+            a->containers[new_container_counts++] = std::move(a->containers[i]);
+        }
+        a->size = new_container_counts;
+    }
+
+    static bool intersects(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        SizeType i = 0, j = 0;
+        while (i < a->size && j < b->size) {
+            auto keya = a->containers[i].index;
+            auto keyb = b->containers[j].index;
+            if (keya < keyb) {
+                i = a->advanceUntil(keyb, i);
+            } else if (keya > keyb) {
+                j = b->advanceUntil(keya, j);
+            } else {
+                if (Child::intersects(child(a->containers[i]), child(b->containers[j]))) {
+                    return true;
+                }
+                i++;
+                j++;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Whether every value of `b` is in `a`.
+    static bool contains(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        SizeType i = 0;
+        for (SizeType j = 0; j < b->size; ++j) {
+            i = a->advanceUntil(b->containers[j].index, i);
+            if (i == a->size || a->containers[i].index != b->containers[j].index ||
+                !Child::contains(child(a->containers[i]), child(b->containers[j]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool equals(const MultiLevelIndex* a, const MultiLevelIndex* b) {
+        if (a->size != b->size) {
+            return false;
+        }
+        for (SizeType i = 0; i < a->size; ++i) {  // quick check
+            if (a->containers[i].index != b->containers[i].index) {
+                return false;
+            }
+        }
+        for (SizeType i = 0; i < a->size; ++i) {
+            if (!Child::equals(child(a->containers[i]), child(b->containers[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SizeType advanceUntil(IndexType key, SizeType pos) const {
+        while (pos < size && containers[pos].index < key) {
+            pos++;
+        }
+        return pos;
+    }
+
+    void expand() { expand_to(2 * capacity); }
+
+    void expand_to(size_t new_cap) {
+        new_cap = std::min(new_cap, MaxContainers);
+        containers = static_cast<ContainerHandle*>(realloc(containers, new_cap * sizeof(ContainerHandle)));
+        assert(containers && "Failed to reallocate memory for containers");
+        FROARING_COUNT(Realloc);
+        this->capacity = new_cap;
+    }
+
+public:
+    // One bit wider than IndexType: a full layer holds 2^HighBits children
+    SizeType size = 0;
+    SizeType capacity = 0;
+    ContainerHandle* containers = nullptr;
+
+private:
+    static IndexType high(ValueType value) { return static_cast<IndexType>(value >> Child::ValueBits); }
+    static ValueType join(IndexType key, ChildValueType low) {
+        return static_cast<ValueType>(ValueType(key) << Child::ValueBits | low);
+    }
+    static ChildValueType low(ValueType value) {
+        return static_cast<ChildValueType>(value & ((ValueType(1) << Child::ValueBits) - 1));
+    }
+
+    static Child* child(const ContainerHandle& handle) {
+        assert(handle.type == CTy::Containers && "A multi-level index only holds index layers");
+        return static_cast<Child*>(handle.ptr);
+    }
+
+    static ContainerHandle duplicate(const ContainerHandle& handle) {
+        return ContainerHandle(new Child(*child(handle)), CTy::Containers, handle.index);
+    }
+
+    /// @brief Append `c` under `key` unless it is empty, in which case it is released.
+    void push_nonempty(SizeType& pos, Child* c, IndexType key) {
+        if (c->size == 0) {
+            delete c;
+        } else {
+            containers[pos++] = ContainerHandle(c, CTy::Containers, key);
+        }
+    }
+
+    /// @brief The child for `key`, created empty if missing.
+    Child* find_or_insert(IndexType key) {
+        const SizeType pos = lower_bound(key);
+        if (pos < size && containers[pos].index == key) {
+            return child(containers[pos]);
+        }
+        if (size == capacity) {
+            expand();
+        }
+        FROARING_COUNT(Memmove);
+        FROARING_COUNT_N(MemmoveBytes, (size - pos) * sizeof(ContainerHandle));
+        std::memmove(&containers[pos + 1], &containers[pos], (size - pos) * sizeof(ContainerHandle));
+        auto c = new Child();
+        containers[pos] = ContainerHandle(c, CTy::Containers, key);
+        size++;
+        return c;
+    }
+};
+
+/// @brief The iterator over the values of an index layer: `FlexibleRoaringIterator` for a `BinsearchIndex`,
+/// `MultiLevelIndexIterator` for a `MultiLevelIndex`.
+template <typename Layer>
+struct LayerIterator;
+
+template <typename WordType, size_t IndexBits, size_t DataBits>
+struct LayerIterator<BinsearchIndex<WordType, IndexBits, DataBits>> {
+    using type = FlexibleRoaringIterator<WordType, IndexBits, DataBits>;
+};
+
+template <typename Child, size_t HighBits>
+struct LayerIterator<MultiLevelIndex<Child, HighBits>> {
+    using type = MultiLevelIndexIterator<Child, HighBits>;
+};
+
+/// @brief Forward iterator over the values of a MultiLevelIndex, in increasing order: walks the children in key order
+/// with an iterator of the layer below. The index must not be modified while it is iterated.
+template <typename Child, size_t HighBits>
+class MultiLevelIndexIterator {
+    using Layer = MultiLevelIndex<Child, HighBits>;
+    using ChildIterator = typename LayerIterator<Child>::type;
+
+public:
+    using ValueType = typename Layer::ValueType;
+
+    /// @brief Positioned on the first value of the `pos`-th child, or at the end if there is none.
+    explicit MultiLevelIndexIterator(const Layer& layer, size_t pos) : layer(&layer) { seek_child(pos); }
+
+    static MultiLevelIndexIterator begin(const Layer& layer) { return MultiLevelIndexIterator(layer, 0); }
+    static MultiLevelIndexIterator end(const Layer& layer) { return MultiLevelIndexIterator(layer, layer.size); }
+
+    bool operator==(const MultiLevelIndexIterator& o) const {
+        return pos == o.pos && (pos == layer->size || *child_it == *o.child_it);
+    }
+
+    bool operator!=(const MultiLevelIndexIterator& o) const { return !(*this == o); }
+
+    // ++i
+    MultiLevelIndexIterator& operator++() {
+        if (++*child_it == *child_end) {
+            seek_child(pos + 1);
+        }
+        return *this;
+    }
+
+    ValueType operator*() const { return Layer::join(layer->containers[pos].index, **child_it); }
+
+private:
+    /// @brief Move to the first value of the first non-empty child at or after position `from`.
+    void seek_child(size_t from) {
+        for (pos = from; pos < layer->size; ++pos) {
+            const Child& c = *Layer::child(layer->containers[pos]);
+            child_it.emplace(ChildIterator::begin(c));
+            child_end.emplace(ChildIterator::end(c));
+            if (*child_it != *child_end) {
+                return;
+            }
+        }
+        pos = layer->size;
+        child_it.reset();
+        child_end.reset();
+    }
+
+    const Layer* layer;
+    /// Position of the current child in `layer->containers`, or `layer->size` at the end.
+    size_t pos = 0;
+    /// Over the current child; empty at the end.
+    std::optional<ChildIterator> child_it;
+    std::optional<ChildIterator> child_end;
+};
+
+/// @brief A bitmap of the values of a `MultiLevelIndex`, with the interface of FlexibleRoaring: point updates and
+/// queries, set operators and iteration in increasing order. No layer is allocated until a value is set.
+/// @tparam Index The top layer.
+template <typename Index>
+class MultiLevelRoaring {
+public:
+    using ValueType = typename Index::ValueType;
+    using iterator = typename LayerIterator<Index>::type;
+    using const_iterator = const iterator;
+
+    MultiLevelRoaring() = default;
+    MultiLevelRoaring(const MultiLevelRoaring& other) : index(other.index ? new Index(*other.index) : nullptr) {}
+    MultiLevelRoaring(MultiLevelRoaring&& other) noexcept : index(std::exchange(other.index, nullptr)) {}
+    ~MultiLevelRoaring() { delete index; }
+
+    MultiLevelRoaring& operator=(const MultiLevelRoaring& other) {
+        if (this != &other) {
+            delete index;
+            index = other.index ? new Index(*other.index) : nullptr;
+        }
+        return *this;
+    }
+
+    MultiLevelRoaring& operator=(MultiLevelRoaring&& other) noexcept {
+        if (this != &other) {
+            delete index;
+            index = std::exchange(other.index, nullptr);
+        }
+        return *this;
+    }
+
+    void set(ValueType value) { mutable_layer().set(value); }
+
+    /// @return Whether `value` was newly set.
+    bool test_and_set(ValueType value) { return mutable_layer().test_and_set(value); }
+
+    void reset(ValueType value) {
+        if (index) {
+            index->reset(value);
+        }
+    }
+
+    bool test(ValueType value) const { return layer().test(value); }
+
+    size_t count() const { return layer().cardinality(); }
+
+    void clear() {
+        if (index) {
+            index->clear();
+        }
+    }
+
+    /// @brief The smallest element, or the largest ValueType if the bitmap is empty.
+    ValueType minimum() const { return layer().minimum(); }
+
+    /// @brief The largest element, or 0 if the bitmap is empty.
+    ValueType maximum() const { return layer().maximum(); }
+
+    MultiLevelRoaring& run_optimize() {
+        if (index) {
+            index->run_optimize();
+        }
+        return *this;
+    }
+
+    MultiLevelRoaring& compact_cold() {
+        if (index) {
+            index->compact_cold();
+        }
+        return *this;
+    }
+
+    /// @brief Bytes allocated for this bitmap, including unused capacity.
+    size_t memory_usage() const { return sizeof(*this) + (index ? index->memory_usage() : 0); }
+
+    const_iterator begin() const { return iterator::begin(layer()); }
+
+    const_iterator end() const { return iterator::end(layer()); }
+
+    bool operator==(const MultiLevelRoaring& other) const { return Index::equals(&layer(), &other.layer()); }
+
+    bool operator!=(const MultiLevelRoaring& other) const { return !(*this == other); }
+
+    bool intersects(const MultiLevelRoaring& other) const { return Index::intersects(&layer(), &other.layer()); }
+
+    /// @brief Whether every value of `other` is in this bitmap.
+    bool contains(const MultiLevelRoaring& other) const { return Index::contains(&layer(), &other.layer()); }
+
+    MultiLevelRoaring operator&(const MultiLevelRoaring& other) const {
+        return MultiLevelRoaring(Index::and_(&layer(), &other.layer()));
+    }
+
+    MultiLevelRoaring& operator&=(const MultiLevelRoaring& other) {
+        if (index && this != &other) {
+            Index::andi(index, &other.layer());
+        }
+        return *this;
+    }
+
+    MultiLevelRoaring operator|(const MultiLevelRoaring& other) const {
+        return MultiLevelRoaring(Index::or_(&layer(), &other.layer()));
+    }
+
+    MultiLevelRoaring& operator|=(const MultiLevelRoaring& other) {
+        if (this != &other) {
+            Index::ori(&mutable_layer(), &other.layer());
+        }
+        return *this;
+    }
+
+    MultiLevelRoaring operator-(const MultiLevelRoaring& other) const {
+        return MultiLevelRoaring(Index::diff(&layer(), &other.layer()));
+    }
+
+    MultiLevelRoaring& operator-=(const MultiLevelRoaring& other) {
+        if (this == &other) {
+            clear();
+        } else if (index) {
+            Index::diffi(index, &other.layer());
+        }
+        return *this;
+    }
+
+private:
+    explicit MultiLevelRoaring(Index* index) : index(index) {}
+
+    /// @brief The top layer, or a shared empty one if none has been allocated yet.
+    const Index& layer() const {
+        static const Index empty;
+        return index ? *index : empty;
+    }
+
+    Index& mutable_layer() {
+        if (!index) {
+            index = new Index();
+        }
+        return *index;
+    }
+
+    Index* index = nullptr;
+};
+
+/// Any 64-bit value: two layers of 20 high bits above a BinsearchIndex of 16-bit keys and 8-bit containers.
+using FlexibleRoaring64 =
+    MultiLevelRoaring<MultiLevelIndex<MultiLevelIndex<BinsearchIndex<uint64_t, 16, 8>, 20>, 20>>;
+}  // namespace froaring
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "froaring.h"
+
+namespace froaring {
+template <typename Bitmap>
+class Query;
+
+/// @brief A boolean expression (AND / OR / ANDNOT / XOR) over FlexibleRoaring leaves, evaluated by a small planner.
+///
+/// Build it from leaves with `& | - ^`: `(Query(a) | b) & c - d`. Chains of the same operator are flattened into one
+/// n-ary node. Leaves are not copied: the bitmaps must outlive the query, and binding a temporary is rejected.
+///
+/// Evaluation plans each node instead of folding left to right:
+/// - The terms of a conjunction (including the first operand of nested ANDNOTs) are intersected smallest estimate
+///   first, and evaluation stops as soon as the running result is empty.
+/// - All subtrahends of a conjunction are applied after the intersections, largest first.
+/// - Only one temporary is created per node. It is updated with `&=`, `|=` and `-=`, and temporaries produced by
+///   children are reused rather than copied.
+/// - `is_empty()` answers with `intersects()` where it can, without materializing the last intersection.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+class Query<FlexibleRoaring<WordType, IndexBits, DataBits>> {
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+
+    enum class Op : uint8_t { Leaf, And, Or, AndNot, Xor };
+
+    Query(const Bitmap& bitmap) : op(Op::Leaf), bitmap(&bitmap) {}
+    Query(Bitmap&&) = delete;
+
+    friend Query operator&(Query a, Query b) { return combine(Op::And, std::move(a), std::move(b)); }
+    friend Query operator|(Query a, Query b) { return combine(Op::Or, std::move(a), std::move(b)); }
+    friend Query operator^(Query a, Query b) { return combine(Op::Xor, std::move(a), std::move(b)); }
+    /// ANDNOT: `a - b - c` is one node, the first child minus all the others.
+    friend Query operator-(Query a, Query b) {
+        if (a.op == Op::AndNot) {
+            a.children.push_back(std::move(b));
+            return a;
+        }
+        return Query(Op::AndNot, {std::move(a), std::move(b)});
+    }
+
+    Op kind() const { return op; }
+
+    /// @brief An upper bound of the result cardinality, from the leaf cardinalities.
+    size_t estimate() const {
+        switch (op) {
+            case Op::Leaf:
+                return bitmap->count();
+            case Op::And: {
+                size_t e = children[0].estimate();
+                for (size_t i = 1; i < children.size() && e != 0; ++i) {
+                    e = std::min(e, children[i].estimate());
+                }
+                return e;
+            }
+            case Op::AndNot:
+                return children[0].estimate();
+            case Op::Or:
+            case Op::Xor: {
+                size_t e = 0;
+                for (const auto& c : children) {
+                    e += c.estimate();
+                }
+                return e;
+            }
+            default:
+                FROARING_UNREACHABLE
+        }
+        return 0;
+    }
+
+    Bitmap evaluate() const { return take(operand(*this)); }
+
+    /// @brief Whether the result is empty, computed without materializing it where possible.
+    bool is_empty() const {
+        switch (op) {
+            case Op::Leaf:
+                return bitmap->count() == 0;
+            case Op::Or:
+                return std::all_of(children.begin(), children.end(), [](const Query& c) { return c.is_empty(); });
+            case Op::And:
+            case Op::AndNot: {
+                Terms terms;
+                collect(*this, terms);
+                if (!terms.negatives.empty() || terms.positives.size() < 2) {
+                    break;
+                }
+                sort_by_estimate(terms.positives);
+                if (terms.positives.front().second == 0) {
+                    return true;
+                }
+                // Intersect all but the largest term, then only ask whether the largest one meets that
+                const Query& last = *terms.positives.back().first;
+                terms.positives.pop_back();
+                Operand rest = terms.positives.size() == 1 ? operand(*terms.positives.front().first)
+                                                           : Operand{nullptr, conjunction(std::move(terms))};
+                return !rest.get().intersects(operand(last).get());
+            }
+            default:
+                break;
+        }
+        return evaluate().count() == 0;
+    }
+
+private:
+    /// @brief An intermediate result: either a leaf bitmap, borrowed, or a temporary owned by the planner.
+    struct Operand {
+        const Bitmap* borrowed;
+        Bitmap owned;
+
+        const Bitmap& get() const { return borrowed ? *borrowed : owned; }
+    };
+
+    /// @brief The flattened terms of a conjunction, with their estimates: the result is
+    /// `positives[0] & ... & positives[n-1] - negatives[0] - ... - negatives[m-1]`.
+    struct Terms {
+        std::vector<std::pair<const Query*, size_t>> positives;
+        std::vector<std::pair<const Query*, size_t>> negatives;
+    };
+
+    Query(Op op, std::vector<Query> children) : op(op), bitmap(nullptr), children(std::move(children)) {}
+
+    static Query combine(Op op, Query a, Query b) {
+        std::vector<Query> children;
+        for (Query* q : {&a, &b}) {
+            if (q->op == op) {
+                for (auto& c : q->children) {
+                    children.push_back(std::move(c));
+                }
+            } else {
+                children.push_back(std::move(*q));
+            }
+        }
+        return Query(op, std::move(children));
+    }
+
+    static void collect(const Query& q, Terms& terms) {
+        if (q.op == Op::And) {
+            for (const auto& c : q.children) {
+                collect(c, terms);
+            }
+        } else if (q.op == Op::AndNot) {
+            collect(q.children[0], terms);
+            for (size_t i = 1; i < q.children.size(); ++i) {
+                terms.negatives.emplace_back(&q.children[i], q.children[i].estimate());
+            }
+        } else {
+            terms.positives.emplace_back(&q, q.estimate());
+        }
+    }
+
+    static void sort_by_estimate(std::vector<std::pair<const Query*, size_t>>& terms) {
+        std::stable_sort(terms.begin(), terms.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    }
+
+    /// @brief A bitmap that may be modified in place: the temporary itself, or a copy-on-write copy of a leaf.
+    static Bitmap take(Operand&& o) { return o.borrowed ? o.borrowed->snapshot() : std::move(o.owned); }
+
+    static Operand operand(const Query& q) {
+        switch (q.op) {
+            case Op::Leaf:
+                return Operand{q.bitmap, Bitmap()};
+            case Op::And:
+            case Op::AndNot: {
+                Terms terms;
+                collect(q, terms);
+                return Operand{nullptr, conjunction(std::move(terms))};
+            }
+            case Op::Or:
+                return Operand{nullptr, disjunction(q.children)};
+            case Op::Xor:
+                return Operand{nullptr, symmetric_difference(q.children)};
+            default:
+                FROARING_UNREACHABLE
+        }
+        return Operand{nullptr, Bitmap()};
+    }
+
+    static Bitmap conjunction(Terms terms) {
+        assert(!terms.positives.empty());
+        sort_by_estimate(terms.positives);
+        if (terms.positives.front().second == 0) {
+            return Bitmap();
+        }
+        Operand first = operand(*terms.positives.front().first);
+        Bitmap acc;
+        size_t i = 1;
+        if (first.borrowed && terms.positives.size() > 1) {
+            // Two leaves: one out-of-place intersection instead of a copy and an in-place one
+            acc = first.get() & operand(*terms.positives[1].first).get();
+            ++i;
+        } else {
+            acc = take(std::move(first));
+        }
+        for (; i < terms.positives.size() && acc.count() != 0; ++i) {
+            acc &= operand(*terms.positives[i].first).get();
+        }
+        // Subtract the largest first, the later ones then work on a smaller result
+        std::stable_sort(terms.negatives.begin(), terms.negatives.end(),
+                         [](const auto& a, const auto& b) { return a.second > b.second; });
+        for (const auto& [negative, estimate] : terms.negatives) {
+            if (acc.count() == 0) {
+                break;
+            }
+            if (estimate != 0) {
+                acc -= operand(*negative).get();
+            }
+        }
+        return acc;
+    }
+
+    static Bitmap disjunction(const std::vector<Query>& children) {
+        std::vector<Operand> operands;
+        operands.reserve(children.size());
+        for (const auto& c : children) {
+            if (c.estimate() != 0) {
+                operands.push_back(operand(c));
+            }
+        }
+        if (operands.empty()) {
+            return Bitmap();
+        }
+        // Accumulate into a temporary when a child produced one
+        auto owned = std::find_if(operands.begin(), operands.end(), [](const Operand& o) { return !o.borrowed; });
+        std::iter_swap(operands.begin(), owned == operands.end() ? operands.begin() : owned);
+        Bitmap acc;
+        size_t i = 1;
+        if (operands[0].borrowed && operands.size() > 1) {
+            acc = operands[0].get() | operands[1].get();
+            ++i;
+        } else {
+            acc = take(std::move(operands[0]));
+        }
+        for (; i < operands.size(); ++i) {
+            acc |= operands[i].get();
+        }
+        return acc;
+    }
+
+    /// XOR has no kernel: `acc ^ x` is computed as `(acc - x) | (x - acc)`.
+    static Bitmap symmetric_difference(const std::vector<Query>& children) {
+        Bitmap acc = take(operand(children[0]));
+        for (size_t i = 1; i < children.size(); ++i) {
+            Operand x = operand(children[i]);
+            Bitmap only_x = x.get() - acc;
+            acc -= x.get();
+            acc |= only_x;
+        }
+        return acc;
+    }
+
+    Op op;
+    const Bitmap* bitmap;  ///< The leaf, for `Op::Leaf`
+    std::vector<Query> children;
+};
+}  // namespace froaring
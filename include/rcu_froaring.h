@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "froaring.h"
+
+namespace froaring {
+/// @brief A FlexibleRoaring for read-mostly workloads, published RCU-style.
+///
+/// The current version is an immutable FlexibleRoaring behind an atomic pointer. A writer copies it with
+/// `FlexibleRoaring::snapshot` (containers are shared copy-on-write, so only the containers it touches get cloned),
+/// applies its changes, and swaps the new version in. Readers only announce the epoch they read in, with a plain atomic
+/// store to their own slot: no locks and no read-modify-write operations on the read path. A replaced version is
+/// freed once every reader that may still see it has left its read section (epoch-based reclamation).
+///
+/// Usage: each reader thread registers once with `reader()`, then opens short read sections with `Reader::read()`.
+/// Writers call `update` (or `publish`); they are serialized by a mutex.
+/// @tparam MaxReaders Number of reader slots. `reader()` waits for a free slot when all of them are taken.
+template <typename WordType = uint64_t, size_t IndexBits = 16, size_t DataBits = 8, size_t MaxReaders = 64>
+class RcuFlexibleRoaring {
+    static constexpr uint64_t Quiescent = 0;
+
+    /// One reader per slot, each slot on its own cache line so that readers do not false-share.
+    struct alignas(64) Slot {
+        /// The epoch announced by the reader's open read section, or `Quiescent`.
+        std::atomic<uint64_t> epoch{Quiescent};
+        std::atomic<bool> claimed{false};
+    };
+
+public:
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+
+    class ReadGuard;
+
+    /// @brief A registered reader slot, owned by one thread at a time.
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept : owner(other.owner), slot(other.slot) { other.owner = nullptr; }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+        ~Reader() {
+            if (owner) {
+                owner->slots[slot].claimed.store(false, std::memory_order_release);
+            }
+        }
+
+        /// @brief Enter a read section: the returned version stays valid (and unchanged) until the guard is
+        /// destroyed. Read sections of one reader must not nest.
+        ReadGuard read() const { return ReadGuard(*owner, owner->slots[slot]); }
+
+    private:
+        friend RcuFlexibleRoaring;
+        Reader(RcuFlexibleRoaring& owner, size_t slot) : owner(&owner), slot(slot) {}
+
+        RcuFlexibleRoaring* owner;
+        size_t slot;
+    };
+
+    /// @brief A read section on the version that was current when it was opened.
+    class ReadGuard {
+    public:
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() { slot.epoch.store(Quiescent, std::memory_order_release); }
+
+        const Bitmap& operator*() const { return *version; }
+        const Bitmap* operator->() const { return version; }
+
+    private:
+        friend Reader;
+        ReadGuard(const RcuFlexibleRoaring& owner, Slot& slot) : slot(slot) {
+            assert(slot.epoch.load(std::memory_order_relaxed) == Quiescent && "Read sections must not nest");
+            // Announce the epoch before loading the version (both seq_cst): a writer that retires the version we
+            // load is then guaranteed to see our announcement when it scans the slots.
+            slot.epoch.store(owner.global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            version = owner.current.load(std::memory_order_seq_cst);
+        }
+
+        Slot& slot;
+        const Bitmap* version;
+    };
+
+    RcuFlexibleRoaring() : current(new Bitmap()) {}
+    explicit RcuFlexibleRoaring(Bitmap&& initial) : current(new Bitmap(std::move(initial))) {
+        current.load(std::memory_order_relaxed)->warm_caches();
+    }
+    RcuFlexibleRoaring(const RcuFlexibleRoaring&) = delete;
+    RcuFlexibleRoaring& operator=(const RcuFlexibleRoaring&) = delete;
+
+    /// @brief No reader may be registered any more.
+    ~RcuFlexibleRoaring() {
+        for (auto& [epoch, version] : retired) {
+            delete version;
+        }
+        delete current.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Claim a reader slot (the only read-side atomic read-modify-write), waiting for one if all are taken.
+    Reader reader() {
+        while (true) {
+            for (size_t i = 0; i < MaxReaders; ++i) {
+                if (!slots[i].claimed.load(std::memory_order_relaxed) &&
+                    !slots[i].claimed.exchange(true, std::memory_order_acquire)) {
+                    return Reader(*this, i);
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /// @brief Publish a new version built by `fn(Bitmap&)` from a copy-on-write snapshot of the current one.
+    template <typename Fn>
+    void update(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        Bitmap next = current.load(std::memory_order_relaxed)->snapshot();
+        fn(next);
+        publish_locked(std::move(next));
+    }
+
+    /// @brief Replace the current version.
+    void publish(Bitmap&& next) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish_locked(std::move(next));
+    }
+
+    /// @brief Free the replaced versions that no reader can see any more, without waiting.
+    /// @return The number of replaced versions still waiting for their grace period.
+    size_t try_reclaim() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return reclaim_locked();
+    }
+
+    /// @brief Wait until every version replaced so far is freed, i.e. until the readers that may see them are gone.
+    void synchronize() {
+        while (try_reclaim() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void publish_locked(Bitmap&& next) {
+        auto fresh = new Bitmap(std::move(next));
+        fresh->warm_caches();  // readers must not fill lazy caches concurrently
+        const Bitmap* old = current.exchange(fresh, std::memory_order_seq_cst);
+        // Readers announcing an epoch <= the retire epoch may still see `old`
+        const uint64_t retire_epoch = global_epoch.fetch_add(1, std::memory_order_seq_cst);
+        retired.emplace_back(retire_epoch, old);
+        reclaim_locked();
+    }
+
+    size_t reclaim_locked() {
+        uint64_t oldest_active = std::numeric_limits<uint64_t>::max();
+        for (const auto& s : slots) {
+            const uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e != Quiescent && e < oldest_active) {
+                oldest_active = e;
+            }
+        }
+        size_t kept = 0;
+        for (auto& [epoch, version] : retired) {
+            if (epoch < oldest_active) {
+                delete version;
+            } else {
+                retired[kept++] = {epoch, version};
+            }
+        }
+        retired.resize(kept);
+        return kept;
+    }
+
+    std::atomic<const Bitmap*> current;
+    /// Starts above `Quiescent`; bumped once per published version.
+    std::atomic<uint64_t> global_epoch{1};
+    std::array<Slot, MaxReaders> slots;
+
+    std::mutex writer_mutex;
+    /// Replaced versions, with the epoch they were retired in. Guarded by `writer_mutex`.
+    std::vector<std::pair<uint64_t, const Bitmap*>> retired;
+};
+}  // namespace froaring
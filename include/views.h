@@ -0,0 +1,133 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+
+#include "lazy.h"
+
+namespace froaring::views {
+/// @brief The values of a lazy formula (see lazy.h), as an input range: nothing is materialized.
+///
+/// Iteration merges the operands container by container. A key is only evaluated when the iteration reaches it, so
+/// stopping early (`std::views::take`, or breaking out of the loop) skips the rest of the work. The current container
+/// is decoded into a heap buffer allocated by `begin()` and shared by the copies of that iterator, so copies are
+/// cheap. As for any input iterator, advancing one copy invalidates the others.
+///
+/// The bitmaps must outlive the view and must not change while it is iterated.
+template <typename Expr>
+class SetOpView : public std::ranges::view_interface<SetOpView<Expr>> {
+    using Word = typename Expr::Word;
+    static constexpr size_t WordsCount = Expr::WordsCount;
+    static constexpr size_t BitsPerWord = 8 * sizeof(Word);
+    static constexpr size_t DataBits = std::countr_zero(WordsCount * BitsPerWord);
+
+public:
+    using value_type = std::remove_cvref_t<decltype(*std::declval<const typename Expr::Bitmap&>().begin())>;
+
+    class iterator {
+    public:
+        using value_type = SetOpView::value_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        value_type operator*() const {
+            return static_cast<value_type>((static_cast<value_type>(key) << DataBits) |
+                                           (word_pos * BitsPerWord + std::countr_zero(word)));
+        }
+
+        iterator& operator++() {
+            word &= word - 1;
+            while (word == 0) {
+                if (++word_pos == WordsCount) {
+                    next_block(key + 1);
+                    return *this;
+                }
+                word = block[word_pos];
+            }
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.key == Expr::EndKey; }
+
+    private:
+        friend SetOpView;
+
+        explicit iterator(const Expr& formula)
+            : expr(formula), block(new Word[Expr::ScratchBlocks * WordsCount]) {
+            expr.rewind();
+            next_block(0);
+        }
+
+        /// @brief Load the first non-empty result block with a key >= `from`, and its first set word.
+        void next_block(size_t from) {
+            for (key = expr.next_key(from); key != Expr::EndKey; key = expr.next_key(key + 1)) {
+                const Word* words = expr.words(key, block.get());
+                if (!words) {
+                    continue;
+                }
+                if (words != block.get()) {
+                    std::memcpy(block.get(), words, WordsCount * sizeof(Word));
+                }
+                for (word_pos = 0; word_pos < WordsCount; ++word_pos) {
+                    word = block[word_pos];
+                    if (word != 0) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        Expr expr;
+        size_t key = Expr::EndKey;
+        size_t word_pos = 0;
+        /// The bits of `block[word_pos]` not visited yet, including the current one.
+        Word word = 0;
+        /// The result goes to the first block, the others are scratch for evaluating the formula.
+        std::shared_ptr<Word[]> block;
+    };
+
+    explicit SetOpView(Expr formula) : formula(std::move(formula)) {}
+
+    iterator begin() const { return iterator(formula); }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+    /// @brief Whether the result is empty: evaluates keys only up to the first non-empty one.
+    bool empty() const { return begin() == end(); }
+
+private:
+    Expr formula;
+};
+
+namespace detail {
+/// Bitmaps are borrowed by the views: temporaries would dangle.
+template <typename T>
+constexpr bool borrowable = std::is_lvalue_reference_v<T> || is_lazy_expression<std::remove_cvref_t<T>>::value;
+}  // namespace detail
+
+/// @brief The values in every operand. Operands are bitmaps or lazy formulas.
+template <typename First, typename... Rest>
+auto intersect(First&& first, Rest&&... rest) {
+    static_assert((detail::borrowable<First> && ... && detail::borrowable<Rest>), "Bitmap operands must be lvalues");
+    return SetOpView((froaring::detail::as_lazy(first) & ... & rest));
+}
+
+/// @brief The values in any operand. Operands are bitmaps or lazy formulas.
+template <typename First, typename... Rest>
+auto unite(First&& first, Rest&&... rest) {
+    static_assert((detail::borrowable<First> && ... && detail::borrowable<Rest>), "Bitmap operands must be lvalues");
+    return SetOpView((froaring::detail::as_lazy(first) | ... | rest));
+}
+
+/// @brief The values of `first` in none of the others. Operands are bitmaps or lazy formulas.
+template <typename First, typename... Rest>
+auto subtract(First&& first, Rest&&... rest) {
+    static_assert((detail::borrowable<First> && ... && detail::borrowable<Rest>), "Bitmap operands must be lvalues");
+    return SetOpView((froaring::detail::as_lazy(first) - ... - rest));
+}
+}  // namespace froaring::views
@@ -72,6 +72,22 @@ TEST_F(ArrayContainerTest, ExpansionTest) {
     EXPECT_TRUE(container->test(255));
 }
 
+TEST(ArrayContainerCapacityTest, ZeroCapacityGrows) {
+    ArrayContainer<uint64_t, 8> empty(0);
+    empty.set(7);
+    empty.set(3);
+    EXPECT_TRUE(empty.test(3));
+    EXPECT_TRUE(empty.test(7));
+    EXPECT_EQ(empty.cardinality(), 2);
+
+    ArrayContainer<uint64_t, 8> source(0);
+    ArrayContainer<uint64_t, 8> copy(source);
+    for (uint64_t i = 0; i < 20; ++i) {
+        copy.set(i);
+    }
+    EXPECT_EQ(copy.cardinality(), 20);
+}
+
 }  // namespace froaring
 
 int main(int argc, char** argv) {
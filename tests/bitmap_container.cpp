@@ -2,6 +2,9 @@
 
 #include <gtest/gtest.h>
 
+#include <bitset>
+#include <random>
+
 namespace froaring {
 class BitmapContainerTest : public ::testing::Test {
 protected:
@@ -122,6 +125,89 @@ TEST_F(BitmapContainerTest, ResetRange) {
     delete container;
 }
 
+TEST_F(BitmapContainerTest, SingleElementRanges) {
+    BitmapContainer<uint64_t, 10> container;
+    container.set_range(300, 300);
+    EXPECT_TRUE(container.test(300));
+    EXPECT_EQ(container.cardinality(), 1);
+    EXPECT_TRUE(container.any_range(300, 300));
+    EXPECT_FALSE(container.any_range(301, 301));
+    EXPECT_FALSE(container.any_range(256, 299));
+
+    container.reset_range(300, 300);
+    EXPECT_FALSE(container.test(300));
+    EXPECT_EQ(container.cardinality(), 0);
+}
+
+TEST_F(BitmapContainerTest, WideRangesFillWholeWords) {
+    // NumType is 16 bits wide here, WordType is 64: the middle words must be filled word by word.
+    BitmapContainer<uint64_t, 16> container;
+    container.set_range(3, 1000);
+    EXPECT_EQ(container.cardinality(), 998);
+    EXPECT_TRUE(container.test_range(3, 1000));
+
+    container.reset_range(10, 990);
+    EXPECT_EQ(container.cardinality(), 17);
+    EXPECT_FALSE(container.any_range(10, 990));
+}
+
+TEST_F(BitmapContainerTest, IntersectRangeClearsOutside) {
+    BitmapContainer<uint64_t, 10> container;
+    container.set(5);
+    container.set(200);
+    container.set(201);
+    container.set(900);
+
+    container.intersect_range(200, 201);
+    EXPECT_FALSE(container.test(5));
+    EXPECT_TRUE(container.test(200));
+    EXPECT_TRUE(container.test(201));
+    EXPECT_FALSE(container.test(900));
+    EXPECT_EQ(container.cardinality(), 2);
+}
+
+TEST_F(BitmapContainerTest, CachedCardinalityTracksMutations) {
+    std::mt19937 rng(5);
+    std::bitset<256> expected;
+    for (int round = 0; round < 2000; ++round) {
+        uint8_t x = rng() % 256, y = rng() % 256;
+        uint8_t lo = std::min(x, y), hi = std::max(x, y);
+        switch (rng() % 6) {
+            case 0:
+                container->set(x);
+                expected.set(x);
+                break;
+            case 1:
+                container->reset(x);
+                expected.reset(x);
+                break;
+            case 2:
+                EXPECT_EQ(container->test_and_set(x), !expected.test(x));
+                expected.set(x);
+                break;
+            case 3:
+                container->set_range(lo, hi);
+                for (size_t v = lo; v <= hi; ++v) expected.set(v);
+                break;
+            case 4:
+                container->reset_range(lo, hi);
+                for (size_t v = lo; v <= hi; ++v) expected.reset(v);
+                break;
+            default:
+                // Raw word writes must be followed by an invalidation
+                container->words[x % container->WordsCount] ^= y;
+                container->invalidate_cardinality();
+                for (size_t bit = 0; bit < 8; ++bit)
+                    if (y >> bit & 1) expected.flip((x % container->WordsCount) * 64 + bit);
+        }
+        EXPECT_EQ(container->cardinality(), expected.count());
+    }
+    BitmapContainer<uint64_t, 8> copy(*container);
+    EXPECT_EQ(copy.cardinality(), expected.count());
+    container->clear();
+    EXPECT_TRUE(container->empty());
+}
+
 }  // namespace froaring
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
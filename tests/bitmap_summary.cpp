@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+
+#include <bitset>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Set = std::set<size_t>;
+
+static_assert(BitmapContainer<uint64_t, 16>::HasSummary && BitmapContainer<uint64_t, 20>::HasSummary);
+static_assert(!BitmapContainer<uint64_t, 8>::HasSummary && !BitmapContainer<uint64_t, 12>::HasSummary);
+static_assert(BitmapContainer<uint64_t, 20>::SummaryWords == 256);
+
+/// Whether the summary flags exactly the non-zero words.
+template <typename WordType, size_t D>
+::testing::AssertionResult summary_matches(const BitmapContainer<WordType, D>& c) {
+    using Bitmap = BitmapContainer<WordType, D>;
+    for (size_t i = 0; i < Bitmap::WordsCount; ++i) {
+        const bool flagged = c.summary[i / Bitmap::BitsPerWord] >> (i % Bitmap::BitsPerWord) & 1;
+        if (flagged != (c.words[i] != 0)) {
+            return ::testing::AssertionFailure() << "word " << i << " flagged " << flagged;
+        }
+    }
+    return ::testing::AssertionSuccess();
+}
+
+/// `n` values in a few clusters of 2^16 values, so that most words are empty.
+template <size_t D>
+Set clustered_values(std::mt19937& rng, size_t n, size_t clusters) {
+    constexpr size_t Width = size_t(1) << 16;
+    std::vector<size_t> starts(clusters);
+    for (auto& s : starts) s = rng() % ((size_t(1) << D) - Width);
+    Set values;
+    while (values.size() < n) values.insert(starts[rng() % clusters] + rng() % Width);
+    return values;
+}
+
+template <size_t D>
+BitmapContainer<uint64_t, D>* make_bitmap(const Set& s) {
+    auto c = new BitmapContainer<uint64_t, D>();
+    for (auto v : s) c->set(v);
+    return c;
+}
+
+template <size_t D>
+Set to_set(const froaring_container_t* c, CTy type) {
+    std::vector<size_t> values(container_cardinality<uint64_t, D>(c, type));
+    container_take_first<uint64_t, D>(c, type, values.size(), size_t(0), values.data());
+    return Set(values.begin(), values.end());
+}
+
+template <size_t D>
+void expect_result(froaring_container_t* r, CTy rt, const Set& expected) {
+    EXPECT_EQ(to_set<D>(r, rt), expected);
+    if (rt == CTy::Bitmap) {
+        EXPECT_TRUE((summary_matches(*static_cast<BitmapContainer<uint64_t, D>*>(r))));
+    }
+    release_container<uint64_t, D>(r, rt);
+}
+}  // namespace
+
+namespace {
+template <typename WordType>
+void track_mutations() {
+    constexpr size_t D = 16;
+    using Bitmap = BitmapContainer<WordType, D>;
+    std::mt19937 rng(50);
+    Bitmap c;
+    std::bitset<size_t(1) << D> expected;
+    for (int round = 0; round < 3000; ++round) {
+        // Keep the values in a few clusters, so that the summary has gaps to skip
+        const size_t x = (rng() % 4) * 16384 + rng() % 600, y = std::min(x + rng() % 300, (size_t(1) << D) - 1);
+        const int op = rng() % 9;
+        switch (op) {
+            case 0:
+            case 1:
+                c.set(x);
+                expected.set(x);
+                break;
+            case 2:
+                c.reset(x);
+                expected.reset(x);
+                break;
+            case 3:
+                EXPECT_EQ(c.test_and_set(x), !expected.test(x));
+                expected.set(x);
+                break;
+            case 4:
+                c.set_range(x, y);
+                for (size_t v = x; v <= y; ++v) expected.set(v);
+                break;
+            case 5:
+                c.reset_range(x, y);
+                for (size_t v = x; v <= y; ++v) expected.reset(v);
+                break;
+            case 6:
+                if (rng() % 20 == 0) {
+                    const size_t end = std::min(y + 20000, expected.size() - 1);
+                    c.intersect_range(x, end);
+                    for (size_t v = 0; v < expected.size(); ++v) {
+                        if (v < x || v > end) expected.reset(v);
+                    }
+                }
+                break;
+            case 7:
+                if (rng() % 50 == 0) {
+                    c.clear();
+                    expected.reset();
+                }
+                break;
+            default:
+                // Raw word writes must be followed by an invalidation
+                c.words[x / Bitmap::BitsPerWord] ^= WordType(y);
+                c.invalidate_cardinality();
+                for (size_t bit = 0; bit < Bitmap::BitsPerWord; ++bit) {
+                    if (WordType(y) >> bit & 1) expected.flip(x / Bitmap::BitsPerWord * Bitmap::BitsPerWord + bit);
+                }
+        }
+        ASSERT_TRUE(summary_matches(c)) << "round " << round << " op " << op;
+        ASSERT_EQ(c.cardinality(), expected.count()) << "round " << round << " op " << op;
+        if (round % 10 != 0 || expected.none()) {
+            continue;
+        }
+        std::vector<size_t> values;
+        for (size_t v = 0; v < expected.size(); ++v) {
+            if (expected.test(v)) values.push_back(v);
+        }
+        EXPECT_EQ(c.minimum(), values.front());
+        EXPECT_EQ(c.maximum(), values.back());
+        const size_t k = rng() % values.size();
+        EXPECT_EQ(c.select(k), values[k]);
+        EXPECT_EQ(c.rank(values[k]), k + 1);
+        const size_t q = rng() % expected.size();
+        EXPECT_EQ(c.rank(q), std::upper_bound(values.begin(), values.end(), q) - values.begin());
+        const size_t lo = rng() % expected.size(), hi = std::min(lo + rng() % 5000, expected.size() - 1);
+        EXPECT_EQ(c.any_range(lo, hi), std::lower_bound(values.begin(), values.end(), lo) !=
+                                           std::upper_bound(values.begin(), values.end(), hi));
+        size_t runs = 0;
+        for (size_t i = 0; i < values.size(); ++i) runs += i == 0 || values[i - 1] + 1 != values[i];
+        EXPECT_EQ(c.count_runs(), runs);
+        std::vector<size_t> out(values.size());
+        ASSERT_EQ(c.take_first(values.size(), size_t(0), out.data()), values.size());
+        EXPECT_EQ(out, values);
+        ASSERT_EQ(c.take_last(3, size_t(0), out.data()), std::min<size_t>(3, values.size()));
+        EXPECT_EQ(out[0], values.back());
+    }
+    Bitmap copy(c);
+    EXPECT_TRUE(summary_matches(copy));
+}
+}  // namespace
+
+TEST(BitmapSummaryTest, TracksMutations) { track_mutations<uint32_t>(); }
+
+// Masks built from `~WordType(0)` must not be sign-extended ints for words narrower than int
+TEST(BitmapSummaryTest, TracksMutationsOfNarrowWords) { track_mutations<uint8_t>(); }
+
+TEST(BitmapSummaryTest, KernelsMatchStdSet) {
+    constexpr size_t D = 20;
+    std::mt19937 rng(2050);
+    for (int round = 0; round < 10; ++round) {
+        // Bitmaps by cardinality, yet mostly empty words
+        const Set sa = clustered_values<D>(rng, 40000 + rng() % 10000, 1 + rng() % 6);
+        const Set sb = round == 0 ? sa : clustered_values<D>(rng, 40000 + rng() % 10000, 1 + rng() % 6);
+        Set and_s, or_s = sa, diff_s;
+        for (auto v : sa) (sb.count(v) ? and_s : diff_s).insert(v);
+        or_s.insert(sb.begin(), sb.end());
+        SCOPED_TRACE(testing::Message() << "round " << round);
+        auto a = make_bitmap<D>(sa), b = make_bitmap<D>(sb);
+        CTy rt;
+        auto r = froaring_and<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap, rt);
+        expect_result<D>(r, rt, and_s);
+        r = froaring_or<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap, rt);
+        expect_result<D>(r, rt, or_s);
+        r = froaring_diff<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap, rt);
+        expect_result<D>(r, rt, diff_s);
+        EXPECT_EQ((froaring_intersects<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap)), !and_s.empty());
+        EXPECT_EQ((froaring_contains<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap)), and_s.size() == sb.size());
+        EXPECT_EQ((froaring_equal<uint64_t, D>(a, b, CTy::Bitmap, CTy::Bitmap)), sa == sb);
+
+        froaring_container_t* ai = make_bitmap<D>(sa);
+        r = froaring_andi<uint64_t, D>(ai, b, CTy::Bitmap, CTy::Bitmap, rt);
+        if (r != ai) release_container<uint64_t, D>(ai, CTy::Bitmap);
+        expect_result<D>(r, rt, and_s);
+        ai = make_bitmap<D>(sa);
+        r = froaring_ori<uint64_t, D>(ai, b, CTy::Bitmap, CTy::Bitmap, rt);
+        if (r != ai) release_container<uint64_t, D>(ai, CTy::Bitmap);
+        expect_result<D>(r, rt, or_s);
+        ai = make_bitmap<D>(sa);
+        r = froaring_diffi<uint64_t, D>(ai, b, CTy::Bitmap, CTy::Bitmap, rt);
+        if (r != ai) release_container<uint64_t, D>(ai, CTy::Bitmap);
+        expect_result<D>(r, rt, diff_s);
+
+        delete a;
+        delete b;
+    }
+}
+
+// The bitmap x RLE and bitmap x array kernels walk the words of both sides in one pass
+TEST(BitmapSummaryTest, MixedKernelsMatchStdSet) {
+    constexpr size_t D = 20;
+    using RLESized = RLEContainer<uint64_t, D>;
+    using ArraySized = ArrayContainer<uint64_t, D>;
+    std::mt19937 rng(2028);
+    for (int round = 0; round < 10; ++round) {
+        const Set sa = clustered_values<D>(rng, 40000 + rng() % 10000, 1 + rng() % 6);
+        // Runs and sparse values, some inside the clusters of `sa` and some far from them
+        Set runs, sparse;
+        for (int i = 0; i < 300; ++i) {
+            const size_t start = i % 2 ? *std::next(sa.begin(), rng() % sa.size()) : rng() % ((size_t(1) << D) - 500);
+            for (size_t v = start; v < start + rng() % 500; ++v) runs.insert(v);
+            sparse.insert(i % 2 ? start : rng() % (size_t(1) << D));
+        }
+        SCOPED_TRACE(testing::Message() << "round " << round);
+        auto a = make_bitmap<D>(sa);
+        auto rle = new RLESized();
+        for (auto v : runs) rle->set(v);
+        auto array = new ArraySized();
+        for (auto v : sparse) array->set(v);
+
+        for (auto [b, tb, sb] : {std::tuple<froaring_container_t*, CTy, const Set*>{rle, CTy::RLE, &runs},
+                                 {array, CTy::Array, &sparse}}) {
+            Set and_s, or_s = sa, a_minus_b, b_minus_a;
+            for (auto v : sa) (sb->count(v) ? and_s : a_minus_b).insert(v);
+            for (auto v : *sb) {
+                if (!sa.count(v)) b_minus_a.insert(v);
+            }
+            or_s.insert(sb->begin(), sb->end());
+            CTy rt;
+            auto r = froaring_and<uint64_t, D>(a, b, CTy::Bitmap, tb, rt);
+            expect_result<D>(r, rt, and_s);
+            r = froaring_or<uint64_t, D>(a, b, CTy::Bitmap, tb, rt);
+            expect_result<D>(r, rt, or_s);
+            r = froaring_diff<uint64_t, D>(a, b, CTy::Bitmap, tb, rt);
+            expect_result<D>(r, rt, a_minus_b);
+            r = froaring_diff<uint64_t, D>(b, a, tb, CTy::Bitmap, rt);
+            expect_result<D>(r, rt, b_minus_a);
+
+            froaring_container_t* ai = make_bitmap<D>(sa);
+            r = froaring_ori<uint64_t, D>(ai, b, CTy::Bitmap, tb, rt);
+            if (r != ai) release_container<uint64_t, D>(ai, CTy::Bitmap);
+            expect_result<D>(r, rt, or_s);
+            ai = make_bitmap<D>(sa);
+            r = froaring_diffi<uint64_t, D>(ai, b, CTy::Bitmap, tb, rt);
+            if (r != ai) release_container<uint64_t, D>(ai, CTy::Bitmap);
+            expect_result<D>(r, rt, a_minus_b);
+        }
+        delete a;
+        delete rle;
+        delete array;
+    }
+}
+
+TEST(BitmapSummaryTest, BitmapsWithSparseContainers) {
+    using Bitmap = FlexibleRoaring<uint64_t, 12, 20>;
+    std::mt19937 rng(20);
+    Set values;
+    for (size_t key = 0; key < 4; ++key) {
+        for (auto v : clustered_values<20>(rng, 40000, 2)) values.insert(key << 20 | v);
+    }
+    Bitmap b;
+    for (auto v : values) b.set(v);
+    b.run_optimize();
+    std::vector<uint64_t> iterated;
+    for (auto it = b.begin(); it != b.end(); ++it) iterated.push_back(*it);
+    EXPECT_EQ(iterated, std::vector<uint64_t>(values.begin(), values.end()));
+    EXPECT_EQ(b.count(), values.size());
+    EXPECT_EQ(b.minimum(), *values.begin());
+    EXPECT_EQ(b.maximum(), *values.rbegin());
+    EXPECT_EQ(b.rank(*std::next(values.begin(), 50000)), 50001u);
+
+    Bitmap other;
+    for (auto v : values) {
+        if (v % 3 == 0) other.set(v + 1);
+    }
+    Bitmap both = b & other;
+    Set expected;
+    for (auto v : values) {
+        if (v % 3 == 0 && values.count(v + 1)) expected.insert(v + 1);
+    }
+    EXPECT_EQ(both.count(), expected.size());
+    EXPECT_TRUE(b.intersects(other));
+    b -= both;
+    EXPECT_FALSE(b.intersects(other));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
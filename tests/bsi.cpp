@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "bsi.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Bsi = BitSlicedIndex<Bitmap>;
+using Reference = std::map<uint64_t, uint64_t>;  // id -> value
+
+template <typename Pred>
+Bitmap select_ids(const Reference& ref, const Bitmap* filter, Pred pred) {
+    Bitmap b;
+    for (auto [id, v] : ref) {
+        if ((!filter || filter->test(id)) && pred(v)) b.set(id);
+    }
+    return b;
+}
+
+struct Fixture {
+    Bsi bsi;
+    Reference ref;
+    Bitmap filter;
+
+    explicit Fixture(uint32_t seed, uint64_t max_value) {
+        std::mt19937_64 rng(seed);
+        for (int i = 0; i < 3000; ++i) {
+            const uint64_t id = rng() % 20000;
+            const uint64_t value = rng() % (max_value + 1);
+            bsi.set(id, value);
+            ref[id] = value;
+        }
+        for (int i = 0; i < 300; ++i) {  // overwrite and erase some
+            const uint64_t id = rng() % 20000;
+            if (rng() % 2) {
+                bsi.erase(id);
+                ref.erase(id);
+            } else {
+                bsi.set(id, rng() % (max_value + 1));
+                ref[id] = 0;
+                bsi.get(id, ref[id]);
+            }
+        }
+        for (uint64_t id = 0; id < 20000; ++id) {
+            if (rng() % 3 == 0) filter.set(id);
+        }
+    }
+};
+}  // namespace
+
+TEST(BsiTest, SetGetErase) {
+    Bsi bsi;
+    uint64_t v = 0;
+    EXPECT_FALSE(bsi.get(5, v));
+    bsi.set(5, 1000);
+    bsi.set(7, 0);
+    bsi.set(5, 3);  // overwrite with fewer bits
+    EXPECT_TRUE(bsi.get(5, v));
+    EXPECT_EQ(v, 3);
+    EXPECT_TRUE(bsi.get(7, v));
+    EXPECT_EQ(v, 0);
+    EXPECT_EQ(bsi.size(), 2);
+    EXPECT_EQ(bsi.bit_depth(), 10);
+    bsi.erase(5);
+    EXPECT_FALSE(bsi.get(5, v));
+    EXPECT_EQ(bsi.size(), 1);
+    bsi.set(9, ~uint64_t(0));
+    EXPECT_TRUE(bsi.get(9, v));
+    EXPECT_EQ(v, ~uint64_t(0));
+}
+
+TEST(BsiTest, RangePredicatesMatchScan) {
+    for (uint64_t max_value : {uint64_t(1), uint64_t(100), uint64_t(1) << 20}) {
+        Fixture f(static_cast<uint32_t>(max_value), max_value);
+        std::mt19937_64 rng(max_value);
+        for (int q = 0; q < 20; ++q) {
+            const uint64_t x = rng() % (max_value + 2);
+            const uint64_t y = x + rng() % (max_value / 4 + 1);
+            for (const Bitmap* filter : std::array<const Bitmap*, 2>{nullptr, &f.filter}) {
+                EXPECT_EQ(f.bsi.equal(x, filter), select_ids(f.ref, filter, [&](uint64_t v) { return v == x; }));
+                EXPECT_EQ(f.bsi.less(x, filter), select_ids(f.ref, filter, [&](uint64_t v) { return v < x; }));
+                EXPECT_EQ(f.bsi.less_equal(x, filter),
+                          select_ids(f.ref, filter, [&](uint64_t v) { return v <= x; }));
+                EXPECT_EQ(f.bsi.greater(x, filter), select_ids(f.ref, filter, [&](uint64_t v) { return v > x; }));
+                EXPECT_EQ(f.bsi.greater_equal(x, filter),
+                          select_ids(f.ref, filter, [&](uint64_t v) { return v >= x; }));
+                EXPECT_EQ(f.bsi.between(x, y, filter),
+                          select_ids(f.ref, filter, [&](uint64_t v) { return x <= v && v <= y; }));
+            }
+        }
+        EXPECT_EQ(f.bsi.less(~uint64_t(0)).count(), f.ref.size());
+        EXPECT_EQ(f.bsi.between(5, 4).count(), 0);
+    }
+}
+
+TEST(BsiTest, AggregatesMatchScan) {
+    Fixture f(7, 1 << 16);
+    for (const Bitmap* filter : std::array<const Bitmap*, 2>{nullptr, &f.filter}) {
+        uint64_t sum = 0, lo = ~uint64_t(0), hi = 0;
+        std::vector<std::pair<uint64_t, uint64_t>> by_value;  // (value desc, id asc) ordering below
+        for (auto [id, v] : f.ref) {
+            if (filter && !filter->test(id)) continue;
+            sum += v;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            by_value.emplace_back(v, id);
+        }
+        EXPECT_EQ(f.bsi.sum(filter), sum);
+
+        uint64_t value = 0;
+        Bitmap ids;
+        ASSERT_TRUE(f.bsi.min(value, filter, &ids));
+        EXPECT_EQ(value, lo);
+        EXPECT_EQ(ids, select_ids(f.ref, filter, [&](uint64_t v) { return v == lo; }));
+        ASSERT_TRUE(f.bsi.max(value, filter));
+        EXPECT_EQ(value, hi);
+
+        std::sort(by_value.begin(), by_value.end(), [](auto a, auto b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        for (size_t k : {size_t(0), size_t(1), size_t(10), size_t(500), by_value.size(), by_value.size() + 5}) {
+            Bitmap expected;
+            for (size_t i = 0; i < std::min(k, by_value.size()); ++i) expected.set(by_value[i].second);
+            EXPECT_EQ(f.bsi.top_k(k, filter), expected) << "k = " << k;
+        }
+    }
+    Bitmap empty;
+    uint64_t value;
+    EXPECT_FALSE(f.bsi.max(value, &empty));
+    EXPECT_EQ(f.bsi.sum(&empty), 0);
+}
+
+TEST(BsiTest, TopKBreaksTiesBySmallestIds) {
+    Bsi bsi;
+    for (uint64_t id = 0; id < 100; ++id) bsi.set(id, id % 10 == 0 ? 50 : 7);
+    Bitmap expected;
+    for (uint64_t id = 0; id < 100; id += 10) expected.set(id);
+    for (uint64_t id = 1; id < 6; ++id) expected.set(id);
+    EXPECT_EQ(bsi.top_k(15), expected);
+}
+
+TEST(BsiTest, TopKLargerThanSizeReturnsAll) {
+    Bsi bsi;
+    Bitmap expected;
+    for (uint64_t id = 0; id < 10; ++id) {
+        bsi.set(id * 3, id % 2);  // half of the ids hold 0, the k-th largest value
+        expected.set(id * 3);
+    }
+    // Must not size anything by k
+    EXPECT_EQ(bsi.top_k(size_t(1) << 40), expected);
+    EXPECT_EQ(Bsi().top_k(size_t(1) << 40), Bitmap());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
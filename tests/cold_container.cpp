@@ -0,0 +1,321 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "lazy.h"
+#include "multilevel.h"
+
+using namespace froaring;
+
+namespace {
+using Set = std::set<size_t>;
+
+/// `n` distinct values of [0, 2^D): runs of 1..`max_run` values separated by gaps of up to `max_gap`.
+template <size_t D>
+Set make_values(std::mt19937& rng, size_t n, size_t max_run, size_t max_gap) {
+    Set s;
+    size_t v = rng() % max_gap;
+    while (s.size() < n && v < (size_t(1) << D)) {
+        for (size_t len = 1 + rng() % max_run; len > 0 && s.size() < n && v < (size_t(1) << D); --len) {
+            s.insert(v++);
+        }
+        v += 1 + rng() % max_gap;
+    }
+    return s;
+}
+
+template <size_t D>
+froaring_container_t* make_container(const Set& s, CTy type) {
+    auto array = new ArrayContainer<uint64_t, D>();
+    for (auto v : s) array->set(v);
+    if (type == CTy::Array) {
+        return array;
+    }
+    auto c = convert_container<uint64_t, D>(array, CTy::Array, type);
+    delete array;
+    return c;
+}
+
+template <size_t D>
+Set to_set(const froaring_container_t* c, CTy type) {
+    std::vector<size_t> values(container_cardinality<uint64_t, D>(c, type));
+    container_take_first<uint64_t, D>(c, type, values.size(), size_t(0), values.data());
+    return Set(values.begin(), values.end());
+}
+
+template <size_t D>
+void check_container(const Set& s) {
+    using Cold = ColdContainer<uint64_t, D>;
+    SCOPED_TRACE(testing::Message() << "D=" << D << " size=" << s.size());
+    auto array = static_cast<ArrayContainer<uint64_t, D>*>(make_container<D>(s, CTy::Array));
+    Cold cold(array);
+    const std::vector<size_t> values(s.begin(), s.end());
+    ASSERT_EQ(cold.cardinality(), values.size());
+    ASSERT_EQ(cold.block_count, (values.size() + Cold::BlockSize - 1) / Cold::BlockSize);
+
+    auto unpacked = cold.to_array();
+    EXPECT_TRUE((froaring_equal<uint64_t, D>(unpacked, array, CTy::Array, CTy::Array)));
+    delete unpacked;
+    Cold copy(cold);
+    EXPECT_TRUE(copy.equals(cold));
+
+    typename Cold::IndexOrNumType current = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        current = cold.next_value(i, current);
+        ASSERT_EQ(current, values[i]);
+    }
+    std::mt19937 rng(D);
+    for (int i = 0; i < 300; ++i) {
+        const size_t v = rng() % (size_t(1) << D);
+        EXPECT_EQ(cold.test(v), array->test(v)) << v;
+        EXPECT_EQ(cold.rank(v), array->rank(v)) << v;
+    }
+    for (auto v : values) EXPECT_TRUE(cold.test(v));
+    EXPECT_EQ(cold.minimum(), values.front());
+    EXPECT_EQ(cold.maximum(), values.back());
+    for (size_t k : {size_t(0), values.size() / 3, values.size() - 1}) EXPECT_EQ(cold.select(k), values[k]);
+    EXPECT_EQ(cold.count_runs(), array->count_runs());
+
+    std::vector<size_t> out(values.size());
+    ASSERT_EQ(cold.take_last(values.size(), size_t(0), out.data()), values.size());
+    EXPECT_TRUE(std::equal(out.begin(), out.end(), values.rbegin()));
+    ASSERT_EQ(cold.take_first(150, size_t(0), out.data()), std::min<size_t>(150, values.size()));
+    EXPECT_TRUE(std::equal(out.begin(), out.begin() + std::min<size_t>(150, values.size()), values.begin()));
+    delete array;
+}
+}  // namespace
+
+TEST(ColdContainerTest, EncodesAndDecodesValues) {
+    std::mt19937 rng(49);
+    for (size_t n : {1, 2, 127, 128, 129, 256, 300, 1000, 3000}) {
+        check_container<16>(make_values<16>(rng, n, 1, 64));     // sparse
+        check_container<16>(make_values<16>(rng, n, 40, 4));     // runs: mostly zero gaps
+        check_container<16>(make_values<16>(rng, n, 1, 30000));  // wide gaps
+        check_container<12>(make_values<12>(rng, n, 2, 3));
+        check_container<8>(make_values<8>(rng, std::min<size_t>(n, 200), 3, 2));
+        check_container<20>(make_values<20>(rng, n, 1, 500));
+    }
+    Set all;
+    for (size_t v = 0; v < 256; ++v) all.insert(v);
+    check_container<8>(all);  // every gap is 0 bits wide
+}
+
+TEST(ColdContainerTest, SmallerThanArraysForClusteredValues) {
+    std::mt19937 rng(7);
+    const Set s = make_values<16>(rng, 2000, 1, 16);
+    auto array = make_container<16>(s, CTy::Array);
+    auto cold = make_container<16>(s, CTy::Cold);
+    EXPECT_LT((container_memory_usage<uint64_t, 16>(cold, CTy::Cold)),
+              (container_memory_usage<uint64_t, 16>(array, CTy::Array)) / 2);
+    release_container<uint64_t, 16>(array, CTy::Array);
+    release_container<uint64_t, 16>(cold, CTy::Cold);
+}
+
+template <size_t D>
+void check_kernels(std::initializer_list<CTy> types) {
+    std::mt19937 rng(2049 + D);
+    for (int round = 0; round < 12; ++round) {
+        const Set sa = make_values<D>(rng, rng() % 1500, 1 + rng() % 8, 1 + rng() % 40);
+        const Set sb = make_values<D>(rng, rng() % 1500, 1 + rng() % 8, 1 + rng() % 40);
+        Set and_s, or_s = sa, diff_s;
+        for (auto v : sa) (sb.count(v) ? and_s : diff_s).insert(v);
+        or_s.insert(sb.begin(), sb.end());
+        for (auto ta : types) {
+            for (auto tb : types) {
+                if (ta != CTy::Cold && tb != CTy::Cold) {
+                    continue;
+                }
+                SCOPED_TRACE(testing::Message() << "round " << round << " types " << int(ta) << "," << int(tb));
+                auto a = make_container<D>(sa, ta), b = make_container<D>(sb, tb);
+                CTy rt;
+                auto r = froaring_and<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), and_s);
+                EXPECT_EQ(rt, (choose_container_type<uint64_t, D>(and_s.size(),
+                                                                  container_run_count<uint64_t, D>(r, rt))));
+                release_container<uint64_t, D>(r, rt);
+                r = froaring_or<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), or_s);
+                release_container<uint64_t, D>(r, rt);
+                r = froaring_diff<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), diff_s);
+                release_container<uint64_t, D>(r, rt);
+                EXPECT_EQ((froaring_intersects<uint64_t, D>(a, b, ta, tb)), !and_s.empty());
+                EXPECT_EQ((froaring_contains<uint64_t, D>(a, b, ta, tb)), and_s.size() == sb.size());
+                EXPECT_EQ((froaring_equal<uint64_t, D>(a, b, ta, tb)), sa == sb);
+                EXPECT_TRUE((froaring_equal<uint64_t, D>(a, a, ta, ta)));
+
+                auto ai = make_container<D>(sa, ta);
+                r = froaring_andi<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), and_s);
+                release_container<uint64_t, D>(r, rt);
+                ai = make_container<D>(sa, ta);
+                r = froaring_ori<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), or_s);
+                release_container<uint64_t, D>(r, rt);
+                ai = make_container<D>(sa, ta);
+                r = froaring_diffi<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), diff_s);
+                release_container<uint64_t, D>(r, rt);
+
+                release_container<uint64_t, D>(a, ta);
+                release_container<uint64_t, D>(b, tb);
+            }
+        }
+    }
+}
+
+TEST(ColdContainerTest, KernelsMatchStdSet) {
+    check_kernels<16>({CTy::Array, CTy::Bitmap, CTy::RLE, CTy::Cold});
+    check_kernels<12>({CTy::Array, CTy::Bitmap, CTy::RLE, CTy::PackedArray, CTy::Cold});
+}
+
+TEST(ColdContainerTest, IntersectionSkipsDisjointRanges) {
+    // Far apart blocks: only the values in the shared range meet
+    Set sa, sb;
+    for (size_t v = 0; v < 1024; ++v) sa.insert(v * 3);
+    for (size_t v = 3000; v < 3100; ++v) sb.insert(v);
+    for (size_t v = 60000; v < 60100; ++v) sb.insert(v);
+    auto a = make_container<16>(sa, CTy::Cold), b = make_container<16>(sb, CTy::Cold);
+    Set expected;
+    for (auto v : sb) {
+        if (sa.count(v)) expected.insert(v);
+    }
+    CTy rt;
+    auto r = froaring_and<uint64_t, 16>(a, b, CTy::Cold, CTy::Cold, rt);
+    EXPECT_EQ(to_set<16>(r, rt), expected);
+    release_container<uint64_t, 16>(r, rt);
+    EXPECT_TRUE((froaring_intersects<uint64_t, 16>(a, b, CTy::Cold, CTy::Cold)));
+    Set far = {50000, 60000};
+    auto c = make_container<16>(far, CTy::Array);
+    EXPECT_FALSE((froaring_intersects<uint64_t, 16>(a, c, CTy::Cold, CTy::Array)));
+    EXPECT_FALSE((froaring_intersects<uint64_t, 16>(c, a, CTy::Array, CTy::Cold)));
+    release_container<uint64_t, 16>(a, CTy::Cold);
+    release_container<uint64_t, 16>(b, CTy::Cold);
+    release_container<uint64_t, 16>(c, CTy::Array);
+}
+
+TEST(ColdContainerTest, CompactColdBitmaps) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 16>;
+    std::mt19937 rng(2049);
+    Bitmap b;
+    Set values;
+    for (size_t key = 0; key < 40; ++key) {
+        for (auto v : make_values<16>(rng, key % 4 == 0 ? 20000 : 500, key % 5 == 0 ? 30 : 1, 20)) {
+            values.insert(key << 16 | v);
+        }
+    }
+    for (auto v : values) b.set(v);
+    b.run_optimize();
+    const Bitmap hot(b);
+    const size_t hot_bytes = b.memory_usage();
+    b.compact_cold();
+    EXPECT_LT(b.memory_usage(), hot_bytes * 3 / 4);
+    EXPECT_TRUE(b == hot);
+    EXPECT_EQ(b.count(), values.size());
+    b.run_optimize();  // keeps cold containers
+    EXPECT_LT(b.memory_usage(), hot_bytes * 3 / 4);
+
+    std::vector<uint64_t> iterated;
+    for (auto it = b.begin(); it != b.end(); ++it) iterated.push_back(*it);
+    EXPECT_EQ(iterated, std::vector<uint64_t>(values.begin(), values.end()));
+    EXPECT_EQ(b.minimum(), *values.begin());
+    EXPECT_EQ(b.maximum(), *values.rbegin());
+    EXPECT_EQ(b.rank(*std::next(values.begin(), 30000)), 30001);
+    uint64_t v = 0;
+    ASSERT_TRUE(b.select(12345, v));
+    EXPECT_EQ(v, *std::next(values.begin(), 12345));
+    std::vector<uint64_t> queries;
+    for (int i = 0; i < 2000; ++i) queries.push_back(rng() % (41 << 16));
+    std::vector<uint8_t> found(queries.size());
+    b.test_many(queries, found.data());
+    for (size_t i = 0; i < queries.size(); ++i) EXPECT_EQ(found[i], values.count(queries[i]));
+
+    // Set operations mixing cold and hot containers give the same results as hot ones only
+    Bitmap other;
+    for (int i = 0; i < 30000; ++i) other.set(rng() % (45 << 16));
+    other.run_optimize();
+    Bitmap cold_other(other);
+    cold_other.compact_cold();
+    for (const Bitmap* rhs : {&other, &cold_other}) {
+        EXPECT_TRUE((b & *rhs) == (hot & other));
+        EXPECT_TRUE((b | *rhs) == (hot | other));
+        EXPECT_TRUE((b - *rhs) == (hot - other));
+        EXPECT_TRUE((*rhs - b) == (other - hot));
+        EXPECT_EQ(b.intersects(*rhs), hot.intersects(other));
+        Bitmap lazy_result = (lazy(b) & *rhs) | (lazy(*rhs) - b);
+        EXPECT_TRUE(lazy_result == ((hot & other) | (other - hot)));
+        Bitmap inplace(b);
+        inplace &= *rhs;
+        EXPECT_TRUE(inplace == (hot & other));
+        inplace = Bitmap(b);
+        inplace |= *rhs;
+        EXPECT_TRUE(inplace == (hot | other));
+        inplace = Bitmap(b);
+        inplace -= *rhs;
+        EXPECT_TRUE(inplace == (hot - other));
+    }
+    EXPECT_TRUE(b.contains(b & other));
+
+    // Mutations decompress the touched container only, and snapshots keep the old contents
+    Bitmap snap = b.snapshot();
+    const uint64_t present = *std::next(values.begin(), 777), absent = (3ull << 16) + 65535;
+    ASSERT_FALSE(values.count(absent));
+    const size_t cold_bytes = b.memory_usage();
+    b.set(present);
+    EXPECT_FALSE(b.test_and_set(present));
+    EXPECT_EQ(b.memory_usage(), cold_bytes);
+    b.reset(absent);
+    b.reset(present);
+    EXPECT_FALSE(b.test(present));
+    EXPECT_TRUE(b.test_and_set(absent));
+    EXPECT_EQ(b.count(), values.size());
+    EXPECT_TRUE(snap.test(present));
+    EXPECT_FALSE(snap.test(absent));
+    EXPECT_TRUE(snap == hot);
+}
+
+TEST(ColdContainerTest, SingleContainer) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 16>;
+    Bitmap b;
+    for (uint64_t v = 5; v < 60000; v += 7) b.set(v);
+    b.compact_cold();
+    ASSERT_EQ(b.handle.type, CTy::Cold);
+    Bitmap copy(b);
+    EXPECT_TRUE(copy == b);
+    EXPECT_TRUE(b.test(12));
+    EXPECT_FALSE(b.test(13));
+    b.set(13);
+    EXPECT_EQ(b.handle.type, CTy::Array);
+    EXPECT_TRUE(b.test(13));
+    EXPECT_EQ(b.count(), copy.count() + 1);
+    EXPECT_FALSE(copy.test(13));
+
+    Bitmap full;  // nothing to compress
+    for (uint64_t v = 0; v < 65536; ++v) full.set(v);
+    full.run_optimize().compact_cold();
+    EXPECT_EQ(full.handle.type, CTy::Full);
+}
+
+TEST(ColdContainerTest, MultiLevelIndex) {
+    using Index = MultiLevelIndex<BinsearchIndex<uint64_t, 16, 16>, 20>;
+    std::mt19937_64 rng(3);
+    Set values;
+    while (values.size() < 5000) values.insert((rng() % 4) << 40 | (rng() % 3) << 16 | (rng() % 20000));
+    Index index;
+    for (auto v : values) index.set(v);
+    const size_t hot_bytes = index.memory_usage();
+    index.compact_cold();
+    EXPECT_LT(index.memory_usage(), hot_bytes);
+    EXPECT_EQ(index.cardinality(), values.size());
+    for (auto v : values) ASSERT_TRUE(index.test(v));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
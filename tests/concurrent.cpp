@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "concurrent_froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Concurrent = ConcurrentFlexibleRoaring<uint64_t, 16, 8, 4>;
+}
+
+TEST(ConcurrentTest, SingleThreadedBehavesLikeFlexibleRoaring) {
+    Concurrent c;
+    for (uint64_t v = 0; v < 5000; v += 3) c.set(v);
+    EXPECT_TRUE(c.test(0));
+    EXPECT_TRUE(c.test(4998));
+    EXPECT_FALSE(c.test(4999));
+    EXPECT_FALSE(c.test_and_set(3));
+    EXPECT_TRUE(c.test_and_set(4));
+    c.reset(4);
+    EXPECT_FALSE(c.test(4));
+    EXPECT_EQ(c.count(), 1667);
+
+    auto snapshot = c.snapshot();
+    EXPECT_EQ(snapshot.count(), 1667);
+    for (uint64_t v = 0; v < 5000; ++v) EXPECT_EQ(snapshot.test(v), v % 3 == 0) << v;
+
+    c.clear();
+    EXPECT_EQ(c.count(), 0);
+}
+
+TEST(ConcurrentTest, DisjointWritersWithConcurrentReaders) {
+    constexpr size_t Writers = 8;
+    constexpr uint64_t PerWriter = 20000;
+    Concurrent c;
+    std::atomic<bool> done{false};
+    std::atomic<size_t> false_positives{0};
+
+    // Readers probe values that are never set, while the index layers grow
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                for (uint64_t v = 1; v < Writers * PerWriter; v += 997) {
+                    if (v % 2 && c.test(v)) ++false_positives;
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < Writers; ++w) {
+        writers.emplace_back([&, w] {
+            std::vector<uint64_t> batch;
+            for (uint64_t v = w * PerWriter; v < (w + 1) * PerWriter; v += 2) {
+                if (v % 4) {
+                    c.set(v);
+                } else {
+                    batch.push_back(v);
+                }
+            }
+            c.set_many(batch.data(), batch.size());
+        });
+    }
+    for (auto& t : writers) t.join();
+    done = true;
+    for (auto& t : readers) t.join();
+
+    EXPECT_EQ(false_positives.load(), 0);
+    EXPECT_EQ(c.count(), Writers * PerWriter / 2);
+    auto snapshot = c.snapshot();
+    for (uint64_t v = 0; v < Writers * PerWriter; ++v) ASSERT_EQ(snapshot.test(v), v % 2 == 0) << v;
+}
+
+TEST(ConcurrentTest, ReadersShareColdStripes) {
+    constexpr size_t Readers = 8;
+    constexpr uint64_t Keys = 2000;
+    Concurrent c;
+    // One value per container: every write adds a container and leaves its stripe's caches cold
+    for (uint64_t key = 0; key < Keys; ++key) c.set(key << 8 | 1);
+
+    // The readers race to be the first to query each stripe
+    std::atomic<size_t> mismatches{0};
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < Readers; ++r) {
+        readers.emplace_back([&, r] {
+            for (uint64_t key = r; key < Keys; key += 3) {
+                if (!c.test(key << 8 | 1) || c.test(key << 8)) ++mismatches;
+            }
+            if (c.count() != Keys) ++mismatches;
+        });
+    }
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
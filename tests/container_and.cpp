@@ -21,11 +21,12 @@ TEST_F(FroaringAndTest, AndBitmapBitmap) {
 
     CTy result_type;
     auto* result = froaring_and_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    delete result;
+    // A single value is the smallest as an array
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringAndTest, AndArrayArray) {
@@ -133,17 +134,104 @@ TEST_F(FroaringAndTest, AndRangeTest) {
 
     CTy result_type;
     auto* result = froaring_and_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
+    // A single run is the smallest as RLE
+    EXPECT_EQ(result_type, CTy::RLE);
+    EXPECT_EQ((static_cast<RLEContainer<uint32_t, 16>*>(result))->run_count, 1);
     for (uint32_t i = 200; i < 250; ++i) {
-        EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
     for (uint32_t i = 250; i <= 260; ++i) {
-        EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
     for (uint32_t i = 261; i <= 300; ++i) {
-        EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
-    delete result;
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringAndTest, AndBitmapArrayManyValues) {
+    BitmapContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        b.set(i);
+        if (i % 2 == 0) a.set(i);
+    }
+
+    CTy result_type;
+    auto* result = froaring_and_ba(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    auto* array = static_cast<ArrayContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(array->size, 500);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(array->test(i), i % 2 == 0);
+    }
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringAndTest, AndRLERLE) {
+    RLEContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 20; ++i) a.set(i);
+    for (uint32_t i = 30; i <= 40; ++i) a.set(i);
+    for (uint32_t i = 15; i <= 35; ++i) b.set(i);
+    b.set(50);
+
+    CTy result_type;
+    auto* result = froaring_and_rr(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::RLE);
+    auto* rle = static_cast<RLEContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(rle->run_count, 2);
+    EXPECT_EQ(rle->cardinality(), 12);
+    EXPECT_TRUE(rle->test(15));
+    EXPECT_TRUE(rle->test(20));
+    EXPECT_FALSE(rle->test(25));
+    EXPECT_TRUE(rle->test(30));
+    EXPECT_TRUE(rle->test(35));
+    EXPECT_FALSE(rle->test(50));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringAndTest, AndBitmapRLEManyRuns) {
+    // Few values in many runs: the array path must walk the runs, not the values
+    BitmapContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 0; i < 40; i += 4) {
+        a.set(i);
+        b.set(i);
+    }
+
+    CTy result_type;
+    auto* result = froaring_and_br(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    auto* array = static_cast<ArrayContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(array->size, 10);
+    for (uint32_t i = 0; i < 40; ++i) {
+        EXPECT_EQ(array->test(i), i % 4 == 0);
+    }
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringAndTest, AndBitmapRLEClearsGaps) {
+    // Enough values to take the bitmap path: everything outside the runs must be cleared
+    BitmapContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    a.set_range(0, 65535);
+    for (uint32_t i = 1000; i <= 10000; ++i) b.set(i);
+    for (uint32_t i = 20000; i <= 30000; ++i) b.set(i);
+
+    CTy result_type;
+    auto* result = froaring_and_br(&a, &b, result_type);
+    // Two runs are the smallest as RLE
+    EXPECT_EQ(result_type, CTy::RLE);
+    auto* rle = static_cast<RLEContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(rle->run_count, 2);
+    EXPECT_EQ(rle->cardinality(), 9001 + 10001);
+    EXPECT_FALSE(rle->test(999));
+    EXPECT_TRUE(rle->test(1000));
+    EXPECT_FALSE(rle->test(15000));
+    EXPECT_TRUE(rle->test(30000));
+    EXPECT_FALSE(rle->test(65535));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 int main(int argc, char** argv) {
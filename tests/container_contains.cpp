@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "froaring_api/contains.h"
+#include "froaring_api/intersects.h"
+
+using namespace froaring;
+
+class FroaringContainsTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(FroaringContainsTest, ContainsRLERLE) {
+    RLEContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 30; ++i) a.set(i);
+    for (uint32_t i = 50; i <= 60; ++i) a.set(i);
+    for (uint32_t i = 12; i <= 15; ++i) b.set(i);
+    for (uint32_t i = 50; i <= 60; ++i) b.set(i);
+    EXPECT_TRUE(froaring_contains_rr(&a, &b));
+
+    b.set(31);
+    EXPECT_FALSE(froaring_contains_rr(&a, &b));
+}
+
+TEST_F(FroaringContainsTest, ContainsArrayRLE) {
+    ArrayContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t v : {1u, 2u, 3u, 5u, 8u, 9u}) a.set(v);
+    for (uint32_t i = 1; i <= 3; ++i) b.set(i);
+    b.set(8);
+    b.set(9);
+    EXPECT_TRUE(froaring_contains_ar(&a, &b));
+
+    b.set(4);
+    EXPECT_FALSE(froaring_contains_ar(&a, &b));
+}
+
+TEST_F(FroaringContainsTest, IntersectsRLERLE) {
+    RLEContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 20; ++i) a.set(i);
+    for (uint32_t i = 40; i <= 50; ++i) a.set(i);
+    for (uint32_t i = 0; i <= 5; ++i) b.set(i);
+    for (uint32_t i = 21; i <= 39; ++i) b.set(i);
+    EXPECT_FALSE(froaring_intersects_rr(&a, &b));
+
+    b.set(50);
+    EXPECT_TRUE(froaring_intersects_rr(&a, &b));
+}
+
+TEST_F(FroaringContainsTest, IntersectsArrayRLE) {
+    ArrayContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t v : {1u, 25u, 60u}) a.set(v);
+    for (uint32_t i = 10; i <= 20; ++i) b.set(i);
+    for (uint32_t i = 30; i <= 50; ++i) b.set(i);
+    EXPECT_FALSE(froaring_intersects_ar(&a, &b));
+
+    a.set(50);
+    EXPECT_TRUE(froaring_intersects_ar(&a, &b));
+}
+
+TEST_F(FroaringContainsTest, IntersectsBitmapRLE) {
+    BitmapContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    a.set(100);
+    for (uint32_t i = 10; i <= 20; ++i) b.set(i);
+    EXPECT_FALSE(froaring_intersects_br(&a, &b));
+
+    a.set(20);
+    EXPECT_TRUE(froaring_intersects_br(&a, &b));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -21,11 +21,11 @@ TEST_F(FroaringDiffTest, DiffBitmapBitmap) {
 
     CTy result_type;
     auto* result = froaring_diff_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    delete result;
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffArrayArray) {
@@ -43,7 +43,7 @@ TEST_F(FroaringDiffTest, DiffArrayArray) {
     EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
     EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
     EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
-    delete result;
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffBitmapArray) {
@@ -56,11 +56,11 @@ TEST_F(FroaringDiffTest, DiffBitmapArray) {
 
     CTy result_type;
     auto* result = froaring_diff_ba(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    delete result;
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffArrayBitmap) {
@@ -73,11 +73,11 @@ TEST_F(FroaringDiffTest, DiffArrayBitmap) {
 
     CTy result_type;
     auto* result = froaring_diff_ba(&b, &a, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    delete result;
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffBitmapRLE) {
@@ -90,12 +90,12 @@ TEST_F(FroaringDiffTest, DiffBitmapRLE) {
 
     CTy result_type;
     auto* result = froaring_diff_br(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(4));
-    delete result;
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(4));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffRLEBitmap) {
@@ -109,12 +109,12 @@ TEST_F(FroaringDiffTest, DiffRLEBitmap) {
 
     CTy result_type;
     auto* result = froaring_diff_br(&b, &a, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(4));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    delete result;
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(4));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffTest, DiffRangeTest) {
@@ -129,16 +129,109 @@ TEST_F(FroaringDiffTest, DiffRangeTest) {
 
     CTy result_type;
     auto* result = froaring_diff_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
+    EXPECT_EQ(result_type, CTy::RLE);
     for (uint32_t i = 200; i <= 260; ++i) {
-        EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
     for (uint32_t i = 263; i <= 513; ++i) {
-        EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(261));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(262));
-    delete result;
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(261));
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(262));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffTest, DiffArrayArrayKeepsTail) {
+    ArrayContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    a.set(1);
+    a.set(2);
+    a.set(5);
+    a.set(9);
+    b.set(2);
+
+    CTy result_type;
+    auto* result = froaring_diff_aa(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    auto* array = static_cast<ArrayContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(array->size, 3);
+    EXPECT_TRUE(array->test(1));
+    EXPECT_FALSE(array->test(2));
+    EXPECT_TRUE(array->test(5));
+    EXPECT_TRUE(array->test(9));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffTest, DiffRLERLE) {
+    RLEContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 30; ++i) a.set(i);
+    for (uint32_t i = 40; i <= 50; ++i) a.set(i);
+    for (uint32_t i = 15; i <= 18; ++i) b.set(i);
+    for (uint32_t i = 25; i <= 45; ++i) b.set(i);
+
+    CTy result_type;
+    auto* result = froaring_diff_rr(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::RLE);
+    auto* rle = static_cast<RLEContainer<uint32_t, 16>*>(result);
+    // [10,14] [19,24] [46,50]
+    EXPECT_EQ(rle->run_count, 3);
+    EXPECT_EQ(rle->cardinality(), 5 + 6 + 5);
+    EXPECT_TRUE(rle->test(14));
+    EXPECT_FALSE(rle->test(15));
+    EXPECT_TRUE(rle->test(19));
+    EXPECT_FALSE(rle->test(25));
+    EXPECT_TRUE(rle->test(46));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffTest, DiffRLEArrayResultType) {
+    RLEContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 20; ++i) a.set(i);
+
+    CTy result_type;
+    auto* result = froaring_diff_ra(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::RLE);
+    EXPECT_EQ((static_cast<RLEContainer<uint32_t, 16>*>(result))->cardinality(), 11);
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffTest, DiffRLEBitmapLargeRuns) {
+    RLEContainer<uint32_t, 16> a;
+    BitmapContainer<uint32_t, 16> b;
+    for (uint32_t i = 0; i <= 20000; ++i) a.set(i);
+    for (uint32_t i = 0; i <= 20000; i += 2) b.set(i);
+
+    CTy result_type;
+    auto* result = froaring_diff_rb(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Bitmap);
+    auto* bitmap = static_cast<BitmapContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(bitmap->cardinality(), 10000);
+    EXPECT_FALSE(bitmap->test(0));
+    EXPECT_TRUE(bitmap->test(1));
+    EXPECT_TRUE(bitmap->test(19999));
+    EXPECT_FALSE(bitmap->test(20001));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffTest, DiffRLEBitmapRunAtMaxValue) {
+    RLEContainer<uint32_t, 16> a;
+    BitmapContainer<uint32_t, 16> b;
+    for (uint32_t i = 65530; i <= 65535; ++i) a.set(i);
+    b.set(65531);
+
+    CTy result_type;
+    auto* result = froaring_diff_rb(&a, &b, result_type);
+    // [65530] and [65532, 65535] are the smallest as RLE
+    EXPECT_EQ(result_type, CTy::RLE);
+    auto* rle = static_cast<RLEContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(rle->run_count, 2);
+    EXPECT_EQ(rle->cardinality(), 5);
+    EXPECT_TRUE(rle->test(65530));
+    EXPECT_FALSE(rle->test(65531));
+    EXPECT_TRUE(rle->test(65535));
+    release_container<uint32_t, 16>(result, result_type);
 }
 
 int main(int argc, char** argv) {
@@ -21,10 +21,11 @@ TEST_F(FroaringDiffInplaceTest, DiffInplaceBitmapBitmap) {
 
     CTy result_type;
     auto* result = froaring_diff_inplace_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffInplaceTest, DiffInplaceArrayArray) {
@@ -54,10 +55,11 @@ TEST_F(FroaringDiffInplaceTest, DiffInplaceBitmapArray) {
 
     CTy result_type;
     auto* result = froaring_diff_inplace_ba(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffInplaceTest, DiffInplaceArrayBitmap) {
@@ -89,11 +91,12 @@ TEST_F(FroaringDiffInplaceTest, DiffInplaceBitmapRLE) {
 
     CTy result_type;
     auto* result = froaring_diff_inplace_br(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(4));
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_FALSE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(4));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringDiffInplaceTest, DiffInplaceRLEBitmap) {
@@ -123,15 +126,52 @@ TEST_F(FroaringDiffInplaceTest, DiffInplaceRangeTest) {
 
     CTy result_type;
     auto* result = froaring_diff_inplace_bb(&a, &b, result_type);
-    EXPECT_EQ(result_type, CTy::Bitmap);
+    EXPECT_EQ(result_type, CTy::RLE);
     for (uint32_t i = 200; i <= 260; ++i) {
-        EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
     for (uint32_t i = 263; i <= 513; ++i) {
-        EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(261));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(262));
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(261));
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(262));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringDiffInplaceTest, DiffInplaceArrayArrayKeepsTail) {
+    ArrayContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    a.set(1);
+    a.set(2);
+    a.set(5);
+    a.set(9);
+    b.set(2);
+
+    CTy result_type;
+    auto* result = froaring_diff_inplace_aa(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_EQ(result, &a);
+    EXPECT_EQ(a.size, 3);
+    EXPECT_TRUE(a.test(1));
+    EXPECT_FALSE(a.test(2));
+    EXPECT_TRUE(a.test(5));
+    EXPECT_TRUE(a.test(9));
+}
+
+TEST_F(FroaringDiffInplaceTest, DiffInplaceArrayRLE) {
+    ArrayContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t v : {1u, 5u, 6u, 7u, 12u, 30u}) a.set(v);
+    for (uint32_t i = 5; i <= 12; ++i) b.set(i);
+
+    CTy result_type;
+    auto* result = froaring_diff_inplace_ar(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_EQ(result, &a);
+    EXPECT_EQ(a.size, 2);
+    EXPECT_TRUE(a.test(1));
+    EXPECT_FALSE(a.test(6));
+    EXPECT_TRUE(a.test(30));
 }
 
 int main(int argc, char** argv) {
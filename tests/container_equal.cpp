@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "froaring_api/equal.h"
+
+using namespace froaring;
+
+class FroaringEqualTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(FroaringEqualTest, EqualArrayRLE) {
+    ArrayContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    for (uint32_t i = 10; i <= 20; ++i) {
+        a.set(i);
+    }
+    b.set(10);
+    for (uint32_t i = 11; i <= 20; ++i) {
+        b.set(i);
+    }
+    EXPECT_TRUE(froaring_equal_ar(&a, &b));
+    EXPECT_TRUE((froaring_equal<uint32_t, 16>(&b, &a, CTy::RLE, CTy::Array)));
+
+    a.reset(15);
+    EXPECT_FALSE(froaring_equal_ar(&a, &b));
+}
+
+TEST_F(FroaringEqualTest, EqualBitmapArray) {
+    BitmapContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    for (uint32_t v : {3u, 40u, 41u, 100u, 65535u}) {
+        a.set(v);
+        b.set(v);
+    }
+    EXPECT_TRUE(froaring_equal_ba(&a, &b));
+    EXPECT_TRUE((froaring_equal<uint32_t, 16>(&b, &a, CTy::Array, CTy::Bitmap)));
+
+    b.reset(100);
+    b.set(101);
+    EXPECT_FALSE(froaring_equal_ba(&a, &b));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "froaring_api/or.h"
+
+using namespace froaring;
+
+class FroaringOrTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(FroaringOrTest, OrArrayArray) {
+    ArrayContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    a.set(1);
+    a.set(5);
+    b.set(5);
+    b.set(9);
+
+    CTy result_type;
+    auto* result = froaring_or_aa(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Array);
+    EXPECT_EQ((static_cast<ArrayContainer<uint32_t, 16>*>(result))->size, 3);
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(5));
+    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(9));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringOrTest, OrArrayArrayBecomesBitmap) {
+    // Each side is smallest as an array, the union is not: 5000 values in 3000 runs
+    ArrayContainer<uint32_t, 16> a;
+    ArrayContainer<uint32_t, 16> b;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        a.set(3 * i);
+    }
+    for (uint32_t i = 0; i < 2000; ++i) {
+        b.set(3 * i + 1);
+    }
+
+    CTy result_type;
+    auto* result = froaring_or_aa(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::Bitmap);
+    auto* bitmap = static_cast<BitmapContainer<uint32_t, 16>*>(result);
+    EXPECT_EQ(bitmap->cardinality(), 5000);
+    EXPECT_TRUE(bitmap->test(3999));
+    EXPECT_FALSE(bitmap->test(4001));
+    EXPECT_TRUE(bitmap->test(5998));
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+TEST_F(FroaringOrTest, OrRLERLECombinesRuns) {
+    RLEContainer<uint32_t, 16> a;
+    RLEContainer<uint32_t, 16> b;
+    a.set(1);
+    a.set(2);
+    for (uint32_t i = 10; i <= 20; ++i) a.set(i);
+    b.set(3);
+    b.set(4);
+    for (uint32_t i = 15; i <= 25; ++i) b.set(i);
+    b.set(40);
+
+    CTy result_type;
+    auto* result = froaring_or_rr(&a, &b, result_type);
+    EXPECT_EQ(result_type, CTy::RLE);
+    auto* rle = static_cast<RLEContainer<uint32_t, 16>*>(result);
+    // [1,2] + [3,4] => [1,4]; [10,20] + [15,25] => [10,25]
+    ASSERT_EQ(rle->run_count, 3);
+    EXPECT_EQ(rle->runs[0].start, 1);
+    EXPECT_EQ(rle->runs[0].end, 4);
+    EXPECT_EQ(rle->runs[1].start, 10);
+    EXPECT_EQ(rle->runs[1].end, 25);
+    EXPECT_EQ(rle->runs[2].start, 40);
+    EXPECT_EQ(rle->runs[2].end, 40);
+    release_container<uint32_t, 16>(result, result_type);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
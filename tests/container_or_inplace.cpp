@@ -21,10 +21,11 @@ TEST_F(FroaringOrInplaceTest, OrInplaceBitmapBitmap) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_bb(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
+    ASSERT_EQ(result_type, CTy::RLE);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceArrayArray) {
@@ -37,11 +38,12 @@ TEST_F(FroaringOrInplaceTest, OrInplaceArrayArray) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_aa(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Array);
-    ASSERT_EQ((static_cast<ArrayContainer<uint32_t, 16>*>(result))->size, 3);
-    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<ArrayContainer<uint32_t, 16>*>(result))->test(3));
+    ASSERT_EQ(result_type, CTy::RLE);
+    ASSERT_EQ((static_cast<RLEContainer<uint32_t, 16>*>(result))->run_count, 1);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceBitmapArray) {
@@ -54,10 +56,11 @@ TEST_F(FroaringOrInplaceTest, OrInplaceBitmapArray) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_ba(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
+    ASSERT_EQ(result_type, CTy::RLE);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceArrayBitmap) {
@@ -70,10 +73,11 @@ TEST_F(FroaringOrInplaceTest, OrInplaceArrayBitmap) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_ab(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
+    ASSERT_EQ(result_type, CTy::RLE);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceBitmapRLE) {
@@ -86,12 +90,13 @@ TEST_F(FroaringOrInplaceTest, OrInplaceBitmapRLE) {
     CTy result_type;
     a.debug_print();
     auto* result = froaring_or_inplace_br(&a, &b, result_type);
-    (static_cast<BitmapContainer<uint32_t, 16>*>(result))->debug_print();
-    ASSERT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(4));
+    (static_cast<RLEContainer<uint32_t, 16>*>(result))->debug_print();
+    ASSERT_EQ(result_type, CTy::RLE);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(4));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceRLEBitmap) {
@@ -105,11 +110,12 @@ TEST_F(FroaringOrInplaceTest, OrInplaceRLEBitmap) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_rb(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Bitmap);
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(1));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(2));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(3));
-    EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(4));
+    ASSERT_EQ(result_type, CTy::RLE);
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(1));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(2));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(3));
+    EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(4));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 TEST_F(FroaringOrInplaceTest, OrInplaceRangeTest) {
@@ -124,15 +130,16 @@ TEST_F(FroaringOrInplaceTest, OrInplaceRangeTest) {
 
     CTy result_type;
     auto* result = froaring_or_inplace_bb(&a, &b, result_type);
-    ASSERT_EQ(result_type, CTy::Bitmap);
+    ASSERT_EQ(result_type, CTy::RLE);
     for (uint32_t i = 200; i <= 260; ++i) {
-        EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
     for (uint32_t i = 263; i <= 513; ++i) {
-        EXPECT_TRUE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(i));
+        EXPECT_TRUE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(i));
     }
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(261));
-    EXPECT_FALSE((static_cast<BitmapContainer<uint32_t, 16>*>(result))->test(262));
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(261));
+    EXPECT_FALSE((static_cast<RLEContainer<uint32_t, 16>*>(result))->test(262));
+    if (result != &a) release_container<uint32_t, 16>(result, result_type);
 }
 
 int main(int argc, char** argv) {
@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+#include "api.h"
+
+using namespace froaring;
+
+// Cross-check every container-pair kernel against std::set on random inputs.
+namespace {
+using W = uint64_t;
+constexpr size_t D = 8;
+using ArraySized = ArrayContainer<W, D>;
+using BitmapSized = BitmapContainer<W, D>;
+using RLESized = RLEContainer<W, D>;
+using Set = std::set<size_t>;
+constexpr CTy AllTypes[] = {CTy::Array, CTy::Bitmap, CTy::RLE, CTy::Full};
+
+froaring_container_t* make_container(const Set& s, CTy type) {
+    switch (type) {
+        case CTy::Array: {
+            auto* c = new ArraySized();
+            for (auto v : s) c->set(v);
+            return c;
+        }
+        case CTy::Bitmap: {
+            auto* c = new BitmapSized();
+            for (auto v : s) c->set(v);
+            return c;
+        }
+        case CTy::RLE: {
+            auto* c = new RLESized();
+            for (auto v : s) c->set(v);
+            return c;
+        }
+        case CTy::Full:
+            return s.size() == (1 << D) ? full_container() : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+Set to_set(const froaring_container_t* c, CTy type) {
+    Set s;
+    for (size_t v = 0; v < (1 << D); ++v) {
+        bool present = false;
+        switch (type) {
+            case CTy::Array:
+                present = static_cast<const ArraySized*>(c)->test(v);
+                break;
+            case CTy::Bitmap:
+                present = static_cast<const BitmapSized*>(c)->test(v);
+                break;
+            case CTy::RLE:
+                present = static_cast<const RLESized*>(c)->test(v);
+                break;
+            case CTy::Full:
+                present = true;
+                break;
+            default:
+                ADD_FAILURE();
+        }
+        if (present) s.insert(v);
+    }
+    EXPECT_EQ((container_cardinality<W, D>(c, type)), s.size());
+    return s;
+}
+
+// Every kernel result should already be in the type chosen by the size policy.
+void expect_minimal(const froaring_container_t* c, CTy type) {
+    size_t card = container_cardinality<W, D>(c, type);
+    size_t runs = container_run_count<W, D>(c, type);
+    EXPECT_EQ((choose_container_type<W, D>(card, runs)), type) << "cardinality " << card << " runs " << runs;
+}
+
+Set random_set(std::mt19937& rng) {
+    Set s;
+    switch (rng() % 5) {
+        case 4:  // full
+            for (size_t v = 0; v < (1 << D); ++v) s.insert(v);
+            break;
+        case 0:  // empty or tiny
+            for (size_t i = rng() % 3; i > 0; --i) s.insert(rng() % (1 << D));
+            break;
+        case 1:  // sparse
+            for (size_t i = rng() % 20; i > 0; --i) s.insert(rng() % (1 << D));
+            break;
+        case 2:  // dense
+            for (size_t v = 0; v < (1 << D); ++v)
+                if (rng() % 4) s.insert(v);
+            break;
+        default:  // runs, touching both ends sometimes
+            for (size_t i = rng() % 6; i > 0; --i) {
+                size_t start = rng() % (1 << D);
+                size_t len = rng() % 80;
+                for (size_t v = start; v < std::min(start + len, size_t(1 << D)); ++v) s.insert(v);
+            }
+            if (rng() % 3 == 0) s.insert((1 << D) - 1);
+            if (rng() % 3 == 0) s.insert(0);
+    }
+    return s;
+}
+
+Set set_and(const Set& a, const Set& b) {
+    Set r;
+    for (auto v : a)
+        if (b.count(v)) r.insert(v);
+    return r;
+}
+Set set_or(const Set& a, const Set& b) {
+    Set r = a;
+    r.insert(b.begin(), b.end());
+    return r;
+}
+Set set_diff(const Set& a, const Set& b) {
+    Set r;
+    for (auto v : a)
+        if (!b.count(v)) r.insert(v);
+    return r;
+}
+}  // namespace
+
+TEST(ContainerRandomTest, BinaryKernels) {
+    std::mt19937 rng(2024);
+    for (int round = 0; round < 300; ++round) {
+        Set sa = random_set(rng), sb = random_set(rng);
+        for (auto ta : AllTypes) {
+            for (auto tb : AllTypes) {
+                SCOPED_TRACE(testing::Message() << "round " << round << " types " << int(ta) << "," << int(tb));
+                if ((ta == CTy::Full && sa.size() != (1 << D)) || (tb == CTy::Full && sb.size() != (1 << D))) {
+                    continue;  // Full only holds full sets
+                }
+                auto* a = make_container(sa, ta);
+                auto* b = make_container(sb, tb);
+                CTy rt;
+
+                auto* r = froaring_and<W, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set(r, rt), set_and(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                r = froaring_or<W, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set(r, rt), set_or(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                r = froaring_diff<W, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set(r, rt), set_diff(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                EXPECT_EQ((froaring_intersects<W, D>(a, b, ta, tb)), !set_and(sa, sb).empty());
+                EXPECT_EQ((froaring_contains<W, D>(a, b, ta, tb)), set_diff(sb, sa).empty());
+                EXPECT_EQ((froaring_equal<W, D>(a, b, ta, tb)), sa == sb);
+                EXPECT_TRUE((froaring_equal<W, D>(a, a, ta, ta)));
+
+                // In-place kernels consume `a`
+                auto* ai = make_container(sa, ta);
+                r = froaring_andi<W, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<W, D>(ai, ta);
+                EXPECT_EQ(to_set(r, rt), set_and(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                ai = make_container(sa, ta);
+                r = froaring_ori<W, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<W, D>(ai, ta);
+                EXPECT_EQ(to_set(r, rt), set_or(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                ai = make_container(sa, ta);
+                r = froaring_diffi<W, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<W, D>(ai, ta);
+                EXPECT_EQ(to_set(r, rt), set_diff(sa, sb));
+                expect_minimal(r, rt);
+                release_container<W, D>(r, rt);
+
+                release_container<W, D>(a, ta);
+                release_container<W, D>(b, tb);
+            }
+        }
+    }
+}
+
+TEST(ContainerRandomTest, OptimizeKeepsContentAndPicksSmallest) {
+    std::mt19937 rng(99);
+    for (int round = 0; round < 300; ++round) {
+        Set s = random_set(rng);
+        for (auto t : AllTypes) {
+            if (t == CTy::Full && s.size() != (1 << D)) {
+                continue;
+            }
+            auto* c = make_container(s, t);
+            CTy rt;
+            auto* r = optimize_container<W, D>(c, t, rt);
+            if (r != c) release_container<W, D>(c, t);
+            EXPECT_EQ(to_set(r, rt), s);
+            size_t runs = container_run_count<W, D>(r, rt);
+            size_t best = std::min({array_size_in_bytes<W, D>(s.size()), bitmap_size_in_bytes<W, D>(),
+                                    rle_size_in_bytes<W, D>(runs)});
+            switch (rt) {
+                case CTy::Array:
+                    EXPECT_EQ((array_size_in_bytes<W, D>(s.size())), best);
+                    break;
+                case CTy::Bitmap:
+                    EXPECT_EQ((bitmap_size_in_bytes<W, D>()), best);
+                    break;
+                case CTy::RLE:
+                    EXPECT_EQ((rle_size_in_bytes<W, D>(runs)), best);
+                    break;
+                case CTy::Full:  // no payload at all
+                    EXPECT_EQ(s.size(), 1 << D);
+                    break;
+                default:
+                    ADD_FAILURE();
+            }
+            shrink_container<W, D>(r, rt);
+            EXPECT_EQ(to_set(r, rt), s);
+            release_container<W, D>(r, rt);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -129,6 +129,30 @@ TEST(FlexibleRoaringTest, AndMixed) {
     // EXPECT_EQ(result.handle.type, CTy::Array);
 }
 
+TEST(FlexibleRoaringTest, AndOperatorEmptyResultIndex) {
+    FlexibleRoaring<uint32_t, 16, 16> bitmap1;
+    FlexibleRoaring<uint32_t, 16, 16> bitmap2;
+    bitmap1.set(1);
+    bitmap1.set(70000);
+    bitmap2.set(140000);
+    bitmap2.set(300000);
+
+    // No common keys: the result is an index without containers
+    FlexibleRoaring<uint32_t, 16, 16> empty;
+    empty.set(1);
+    empty.set(70000);
+    empty &= bitmap2;
+    EXPECT_EQ(empty.count(), 0);
+
+    auto and_result = empty & bitmap1;
+    EXPECT_EQ(and_result.count(), 0);
+    auto or_result = empty | bitmap1;
+    EXPECT_EQ(or_result.count(), 2);
+    EXPECT_TRUE(or_result.test(70000));
+    EXPECT_FALSE(empty.intersects(bitmap1));
+    EXPECT_FALSE(bitmap1.intersects(empty));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -22,6 +22,45 @@ TEST(FlexibleRoaringTest, AndInplace) {
     EXPECT_TRUE(bitmap1.test(3));
     EXPECT_FALSE(bitmap1.test(4));
 }
+TEST(FlexibleRoaringTest, AndInplaceIndexWithSingle) {
+    FlexibleRoaring<uint32_t, 16, 16> index;
+    index.set(1);
+    index.set(2);
+    index.set(70000);
+    FlexibleRoaring<uint32_t, 16, 16> single;
+    single.set(2);
+    single.set(3);
+
+    index &= single;
+    EXPECT_TRUE(index.test(2));
+    EXPECT_FALSE(index.test(1));
+    EXPECT_FALSE(index.test(70000));
+    EXPECT_EQ(index.count(), 1);
+
+    FlexibleRoaring<uint32_t, 16, 16> disjoint;
+    disjoint.set(5);
+    disjoint.set(70000);
+    FlexibleRoaring<uint32_t, 16, 16> other_single;
+    other_single.set(6);
+    disjoint &= other_single;
+    EXPECT_FALSE(disjoint.is_inited());
+    EXPECT_EQ(disjoint.count(), 0);
+}
+
+TEST(FlexibleRoaringTest, AndInplaceSingleWithIndex) {
+    FlexibleRoaring<uint32_t, 16, 16> single;
+    single.set(1);
+    single.set(2);
+    FlexibleRoaring<uint32_t, 16, 16> index;
+    index.set(2);
+    index.set(70000);
+
+    single &= index;
+    EXPECT_TRUE(single.test(2));
+    EXPECT_FALSE(single.test(1));
+    EXPECT_EQ(single.count(), 1);
+}
+
 }  // namespace froaring
 
 int main(int argc, char **argv) {
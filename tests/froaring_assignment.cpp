@@ -37,6 +37,56 @@ TEST_F(FlexibleRoaringTest, CopyAssignmentOperator) {
     EXPECT_TRUE(bitmap2.test(2));
 }
 
+TEST_F(FlexibleRoaringTest, MoveConstructorLeavesSourceEmpty) {
+    FlexibleRoaring<uint32_t, 16, 16> single;
+    single.set(1);
+    FlexibleRoaring<uint32_t, 16, 16> moved_single(std::move(single));
+    EXPECT_TRUE(moved_single.test(1));
+    EXPECT_FALSE(single.is_inited());
+
+    FlexibleRoaring<uint32_t, 16, 16> index;
+    index.set(1);
+    index.set(70000);
+    FlexibleRoaring<uint32_t, 16, 16> moved_index(std::move(index));
+    EXPECT_TRUE(moved_index.test(1));
+    EXPECT_TRUE(moved_index.test(70000));
+    EXPECT_FALSE(index.is_inited());
+}
+
+TEST_F(FlexibleRoaringTest, CopyAssignmentEdgeCases) {
+    FlexibleRoaring<uint32_t, 16, 16> bitmap1;
+    bitmap1.set(1);
+    bitmap1.set(70000);
+
+    bitmap1 = bitmap1;
+    EXPECT_TRUE(bitmap1.test(1));
+    EXPECT_TRUE(bitmap1.test(70000));
+    EXPECT_EQ(bitmap1.count(), 2);
+
+    FlexibleRoaring<uint32_t, 16, 16> empty;
+    bitmap1 = empty;
+    EXPECT_FALSE(bitmap1.is_inited());
+    EXPECT_EQ(bitmap1.count(), 0);
+}
+
+TEST_F(FlexibleRoaringTest, EqualityAcrossShapes) {
+    FlexibleRoaring<uint32_t, 16, 16> single;
+    single.set(1);
+    FlexibleRoaring<uint32_t, 16, 16> index;
+    index.set(1);
+    index.set(70000);
+    FlexibleRoaring<uint32_t, 16, 16> empty;
+
+    EXPECT_FALSE(index == single);
+    EXPECT_FALSE(single == index);
+    EXPECT_FALSE(single == empty);
+    EXPECT_FALSE(empty == single);
+    EXPECT_TRUE(empty == empty);
+
+    index.reset(70000);
+    EXPECT_EQ(single == index, index == single);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -97,6 +97,75 @@ TEST_F(FlexibleRoaringDiffTest, DiffRangeTest) {
     ASSERT_FALSE(result.test(262));
 }
 
+TEST_F(FlexibleRoaringDiffTest, DiffKeepsUnmatchedContainers) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(1);
+    a.set(70000);
+    a.set(140000);
+    a.set(300000);
+    b.set(1);
+    b.set(70000);
+
+    auto result = a - b;
+    EXPECT_FALSE(result.test(1));
+    EXPECT_FALSE(result.test(70000));
+    EXPECT_TRUE(result.test(140000));
+    EXPECT_TRUE(result.test(300000));
+    EXPECT_EQ(result.count(), 2);
+
+    a -= b;
+    EXPECT_FALSE(a.test(1));
+    EXPECT_FALSE(a.test(70000));
+    EXPECT_TRUE(a.test(140000));
+    EXPECT_TRUE(a.test(300000));
+    EXPECT_EQ(a.count(), 2);
+}
+
+TEST_F(FlexibleRoaringDiffTest, DiffInplaceKeepsContainersBeforeOtherKeys) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(1);
+    a.set(70000);
+    a.set(140000);
+    b.set(140000);
+    b.set(300000);
+
+    a -= b;
+    EXPECT_TRUE(a.test(1));
+    EXPECT_TRUE(a.test(70000));
+    EXPECT_FALSE(a.test(140000));
+    EXPECT_EQ(a.count(), 2);
+}
+
+TEST_F(FlexibleRoaringDiffTest, DiffSingleMinusIndex) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(1);
+    a.set(2);
+    b.set(2);
+    b.set(70000);
+    auto result = a - b;
+    EXPECT_TRUE(result.test(1));
+    EXPECT_FALSE(result.test(2));
+    EXPECT_EQ(result.count(), 1);
+
+    auto reversed = b - a;
+    EXPECT_TRUE(reversed.test(70000));
+    EXPECT_FALSE(reversed.test(2));
+    EXPECT_EQ(reversed.count(), 1);
+}
+
+TEST_F(FlexibleRoaringDiffTest, DiffSingleContainersDifferentIndexes) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(1);
+    b.set(70000);
+    auto result = a - b;
+    EXPECT_TRUE(result.test(1));
+    EXPECT_EQ(result.count(), 1);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -86,6 +86,19 @@ TEST_F(FlexibleRoaringIteratorTest, MixTest) {
     EXPECT_EQ(it, end);
 }
 
+TEST_F(FlexibleRoaringIteratorTest, SingleArrayContainerAwayFromZeroTest) {
+    FlexibleRoaring<uint32_t, 16, 8> bitmap;
+    bitmap.set(7 * 256 + 156);
+    bitmap.set(7 * 256 + 200);
+    auto it = FlexibleRoaringIterator<uint32_t, 16, 8>::begin(bitmap);
+    auto end = FlexibleRoaringIterator<uint32_t, 16, 8>::end(bitmap);
+    EXPECT_EQ(*it, 7 * 256 + 156);
+    ++it;
+    EXPECT_EQ(*it, 7 * 256 + 200);
+    ++it;
+    EXPECT_EQ(it, end);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -100,6 +100,65 @@ TEST_F(FroaringOrTest, OrOperatorRangeTest) {
     EXPECT_TRUE(result.test(513));
 }
 
+TEST_F(FroaringOrTest, OrOperatorSingleContainersDifferentIndexes) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(70000);
+    b.set(1);
+    auto result = a | b;
+    EXPECT_TRUE(result.test(1));
+    EXPECT_TRUE(result.test(70000));
+    EXPECT_EQ(result.count(), 2);
+}
+
+TEST_F(FroaringOrTest, OrOperatorFullIndex) {
+    // Every one of the 2^IndexBits containers is populated: the index size no longer fits in IndexType
+    FlexibleRoaring<uint64_t, 8, 8> a;
+    FlexibleRoaring<uint64_t, 8, 8> b;
+    for (uint64_t i = 0; i < 256; ++i) {
+        a.set(i << 8);
+        b.set((i << 8) | 1);
+    }
+    auto result = a | b;
+    EXPECT_EQ(result.count(), 512);
+    a |= b;
+    EXPECT_EQ(a.count(), 512);
+    EXPECT_TRUE(a == result);
+}
+
+TEST_F(FroaringOrTest, OrOperatorFullIndexWithSingleContainer) {
+    // The containers on the left and the single container on the right together fill the whole index
+    FlexibleRoaring<uint64_t, 8, 8> a;
+    FlexibleRoaring<uint64_t, 8, 8> b;
+    for (uint64_t i = 0; i < 255; ++i) {
+        a.set(i << 8);
+    }
+    b.set((255 << 8) | 1);
+    auto result = a | b;
+    EXPECT_EQ(result.count(), 256);
+    EXPECT_TRUE(result.test((255 << 8) | 1));
+    auto reversed = b | a;
+    EXPECT_EQ(reversed.count(), 256);
+    b |= a;
+    EXPECT_EQ(b.count(), 256);
+    EXPECT_TRUE(b == result);
+}
+
+TEST_F(FroaringOrTest, OrOperatorFullIndexAtSizeTypeBoundary) {
+    // 2^7 + 2^7 containers do not fit in SizeType (uint8_t) when IndexBits = 7
+    FlexibleRoaring<uint32_t, 7, 8> a;
+    FlexibleRoaring<uint32_t, 7, 8> b;
+    for (uint32_t i = 0; i < 128; ++i) {
+        a.set(i << 8);
+        b.set((i << 8) | 1);
+    }
+    auto result = a | b;
+    EXPECT_EQ(result.count(), 256);
+    a |= b;
+    EXPECT_EQ(a.count(), 256);
+    EXPECT_TRUE(a == result);
+}
+
 }  // namespace froaring
 
 int main(int argc, char** argv) {
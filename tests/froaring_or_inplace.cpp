@@ -103,6 +103,40 @@ TEST_F(FroaringOrTest, OrOperatorRangeTest) {
     EXPECT_TRUE(a.test(513));
 }
 
+TEST_F(FroaringOrTest, OrInplaceSingleWithIndex) {
+    FlexibleRoaring<uint32_t, 16, 16> a;
+    FlexibleRoaring<uint32_t, 16, 16> b;
+    a.set(140000);
+    b.set(2);
+    b.set(70000);
+    a |= b;
+    EXPECT_TRUE(a.test(2));
+    EXPECT_TRUE(a.test(70000));
+    EXPECT_TRUE(a.test(140000));
+    EXPECT_EQ(a.count(), 3);
+    EXPECT_EQ(b.count(), 2);
+
+    FlexibleRoaring<uint32_t, 16, 16> empty;
+    empty |= b;
+    EXPECT_TRUE(empty == b);
+}
+
+TEST_F(FroaringOrTest, OrOperatorEmptyIndices) {
+    FlexibleRoaring<uint64_t, 16, 8> a;
+    FlexibleRoaring<uint64_t, 16, 8> b;
+    // Two containers each, then emptied: both keep an index with no containers
+    for (uint64_t v : {1, 1000}) a.set(v);
+    for (uint64_t v : {2, 2000}) b.set(v);
+    for (uint64_t v : {1, 1000}) a.reset(v);
+    for (uint64_t v : {2, 2000}) b.reset(v);
+    a |= b;
+    EXPECT_EQ(a.count(), 0);
+    b.set(3000);
+    a |= b;
+    EXPECT_EQ(a.count(), 1);
+    EXPECT_TRUE(a.test(3000));
+}
+
 }  // namespace froaring
 
 int main(int argc, char** argv) {
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "lazy.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Set = std::set<uint64_t>;
+
+/// A time-range-like bitmap: whole containers `[first, last)`, plus a few loose values of other containers.
+Bitmap make_ranges(uint64_t first, uint64_t last, const Set& loose = {}) {
+    Bitmap b;
+    for (uint64_t v = first * 256; v < last * 256; ++v) b.set(v);
+    for (auto v : loose) b.set(v);
+    b.run_optimize();
+    return b;
+}
+
+Set to_set(const Bitmap& b) {
+    Set s;
+    for (auto it = b.begin(); it != b.end(); ++it) s.insert(*it);
+    return s;
+}
+}  // namespace
+
+TEST(FullContainerTest, SingleContainer) {
+    Bitmap b = make_ranges(3, 4);
+    ASSERT_EQ(b.handle.type, CTy::Full);
+    EXPECT_EQ(b.count(), 256);
+    EXPECT_EQ(b.memory_usage(), sizeof(Bitmap));
+    EXPECT_TRUE(b.test(3 * 256));
+    EXPECT_TRUE(b.test(4 * 256 - 1));
+    EXPECT_FALSE(b.test(4 * 256));
+    EXPECT_FALSE(b.test_and_set(3 * 256 + 9));
+    EXPECT_EQ(to_set(b).size(), 256);
+    EXPECT_EQ(*to_set(b).begin(), 3 * 256);
+
+    EXPECT_EQ(b.minimum(), 3 * 256);
+    EXPECT_EQ(b.maximum(), 4 * 256 - 1);
+    EXPECT_EQ(b.rank(3 * 256 + 10), 11);
+    uint64_t v = 0;
+    ASSERT_TRUE(b.select(200, v));
+    EXPECT_EQ(v, 3 * 256 + 200);
+    uint64_t out[3];
+    ASSERT_EQ(b.take_first(3, out), 3);
+    EXPECT_EQ(out[2], 3 * 256 + 2);
+    ASSERT_EQ(b.take_last(3, out), 3);
+    EXPECT_EQ(out[2], 4 * 256 - 3);
+
+    // Resetting a value turns it back into a run container, and setting the value refills it
+    b.reset(3 * 256 + 7);
+    EXPECT_EQ(b.handle.type, CTy::RLE);
+    EXPECT_EQ(b.count(), 255);
+    EXPECT_FALSE(b.test(3 * 256 + 7));
+    b.set(3 * 256 + 7);
+    EXPECT_EQ(b.handle.type, CTy::Full);
+    EXPECT_EQ(b.count(), 256);
+}
+
+TEST(FullContainerTest, CopiesAndSnapshotsShareNothingToFree) {
+    Bitmap b = make_ranges(0, 5);
+    Bitmap copy(b);
+    Bitmap snap = b.snapshot();
+    b.reset(2 * 256);
+    EXPECT_TRUE(copy.test(2 * 256));
+    EXPECT_TRUE(snap.test(2 * 256));
+    EXPECT_EQ(copy.count(), 5 * 256);
+    EXPECT_EQ(snap.count(), 5 * 256);
+    EXPECT_EQ(b.count(), 5 * 256 - 1);
+    copy.clear();
+    EXPECT_EQ(snap.count(), 5 * 256);
+}
+
+TEST(FullContainerTest, SetOperationsMatchMaterializedValues) {
+    std::mt19937_64 rng(47);
+    for (int round = 0; round < 30; ++round) {
+        Set loose_a, loose_b;
+        for (int i = 0; i < 50; ++i) loose_a.insert(rng() % (16 * 256));
+        for (int i = 0; i < 50; ++i) loose_b.insert(rng() % (16 * 256));
+        const uint64_t fa = rng() % 8, fb = rng() % 8;
+        const Bitmap a = make_ranges(fa, fa + rng() % 8, loose_a), b = make_ranges(fb, fb + rng() % 8, loose_b);
+        const Set sa = to_set(a), sb = to_set(b);
+
+        Set and_s, or_s = sa, diff_s;
+        for (auto v : sa) {
+            (sb.count(v) ? and_s : diff_s).insert(v);
+        }
+        or_s.insert(sb.begin(), sb.end());
+
+        EXPECT_EQ(to_set(a & b), and_s);
+        EXPECT_EQ(to_set(a | b), or_s);
+        EXPECT_EQ(to_set(a - b), diff_s);
+        EXPECT_EQ((a & b).count(), and_s.size());
+        EXPECT_EQ((a | b).count(), or_s.size());
+        EXPECT_EQ(a.intersects(b), !and_s.empty());
+        EXPECT_EQ(a.contains(b), and_s.size() == sb.size());
+        EXPECT_EQ(a == b, sa == sb);
+
+        Bitmap andi(a), ori(a), diffi(a);
+        andi &= b;
+        ori |= b;
+        diffi -= b;
+        EXPECT_TRUE(andi == (a & b));
+        EXPECT_TRUE(ori == (a | b));
+        EXPECT_TRUE(diffi == (a - b));
+
+        Bitmap lazy_result = (lazy(a) & b) | (lazy(b) - a);
+        EXPECT_TRUE(lazy_result == ((a & b) | (b - a)));
+        EXPECT_EQ(((lazy(a) | b) - a).count(), (b - a).count());
+
+        std::vector<uint64_t> queries(256);
+        for (auto& q : queries) q = rng() % (16 * 256);
+        std::vector<uint8_t> found(queries.size());
+        a.test_many(queries, found.data());
+        for (size_t i = 0; i < queries.size(); ++i) EXPECT_EQ(found[i], sa.count(queries[i]));
+    }
+}
+
+TEST(FullContainerTest, ShortcutsKeepTheOtherSide) {
+    const Bitmap full = make_ranges(0, 1);
+    Bitmap runs;
+    for (uint64_t v = 10; v < 200; ++v) runs.set(v);
+    runs.run_optimize();
+
+    Bitmap r = full & runs;
+    EXPECT_EQ(r.handle.type, CTy::RLE);
+    EXPECT_TRUE(r == runs);
+    r = full | runs;
+    EXPECT_EQ(r.handle.type, CTy::Full);
+    r = runs - full;
+    EXPECT_EQ(r.count(), 0);
+    r = full - runs;
+    EXPECT_EQ(r.count(), 256 - 190);
+    EXPECT_TRUE(full.contains(runs));
+    EXPECT_FALSE(runs.contains(full));
+    EXPECT_TRUE(full.contains(full));
+
+    r = Bitmap(runs);
+    r |= full;
+    EXPECT_EQ(r.handle.type, CTy::Full);
+    r &= runs;
+    EXPECT_TRUE(r == runs);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+// Enable the instrumentation hooks for this file only.
+#define FROARING_INSTRUMENT 1
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+#include "froaring.h"
+
+using namespace froaring;
+using namespace froaring::instrument;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+}
+
+TEST(InstrumentTest, CountsConversionsAndAllocations) {
+    reset();
+    ArrayContainer<uint64_t, 8> array;
+    for (uint64_t v = 0; v < 100; ++v) array.set(99 - v);  // every insertion shifts the existing values
+    auto* bitmap = array_to_bitmap<uint64_t, 8>(&array);
+    auto* back = bitmap_to_array<uint64_t, 8>(bitmap);
+
+    const auto c = snapshot();
+    EXPECT_EQ(c.event(Event::ArrayToBitmap), 1);
+    EXPECT_EQ(c.event(Event::BitmapToArray), 1);
+    EXPECT_GE(c.event(Event::Alloc), 2);
+    EXPECT_GE(c.event(Event::Realloc), 1);
+    EXPECT_EQ(c.event(Event::Memmove), 100);
+    EXPECT_EQ(c.event(Event::MemmoveBytes), 99 * 100 / 2);
+    delete bitmap;
+    delete back;
+}
+
+TEST(InstrumentTest, CountsKernelPairs) {
+    reset();
+    Bitmap a, b;
+    for (uint64_t v = 0; v < 10; ++v) a.set(v);
+    for (uint64_t v = 0; v < 100; ++v) b.set(v * 2);  // both bitmaps stay single containers
+    Bitmap r = a & b;
+    r |= b;
+    EXPECT_TRUE(a.intersects(b));
+
+    const auto c = snapshot();
+    EXPECT_EQ(c.calls(Kernel::And, a.handle.type, b.handle.type), 1);
+    EXPECT_EQ(c.calls(Kernel::Intersects, a.handle.type, b.handle.type), 1);
+    uint64_t or_calls = 0;
+    for (auto count : c.kernel_calls[static_cast<size_t>(Kernel::OrInplace)]) or_calls += count;
+    EXPECT_EQ(or_calls, 1);
+
+    std::ostringstream os;
+    dump(os, c);
+    EXPECT_NE(os.str().find("and/"), std::string::npos);
+}
+
+TEST(InstrumentTest, AggregatesThreads) {
+    reset();
+    auto work = [] {
+        ArrayContainer<uint64_t, 8> array;
+        auto* bitmap = array_to_bitmap<uint64_t, 8>(&array);
+        delete bitmap;
+    };
+    std::thread t1(work), t2(work);
+    t1.join();
+    t2.join();
+    work();
+    EXPECT_EQ(snapshot().event(Event::ArrayToBitmap), 3);
+    reset();
+    EXPECT_EQ(snapshot().event(Event::ArrayToBitmap), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
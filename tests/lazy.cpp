@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "lazy.h"
+
+using namespace froaring;
+
+namespace {
+/// Bitmaps mixing array, bitmap and run containers over a few keys, some keys shared and some not.
+template <typename Bitmap>
+std::vector<Bitmap> make_operands(uint64_t seed, uint64_t container_bits) {
+    std::mt19937_64 rng(seed);
+    const uint64_t span = uint64_t(1) << container_bits;
+    std::vector<Bitmap> operands;
+    for (int i = 0; i < 6; ++i) {
+        Bitmap b;
+        for (uint64_t key = 0; key < 12; ++key) {
+            switch (rng() % 4) {
+                case 0:  // absent
+                    break;
+                case 1:  // sparse
+                    for (int n = 0; n < 5; ++n) b.set(key * span + rng() % span);
+                    break;
+                case 2:  // dense
+                    for (uint64_t v = 0; v < span; ++v) {
+                        if (rng() % 3) b.set(key * span + v);
+                    }
+                    break;
+                default: {  // a few runs
+                    for (int r = 0; r < 3; ++r) {
+                        const uint64_t start = rng() % span, len = rng() % (span - start);
+                        for (uint64_t v = start; v <= start + len; ++v) b.set(key * span + v);
+                    }
+                }
+            }
+        }
+        b.run_optimize();
+        operands.push_back(std::move(b));
+    }
+    return operands;
+}
+
+template <typename Bitmap>
+void check_formulas(const std::vector<Bitmap>& o) {
+    const auto& [a, b, c, d, e, f] = std::tie(o[0], o[1], o[2], o[3], o[4], o[5]);
+    {
+        Bitmap lazy_result = (lazy(a) & b) | (lazy(c) - d);
+        EXPECT_TRUE(lazy_result == ((a & b) | (c - d)));
+        EXPECT_EQ(((lazy(a) & b) | (lazy(c) - d)).count(), ((a & b) | (c - d)).count());
+    }
+    {
+        Bitmap lazy_result = ((lazy(a) | b | c) - (lazy(d) & e)) & f;
+        EXPECT_TRUE(lazy_result == (((a | b | c) - (d & e)) & f));
+    }
+    {
+        Bitmap lazy_result = lazy(a) - b - c - d;
+        EXPECT_TRUE(lazy_result == (a - b - c - d));
+        EXPECT_EQ((lazy(a) & b & c & d & e & f).count(), (a & b & c & d & e & f).count());
+    }
+    {
+        Bitmap lazy_result = lazy(e);
+        EXPECT_TRUE(lazy_result == e);
+        Bitmap empty = lazy(a) - a;
+        EXPECT_FALSE(empty.is_inited());
+        EXPECT_EQ((lazy(a) & (lazy(b) - b)).count(), 0);
+    }
+}
+}  // namespace
+
+TEST(LazyTest, MatchesEagerOperators) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    for (uint64_t seed = 0; seed < 20; ++seed) {
+        check_formulas(make_operands<Bitmap>(seed, 8));
+    }
+}
+
+TEST(LazyTest, MatchesEagerOperatorsOnWideContainers) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 12>;
+    for (uint64_t seed = 0; seed < 5; ++seed) {
+        check_formulas(make_operands<Bitmap>(seed, 12));
+    }
+}
+
+TEST(LazyTest, ResultContainersHaveTheSmallestType) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    Bitmap runs, sparse, all;
+    for (uint64_t v = 0; v < 256; ++v) all.set(v);
+    for (uint64_t v = 10; v < 200; ++v) runs.set(v);
+    sparse.set(3);
+    sparse.set(77);
+    Bitmap r = lazy(all) & runs;
+    EXPECT_EQ(r.handle.type, CTy::RLE);
+    EXPECT_EQ(r.count(), 190);
+    r = lazy(all) & sparse;
+    EXPECT_EQ(r.handle.type, CTy::Array);
+    EXPECT_EQ(r.count(), 2);
+}
+
+TEST(LazyTest, SingleContainerKeepsItsIndex) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    Bitmap a, b;
+    a.set(5 * 256 + 1);
+    a.set(9 * 256 + 2);
+    b.set(9 * 256 + 2);
+    Bitmap r = lazy(a) & b;
+    EXPECT_EQ(r.count(), 1);
+    EXPECT_TRUE(r.test(9 * 256 + 2));
+    EXPECT_FALSE(r.test(2));
+}
+
+TEST(LazyTest, FirstNMatchesMaterializedResult) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    auto check = [](const Bitmap& expected, auto first_n) {
+        std::vector<uint64_t> all(expected.count());
+        expected.take_first(all.size(), all.data());
+        for (size_t offset : {size_t(0), size_t(1), size_t(37), size_t(300), all.size() / 2, all.size()}) {
+            for (size_t n : {size_t(0), size_t(1), size_t(10), size_t(1000), all.size()}) {
+                std::vector<uint64_t> out(n);
+                const size_t written = first_n(n, out.data(), offset);
+                const size_t available = offset < all.size() ? all.size() - offset : 0;
+                ASSERT_EQ(written, std::min(n, available));
+                EXPECT_TRUE(std::equal(out.begin(), out.begin() + written, all.begin() + offset));
+            }
+        }
+    };
+    for (uint64_t seed = 0; seed < 10; ++seed) {
+        const auto o = make_operands<Bitmap>(seed, 8);
+        const Bitmap &a = o[0], &b = o[1];
+        check(a & b, [&](size_t n, uint64_t* out, size_t offset) { return and_first_n(a, b, n, out, offset); });
+        check(a | b, [&](size_t n, uint64_t* out, size_t offset) { return or_first_n(a, b, n, out, offset); });
+        check(a - b, [&](size_t n, uint64_t* out, size_t offset) { return andnot_first_n(a, b, n, out, offset); });
+        check((a & b) | (o[2] - o[3]), [&](size_t n, uint64_t* out, size_t offset) {
+            return ((lazy(a) & b) | (lazy(o[2]) - o[3])).take_first(n, out, offset);
+        });
+    }
+}
+
+TEST(LazyTest, FirstNOfEmptyOperands) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    Bitmap empty, b;
+    b.set(3 * 256 + 7);
+    uint64_t out[4] = {};
+    EXPECT_EQ(and_first_n(empty, b, 4, out), 0);
+    EXPECT_EQ(andnot_first_n(empty, b, 4, out), 0);
+    EXPECT_EQ(andnot_first_n(b, b, 4, out), 0);
+    ASSERT_EQ(or_first_n(empty, b, 4, out), 1);
+    EXPECT_EQ(out[0], 3 * 256 + 7);
+    EXPECT_EQ(or_first_n(empty, b, 4, out, 1), 0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Set = std::set<uint64_t>;
+
+template <typename Container>
+void check_container(const Container& c, const Set& s) {
+    std::vector<uint64_t> ascending(s.begin(), s.end());
+    std::vector<uint64_t> descending(s.rbegin(), s.rend());
+    EXPECT_EQ(c.minimum(), ascending.front());
+    EXPECT_EQ(c.maximum(), ascending.back());
+    for (size_t n : {size_t(0), size_t(1), size_t(3), s.size(), s.size() + 5}) {
+        std::vector<uint64_t> out(n + 1, 0);
+        size_t written = c.take_first(n, uint64_t(1000), out.data());
+        ASSERT_EQ(written, std::min(n, s.size()));
+        for (size_t i = 0; i < written; ++i) EXPECT_EQ(out[i], 1000 + ascending[i]);
+        written = c.take_last(n, uint64_t(1000), out.data());
+        ASSERT_EQ(written, std::min(n, s.size()));
+        for (size_t i = 0; i < written; ++i) EXPECT_EQ(out[i], 1000 + descending[i]);
+    }
+}
+}  // namespace
+
+TEST(MinMaxTest, ContainerKernels) {
+    std::mt19937 rng(3);
+    for (int round = 0; round < 100; ++round) {
+        Set s;
+        // Include both ends of the container sometimes, where run and word arithmetic may wrap around
+        if (rng() % 3 == 0) s.insert(0);
+        if (rng() % 3 == 0) s.insert(255);
+        for (size_t i = rng() % 5; i > 0; --i) {
+            size_t start = rng() % 256;
+            for (size_t v = start; v < std::min(start + rng() % 40, size_t(256)); ++v) s.insert(v);
+        }
+        s.insert(rng() % 256);
+        ArrayContainer<uint64_t, 8> array;
+        BitmapContainer<uint64_t, 8> bitmap;
+        RLEContainer<uint64_t, 8> rle;
+        for (auto v : s) {
+            array.set(v);
+            bitmap.set(v);
+            rle.set(v);
+        }
+        check_container(array, s);
+        check_container(bitmap, s);
+        check_container(rle, s);
+    }
+}
+
+TEST(MinMaxTest, EmptyBitmap) {
+    FlexibleRoaring<uint64_t, 16, 8> bitmap;
+    EXPECT_EQ(bitmap.minimum(), std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(bitmap.maximum(), 0);
+    uint64_t out[4];
+    EXPECT_EQ(bitmap.take_first(4, out), 0);
+    EXPECT_EQ(bitmap.take_last(4, out), 0);
+    bitmap.set(7);
+    bitmap.reset(7);
+    EXPECT_EQ(bitmap.minimum(), std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(bitmap.take_last(4, out), 0);
+}
+
+TEST(MinMaxTest, AcrossContainers) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    std::mt19937 rng(77);
+    for (int round = 0; round < 100; ++round) {
+        Bitmap bitmap;
+        Set reference;
+        for (size_t i = rng() % 300 + 1; i > 0; --i) {
+            uint64_t v = rng() % 4000;
+            bitmap.set(v);
+            reference.insert(v);
+        }
+        if (round % 2) bitmap.run_optimize();  // mix in bitmap and RLE containers
+
+        EXPECT_EQ(bitmap.minimum(), *reference.begin());
+        EXPECT_EQ(bitmap.maximum(), *reference.rbegin());
+
+        size_t n = rng() % (reference.size() + 3);
+        std::vector<uint64_t> out(n);
+        ASSERT_EQ(bitmap.take_first(n, out.data()), std::min(n, reference.size()));
+        auto it = reference.begin();
+        for (size_t i = 0; i < std::min(n, reference.size()); ++i, ++it) EXPECT_EQ(out[i], *it);
+        ASSERT_EQ(bitmap.take_last(n, out.data()), std::min(n, reference.size()));
+        auto rit = reference.rbegin();
+        for (size_t i = 0; i < std::min(n, reference.size()); ++i, ++rit) EXPECT_EQ(out[i], *rit);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
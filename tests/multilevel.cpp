@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "multilevel.h"
+
+using namespace froaring;
+
+namespace {
+/// Three layers over the whole 64-bit space: 20 + 20 high bits above a 16 + 8 bit BinsearchIndex.
+using Index = MultiLevelIndex<MultiLevelIndex<BinsearchIndex<uint64_t, 16, 8>, 20>, 20>;
+
+/// Clustered ids spread over the 64-bit space, so that every layer has several keys and some of them are shared.
+std::set<uint64_t> make_values(uint64_t seed, size_t n) {
+    std::mt19937_64 rng(seed);
+    const uint64_t prefixes[] = {0, 1ull << 44, 3ull << 44, 0xfffffull << 44, (7ull << 44) | (5ull << 24)};
+    std::set<uint64_t> values;
+    while (values.size() < n) {
+        values.insert(prefixes[rng() % 5] | (rng() % 4) << 24 | rng() % 4096);
+    }
+    return values;
+}
+
+Index* make_index(const std::set<uint64_t>& values) {
+    auto index = new Index();
+    for (auto v : values) index->set(v);
+    return index;
+}
+
+void expect_same(const Index* index, const std::set<uint64_t>& expected) {
+    ASSERT_EQ(index->cardinality(), expected.size());
+    for (auto v : expected) {
+        ASSERT_TRUE(index->test(v)) << v;
+    }
+}
+}  // namespace
+
+TEST(MultiLevelIndexTest, SetTestReset) {
+    auto values = make_values(1, 3000);
+    auto index = make_index(values);
+    expect_same(index, values);
+    EXPECT_FALSE(index->test(2ull << 44));
+    EXPECT_TRUE(index->test_and_set(~0ull));  // newly set
+    EXPECT_FALSE(index->test_and_set(~0ull));
+    values.insert(~0ull);
+    expect_same(index, values);
+
+    std::mt19937_64 rng(2);
+    for (auto it = values.begin(); it != values.end();) {
+        if (rng() % 2) {
+            index->reset(*it);
+            it = values.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    expect_same(index, values);
+    for (auto v : values) index->reset(v);
+    EXPECT_EQ(index->size, 0);
+    EXPECT_EQ(index->cardinality(), 0);
+    delete index;
+}
+
+TEST(MultiLevelIndexTest, SetOperationsRecurse) {
+    for (uint64_t seed = 0; seed < 5; ++seed) {
+        const auto va = make_values(2 * seed, 2000), vb = make_values(2 * seed + 1, 2000);
+        auto a = make_index(va), b = make_index(vb);
+        std::set<uint64_t> and_v, or_v, diff_v;
+        std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(and_v, and_v.end()));
+        std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(or_v, or_v.end()));
+        std::set_difference(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(diff_v, diff_v.end()));
+
+        auto and_r = Index::and_(a, b), or_r = Index::or_(a, b), diff_r = Index::diff(a, b);
+        expect_same(and_r, and_v);
+        expect_same(or_r, or_v);
+        expect_same(diff_r, diff_v);
+        EXPECT_EQ(Index::intersects(a, b), !and_v.empty());
+        EXPECT_TRUE(Index::contains(or_r, a));
+        EXPECT_TRUE(Index::contains(a, diff_r));
+        EXPECT_FALSE(Index::contains(diff_r, b));
+        EXPECT_FALSE(Index::intersects(diff_r, b));
+
+        Index andi_r(*a), ori_r(*a), diffi_r(*a);
+        Index::andi(&andi_r, b);
+        Index::ori(&ori_r, b);
+        Index::diffi(&diffi_r, b);
+        EXPECT_TRUE(Index::equals(&andi_r, and_r));
+        EXPECT_TRUE(Index::equals(&ori_r, or_r));
+        EXPECT_TRUE(Index::equals(&diffi_r, diff_r));
+        EXPECT_FALSE(Index::equals(a, b));
+
+        // Emptied children are released at every layer
+        Index::diffi(&ori_r, or_r);
+        EXPECT_EQ(ori_r.size, 0);
+        auto empty = Index::and_(diff_r, b);
+        EXPECT_EQ(empty->size, 0);
+        delete empty;
+
+        for (auto p : {a, b, and_r, or_r, diff_r}) delete p;
+    }
+}
+
+TEST(MultiLevelIndexTest, OrOfFullLayersAtSizeTypeBoundary) {
+    // 2^7 + 2^7 children do not fit in SizeType (uint8_t) when HighBits = 7
+    using Small = MultiLevelIndex<BinsearchIndex<uint32_t, 4, 8>, 7>;
+    Small a, b;
+    for (uint32_t high = 0; high < 128; ++high) {
+        a.set(high << 12);
+        b.set((high << 12) | 1);
+    }
+    auto or_r = Small::or_(&a, &b);
+    EXPECT_EQ(or_r->size, 128);
+    EXPECT_EQ(or_r->cardinality(), 256);
+    Small::ori(&a, &b);
+    EXPECT_TRUE(Small::equals(&a, or_r));
+    delete or_r;
+}
+
+TEST(MultiLevelIndexTest, OptimizeKeepsValues) {
+    Index index;
+    for (uint64_t v = 0; v < 5000; ++v) index.set((9ull << 44) + v);
+    index.set(1);
+    const size_t before = index.memory_usage();
+    index.run_optimize();
+    EXPECT_LT(index.memory_usage(), before);
+    EXPECT_EQ(index.cardinality(), 5001);
+    EXPECT_TRUE(index.test((9ull << 44) + 4999));
+    EXPECT_TRUE(index.test(1));
+    EXPECT_FALSE(index.test((9ull << 44) + 5000));
+}
+
+TEST(MultiLevelRoaringTest, IteratesInOrder) {
+    FlexibleRoaring64 empty;
+    EXPECT_TRUE(empty.begin() == empty.end());
+    EXPECT_EQ(empty.count(), 0);
+    EXPECT_EQ(empty.minimum(), ~0ull);
+    EXPECT_EQ(empty.maximum(), 0);
+
+    auto values = make_values(7, 3000);
+    values.insert(~0ull);
+    FlexibleRoaring64 b;
+    for (auto v : values) b.set(v);
+    b.run_optimize();  // mixes container types in the leaves
+    std::vector<uint64_t> iterated;
+    for (auto it = b.begin(); it != b.end(); ++it) iterated.push_back(*it);
+    EXPECT_EQ(iterated, std::vector<uint64_t>(values.begin(), values.end()));
+    EXPECT_EQ(b.count(), values.size());
+    EXPECT_EQ(b.minimum(), *values.begin());
+    EXPECT_EQ(b.maximum(), ~0ull);
+
+    b.reset(~0ull);
+    EXPECT_EQ(b.maximum(), *std::next(values.rbegin()));
+    b.clear();
+    EXPECT_TRUE(b.begin() == b.end());
+}
+
+TEST(MultiLevelRoaringTest, SetOperators) {
+    const auto va = make_values(8, 2000), vb = make_values(9, 2000);
+    FlexibleRoaring64 a, b;
+    for (auto v : va) a.set(v);
+    for (auto v : vb) b.set(v);
+    auto expect_values = [](const FlexibleRoaring64& r, const std::set<uint64_t>& expected) {
+        std::vector<uint64_t> iterated;
+        for (auto it = r.begin(); it != r.end(); ++it) iterated.push_back(*it);
+        EXPECT_EQ(iterated, std::vector<uint64_t>(expected.begin(), expected.end()));
+    };
+    std::set<uint64_t> and_v, or_v, diff_v;
+    std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(and_v, and_v.end()));
+    std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(or_v, or_v.end()));
+    std::set_difference(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(diff_v, diff_v.end()));
+
+    expect_values(a & b, and_v);
+    expect_values(a | b, or_v);
+    expect_values(a - b, diff_v);
+    EXPECT_EQ(a.intersects(b), !and_v.empty());
+    EXPECT_TRUE((a | b).contains(a));
+    EXPECT_FALSE((a - b).intersects(b));
+
+    FlexibleRoaring64 c = a;
+    EXPECT_TRUE(c == a);
+    c &= b;
+    EXPECT_TRUE(c == (a & b));
+    c = a;
+    c |= b;
+    EXPECT_TRUE(c == (a | b));
+    c = a;
+    c -= b;
+    EXPECT_TRUE(c == (a - b));
+    EXPECT_TRUE(c != a);
+
+    // Operands that were never set, or moved from, are empty
+    FlexibleRoaring64 empty, moved = std::move(c);
+    EXPECT_TRUE(c == empty);
+    EXPECT_TRUE((a & empty) == empty);
+    EXPECT_TRUE((empty | a) == a);
+    empty |= a;
+    EXPECT_TRUE(empty == a);
+    a -= a;
+    EXPECT_EQ(a.count(), 0);
+    EXPECT_EQ(moved.count(), diff_v.size());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
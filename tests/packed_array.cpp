@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "lazy.h"
+
+using namespace froaring;
+
+namespace {
+using Set = std::set<size_t>;
+
+static_assert(PackedArrayContainer<uint64_t, 12>::Enabled && PackedArrayContainer<uint64_t, 20>::Enabled);
+static_assert(!PackedArrayContainer<uint64_t, 8>::Enabled && !PackedArrayContainer<uint64_t, 16>::Enabled);
+
+template <size_t D>
+Set random_values(std::mt19937& rng, size_t n) {
+    Set s;
+    while (s.size() < n) s.insert(rng() % (size_t(1) << D));
+    return s;
+}
+
+template <size_t D>
+froaring_container_t* make_container(const Set& s, CTy type) {
+    auto array = new ArrayContainer<uint64_t, D>();
+    for (auto v : s) array->set(v);
+    if (type == CTy::Array) {
+        return array;
+    }
+    auto c = convert_container<uint64_t, D>(array, CTy::Array, type);
+    delete array;
+    return c;
+}
+
+template <size_t D>
+Set to_set(const froaring_container_t* c, CTy type) {
+    Set s;
+    for (size_t v = 0; v < (size_t(1) << D); ++v) {
+        if (container_rank<uint64_t, D>(c, type, v) != (v == 0 ? 0 : container_rank<uint64_t, D>(c, type, v - 1))) {
+            s.insert(v);
+        }
+    }
+    return s;
+}
+
+template <size_t D>
+void check_container(const Set& s) {
+    using Packed = PackedArrayContainer<uint64_t, D>;
+    auto array = static_cast<ArrayContainer<uint64_t, D>*>(make_container<D>(s, CTy::Array));
+    Packed packed(array);
+    const std::vector<size_t> values(s.begin(), s.end());
+    ASSERT_EQ(packed.cardinality(), values.size());
+    EXPECT_EQ((packed_size_in_bytes<uint64_t, D>(values.size())), (values.size() * D + 63) / 64 * 8);
+    for (size_t i = 0; i < values.size(); ++i) ASSERT_EQ(packed.get(i), values[i]);
+
+    auto unpacked = packed.to_array();
+    EXPECT_TRUE((froaring_equal<uint64_t, D>(unpacked, array, CTy::Array, CTy::Array)));
+    delete unpacked;
+
+    std::mt19937 rng(D);
+    for (int i = 0; i < 500; ++i) {
+        const size_t v = rng() % (size_t(1) << D);
+        EXPECT_EQ(packed.lower_bound(v), array->lower_bound(v)) << v;
+        EXPECT_EQ(packed.test(v), array->test(v)) << v;
+    }
+    for (auto v : values) EXPECT_TRUE(packed.test(v));
+    if (!values.empty()) {
+        EXPECT_EQ(packed.minimum(), values.front());
+        EXPECT_EQ(packed.maximum(), values.back());
+        EXPECT_EQ(packed.select(values.size() / 2), values[values.size() / 2]);
+    }
+    EXPECT_EQ(packed.count_runs(), array->count_runs());
+    delete array;
+}
+}  // namespace
+
+TEST(PackedArrayTest, PacksAndDecodesValues) {
+    std::mt19937 rng(48);
+    for (size_t n : {0, 1, 5, 63, 64, 65, 200, 341}) {
+        check_container<12>(random_values<12>(rng, n));
+        check_container<10>(random_values<10>(rng, std::min<size_t>(n, 100)));
+        check_container<20>(random_values<20>(rng, n));
+    }
+    Set ends = {0, 1, 4094, 4095};
+    check_container<12>(ends);
+}
+
+TEST(PackedArrayTest, PolicyPrefersItWhenSmaller) {
+    EXPECT_EQ((choose_container_type<uint64_t, 12>(1, 1)), CTy::Array);  // one word is larger than 2 bytes
+    EXPECT_EQ((choose_container_type<uint64_t, 12>(100, 100)), CTy::PackedArray);
+    EXPECT_EQ((choose_container_type<uint64_t, 12>(341, 341)), CTy::PackedArray);  // beyond 256 values of Array
+    EXPECT_EQ((choose_container_type<uint64_t, 12>(400, 400)), CTy::Bitmap);
+    EXPECT_EQ((choose_container_type<uint64_t, 12>(100, 2)), CTy::RLE);
+    EXPECT_EQ((choose_container_type<uint64_t, 16>(100, 100)), CTy::Array);
+    EXPECT_EQ((choose_container_type<uint64_t, 8>(10, 10)), CTy::Array);
+}
+
+TEST(PackedArrayTest, KernelsMatchStdSet) {
+    constexpr size_t D = 12;
+    constexpr CTy Types[] = {CTy::Array, CTy::Bitmap, CTy::RLE, CTy::PackedArray};
+    std::mt19937 rng(2048);
+    for (int round = 0; round < 30; ++round) {
+        const Set sa = random_values<D>(rng, rng() % 300), sb = random_values<D>(rng, rng() % 300);
+        Set and_s, or_s = sa, diff_s;
+        for (auto v : sa) (sb.count(v) ? and_s : diff_s).insert(v);
+        or_s.insert(sb.begin(), sb.end());
+        for (auto ta : Types) {
+            for (auto tb : Types) {
+                SCOPED_TRACE(testing::Message() << "round " << round << " types " << int(ta) << "," << int(tb));
+                auto a = make_container<D>(sa, ta), b = make_container<D>(sb, tb);
+                CTy rt;
+                auto r = froaring_and<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), and_s);
+                EXPECT_EQ(rt, (choose_container_type<uint64_t, D>(and_s.size(),
+                                                                  container_run_count<uint64_t, D>(r, rt))));
+                release_container<uint64_t, D>(r, rt);
+                r = froaring_or<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), or_s);
+                release_container<uint64_t, D>(r, rt);
+                r = froaring_diff<uint64_t, D>(a, b, ta, tb, rt);
+                EXPECT_EQ(to_set<D>(r, rt), diff_s);
+                release_container<uint64_t, D>(r, rt);
+                EXPECT_EQ((froaring_intersects<uint64_t, D>(a, b, ta, tb)), !and_s.empty());
+                EXPECT_EQ((froaring_contains<uint64_t, D>(a, b, ta, tb)), and_s.size() == sb.size());
+                EXPECT_EQ((froaring_equal<uint64_t, D>(a, b, ta, tb)), sa == sb);
+                EXPECT_TRUE((froaring_equal<uint64_t, D>(a, a, ta, ta)));
+
+                auto ai = make_container<D>(sa, ta);
+                r = froaring_andi<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), and_s);
+                release_container<uint64_t, D>(r, rt);
+                ai = make_container<D>(sa, ta);
+                r = froaring_ori<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), or_s);
+                release_container<uint64_t, D>(r, rt);
+                ai = make_container<D>(sa, ta);
+                r = froaring_diffi<uint64_t, D>(ai, b, ta, tb, rt);
+                if (r != ai) release_container<uint64_t, D>(ai, ta);
+                EXPECT_EQ(to_set<D>(r, rt), diff_s);
+                release_container<uint64_t, D>(r, rt);
+
+                release_container<uint64_t, D>(a, ta);
+                release_container<uint64_t, D>(b, tb);
+            }
+        }
+    }
+}
+
+TEST(PackedArrayTest, BitmapsPackSparseContainers) {
+    using Bitmap = FlexibleRoaring<uint64_t, 20, 12>;
+    std::mt19937 rng(12);
+    Bitmap b;
+    Set values;
+    for (size_t key = 0; key < 50; ++key) {
+        for (int i = 0; i < 150; ++i) values.insert(key * 4096 + rng() % 4096);
+    }
+    for (auto v : values) b.set(v);
+    b.shrink_to_fit();
+    const size_t unpacked_bytes = b.memory_usage();
+    Bitmap copy(b);
+    b.run_optimize();
+    EXPECT_LT(b.memory_usage(), unpacked_bytes);
+    EXPECT_TRUE(b == copy);
+    EXPECT_EQ(b.count(), values.size());
+
+    std::vector<uint64_t> iterated;
+    for (auto it = b.begin(); it != b.end(); ++it) iterated.push_back(*it);
+    EXPECT_EQ(iterated, std::vector<uint64_t>(values.begin(), values.end()));
+    EXPECT_EQ(b.minimum(), *values.begin());
+    EXPECT_EQ(b.maximum(), *values.rbegin());
+    EXPECT_EQ(b.rank(*values.rbegin()), values.size());
+    uint64_t v = 0;
+    ASSERT_TRUE(b.select(1000, v));
+    EXPECT_EQ(v, *std::next(values.begin(), 1000));
+    std::vector<uint64_t> queries(values.begin(), std::next(values.begin(), 200));
+    queries.push_back(4096 * 60);
+    std::vector<uint8_t> found(queries.size());
+    b.test_many(queries, found.data());
+    for (size_t i = 0; i < queries.size(); ++i) EXPECT_EQ(found[i], values.count(queries[i]));
+
+    // Set operations and lazy formulas over packed containers
+    Bitmap other;
+    for (auto x : values) {
+        if (x % 3 == 0) other.set(x + 1);
+    }
+    other.run_optimize();
+    Bitmap eager_and = b & other, eager_or = b | other, eager_diff = b - other;
+    Bitmap lazy_and = lazy(b) & other, lazy_or = lazy(b) | other, lazy_diff = lazy(b) - other;
+    EXPECT_TRUE(eager_and == lazy_and);
+    EXPECT_TRUE(eager_or == lazy_or);
+    EXPECT_TRUE(eager_diff == lazy_diff);
+    EXPECT_EQ(eager_and.count() + eager_diff.count(), b.count());
+
+    // Mutations unpack the touched container only
+    const uint64_t absent = 7 * 4096 + 1;
+    values.erase(absent);
+    b.reset(absent);
+    EXPECT_FALSE(b.test(absent));
+    EXPECT_FALSE(b.test_and_set(*values.begin()));
+    EXPECT_TRUE(b.test_and_set(absent));
+    b.reset(*values.begin());
+    EXPECT_FALSE(b.test(*values.begin()));
+    EXPECT_EQ(b.count(), values.size());
+
+    Bitmap snap = b.snapshot();
+    b.set(absent + 1);
+    EXPECT_FALSE(snap.test(absent + 1));
+}
+
+TEST(PackedArrayTest, SingleContainer) {
+    using Bitmap = FlexibleRoaring<uint64_t, 20, 12>;
+    Bitmap b;
+    for (uint64_t v = 5; v < 4096; v += 37) b.set(v);
+    b.run_optimize();
+    ASSERT_EQ(b.handle.type, CTy::PackedArray);
+    Bitmap copy(b);
+    EXPECT_TRUE(copy == b);
+    EXPECT_TRUE(b.test(42));
+    EXPECT_FALSE(b.test(43));
+    b.set(43);
+    EXPECT_EQ(b.handle.type, CTy::Array);
+    EXPECT_TRUE(b.test(43));
+    EXPECT_EQ(b.count(), copy.count() + 1);
+    EXPECT_TRUE(copy.test(42));
+    EXPECT_FALSE(copy.test(43));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "query.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Q = Query<Bitmap>;
+using Reference = std::set<uint64_t>;
+
+Reference to_set(const Bitmap& b) {
+    Reference s;
+    for (auto it = b.begin(); it != b.end(); ++it) s.insert(*it);
+    return s;
+}
+
+Reference apply(Q::Op op, const Reference& a, const Reference& b) {
+    Reference r;
+    switch (op) {
+        case Q::Op::And:
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(r, r.end()));
+            break;
+        case Q::Op::Or:
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(r, r.end()));
+            break;
+        case Q::Op::AndNot:
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(r, r.end()));
+            break;
+        case Q::Op::Xor:
+            std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(r, r.end()));
+            break;
+        default:
+            break;
+    }
+    return r;
+}
+
+Q combine(Q::Op op, Q a, Q b) {
+    switch (op) {
+        case Q::Op::And:
+            return a & b;
+        case Q::Op::Or:
+            return a | b;
+        case Q::Op::AndNot:
+            return a - b;
+        default:
+            return a ^ b;
+    }
+}
+
+struct Fixture {
+    std::vector<Bitmap> leaves;
+    std::vector<Reference> references;
+
+    explicit Fixture(uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        // Densities from empty to dense, over a handful of containers
+        for (uint64_t density : {0, 1, 3, 20, 60, 128, 200, 250}) {
+            Bitmap b;
+            Reference r;
+            for (uint64_t v = 0; v < 8 * 256; ++v) {
+                if (rng() % 256 < density) {
+                    b.set(v);
+                    r.insert(v);
+                }
+            }
+            leaves.push_back(std::move(b));
+            references.push_back(std::move(r));
+        }
+    }
+
+    /// A random expression of the given depth, with its expected result.
+    std::pair<Q, Reference> random_query(std::mt19937_64& rng, int depth) const {
+        if (depth == 0 || rng() % 4 == 0) {
+            const size_t i = rng() % leaves.size();
+            return {Q(leaves[i]), references[i]};
+        }
+        auto [q, r] = random_query(rng, depth - 1);
+        const size_t terms = 1 + rng() % 3;
+        const auto op = static_cast<Q::Op>(1 + rng() % 4);
+        for (size_t t = 0; t < terms; ++t) {
+            auto [q2, r2] = random_query(rng, depth - 1);
+            r = apply(op, r, r2);
+            q = combine(op, std::move(q), std::move(q2));
+        }
+        return {std::move(q), std::move(r)};
+    }
+};
+}  // namespace
+
+TEST(QueryTest, ChainsAreFlattened) {
+    Bitmap a, b, c;
+    EXPECT_EQ((Q(a) & b & c).kind(), Q::Op::And);
+    EXPECT_EQ((Q(a) - b - c).kind(), Q::Op::AndNot);
+    EXPECT_EQ(((Q(a) | b) & c).kind(), Q::Op::And);
+    EXPECT_EQ(Q(a).kind(), Q::Op::Leaf);
+}
+
+TEST(QueryTest, EstimatesBoundTheResult) {
+    Fixture f(1);
+    std::mt19937_64 rng(2);
+    for (int i = 0; i < 300; ++i) {
+        auto [q, expected] = f.random_query(rng, 3);
+        EXPECT_GE(q.estimate(), expected.size());
+    }
+}
+
+TEST(QueryTest, EvaluateMatchesSetAlgebra) {
+    for (uint64_t seed = 0; seed < 4; ++seed) {
+        Fixture f(seed);
+        std::mt19937_64 rng(seed + 100);
+        for (int i = 0; i < 300; ++i) {
+            auto [q, expected] = f.random_query(rng, 3);
+            EXPECT_EQ(to_set(q.evaluate()), expected);
+            EXPECT_EQ(q.is_empty(), expected.empty());
+        }
+    }
+}
+
+TEST(QueryTest, LeavesAreNotModified) {
+    Fixture f(7);
+    const Q q = ((Q(f.leaves[4]) | f.leaves[5]) & (Q(f.leaves[6]) - f.leaves[3])) ^ f.leaves[7];
+    Bitmap result = q.evaluate();
+    result.set(5000);
+    Bitmap leaf = q.evaluate();
+    leaf = Q(f.leaves[4]).evaluate();
+    leaf.set(5001);
+    for (size_t i = 0; i < f.leaves.size(); ++i) {
+        EXPECT_EQ(to_set(f.leaves[i]), f.references[i]);
+    }
+}
+
+TEST(QueryTest, IsEmptyOnDisjointLeaves) {
+    Bitmap evens, odds, all;
+    for (uint64_t v = 0; v < 4096; ++v) {
+        (v % 2 ? odds : evens).set(v);
+        all.set(v);
+    }
+    EXPECT_TRUE((Q(evens) & odds).is_empty());
+    EXPECT_TRUE((Q(evens) & all & odds).is_empty());
+    EXPECT_FALSE((Q(evens) & all).is_empty());
+    EXPECT_TRUE((Q(all) - evens - odds).is_empty());
+    EXPECT_FALSE((Q(all) - evens).is_empty());
+    EXPECT_TRUE((Q(evens) ^ evens).is_empty());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
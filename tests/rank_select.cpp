@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Set = std::set<uint64_t>;
+
+template <typename Container>
+void check_container(const Container& c, const Set& s, size_t universe) {
+    std::vector<uint64_t> sorted(s.begin(), s.end());
+    size_t expected_rank = 0;
+    for (size_t v = 0; v < universe; ++v) {
+        expected_rank += s.count(v);
+        EXPECT_EQ(c.rank(v), expected_rank) << "value " << v;
+    }
+    for (size_t k = 0; k < sorted.size(); ++k) {
+        EXPECT_EQ(c.select(k), sorted[k]) << "k " << k;
+    }
+}
+
+Set random_set(std::mt19937& rng, size_t universe) {
+    Set s;
+    switch (rng() % 3) {
+        case 0:
+            for (size_t i = rng() % 30; i > 0; --i) s.insert(rng() % universe);
+            break;
+        case 1:
+            for (size_t v = 0; v < universe; ++v)
+                if (rng() % 3) s.insert(v);
+            break;
+        default:
+            for (size_t i = rng() % 8; i > 0; --i) {
+                size_t start = rng() % universe;
+                for (size_t v = start; v < std::min(start + rng() % 100, universe); ++v) s.insert(v);
+            }
+    }
+    return s;
+}
+}  // namespace
+
+TEST(RankSelectTest, ContainerKernels) {
+    std::mt19937 rng(17);
+    for (int round = 0; round < 50; ++round) {
+        SCOPED_TRACE(testing::Message() << "round " << round);
+        Set s = random_set(rng, 1 << 10);
+        ArrayContainer<uint64_t, 10> array;
+        BitmapContainer<uint64_t, 10> bitmap;
+        RLEContainer<uint64_t, 10> rle;
+        for (auto v : s) {
+            array.set(v);
+            bitmap.set(v);
+            rle.set(v);
+        }
+        check_container(array, s, 1 << 10);
+        check_container(bitmap, s, 1 << 10);
+        check_container(rle, s, 1 << 10);
+        // Ranks in the upper half of a bitmap fall back to popcounting when the cached cardinality is stale
+        bitmap.invalidate_cardinality();
+        check_container(bitmap, s, 1 << 10);
+    }
+}
+
+TEST(RankSelectTest, BitmapWithMutations) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    std::mt19937 rng(4242);
+    Bitmap bitmap;
+    Set reference;
+    for (int round = 0; round < 3000; ++round) {
+        uint64_t val = rng() % 5000;
+        if (rng() % 4 == 0) {
+            bitmap.reset(val);
+            reference.erase(val);
+        } else {
+            bitmap.set(val);
+            reference.insert(val);
+        }
+        // Interleave queries with mutations so that the prefix sums are rebuilt many times
+        uint64_t probe = rng() % 5200;
+        size_t expected_rank = std::distance(reference.begin(), reference.upper_bound(probe));
+        EXPECT_EQ(bitmap.rank(probe), expected_rank);
+        size_t k = rng() % (reference.size() + 2);
+        uint64_t selected = ~0ULL;
+        EXPECT_EQ(bitmap.select(k, selected), k < reference.size());
+        if (k < reference.size()) {
+            EXPECT_EQ(selected, *std::next(reference.begin(), k));
+        }
+    }
+    uint64_t lo = 1000, hi = 3000;
+    EXPECT_EQ(bitmap.range_cardinality(lo, hi),
+              static_cast<size_t>(std::distance(reference.lower_bound(lo), reference.upper_bound(hi))));
+    EXPECT_EQ(bitmap.range_cardinality(hi, lo), 0);
+}
+
+TEST(RankSelectTest, AfterSetOperations) {
+    using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+    std::mt19937 rng(9);
+    for (int round = 0; round < 100; ++round) {
+        Set sa = random_set(rng, 2000), sb = random_set(rng, 2000);
+        Bitmap a, b;
+        for (auto v : sa) a.set(v);
+        for (auto v : sb) b.set(v);
+        a.rank(0);  // build the prefix sums before mutating in-place
+
+        Set expected;
+        switch (round % 3) {
+            case 0:
+                a |= b;
+                expected = sa;
+                expected.insert(sb.begin(), sb.end());
+                break;
+            case 1:
+                a -= b;
+                for (auto v : sa)
+                    if (!sb.count(v)) expected.insert(v);
+                break;
+            default:
+                a &= b;
+                for (auto v : sa)
+                    if (sb.count(v)) expected.insert(v);
+        }
+        size_t k = 0;
+        for (auto v : expected) {
+            uint64_t selected = 0;
+            ASSERT_TRUE(a.select(k, selected));
+            EXPECT_EQ(selected, v);
+            EXPECT_EQ(a.rank(v), ++k);
+        }
+        EXPECT_EQ(a.rank(4000), expected.size());
+        EXPECT_EQ(a.range_cardinality(0, 4000), expected.size());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "rcu_froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Rcu = RcuFlexibleRoaring<uint64_t, 16, 8, 8>;
+using Bitmap = Rcu::Bitmap;
+}  // namespace
+
+TEST(RcuTest, ReadSectionKeepsItsVersion) {
+    Rcu rcu;
+    auto reader = rcu.reader();
+    rcu.update([](Bitmap& b) {
+        for (uint64_t v = 0; v < 1000; v += 2) b.set(v);
+    });
+    {
+        auto before = reader.read();
+        rcu.update([](Bitmap& b) {
+            b.set(1);
+            b.reset(0);
+        });
+        EXPECT_TRUE(before->test(0));
+        EXPECT_FALSE(before->test(1));
+        EXPECT_EQ(before->count(), 500);
+    }
+    auto after = reader.read();
+    EXPECT_FALSE(after->test(0));
+    EXPECT_TRUE(after->test(1));
+    EXPECT_EQ((*after).count(), 500);
+}
+
+TEST(RcuTest, ReplacedVersionsWaitForReaders) {
+    Rcu rcu;
+    auto reader = rcu.reader();
+    rcu.update([](Bitmap& b) { b.set(1); });
+    EXPECT_EQ(rcu.try_reclaim(), 0);
+    {
+        auto guard = reader.read();
+        rcu.update([](Bitmap& b) { b.set(2); });
+        rcu.publish(Bitmap());
+        EXPECT_EQ(rcu.try_reclaim(), 2);
+        EXPECT_TRUE(guard->test(1));
+        EXPECT_FALSE(guard->test(2));
+    }
+    rcu.synchronize();
+    EXPECT_EQ(rcu.try_reclaim(), 0);
+    EXPECT_EQ(reader.read()->count(), 0);
+}
+
+TEST(RcuTest, ReaderSlotsAreRecycled) {
+    Rcu rcu;
+    for (int round = 0; round < 3; ++round) {
+        std::vector<Rcu::Reader> readers;
+        for (int i = 0; i < 8; ++i) readers.push_back(rcu.reader());
+    }
+    auto reader = rcu.reader();
+    EXPECT_EQ(reader.read()->count(), 0);
+}
+
+// Version n holds exactly [0, 64 * n): every read section must observe one complete version.
+TEST(RcuTest, ConcurrentReadersSeeWholeVersions) {
+    constexpr uint64_t Step = 64;
+    constexpr uint64_t Versions = 300;
+    Rcu rcu;
+    Bitmap probe;
+    probe.set(Step * Versions - 1);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> readers;
+    std::vector<int> failures(4);
+    for (size_t t = 0; t < failures.size(); ++t) {
+        readers.emplace_back([&, t] {
+            auto reader = rcu.reader();
+            uint64_t last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                auto version = reader.read();
+                const uint64_t n = version->count();
+                uint64_t sum = 0;
+                for (auto it = version->begin(); it != version->end(); ++it) sum += *it;
+                const bool whole = n % Step == 0 && n >= last && sum == (n ? n * (n - 1) / 2 : 0) &&
+                                   (n == 0 || version->test(n - 1)) && !version->test(n) &&
+                                   version->intersects(probe) == (n == Step * Versions);
+                failures[t] += !whole;
+                last = n;
+            }
+        });
+    }
+    for (uint64_t n = 1; n <= Versions; ++n) {
+        rcu.update([n](Bitmap& b) {
+            for (uint64_t v = Step * (n - 1); v < Step * n; ++v) b.set(v);
+        });
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& r : readers) r.join();
+    for (auto f : failures) EXPECT_EQ(f, 0);
+    rcu.synchronize();
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
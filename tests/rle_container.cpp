@@ -94,6 +94,22 @@ TEST_F(RLEContainerTest, AlternativelySetTest) {
     EXPECT_EQ(container->run_count, 1);
 }
 
+TEST(RLEContainerCapacityTest, ZeroCapacityGrows) {
+    RLEContainer<uint64_t, 8> empty(0);
+    empty.set(7);
+    empty.set(3);
+    EXPECT_TRUE(empty.test(3));
+    EXPECT_TRUE(empty.test(7));
+    EXPECT_EQ(empty.cardinality(), 2);
+
+    RLEContainer<uint64_t, 8> source(0);
+    RLEContainer<uint64_t, 8> copy(source);
+    for (uint64_t i = 0; i < 20; i += 2) {
+        copy.set(i);
+    }
+    EXPECT_EQ(copy.cardinality(), 10);
+}
+
 }  // namespace froaring
 
 int main(int argc, char** argv) {
@@ -0,0 +1,131 @@
+// Run the optimizing post-pass after every set operation in this file.
+#define FROARING_SET_OP_POST_PASS (FROARING_POST_PASS_RUN_OPTIMIZE | FROARING_POST_PASS_SHRINK_TO_FIT)
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Set = std::set<uint64_t>;
+
+Set random_set(std::mt19937& rng) {
+    Set s;
+    // A few blocks, each of them sparse, dense or made of runs
+    for (size_t blocks = rng() % 4; blocks > 0; --blocks) {
+        uint64_t base = (rng() % 6) << 8;
+        switch (rng() % 3) {
+            case 0:
+                for (size_t i = rng() % 10; i > 0; --i) s.insert(base + rng() % 256);
+                break;
+            case 1:
+                for (size_t v = 0; v < 256; ++v)
+                    if (rng() % 3) s.insert(base + v);
+                break;
+            default: {
+                size_t start = rng() % 256;
+                size_t len = rng() % 200;
+                for (size_t v = start; v < std::min(start + len, size_t(256)); ++v) s.insert(base + v);
+            }
+        }
+    }
+    return s;
+}
+
+Bitmap make_bitmap(const Set& s) {
+    Bitmap b;
+    for (auto v : s) b.set(v);
+    return b;
+}
+
+void expect_same(const Bitmap& b, const Set& s) {
+    EXPECT_EQ(b.count(), s.size());
+    for (uint64_t v = 0; v < (6 << 8); ++v) {
+        EXPECT_EQ(b.test(v), s.count(v) == 1) << "value " << v;
+    }
+}
+}  // namespace
+
+TEST(RunOptimizeTest, SingleContainerPicksRuns) {
+    Bitmap b;
+    for (uint64_t v = 10; v < 200; ++v) b.set(v);
+    EXPECT_NE(b.handle.type, CTy::RLE);
+    b.run_optimize();
+    EXPECT_EQ(b.handle.type, CTy::RLE);
+    EXPECT_EQ((static_cast<RLEContainer<uint64_t, 8>*>(b.handle.ptr)->run_count), 1);
+    EXPECT_EQ(b.count(), 190);
+}
+
+TEST(RunOptimizeTest, IndexDropsEmptyAndCollapses) {
+    Bitmap b;
+    b.set(1);
+    b.set(1000);
+    EXPECT_EQ(b.handle.type, CTy::Containers);
+    b.reset(1000);
+    b.run_optimize();
+    EXPECT_NE(b.handle.type, CTy::Containers);
+    EXPECT_TRUE(b.test(1));
+    EXPECT_EQ(b.count(), 1);
+}
+
+TEST(RunOptimizeTest, ShrinkToFitKeepsContent) {
+    Bitmap b;
+    for (uint64_t v = 0; v < 20; ++v) b.set(v * 300);
+    b.shrink_to_fit();
+    for (uint64_t v = 0; v < 20; ++v) EXPECT_TRUE(b.test(v * 300));
+    b.set(7);
+    EXPECT_TRUE(b.test(7));
+    EXPECT_EQ(b.count(), 21);
+}
+
+TEST(RunOptimizeTest, MemoryUsageShrinksWithOptimizations) {
+    Bitmap b;
+    EXPECT_EQ(b.memory_usage(), sizeof(Bitmap));
+    for (uint64_t v = 0; v < 2000; ++v) b.set(v);
+    const size_t before = b.memory_usage();
+    EXPECT_GT(before, sizeof(Bitmap));
+    b.run_optimize();
+    EXPECT_LT(b.memory_usage(), before);
+    const size_t optimized = b.memory_usage();
+    b.shrink_to_fit();
+    EXPECT_LE(b.memory_usage(), optimized);
+}
+
+TEST(RunOptimizeTest, RandomSetOperationsWithPostPass) {
+    std::mt19937 rng(31337);
+    for (int round = 0; round < 200; ++round) {
+        SCOPED_TRACE(testing::Message() << "round " << round);
+        Set sa = random_set(rng), sb = random_set(rng);
+        Bitmap a = make_bitmap(sa), b = make_bitmap(sb);
+
+        Set expected_and, expected_or = sa, expected_diff;
+        for (auto v : sa) (sb.count(v) ? expected_and : expected_diff).insert(v);
+        expected_or.insert(sb.begin(), sb.end());
+
+        expect_same(a & b, expected_and);
+        expect_same(a | b, expected_or);
+        expect_same(a - b, expected_diff);
+        EXPECT_EQ(a.intersects(b), !expected_and.empty());
+        EXPECT_EQ((a | b) == make_bitmap(expected_or), true);
+
+        Bitmap c = make_bitmap(sa);
+        c &= b;
+        expect_same(c, expected_and);
+        c = make_bitmap(sa);
+        c |= b;
+        expect_same(c, expected_or);
+        c = make_bitmap(sa);
+        c -= b;
+        expect_same(c, expected_diff);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+// Build the whole file with the Eytzinger index search, so the lazily rebuilt shadow keys are exercised as well.
+#define FROARING_SEARCH_MODE FROARING_SEARCH_EYTZINGER
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+TEST(SearchTest, BranchlessLowerBoundMatchesStd) {
+    std::mt19937 rng(42);
+    for (size_t n = 0; n < 70; ++n) {
+        std::vector<uint16_t> vals(n);
+        for (auto& v : vals) v = rng() % 200;
+        std::sort(vals.begin(), vals.end());
+        for (uint16_t key = 0; key < 210; ++key) {
+            size_t expected = std::lower_bound(vals.begin(), vals.end(), key) - vals.begin();
+            EXPECT_EQ(branchless_lower_bound(vals.data(), n, key, [](uint16_t v) { return v; }), expected);
+        }
+    }
+}
+
+TEST(SearchTest, EytzingerLowerBoundMatchesStd) {
+    std::mt19937 rng(7);
+    for (size_t n = 0; n < 70; ++n) {
+        std::set<uint16_t> uniq;
+        while (uniq.size() < n) uniq.insert(rng() % 500);
+        std::vector<uint16_t> vals(uniq.begin(), uniq.end());
+        EytzingerLayout<uint16_t, size_t> layout;
+        EXPECT_TRUE(layout.stale());
+        layout.rebuild(vals.data(), n, [](uint16_t v) { return v; });
+        EXPECT_FALSE(layout.stale());
+        for (uint16_t key = 0; key < 510; ++key) {
+            size_t expected = std::lower_bound(vals.begin(), vals.end(), key) - vals.begin();
+            EXPECT_EQ(layout.lower_bound(key), expected);
+        }
+    }
+}
+
+TEST(SearchTest, ArrayContainerLowerBound) {
+    ArrayContainer<uint64_t, 16> array;
+    for (uint16_t i = 0; i < 100; ++i) array.set(i * 3);
+    for (uint16_t i = 0; i < 300; ++i) {
+        EXPECT_EQ(array.lower_bound(i), (i + 2) / 3);
+        EXPECT_EQ(array.test(i), i % 3 == 0);
+    }
+}
+
+TEST(SearchTest, RLEContainerSearch) {
+    RLEContainer<uint64_t, 16> rle;
+    for (uint16_t i = 0; i < 50; ++i) {
+        rle.set(i * 10);
+        rle.set(i * 10 + 1);
+    }
+    EXPECT_EQ(rle.run_count, 50);
+    for (uint16_t i = 0; i < 500; ++i) {
+        EXPECT_EQ(rle.test(i), i % 10 < 2);
+    }
+}
+
+TEST(SearchTest, IndexShadowRebuiltAfterMutation) {
+    FlexibleRoaring<uint64_t, 16, 8> bitmap;
+    std::set<uint64_t> reference;
+    std::mt19937 rng(1234);
+    for (int round = 0; round < 2000; ++round) {
+        uint64_t val = rng() % (1 << 20);
+        if (rng() % 3 == 0 && !reference.empty()) {
+            auto victim = *reference.lower_bound(val % (*reference.rbegin() + 1));
+            bitmap.reset(victim);
+            reference.erase(victim);
+        } else {
+            bitmap.set(val);
+            reference.insert(val);
+        }
+        // Interleave queries with mutations so the shadow goes stale and gets rebuilt many times.
+        uint64_t probe = rng() % (1 << 20);
+        EXPECT_EQ(bitmap.test(probe), reference.count(probe) == 1);
+    }
+    for (auto val : reference) {
+        EXPECT_TRUE(bitmap.test(val));
+    }
+    EXPECT_EQ(bitmap.count(), reference.size());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,231 @@
+// Count allocations to check that snapshots copy handles, not containers.
+#define FROARING_INSTRUMENT 1
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+using Set = std::set<uint64_t>;
+
+Set random_set(std::mt19937& rng, size_t blocks) {
+    Set s;
+    for (size_t block = 0; block < blocks; ++block) {
+        uint64_t base = block << 8;
+        switch (rng() % 3) {
+            case 0:  // array
+                for (size_t i = 1 + rng() % 10; i > 0; --i) s.insert(base + rng() % 256);
+                break;
+            case 1:  // bitmap
+                for (size_t v = 0; v < 256; ++v)
+                    if (rng() % 3) s.insert(base + v);
+                break;
+            default:  // runs
+                for (size_t v = rng() % 64; v < 200; ++v) s.insert(base + v);
+        }
+    }
+    return s;
+}
+
+Bitmap make_bitmap(const Set& s) {
+    Bitmap b;
+    for (auto v : s) b.set(v);
+    b.run_optimize();
+    return b;
+}
+
+void expect_equal(const Bitmap& b, const Set& s) {
+    EXPECT_EQ(b.count(), s.size());
+    std::vector<uint64_t> values;
+    for (auto it = b.begin(); it != b.end(); ++it) values.push_back(*it);
+    EXPECT_EQ(values, std::vector<uint64_t>(s.begin(), s.end()));
+}
+}  // namespace
+
+TEST(SnapshotTest, EmptyAndSingleContainer) {
+    Bitmap empty;
+    expect_equal(empty.snapshot(), {});
+
+    Bitmap single;
+    for (uint64_t v = 0; v < 100; v += 3) single.set(v);
+    Bitmap snap = single.snapshot();
+    single.set(1);
+    single.reset(0);
+    EXPECT_TRUE(snap.test(0));
+    EXPECT_FALSE(snap.test(1));
+    EXPECT_EQ(snap.count(), 34);
+    EXPECT_TRUE(single.test(1));
+    EXPECT_FALSE(single.test(0));
+}
+
+TEST(SnapshotTest, PointUpdatesOnEitherSide) {
+    std::mt19937 rng(38);
+    for (int round = 0; round < 50; ++round) {
+        Set s = random_set(rng, 1 + rng() % 6);
+        Bitmap source = make_bitmap(s);
+        Bitmap snap = source.snapshot();
+        expect_equal(snap, s);
+
+        Set source_set = s, snap_set = s;
+        for (int i = 0; i < 200; ++i) {
+            uint64_t v = rng() % (7 << 8);
+            bool on_source = rng() % 2;
+            Bitmap& target = on_source ? source : snap;
+            Set& target_set = on_source ? source_set : snap_set;
+            switch (rng() % 3) {
+                case 0:
+                    target.set(v);
+                    target_set.insert(v);
+                    break;
+                case 1:
+                    EXPECT_EQ(target.test_and_set(v), target_set.insert(v).second);
+                    break;
+                default:
+                    target.reset(v);
+                    target_set.erase(v);
+            }
+        }
+        expect_equal(source, source_set);
+        expect_equal(snap, snap_set);
+    }
+}
+
+TEST(SnapshotTest, InplaceSetOperationsLeaveSnapshotIntact) {
+    std::mt19937 rng(380);
+    for (int round = 0; round < 50; ++round) {
+        for (int op = 0; op < 3; ++op) {
+            Set s = random_set(rng, 1 + rng() % 6);
+            Set other_set = random_set(rng, 1 + rng() % 6);
+            Bitmap source = make_bitmap(s);
+            Bitmap other = make_bitmap(other_set);
+            Bitmap snap = source.snapshot();
+            Bitmap other_snap = other.snapshot();
+
+            Set expected;
+            if (op == 0) {
+                source &= other;
+                for (auto v : s)
+                    if (other_set.count(v)) expected.insert(v);
+            } else if (op == 1) {
+                source |= other;
+                expected = s;
+                expected.insert(other_set.begin(), other_set.end());
+            } else {
+                source -= other;
+                for (auto v : s)
+                    if (!other_set.count(v)) expected.insert(v);
+            }
+            expect_equal(source, expected);
+            expect_equal(snap, s);
+            expect_equal(other, other_set);
+            expect_equal(other_snap, other_set);
+        }
+    }
+}
+
+TEST(SnapshotTest, SnapshotAsOperand) {
+    Bitmap a;
+    for (uint64_t v = 0; v < 2000; v += 7) a.set(v);
+    Set expected;
+    for (uint64_t v = 0; v < 2000; v += 7) expected.insert(v);
+    Bitmap snap = a.snapshot();
+    a |= snap;
+    a &= snap;
+    expect_equal(a, expected);
+    a -= snap;
+    expect_equal(a, {});
+    expect_equal(snap, expected);
+}
+
+TEST(SnapshotTest, OnlyTouchedContainersAreCloned) {
+    Bitmap source;
+    for (uint64_t block = 0; block < 8; ++block) {
+        for (uint64_t v = 0; v < 4; ++v) source.set((block << 8) + v);
+    }
+
+    instrument::reset();
+    Bitmap snap = source.snapshot();
+    EXPECT_EQ(instrument::snapshot().event(instrument::Event::Alloc), 1);  // the index layer only
+
+    instrument::reset();
+    source.set((3 << 8) + 100);
+    source.set((3 << 8) + 101);
+    EXPECT_EQ(instrument::snapshot().event(instrument::Event::Alloc), 1);  // one private copy of container 3
+
+    EXPECT_TRUE(source.test((3 << 8) + 100));
+    EXPECT_FALSE(snap.test((3 << 8) + 100));
+    EXPECT_EQ(snap.count(), 32);
+    EXPECT_EQ(source.count(), 34);
+}
+
+TEST(SnapshotTest, ChainedSnapshotsAndAnyDestructionOrder) {
+    Set s;
+    for (uint64_t v = 0; v < 3000; v += 5) s.insert(v);
+    auto source = std::make_unique<Bitmap>(make_bitmap(s));
+    auto first = std::make_unique<Bitmap>(source->snapshot());
+    auto second = std::make_unique<Bitmap>(first->snapshot());
+    source.reset();
+    first->set(1);
+    expect_equal(*second, s);
+    second.reset();
+    EXPECT_TRUE(first->test(1));
+    EXPECT_EQ(first->count(), s.size() + 1);
+}
+
+TEST(SnapshotTest, ReadersRunAlongsideTheWriter) {
+    Set s;
+    for (uint64_t v = 0; v < 20000; v += 3) s.insert(v);
+    Bitmap source = make_bitmap(s);
+    Bitmap snap = source.snapshot();
+
+    std::vector<std::thread> readers;
+    std::vector<size_t> seen(4);
+    for (size_t t = 0; t < seen.size(); ++t) {
+        readers.emplace_back([&, t] {
+            for (uint64_t v = 0; v < 20000; ++v) seen[t] += snap.test(v);
+        });
+    }
+    for (uint64_t v = 0; v < 20000; ++v) {
+        if (v % 3) {
+            source.set(v);
+        } else {
+            source.reset(v);
+        }
+    }
+    for (auto& r : readers) r.join();
+    for (auto n : seen) EXPECT_EQ(n, s.size());
+    EXPECT_EQ(source.count(), 20000 - s.size());
+}
+
+TEST(SnapshotTest, ReadersShareOneSnapshot) {
+    std::mt19937 rng(7);
+    const Set s = random_set(rng, 300);
+    Bitmap source = make_bitmap(s);
+    const Bitmap snap = source.snapshot();
+
+    // Only const queries, from several threads at once: with the caches warmed, none of them writes
+    std::vector<std::thread> readers;
+    std::vector<size_t> mismatches(4);
+    for (size_t t = 0; t < mismatches.size(); ++t) {
+        readers.emplace_back([&, t] {
+            mismatches[t] += snap.count() != s.size();
+            for (uint64_t v = t; v < (300 << 8); v += 5) mismatches[t] += snap.test(v) != s.count(v);
+        });
+    }
+    for (auto& r : readers) r.join();
+    for (auto n : mismatches) EXPECT_EQ(n, 0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "froaring.h"
+
+using namespace froaring;
+
+namespace {
+template <typename Bitmap, typename WordType>
+void expect_matches_test(const Bitmap& b, const std::vector<WordType>& queries) {
+    std::vector<uint8_t> out(queries.size(), 0xAA);
+    b.test_many(queries, out.data());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_EQ(out[i], b.test(queries[i]) ? 1 : 0) << "query " << queries[i];
+    }
+}
+
+/// Random bitmaps mixing array, bitmap and run containers, probed by unsorted, sorted and clustered batches.
+template <typename WordType, size_t IndexBits, size_t DataBits>
+void check_random(uint32_t seed) {
+    using Bitmap = FlexibleRoaring<WordType, IndexBits, DataBits>;
+    constexpr uint64_t Block = uint64_t(1) << DataBits;
+    constexpr uint64_t Blocks = std::min<uint64_t>(40, (uint64_t(1) << IndexBits) - 1);
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 20; ++round) {
+        Bitmap b;
+        for (size_t block = rng() % 12; block > 0; --block) {
+            const uint64_t base = (rng() % Blocks) * Block;
+            switch (rng() % 3) {
+                case 0:
+                    for (int i = 0; i < 5; ++i) b.set(base + rng() % Block);
+                    break;
+                case 1:
+                    for (uint64_t v = 0; v < Block; ++v)
+                        if (rng() % 2) b.set(base + v);
+                    break;
+                default:
+                    for (uint64_t v = rng() % (Block / 2); v < Block; ++v) b.set(base + v);
+            }
+        }
+        b.run_optimize();
+
+        std::vector<WordType> queries(1024);
+        for (auto& q : queries) q = rng() % (Blocks * Block);
+        expect_matches_test(b, queries);
+        std::sort(queries.begin(), queries.end());
+        expect_matches_test(b, queries);
+        for (size_t i = 0; i < queries.size(); ++i) queries[i] = (i / 64 * 3 % Blocks) * Block + rng() % Block;
+        expect_matches_test(b, queries);
+    }
+}
+}  // namespace
+
+TEST(TestManyTest, EmptyBatchAndEmptyBitmap) {
+    FlexibleRoaring<uint64_t, 16, 8> b;
+    uint8_t out[3] = {7, 7, 7};
+    b.test_many({}, out);
+    EXPECT_EQ(out[0], 7);
+    const uint64_t queries[] = {0, 1, 1000};
+    b.test_many(queries, out);
+    EXPECT_EQ(out[0] + out[1] + out[2], 0);
+}
+
+TEST(TestManyTest, SingleContainer) {
+    FlexibleRoaring<uint64_t, 16, 8> b;
+    for (uint64_t v = 512; v < 768; v += 3) b.set(v);
+    std::vector<uint64_t> queries;
+    for (uint64_t v = 0; v < 1024; ++v) queries.push_back(v * 7 % 1024);
+    expect_matches_test(b, queries);
+    for (uint64_t v = 512; v < 768; ++v) b.set(v);  // now a run container
+    b.run_optimize();
+    expect_matches_test(b, queries);
+}
+
+TEST(TestManyTest, MatchesTest) {
+    check_random<uint64_t, 16, 8>(40);
+    check_random<uint64_t, 8, 16>(41);
+    check_random<uint32_t, 16, 16>(42);
+    check_random<uint32_t, 20, 10>(43);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <ranges>
+#include <vector>
+
+#include "views.h"
+
+using namespace froaring;
+
+namespace {
+using Bitmap = FlexibleRoaring<uint64_t, 16, 8>;
+
+static_assert(std::ranges::input_range<decltype(views::intersect(std::declval<Bitmap&>(), std::declval<Bitmap&>()))>);
+
+std::vector<uint64_t> values(const Bitmap& b) {
+    std::vector<uint64_t> out;
+    for (auto it = b.begin(); it != b.end(); ++it) out.push_back(*it);
+    return out;
+}
+
+template <typename View>
+std::vector<uint64_t> values(const View& view) {
+    std::vector<uint64_t> out;
+    for (auto v : view) out.push_back(v);
+    return out;
+}
+
+/// Operands mixing array, bitmap and run containers, with keys in common and keys of their own.
+std::vector<Bitmap> make_operands(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<Bitmap> operands(4);
+    for (auto& b : operands) {
+        for (uint64_t key = 0; key < 16; ++key) {
+            const uint64_t kind = rng() % 4;
+            for (uint64_t v = 0; v < 256 && kind != 0; ++v) {
+                const bool set = kind == 1 ? rng() % 50 == 0 : kind == 2 ? rng() % 2 == 0 : (v / 40) % 2 == 0;
+                if (set) b.set(key * 256 + v);
+            }
+        }
+        b.run_optimize();
+    }
+    return operands;
+}
+}  // namespace
+
+TEST(ViewsTest, MatchEagerOperators) {
+    for (uint64_t seed = 0; seed < 20; ++seed) {
+        const auto o = make_operands(seed);
+        EXPECT_EQ(values(views::intersect(o[0], o[1])), values(o[0] & o[1]));
+        EXPECT_EQ(values(views::intersect(o[0], o[1], o[2])), values(o[0] & o[1] & o[2]));
+        EXPECT_EQ(values(views::unite(o[0], o[1], o[2], o[3])), values(o[0] | o[1] | o[2] | o[3]));
+        EXPECT_EQ(values(views::subtract(o[0], o[1])), values(o[0] - o[1]));
+        EXPECT_EQ(values(views::subtract(o[3], o[0], o[2])), values(o[3] - o[0] - o[2]));
+        EXPECT_EQ(values(views::unite(lazy(o[0]) & o[1], o[2] - lazy(o[3]))), values((o[0] & o[1]) | (o[2] - o[3])));
+        EXPECT_EQ(values(views::intersect(o[2])), values(o[2]));
+    }
+}
+
+TEST(ViewsTest, EmptyOperands) {
+    Bitmap empty, b;
+    b.set(7);
+    EXPECT_TRUE(views::intersect(empty, b).empty());
+    EXPECT_TRUE(views::subtract(b, b).empty());
+    EXPECT_EQ(values(views::unite(empty, b)), std::vector<uint64_t>{7});
+}
+
+TEST(ViewsTest, StopsEarlyWithTake) {
+    const auto o = make_operands(3);
+    const auto all = values(o[0] | o[1]);
+    std::vector<uint64_t> first;
+    for (auto v : views::unite(o[0], o[1]) | std::views::take(10)) first.push_back(v);
+    ASSERT_EQ(first.size(), std::min<size_t>(10, all.size()));
+    EXPECT_TRUE(std::equal(first.begin(), first.end(), all.begin()));
+}
+
+TEST(ViewsTest, IteratorWalksEveryContainerType) {
+    Bitmap b;
+    for (uint64_t v = 250; v < 256; ++v) b.set(v);                // a run ending at the container boundary
+    for (uint64_t v = 256; v < 512; v += 2) b.set(v);             // bitmap
+    for (uint64_t v : {1024, 1100, 1279}) b.set(v);               // array
+    for (uint64_t v = 2048 + 255; v < 2048 + 256; ++v) b.set(v);  // the last value of a container
+    b.run_optimize();
+    std::vector<uint64_t> expected;
+    for (uint64_t v = 0; v < 4096; ++v) {
+        if (b.test(v)) expected.push_back(v);
+    }
+    EXPECT_EQ(values(b), expected);
+    EXPECT_EQ(values(views::intersect(b)), expected);
+}
+
+TEST(ViewsTest, IteratorsOfWideContainersAreSmall) {
+    using Wide = FlexibleRoaring<uint64_t, 8, 20>;
+    Wide a, b;
+    for (uint64_t v = 0; v < (uint64_t(3) << 20); v += 1000) a.set(v);
+    for (uint64_t v = 0; v < (uint64_t(3) << 20); v += 1500) b.set(v);
+    auto view = views::intersect(a, b);
+    static_assert(sizeof(decltype(view.begin())) < 256, "an iterator must not hold a whole container");
+
+    auto it = view.begin();
+    auto copy = it;  // shares the decoded container
+    EXPECT_EQ(*copy, 0);
+    size_t n = 0;
+    for (uint64_t expected = 0; it != view.end(); ++it, expected += 3000) {
+        ASSERT_EQ(*it, expected);
+        ++n;
+    }
+    EXPECT_EQ(n, (a & b).count());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}